@@ -0,0 +1,57 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// buffer_access_strategy.cpp
+//
+// Identification: src/buffer/buffer_access_strategy.cpp
+//
+// Copyright (c) 2015-2019, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include "buffer/buffer_access_strategy.h"
+
+namespace bustub {
+
+BufferAccessStrategy::BufferAccessStrategy(AccessStrategyType type, size_t num_instances, size_t ring_size)
+    : type_(type), ring_size_(ring_size), rings_(num_instances) {
+  BUSTUB_ASSERT(ring_size_ > 0, "A ring needs at least one frame.");
+  for (auto &ring : rings_) {
+    ring.slots_.resize(ring_size_);
+  }
+}
+
+BufferAccessStrategy::~BufferAccessStrategy() {
+  closing_ = true;
+  // A prefetch notices closing_ between pages, so this waits for at most one page read per request.
+  std::unique_lock<std::mutex> latch(pending_latch_);
+  pending_cv_.wait(latch, [this] { return pending_prefetches_ == 0; });
+}
+
+void BufferAccessStrategy::AddPendingPrefetch() {
+  std::lock_guard<std::mutex> guard(pending_latch_);
+  pending_prefetches_++;
+}
+
+void BufferAccessStrategy::FinishPendingPrefetch() {
+  // The destructor may run as soon as the count is zero, so the signal is sent while the latch is still held.
+  std::lock_guard<std::mutex> guard(pending_latch_);
+  if (--pending_prefetches_ == 0) {
+    pending_cv_.notify_all();
+  }
+}
+
+BufferAccessStrategy::RingSlot *BufferAccessStrategy::NextSlot(size_t shard_index) {
+  Ring &ring = rings_[shard_index];
+  ring.current_ = (ring.current_ + 1) % ring_size_;
+  return &ring.slots_[ring.current_];
+}
+
+void BufferAccessStrategy::SetCurrentSlot(size_t shard_index, frame_id_t frame_id, page_id_t page_id) {
+  Ring &ring = rings_[shard_index];
+  ring.slots_[ring.current_].frame_id_ = frame_id;
+  ring.slots_[ring.current_].page_id_ = page_id;
+}
+
+}  // namespace bustub
@@ -12,31 +12,455 @@
 
 #include "buffer/buffer_pool_manager.h"
 
+#include "common/logger.h"
 #include "storage/page/table_page.h"
 
+#include <algorithm>
+#include <cinttypes>
 #include <list>
+#include <thread>  // NOLINT
 #include <unordered_map>
+#include <vector>
 
 namespace bustub {
 
-BufferPoolManager::BufferPoolManager(size_t pool_size, DiskManager *disk_manager, LogManager *log_manager)
-    : pool_size_(pool_size), disk_manager_(disk_manager), log_manager_(log_manager) {
+BufferPoolManager::BufferPoolManager(size_t pool_size, DiskManager *disk_manager, LogManager *log_manager,
+                                     size_t num_instances, ReplacerPolicy replacer_policy)
+    : pool_size_(pool_size),
+      num_instances_(num_instances),
+      replacer_policy_(replacer_policy),
+      disk_manager_(disk_manager),
+      log_manager_(log_manager) {
+  BUSTUB_ASSERT(num_instances_ > 0 && num_instances_ <= pool_size_, "Every shard needs at least one frame.");
   // We allocate a consecutive memory space for the buffer pool.
   pages_ = new Page[pool_size_];
-  replacer_ = new ClockReplacer(pool_size);
 
-  // Initially, every page is in the free list.
-  for (size_t i = 0; i < pool_size_; ++i) {
-    free_list_.push_back(i);
+  // Hand out the frames to the shards, spreading the remainder over the first few.
+  size_t next_frame = 0;
+  for (size_t i = 0; i < num_instances_; ++i) {
+    size_t shard_size = pool_size_ / num_instances_ + (i < pool_size_ % num_instances_ ? 1 : 0);
+    shards_.emplace_back(std::make_unique<Shard>(pages_ + next_frame, shard_size, replacer_policy_));
+    next_frame += shard_size;
   }
 }
 
 BufferPoolManager::~BufferPoolManager() {
+  StopPrefetcher();
+  StopBackgroundWriter();
+  shards_.clear();
   delete[] pages_;
-  delete replacer_;
 }
 
-Page *BufferPoolManager::FetchPageImpl(page_id_t page_id) {
+void BufferPoolManager::RunBackgroundWriter(size_t clean_target, std::chrono::milliseconds interval) {
+  if (!bg_writer_running_) {
+    bg_writer_running_ = true;
+    bg_writer_start_ = std::chrono::steady_clock::now();
+    bg_writer_thread_ = new std::thread(&BufferPoolManager::BackgroundWriterLoop, this, clean_target, interval);
+  }
+}
+
+void BufferPoolManager::StopBackgroundWriter() {
+  if (bg_writer_running_) {
+    {
+      std::lock_guard<std::mutex> guard(bg_writer_latch_);
+      bg_writer_running_ = false;
+    }
+    bg_writer_cv_.notify_all();
+    bg_writer_thread_->join();
+    delete bg_writer_thread_;
+    bg_writer_thread_ = nullptr;
+    bg_writer_stop_ = std::chrono::steady_clock::now();
+    BackgroundWriterStats stats = GetBackgroundWriterStats();
+    LOG_INFO("Background writer wrote %" PRIu64 " pages (%.0f pages/s), saving %" PRIu64
+             " foreground writes; %" PRIu64 " evictions still wrote in the foreground.",
+             stats.pages_written_, stats.flush_rate_, stats.stalls_avoided_, stats.foreground_writes_);
+  }
+}
+
+BackgroundWriterStats BufferPoolManager::GetBackgroundWriterStats() {
+  BackgroundWriterStats stats;
+  stats.pages_written_ = bg_pages_written_;
+  stats.stalls_avoided_ = stalls_avoided_;
+  stats.foreground_writes_ = foreground_writes_;
+  if (bg_writer_start_ != std::chrono::steady_clock::time_point()) {
+    auto end = bg_writer_running_ ? std::chrono::steady_clock::now() : bg_writer_stop_;
+    std::chrono::duration<double> elapsed = end - bg_writer_start_;
+    if (elapsed.count() > 0) {
+      stats.flush_rate_ = static_cast<double>(stats.pages_written_) / elapsed.count();
+    }
+  }
+  return stats;
+}
+
+void BufferPoolManager::BackgroundWriterLoop(size_t clean_target, std::chrono::milliseconds interval) {
+  while (bg_writer_running_) {
+    size_t written = 0;
+    for (auto &shard : shards_) {
+      written += CleanShard(shard.get(), std::min(clean_target, shard->pool_size_));
+    }
+    // Keep going while there is work; otherwise sleep until the next round or a foreground write.
+    if (written == 0) {
+      std::unique_lock<std::mutex> lock(bg_writer_latch_);
+      if (bg_writer_running_) {
+        bg_writer_cv_.wait_for(lock, interval);
+      }
+    }
+  }
+}
+
+size_t BufferPoolManager::CleanShard(Shard *shard, size_t clean_target) {
+  std::vector<std::pair<frame_id_t, page_id_t>> dirty_frames;
+  {
+    std::lock_guard<std::mutex> guard(shard->latch_);
+    size_t clean = shard->free_list_.size();
+    if (clean >= clean_target) {
+      return 0;
+    }
+    // Pinned frames stay in the replacer, so look further ahead than the target.
+    std::vector<frame_id_t> upcoming;
+    shard->replacer_->UpcomingVictims(2 * clean_target, &upcoming);
+    for (frame_id_t frame_id : upcoming) {
+      Page *page = &shard->pages_[frame_id];
+      if (clean >= clean_target) {
+        break;
+      }
+      if (page->pin_count_ > 0 || shard->io_in_progress_[frame_id]) {
+        continue;
+      }
+      if (page->is_dirty_) {
+        dirty_frames.emplace_back(frame_id, page->page_id_);
+      }
+      clean++;
+    }
+  }
+
+  size_t written = 0;
+  for (auto &dirty_frame : dirty_frames) {
+    frame_id_t frame_id = dirty_frame.first;
+    page_id_t page_id = dirty_frame.second;
+    Page *page = &shard->pages_[frame_id];
+    std::unique_lock<std::mutex> latch(shard->latch_);
+    // The frame may have been reclaimed or be in use again since we looked.
+    if (page->page_id_ != page_id || page->pin_count_ > 0 || !page->is_dirty_) {
+      continue;
+    }
+    // Unlike a foreground write, the writer does not wait for the log. It nudges the log and tries again later.
+    if (enable_logging && page->GetLSN() > log_manager_->GetPersistentLSN()) {
+      log_manager_->GetCv().notify_one();
+      continue;
+    }
+    // Pin the page so that it stays put while we write it out without the latch, like FlushPageImpl.
+    page->pin_count_++;
+    MarkClean(page);
+    latch.unlock();
+    page->RLatch();
+    WritePageData(page_id, page->data_);
+    page->RUnlatch();
+    shard->cleaned_[frame_id] = true;
+    page->pin_count_--;
+    written++;
+  }
+  bg_pages_written_ += written;
+  return written;
+}
+
+void BufferPoolManager::PrefetchPages(const std::vector<page_id_t> &page_ids, BufferAccessStrategy *strategy) {
+  if (page_ids.empty()) {
+    return;
+  }
+  PrefetchRequest request;
+  request.page_ids_ = page_ids;
+  request.count_ = page_ids.size();
+  request.strategy_ = strategy;
+  EnqueuePrefetch(std::move(request));
+}
+
+void BufferPoolManager::PrefetchChain(page_id_t first_page_id, size_t count,
+                                      std::function<page_id_t(Page *)> next_page_id, BufferAccessStrategy *strategy) {
+  if (first_page_id == INVALID_PAGE_ID || count == 0) {
+    return;
+  }
+  PrefetchRequest request;
+  request.page_ids_.push_back(first_page_id);
+  request.count_ = count;
+  request.next_page_id_ = std::move(next_page_id);
+  request.strategy_ = strategy;
+  EnqueuePrefetch(std::move(request));
+}
+
+void BufferPoolManager::WaitForPrefetches() {
+  std::unique_lock<std::mutex> lock(prefetch_latch_);
+  prefetch_cv_.wait(lock, [&] { return !prefetch_running_ || (prefetch_queue_.empty() && prefetch_busy_ == 0); });
+}
+
+void BufferPoolManager::EnqueuePrefetch(PrefetchRequest &&request) {
+  {
+    std::lock_guard<std::mutex> guard(prefetch_latch_);
+    if (prefetch_queue_.size() >= PREFETCH_QUEUE_DEPTH) {
+      return;
+    }
+    if (prefetch_threads_.empty()) {
+      prefetch_running_ = true;
+      for (size_t i = 0; i < PREFETCH_WORKERS; i++) {
+        prefetch_threads_.emplace_back(&BufferPoolManager::PrefetchLoop, this);
+      }
+    }
+    // A list is split into a contiguous part for each prefetcher.
+    size_t parts = request.next_page_id_ ? 1 : std::min(request.count_, PREFETCH_WORKERS);
+    for (size_t part = 0; part < parts; part++) {
+      PrefetchRequest part_request;
+      if (parts == 1) {
+        part_request = std::move(request);
+      } else {
+        part_request.page_ids_.assign(request.page_ids_.begin() + request.count_ * part / parts,
+                                      request.page_ids_.begin() + request.count_ * (part + 1) / parts);
+        part_request.count_ = part_request.page_ids_.size();
+        part_request.strategy_ = request.strategy_;
+      }
+      if (part_request.strategy_ != nullptr) {
+        part_request.strategy_->AddPendingPrefetch();
+      }
+      prefetch_queue_.emplace_back(std::move(part_request));
+    }
+  }
+  prefetch_cv_.notify_all();
+}
+
+void BufferPoolManager::StopPrefetcher() {
+  {
+    std::lock_guard<std::mutex> guard(prefetch_latch_);
+    if (prefetch_threads_.empty()) {
+      return;
+    }
+    prefetch_running_ = false;
+  }
+  prefetch_cv_.notify_all();
+  for (auto &thread : prefetch_threads_) {
+    thread.join();
+  }
+  prefetch_threads_.clear();
+  for (auto &request : prefetch_queue_) {
+    if (request.strategy_ != nullptr) {
+      request.strategy_->FinishPendingPrefetch();
+    }
+  }
+  prefetch_queue_.clear();
+}
+
+void BufferPoolManager::PrefetchLoop() {
+  std::unique_lock<std::mutex> lock(prefetch_latch_);
+  while (true) {
+    prefetch_cv_.wait(lock, [&] { return !prefetch_running_ || !prefetch_queue_.empty(); });
+    if (!prefetch_running_) {
+      break;
+    }
+    PrefetchRequest request = std::move(prefetch_queue_.front());
+    prefetch_queue_.pop_front();
+    prefetch_busy_++;
+    lock.unlock();
+    RunPrefetch(request);
+    if (request.strategy_ != nullptr) {
+      request.strategy_->FinishPendingPrefetch();
+    }
+    lock.lock();
+    prefetch_busy_--;
+    prefetch_cv_.notify_all();
+  }
+  // Wake up anyone still waiting for the requests that are about to be dropped.
+  prefetch_cv_.notify_all();
+}
+
+void BufferPoolManager::RunPrefetch(const PrefetchRequest &request) {
+  page_id_t page_id = request.page_ids_[0];
+  for (size_t i = 0; i < request.count_ && page_id != INVALID_PAGE_ID; i++) {
+    if (request.strategy_ != nullptr && request.strategy_->closing_) {
+      return;
+    }
+    Page *page = FetchPageImpl(page_id, request.strategy_);
+    if (page == nullptr) {
+      // Every frame is pinned, so the pages would not stay around anyway.
+      return;
+    }
+    page_id_t next_page_id = INVALID_PAGE_ID;
+    if (request.next_page_id_) {
+      page->RLatch();
+      next_page_id = request.next_page_id_(page);
+      page->RUnlatch();
+    } else if (i + 1 < request.count_) {
+      next_page_id = request.page_ids_[i + 1];
+    }
+    UnpinPageImpl(page_id, false);
+    page_id = next_page_id;
+  }
+}
+
+std::unique_ptr<ExtentReservation> BufferPoolManager::GetExtentReservation(size_t extent_size) {
+  return std::make_unique<ExtentReservation>(disk_manager_, extent_size);
+}
+
+std::unique_ptr<BufferAccessStrategy> BufferPoolManager::GetAccessStrategy(AccessStrategyType type) {
+  size_t ring_size = type == AccessStrategyType::BULK_READ ? BULK_READ_RING_SIZE : BULK_WRITE_RING_SIZE;
+  ring_size = std::min(ring_size, pool_size_ / 8);
+  return std::make_unique<BufferAccessStrategy>(type, num_instances_,
+                                                std::max(ring_size / num_instances_, MIN_RING_SIZE));
+}
+
+bool BufferPoolManager::LockFrame(Page *page) {
+  int unpinned = 0;
+  return page->pin_count_.compare_exchange_strong(unpinned, FRAME_LOCKED);
+}
+
+void BufferPoolManager::UnlockFrame(Page *page, int pin_count) {
+  // Add rather than store, so that the pins of hits that are still backing off are not lost.
+  page->pin_count_.fetch_add(pin_count - FRAME_LOCKED);
+}
+
+bool BufferPoolManager::TryPinResident(Shard *shard, page_id_t page_id, frame_id_t frame_id) {
+  Page *page = &shard->pages_[frame_id];
+  // Read the LSN before pinning, so that it is no newer than any change made under this pin.
+  lsn_t pin_lsn = GetNextLSN();
+  int pin_count = page->pin_count_.fetch_add(1);
+  if (pin_count < 0) {
+    // The frame is being reclaimed.
+    page->pin_count_.fetch_sub(1);
+    return false;
+  }
+  // Our pin keeps the frame from being reclaimed from now on, but it may have been reclaimed before, or the page may
+  // still be on its way in.
+  if (page->page_id_ != page_id || shard->io_in_progress_[frame_id]) {
+    page->pin_count_.fetch_sub(1);
+    return false;
+  }
+  RecordHit(shard, frame_id);
+  if (pin_count == 0) {
+    page->pin_lsn_ = pin_lsn;
+  }
+  return true;
+}
+
+void BufferPoolManager::RecordHit(Shard *shard, frame_id_t frame_id) {
+  if (!shard->replacer_->RecordAccess(frame_id)) {
+    shard->accessed_[frame_id] = true;
+  }
+}
+
+bool BufferPoolManager::FindVictim(Shard *shard, frame_id_t *frame_id) {
+  std::vector<frame_id_t> pinned;
+  bool found = false;
+  size_t considered = 0;
+  while (!found && shard->replacer_->Victim(frame_id)) {
+    // Replacers that cannot take hits through RecordAccess only learn about them here. Until we have gone around the
+    // shard once, a frame that was hit since we last looked at it gets that reference recorded and another chance.
+    if (considered++ < shard->pool_size_ && shard->accessed_[*frame_id].exchange(false)) {
+      shard->replacer_->Pin(*frame_id);
+      shard->replacer_->Unpin(*frame_id);
+    } else if (LockFrame(&shard->pages_[*frame_id])) {
+      found = true;
+    } else {
+      pinned.push_back(*frame_id);
+    }
+  }
+  for (frame_id_t pinned_frame_id : pinned) {
+    shard->replacer_->Unpin(pinned_frame_id);
+  }
+  return found;
+}
+
+bool BufferPoolManager::TakeRingFrame(Shard *shard, size_t shard_index, BufferAccessStrategy *strategy,
+                                      frame_id_t *frame_id) {
+  BufferAccessStrategy::RingSlot *slot = strategy->NextSlot(shard_index);
+  if (slot->frame_id_ == -1) {
+    return false;
+  }
+  // Leave the frame alone if someone else loaded another page into it or is using it. A dirty frame is only ours to
+  // write back under a bulk write strategy; readers leave it to the shared pool.
+  Page *page = &shard->pages_[slot->frame_id_];
+  if (page->page_id_ != slot->page_id_ || (page->is_dirty_ && !strategy->ReusesDirtyFrames()) || !LockFrame(page)) {
+    return false;
+  }
+  *frame_id = slot->frame_id_;
+  return true;
+}
+
+bool BufferPoolManager::ClaimFrame(Shard *shard, page_id_t page_id, frame_id_t *frame_id,
+                                   page_id_t *victim_page_id, BufferAccessStrategy *strategy) {
+  *victim_page_id = INVALID_PAGE_ID;
+  size_t shard_index = GetShardIndex(page_id);
+  if (strategy != nullptr && TakeRingFrame(shard, shard_index, strategy, frame_id)) {
+    EvictFrame(shard, *frame_id, victim_page_id);
+  } else if (!shard->free_list_.empty()) {
+    *frame_id = shard->free_list_.front();
+    shard->free_list_.pop_front();
+    // Only hits with a stale page table entry touch a free frame, and they back off right away.
+    while (!LockFrame(&shard->pages_[*frame_id])) {
+      std::this_thread::yield();
+    }
+  } else if (FindVictim(shard, frame_id)) {
+    EvictFrame(shard, *frame_id, victim_page_id);
+  } else {
+    return false;
+  }
+  if (strategy != nullptr) {
+    strategy->SetCurrentSlot(shard_index, *frame_id, page_id);
+  }
+  // Forget the history of the old page and record the reference to the new one. The frame stays out of the replacer
+  // until its I/O is done.
+  shard->replacer_->Remove(*frame_id);
+  shard->replacer_->Pin(*frame_id);
+  shard->accessed_[*frame_id] = false;
+  shard->cleaned_[*frame_id] = false;
+  // Mark the I/O before publishing the frame, so that hits on the new page wait for it.
+  shard->io_in_progress_[*frame_id] = true;
+  Page *page = &shard->pages_[*frame_id];
+  page->page_id_ = page_id;
+  MarkClean(page);
+  page->pin_lsn_ = GetNextLSN();
+  shard->page_table_.Insert(page_id, *frame_id);
+  UnlockFrame(page, 1);
+  return true;
+}
+
+void BufferPoolManager::EvictFrame(Shard *shard, frame_id_t frame_id, page_id_t *victim_page_id) {
+  Page *victim = &shard->pages_[frame_id];
+  shard->page_table_.Remove(victim->page_id_);
+  if (victim->is_dirty_) {
+    // Until the write-back is done, requesters of the victim must not read its stale image from disk.
+    *victim_page_id = victim->page_id_;
+    shard->evicting_[victim->page_id_] = frame_id;
+    // The background writer fell behind.
+    foreground_writes_++;
+    if (bg_writer_running_) {
+      bg_writer_cv_.notify_one();
+    }
+  } else if (shard->cleaned_[frame_id]) {
+    stalls_avoided_++;
+  }
+}
+
+void BufferPoolManager::WriteBackVictim(Shard *shard, frame_id_t frame_id, page_id_t victim_page_id) {
+  WritePageData(victim_page_id, shard->pages_[frame_id].data_);
+  std::lock_guard<std::mutex> guard(shard->latch_);
+  shard->evicting_.erase(victim_page_id);
+  shard->io_cv_[frame_id].notify_all();
+}
+
+void BufferPoolManager::FinishIO(Shard *shard, frame_id_t frame_id) {
+  shard->io_in_progress_[frame_id] = false;
+  shard->io_cv_[frame_id].notify_all();
+  // Resident frames stay in the replacer whether they are pinned or not; eviction checks the pin count.
+  shard->replacer_->Unpin(frame_id);
+}
+
+void BufferPoolManager::WritePageData(page_id_t page_id, const char *page_data) {
+  // WAL: the log records up to the page LSN must be on disk before the page itself.
+  lsn_t page_lsn = *reinterpret_cast<const lsn_t *>(page_data + Page::OFFSET_LSN);
+  if (enable_logging && page_lsn > log_manager_->GetPersistentLSN()) {
+    log_manager_->WaitForFlush(page_lsn);
+  }
+  disk_manager_->WritePage(page_id, page_data);
+}
+
+Page *BufferPoolManager::FetchPageImpl(page_id_t page_id, BufferAccessStrategy *strategy) {
   // 1.     Search the page table for the requested page (P).
   // 1.1    If P exists, pin it and return it immediately.
   // 1.2    If P does not exist, find a replacement page (R) from either the free list or the replacer.
@@ -44,53 +468,74 @@ Page *BufferPoolManager::FetchPageImpl(page_id_t page_id) {
   // 2.     If R is dirty, write it back to the disk.
   // 3.     Delete R from the page table and insert P.
   // 4.     Update P's metadata, read in the page content from disk, and then return a pointer to P.
-  latch_.lock();
-  auto iter = page_table_.find(page_id);
+  Shard *shard = GetShard(page_id);
   frame_id_t frame_id;
-  if (iter != page_table_.end()) {
-    frame_id = iter->second;
-    replacer_->Pin(frame_id);
-    pages_[frame_id].pin_count_++;
-    latch_.unlock();
-    return &pages_[frame_id];
-  }
-  if (!free_list_.empty()) {
-    frame_id = free_list_.front();
-    free_list_.pop_front();
-    goto update;
-  }
-  if (replacer_->Victim(&frame_id)) {
-    if (pages_[frame_id].is_dirty_) {
-      FlushPage(pages_[frame_id].page_id_);
-    }
-    page_table_.erase(pages_[frame_id].page_id_);
-  } else {
-    latch_.unlock();
+  if (shard->page_table_.Find(page_id, &frame_id) && TryPinResident(shard, page_id, frame_id)) {
+    return &shard->pages_[frame_id];
+  }
+
+  // The page is not resident, is on its way in, or the table was changing under us. Retry under the latch.
+  std::unique_lock<std::mutex> latch(shard->latch_);
+  while (true) {
+    if (shard->page_table_.Find(page_id, &frame_id)) {
+      // Under the latch, nobody is reclaiming a frame, so a plain increment pins it.
+      shard->pages_[frame_id].pin_count_++;
+      RecordHit(shard, frame_id);
+      // The page may still be on its way in; our pin keeps the frame from being reclaimed meanwhile.
+      shard->io_cv_[frame_id].wait(latch, [shard, frame_id] { return !shard->io_in_progress_[frame_id]; });
+      return &shard->pages_[frame_id];
+    }
+    auto evicting = shard->evicting_.find(page_id);
+    if (evicting == shard->evicting_.end()) {
+      break;
+    }
+    // P was just evicted and is still being written back. Wait for that before reading it from disk.
+    shard->io_cv_[evicting->second].wait(latch);
+  }
+
+  page_id_t victim_page_id;
+  if (!ClaimFrame(shard, page_id, &frame_id, &victim_page_id, strategy)) {
     return nullptr;
   }
-update:
-  pages_[frame_id].page_id_ = page_id;
-  pages_[frame_id].pin_count_ = 1;
-  disk_manager_->ReadPage(page_id, pages_[frame_id].data_);
-  page_table_[page_id] = frame_id;
-  latch_.unlock();
-  return &pages_[frame_id];
+  Page *page = &shard->pages_[frame_id];
+  latch.unlock();
+  if (victim_page_id != INVALID_PAGE_ID) {
+    WriteBackVictim(shard, frame_id, victim_page_id);
+  }
+  disk_manager_->ReadPage(page_id, page->data_);
+  latch.lock();
+  FinishIO(shard, frame_id);
+  return page;
 }
 
 bool BufferPoolManager::UnpinPageImpl(page_id_t page_id, bool is_dirty) {
-  latch_.lock();
+  Shard *shard = GetShard(page_id);
   frame_id_t frame_id;
-  auto iter = page_table_.find(page_id);
-  if (iter == page_table_.end() || pages_[frame_id = iter->second].pin_count_ <= 0) {
-    latch_.unlock();
-    return false;
+  if (!shard->page_table_.Find(page_id, &frame_id)) {
+    // The miss may be spurious; only the latch makes it certain.
+    std::lock_guard<std::mutex> guard(shard->latch_);
+    if (!shard->page_table_.Find(page_id, &frame_id)) {
+      return false;
+    }
   }
-  pages_[frame_id].is_dirty_ = pages_[frame_id].is_dirty_ || is_dirty;
-  pages_[frame_id].pin_count_--;
-  if (pages_[frame_id].pin_count_ == 0) {
-    replacer_->Unpin(frame_id);
+  // The caller's pin keeps the page in its frame, so no latch is needed from here on.
+  Page *page = &shard->pages_[frame_id];
+  if (page->page_id_ != page_id) {
+    return false;
   }
-  latch_.unlock();
+  int pin_count = page->pin_count_;
+  do {
+    if (pin_count <= 0) {
+      return false;
+    }
+    // Mark the page dirty before dropping the pin, so that whoever evicts it sees the flag. The first change since
+    // the page was last written sets its recLSN.
+    if (is_dirty) {
+      lsn_t clean = INVALID_LSN;
+      page->rec_lsn_.compare_exchange_strong(clean, page->pin_lsn_);
+      page->is_dirty_ = true;
+    }
+  } while (!page->pin_count_.compare_exchange_weak(pin_count, pin_count - 1));
   return true;
 }
 
@@ -99,56 +544,67 @@ bool BufferPoolManager::FlushPageImpl(page_id_t page_id) {
   if (page_id == INVALID_PAGE_ID) {
     return false;
   }
+  Shard *shard = GetShard(page_id);
+  std::unique_lock<std::mutex> latch(shard->latch_);
   frame_id_t frame_id;
-  auto iter = page_table_.find(page_id);
-  if (iter == page_table_.end()) {
+  if (!shard->page_table_.Find(page_id, &frame_id)) {
     return false;
   }
-  frame_id = iter->second;
-
-
-  auto *table_page = reinterpret_cast<TablePage *>(pages_[frame_id].data_);
-  lsn_t page_lsn = table_page->GetLSN();
-  while (enable_logging && page_lsn > log_manager_->GetPersistentLSN()){
-    log_manager_->GetCv().notify_one();
-    std::this_thread::yield();
-  }
-
-  disk_manager_->WritePage(page_id, pages_[frame_id].data_);
-  pages_[frame_id].is_dirty_ = false;
+  // Pin the page so that it stays put while we write it out without the latch.
+  Page *page = &shard->pages_[frame_id];
+  page->pin_count_++;
+  shard->io_cv_[frame_id].wait(latch, [shard, frame_id] { return !shard->io_in_progress_[frame_id]; });
+  // Clear the flag first, so that a write racing with the flush marks the page dirty again. The page's read latch
+  // keeps writers from tearing the image while it is written.
+  MarkClean(page);
+  latch.unlock();
+  page->RLatch();
+  WritePageData(page_id, page->data_);
+  page->RUnlatch();
+  page->pin_count_--;
   return true;
 }
 
-Page *BufferPoolManager::NewPageImpl(page_id_t *page_id) {
+Page *BufferPoolManager::NewPageImpl(page_id_t *page_id, BufferAccessStrategy *strategy, ExtentReservation *extent) {
   // 0.   Make sure you call DiskManager::AllocatePage!
   // 1.   If all the pages in the buffer pool are pinned, return nullptr.
   // 2.   Pick a victim page P from either the free list or the replacer. Always pick from the free list first.
   // 3.   Update P's metadata, zero out memory and add P to the page table.
   // 4.   Set the page ID output parameter. Return a pointer to P.
-  latch_.lock();
-  frame_id_t frame_id;
-  if (!free_list_.empty()) {
-    frame_id = free_list_.front();
-    free_list_.pop_front();
-    goto update;
+  //
+  // The shard is only known once the page id is, so we allocate first. If the shard is full we try the next id,
+  // which usually lands in the next shard, and give back the ids we could not use. Ids from an extent go back to the
+  // reservation rather than the disk manager, so that they are handed out again and the extent has no holes.
+  std::vector<page_id_t> rejected;
+  Page *page = nullptr;
+  for (size_t attempt = 0; attempt < num_instances_ && page == nullptr; ++attempt) {
+    page_id_t new_page_id = extent != nullptr ? extent->AllocatePage() : disk_manager_->AllocatePage();
+    Shard *shard = GetShard(new_page_id);
+    std::unique_lock<std::mutex> latch(shard->latch_);
+    frame_id_t frame_id;
+    page_id_t victim_page_id;
+    if (!ClaimFrame(shard, new_page_id, &frame_id, &victim_page_id, strategy)) {
+      rejected.push_back(new_page_id);
+      continue;
+    }
+    page = &shard->pages_[frame_id];
+    if (victim_page_id != INVALID_PAGE_ID) {
+      latch.unlock();
+      WriteBackVictim(shard, frame_id, victim_page_id);
+      latch.lock();
+    }
+    page->ResetMemory();
+    FinishIO(shard, frame_id);
+    *page_id = new_page_id;
   }
-  if (replacer_->Victim(&frame_id)) {
-    if (pages_[frame_id].is_dirty_) {
-      FlushPage(pages_[frame_id].page_id_);
+  for (page_id_t rejected_page_id : rejected) {
+    if (extent != nullptr) {
+      extent->ReturnPage(rejected_page_id);
+    } else {
+      disk_manager_->DeallocatePage(rejected_page_id);
     }
-    page_table_.erase(pages_[frame_id].page_id_);
-  } else {
-    latch_.unlock();
-    return nullptr;
   }
-update:
-  *page_id = disk_manager_->AllocatePage();
-  pages_[frame_id].page_id_ = *page_id;
-  pages_[frame_id].pin_count_ = 1;
-  pages_[frame_id].ResetMemory();
-  page_table_[*page_id] = frame_id;
-  latch_.unlock();
-  return &pages_[frame_id];
+  return page;
 }
 
 bool BufferPoolManager::DeletePageImpl(page_id_t page_id) {
@@ -157,38 +613,71 @@ bool BufferPoolManager::DeletePageImpl(page_id_t page_id) {
   // 1.   If P does not exist, return true.
   // 2.   If P exists, but has a non-zero pin-count, return false. Someone is using the page.
   // 3.   Otherwise, P can be deleted. Remove P from the page table, reset its metadata and return it to the free list.
-  latch_.lock();
-  auto iter = page_table_.find(page_id);
-  if (iter == page_table_.end()) {
-    latch_.unlock();
-    return true;
-  }
-  frame_id_t frame_id = iter->second;
-  if (pages_[frame_id].pin_count_ > 0) {
-    latch_.unlock();
+  Shard *shard = GetShard(page_id);
+  std::unique_lock<std::mutex> latch(shard->latch_);
+  frame_id_t frame_id;
+  while (!shard->page_table_.Find(page_id, &frame_id)) {
+    auto evicting = shard->evicting_.find(page_id);
+    if (evicting == shard->evicting_.end()) {
+      latch.unlock();
+      disk_manager_->DeallocatePage(page_id);
+      return true;
+    }
+    // The page is still being written back. Let that land before the page can be handed out again.
+    shard->io_cv_[evicting->second].wait(latch);
+  }
+  Page *page = &shard->pages_[frame_id];
+  // Frames doing I/O are pinned, so this also keeps us away from them.
+  if (!LockFrame(page)) {
     return false;
   }
-  replacer_->Pin(frame_id);
-  page_table_.erase(iter);
-  pages_[frame_id].page_id_ = INVALID_PAGE_ID;
-  pages_[frame_id].is_dirty_ = false;
-  pages_[frame_id].pin_count_ = 0;
-  pages_[frame_id].ResetMemory();
-  free_list_.push_back(frame_id);
+  shard->replacer_->Remove(frame_id);
+  shard->page_table_.Remove(page_id);
+  page->page_id_ = INVALID_PAGE_ID;
+  MarkClean(page);
+  page->ResetMemory();
+  UnlockFrame(page, 0);
+  shard->free_list_.push_back(frame_id);
+  latch.unlock();
   disk_manager_->DeallocatePage(page_id);
-  latch_.unlock();
   return true;
 }
 
+std::vector<std::pair<page_id_t, lsn_t>> BufferPoolManager::GetDirtyPageTable() {
+  std::vector<std::pair<page_id_t, lsn_t>> dirty_pages;
+  for (auto &shard : shards_) {
+    // The latch keeps frames from changing hands while we look at them.
+    std::lock_guard<std::mutex> guard(shard->latch_);
+    for (size_t i = 0; i < shard->pool_size_; ++i) {
+      Page *page = &shard->pages_[i];
+      lsn_t rec_lsn = page->rec_lsn_;
+      // A pinned page may have a change that is logged but not marked dirty yet.
+      if (rec_lsn == INVALID_LSN && page->pin_count_ > 0) {
+        rec_lsn = page->pin_lsn_;
+      }
+      if (page->page_id_ != INVALID_PAGE_ID && rec_lsn != INVALID_LSN) {
+        dirty_pages.emplace_back(page->page_id_, rec_lsn);
+      }
+    }
+  }
+  return dirty_pages;
+}
+
 void BufferPoolManager::FlushAllPagesImpl() {
-  // You can do it!
-  latch_.lock();
-  for (auto &iter : page_table_) {
-    if (pages_[iter.second].is_dirty_) {
-      FlushPage(iter.first);
+  for (auto &shard : shards_) {
+    std::vector<page_id_t> dirty_pages;
+    {
+      std::lock_guard<std::mutex> guard(shard->latch_);
+      for (size_t i = 0; i < shard->pool_size_; ++i) {
+        if (shard->pages_[i].page_id_ != INVALID_PAGE_ID && shard->pages_[i].is_dirty_) {
+          dirty_pages.push_back(shard->pages_[i].page_id_);
+        }
+      }
+    }
+    for (page_id_t page_id : dirty_pages) {
+      BufferPoolManager::FlushPageImpl(page_id);
     }
   }
-  latch_.unlock();
 }
 
 }  // namespace bustub
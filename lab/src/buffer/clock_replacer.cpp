@@ -71,6 +71,21 @@ void ClockReplacer::Unpin(frame_id_t frame_id) {
   latch_.unlock();
 }
 
+void ClockReplacer::UpcomingVictims(size_t count, std::vector<frame_id_t> *frame_ids) {
+  frame_ids->clear();
+  latch_.lock();
+  // The hand takes the unreferenced frames on its first sweep and the referenced ones, now cleared, on its second.
+  for (size_t pass = 0; pass < 2; ++pass) {
+    for (size_t i = 0; i < num_frames && frame_ids->size() < count; ++i) {
+      size_t frame = (clock_hand + i) % num_frames;
+      if (!frame_pin[frame] && frame_refs[frame] == (pass == 1)) {
+        frame_ids->push_back(frame);
+      }
+    }
+  }
+  latch_.unlock();
+}
+
 size_t ClockReplacer::Size() {
   return replace_size;
 }
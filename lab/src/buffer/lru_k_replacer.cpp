@@ -0,0 +1,172 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// lru_k_replacer.cpp
+//
+// Identification: src/buffer/lru_k_replacer.cpp
+//
+// Copyright (c) 2015-2019, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include "buffer/lru_k_replacer.h"
+
+#include <algorithm>
+#include <utility>
+
+#include "common/macros.h"
+
+namespace bustub {
+
+LRUKReplacer::LRUKReplacer(size_t num_pages, size_t k, size_t correlated_reference_period)
+    : k_(k),
+      correlated_reference_period_(correlated_reference_period),
+      frames_(num_pages),
+      num_accesses_(num_pages),
+      access_times_(num_pages * k) {
+  BUSTUB_ASSERT(k_ > 0, "LRU-K needs at least one reference per frame.");
+}
+
+LRUKReplacer::~LRUKReplacer() = default;
+
+bool LRUKReplacer::Victim(frame_id_t *frame_id) {
+  std::lock_guard<std::mutex> guard(latch_);
+  if (num_evictable_ == 0) {
+    return false;
+  }
+  frame_id_t victim = -1;
+  std::tuple<bool, bool, uint64_t> victim_key;
+  for (size_t i = 0; i < frames_.size(); ++i) {
+    if (!frames_[i].evictable_) {
+      continue;
+    }
+    MergeAccesses(i);
+    auto key = EvictionKey(i);
+    if (victim == -1 || key < victim_key) {
+      victim = i;
+      victim_key = key;
+    }
+  }
+  // The history is kept until the frame is removed, in case the caller puts the victim back.
+  *frame_id = victim;
+  frames_[victim].evictable_ = false;
+  num_evictable_--;
+  return true;
+}
+
+void LRUKReplacer::Pin(frame_id_t frame_id) {
+  std::lock_guard<std::mutex> guard(latch_);
+  FrameHistory &frame = frames_[frame_id];
+  if (frame.evictable_) {
+    frame.evictable_ = false;
+    num_evictable_--;
+  }
+  MergeAccesses(frame_id);
+  RecordReference(frame_id, ++current_time_);
+}
+
+void LRUKReplacer::Unpin(frame_id_t frame_id) {
+  std::lock_guard<std::mutex> guard(latch_);
+  FrameHistory &frame = frames_[frame_id];
+  if (!frame.evictable_) {
+    frame.evictable_ = true;
+    num_evictable_++;
+  }
+}
+
+bool LRUKReplacer::RecordAccess(frame_id_t frame_id) {
+  uint64_t now = ++current_time_;
+  uint64_t slot = num_accesses_[frame_id].fetch_add(1);
+  // A merge that runs before the store reads the slot's previous time, which is older than the frame's history and
+  // gets skipped, so a racing reference can be missed but never recorded twice.
+  access_times_[frame_id * k_ + slot % k_].store(now);
+  return true;
+}
+
+void LRUKReplacer::Remove(frame_id_t frame_id) {
+  std::lock_guard<std::mutex> guard(latch_);
+  if (frames_[frame_id].evictable_) {
+    num_evictable_--;
+  }
+  frames_[frame_id] = FrameHistory();
+  frames_[frame_id].merged_accesses_ = num_accesses_[frame_id].load();
+}
+
+void LRUKReplacer::UpcomingVictims(size_t count, std::vector<frame_id_t> *frame_ids) {
+  std::lock_guard<std::mutex> guard(latch_);
+  std::vector<std::pair<std::tuple<bool, bool, uint64_t>, frame_id_t>> candidates;
+  for (size_t i = 0; i < frames_.size(); ++i) {
+    if (frames_[i].evictable_) {
+      MergeAccesses(i);
+      candidates.emplace_back(EvictionKey(i), i);
+    }
+  }
+  count = std::min(count, candidates.size());
+  std::partial_sort(candidates.begin(), candidates.begin() + count, candidates.end());
+  frame_ids->clear();
+  for (size_t i = 0; i < count; ++i) {
+    frame_ids->push_back(candidates[i].second);
+  }
+}
+
+size_t LRUKReplacer::Size() {
+  std::lock_guard<std::mutex> guard(latch_);
+  return num_evictable_;
+}
+
+std::tuple<bool, bool, uint64_t> LRUKReplacer::EvictionKey(frame_id_t frame_id) const {
+  const FrameHistory &frame = frames_[frame_id];
+  // Frames still inside their correlated reference period are only taken when nothing else is evictable.
+  bool correlated = current_time_ - frame.last_reference_ <= correlated_reference_period_;
+  bool finite = frame.history_.size() >= k_;
+  // Infinite distances are ordered by their last reference, finite ones by their K-th most recent reference.
+  return {correlated, finite, finite ? frame.history_.back() : frame.last_reference_};
+}
+
+void LRUKReplacer::RecordReference(frame_id_t frame_id, uint64_t now) {
+  FrameHistory &frame = frames_[frame_id];
+  if (frame.history_.empty()) {
+    frame.history_.push_front(now);
+    frame.last_reference_ = now;
+    return;
+  }
+  if (now - frame.last_reference_ <= correlated_reference_period_) {
+    // A correlated reference, e.g. the same transaction touching the page again. It does not count.
+    frame.last_reference_ = now;
+    return;
+  }
+  // Close the correlated period: shift the older references by its length so that the burst counts as one reference.
+  uint64_t correlated_period = frame.last_reference_ - frame.history_.front();
+  for (auto &time : frame.history_) {
+    time += correlated_period;
+  }
+  frame.history_.push_front(now);
+  if (frame.history_.size() > k_) {
+    frame.history_.pop_back();
+  }
+  frame.last_reference_ = now;
+}
+
+void LRUKReplacer::MergeAccesses(frame_id_t frame_id) {
+  FrameHistory &frame = frames_[frame_id];
+  uint64_t num_accesses = num_accesses_[frame_id].load();
+  if (num_accesses == frame.merged_accesses_) {
+    return;
+  }
+  // Only the last K references can be in the history afterwards, and those are the ones the ring still holds.
+  std::vector<uint64_t> times;
+  for (uint64_t slot = std::max(frame.merged_accesses_, num_accesses - std::min<uint64_t>(num_accesses, k_));
+       slot < num_accesses; ++slot) {
+    times.push_back(access_times_[frame_id * k_ + slot % k_].load());
+  }
+  std::sort(times.begin(), times.end());
+  for (uint64_t time : times) {
+    if (time > frame.last_reference_) {
+      RecordReference(frame_id, time);
+    }
+  }
+  frame.merged_accesses_ = num_accesses;
+}
+
+}  // namespace bustub
@@ -0,0 +1,93 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// page_table.cpp
+//
+// Identification: src/buffer/page_table.cpp
+//
+// Copyright (c) 2015-2019, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include "buffer/page_table.h"
+
+namespace bustub {
+
+PageTable::PageTable(size_t max_entries) {
+  // Keep the load factor at or below one half, so that probes stay short.
+  size_t num_slots = 2;
+  shift_ = 63;
+  while (num_slots < 2 * max_entries) {
+    num_slots *= 2;
+    shift_--;
+  }
+  mask_ = num_slots - 1;
+  slots_ = std::make_unique<std::atomic<uint64_t>[]>(num_slots);
+  for (size_t i = 0; i < num_slots; ++i) {
+    slots_[i].store(EMPTY_SLOT);
+  }
+}
+
+bool PageTable::Find(page_id_t page_id, frame_id_t *frame_id) const {
+  size_t slot = HomeSlot(page_id);
+  for (size_t probes = 0; probes <= mask_; ++probes) {
+    uint64_t entry = slots_[slot].load();
+    if (entry == EMPTY_SLOT) {
+      return false;
+    }
+    if (EntryPageId(entry) == page_id) {
+      *frame_id = EntryFrameId(entry);
+      return true;
+    }
+    slot = (slot + 1) & mask_;
+  }
+  return false;
+}
+
+void PageTable::Insert(page_id_t page_id, frame_id_t frame_id) {
+  BUSTUB_ASSERT(page_id != INVALID_PAGE_ID, "Cannot map the invalid page.");
+  size_t slot = HomeSlot(page_id);
+  while (true) {
+    uint64_t entry = slots_[slot].load();
+    if (entry == EMPTY_SLOT || EntryPageId(entry) == page_id) {
+      slots_[slot].store(MakeEntry(page_id, frame_id));
+      return;
+    }
+    slot = (slot + 1) & mask_;
+  }
+}
+
+bool PageTable::Remove(page_id_t page_id) {
+  size_t hole = HomeSlot(page_id);
+  while (true) {
+    uint64_t entry = slots_[hole].load();
+    if (entry == EMPTY_SLOT) {
+      return false;
+    }
+    if (EntryPageId(entry) == page_id) {
+      break;
+    }
+    hole = (hole + 1) & mask_;
+  }
+  // Shift back every later entry of the cluster that may live in the hole, i.e. whose home slot is not between the
+  // hole and the entry. The entry is written to its new slot before its old slot is reused, so a concurrent lookup
+  // sees it at least once or misses it, but never finds another page's frame.
+  size_t slot = hole;
+  while (true) {
+    slot = (slot + 1) & mask_;
+    uint64_t entry = slots_[slot].load();
+    if (entry == EMPTY_SLOT) {
+      break;
+    }
+    size_t home = HomeSlot(EntryPageId(entry));
+    if (((slot - home) & mask_) >= ((slot - hole) & mask_)) {
+      slots_[hole].store(entry);
+      hole = slot;
+    }
+  }
+  slots_[hole].store(EMPTY_SLOT);
+  return true;
+}
+
+}  // namespace bustub
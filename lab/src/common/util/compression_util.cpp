@@ -0,0 +1,165 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// compression_util.cpp
+//
+// Identification: src/common/util/compression_util.cpp
+//
+// Copyright (c) 2015-2019, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include "common/util/compression_util.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+
+namespace bustub {
+
+namespace {
+
+constexpr size_t MIN_MATCH = 4;       // shortest match worth encoding
+constexpr size_t LAST_LITERALS = 5;   // the block always ends with this many literals
+constexpr size_t MATCH_LIMIT = 12;    // no match starts in the last this many bytes
+constexpr size_t MAX_OFFSET = 65535;  // farthest a match can look back
+constexpr size_t HASH_BITS = 12;
+
+inline uint32_t Read32(const uint8_t *p) {
+  uint32_t value;
+  memcpy(&value, p, sizeof(value));
+  return value;
+}
+
+inline size_t HashSequence(uint32_t sequence) { return (sequence * 2654435761U) >> (32 - HASH_BITS); }
+
+/** Write the part of a length that does not fit into its 4 bits of the token. */
+inline void WriteLength(size_t length, uint8_t **out) {
+  for (; length >= 255; length -= 255) {
+    *(*out)++ = 255;
+  }
+  *(*out)++ = static_cast<uint8_t>(length);
+}
+
+/** Read the part of a length that did not fit into its 4 bits of the token. */
+inline bool ReadLength(const uint8_t **in, const uint8_t *in_end, size_t *length) {
+  uint8_t byte;
+  do {
+    if (*in == in_end) {
+      return false;
+    }
+    byte = *(*in)++;
+    *length += byte;
+  } while (byte == 255);
+  return true;
+}
+
+/** Write a literal run and the match after it; a match_length of 0 ends the block. */
+bool WriteSequence(const uint8_t *literals, size_t literal_length, size_t offset, size_t match_length, uint8_t **out,
+                   const uint8_t *out_end) {
+  size_t worst_case = 1 + literal_length / 255 + 1 + literal_length + 2 + match_length / 255 + 1;
+  if (static_cast<size_t>(out_end - *out) < worst_case) {
+    return false;
+  }
+  uint8_t *token = (*out)++;
+  *token = static_cast<uint8_t>(std::min<size_t>(literal_length, 15) << 4);
+  if (literal_length >= 15) {
+    WriteLength(literal_length - 15, out);
+  }
+  memcpy(*out, literals, literal_length);
+  *out += literal_length;
+  if (match_length == 0) {
+    return true;
+  }
+  *(*out)++ = static_cast<uint8_t>(offset);
+  *(*out)++ = static_cast<uint8_t>(offset >> 8);
+  size_t length = match_length - MIN_MATCH;
+  *token |= static_cast<uint8_t>(std::min<size_t>(length, 15));
+  if (length >= 15) {
+    WriteLength(length - 15, out);
+  }
+  return true;
+}
+
+}  // namespace
+
+size_t CompressionUtil::Compress(const char *src, size_t size, char *dest, size_t capacity) {
+  const auto *in = reinterpret_cast<const uint8_t *>(src);
+  auto *out = reinterpret_cast<uint8_t *>(dest);
+  const uint8_t *out_end = out + capacity;
+  // positions of recent 4-byte sequences, plus one so that 0 means none
+  uint32_t table[1 << HASH_BITS] = {};
+  size_t anchor = 0;
+  size_t pos = 0;
+  while (size >= MATCH_LIMIT && pos + MATCH_LIMIT <= size) {
+    uint32_t sequence = Read32(in + pos);
+    size_t hash = HashSequence(sequence);
+    size_t candidate = table[hash];
+    table[hash] = static_cast<uint32_t>(pos + 1);
+    if (candidate == 0 || pos + 1 - candidate > MAX_OFFSET || Read32(in + candidate - 1) != sequence) {
+      pos++;
+      continue;
+    }
+    candidate--;
+    size_t length = MIN_MATCH;
+    while (pos + length < size - LAST_LITERALS && in[candidate + length] == in[pos + length]) {
+      length++;
+    }
+    if (!WriteSequence(in + anchor, pos - anchor, pos - candidate, length, &out, out_end)) {
+      return 0;
+    }
+    pos += length;
+    anchor = pos;
+  }
+  if (!WriteSequence(in + anchor, size - anchor, 0, 0, &out, out_end)) {
+    return 0;
+  }
+  return out - reinterpret_cast<uint8_t *>(dest);
+}
+
+bool CompressionUtil::Decompress(const char *src, size_t size, char *dest, size_t dest_size) {
+  const auto *in = reinterpret_cast<const uint8_t *>(src);
+  const uint8_t *in_end = in + size;
+  auto *out = reinterpret_cast<uint8_t *>(dest);
+  const uint8_t *out_end = out + dest_size;
+  while (in < in_end) {
+    uint8_t token = *in++;
+    size_t literal_length = token >> 4;
+    if (literal_length == 15 && !ReadLength(&in, in_end, &literal_length)) {
+      return false;
+    }
+    if (literal_length > static_cast<size_t>(in_end - in) || literal_length > static_cast<size_t>(out_end - out)) {
+      return false;
+    }
+    memcpy(out, in, literal_length);
+    in += literal_length;
+    out += literal_length;
+    // the last sequence has no match
+    if (in == in_end) {
+      break;
+    }
+    if (in_end - in < 2) {
+      return false;
+    }
+    size_t offset = in[0] | (in[1] << 8);
+    in += 2;
+    size_t match_length = token & 15;
+    if (match_length == 15 && !ReadLength(&in, in_end, &match_length)) {
+      return false;
+    }
+    match_length += MIN_MATCH;
+    if (offset == 0 || offset > static_cast<size_t>(out - reinterpret_cast<uint8_t *>(dest)) ||
+        match_length > static_cast<size_t>(out_end - out)) {
+      return false;
+    }
+    // byte by byte, since a match may overlap the bytes it produces
+    const uint8_t *match = out - offset;
+    for (size_t i = 0; i < match_length; i++) {
+      *out++ = *match++;
+    }
+  }
+  return out == out_end;
+}
+
+}  // namespace bustub
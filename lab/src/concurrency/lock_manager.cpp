@@ -12,55 +12,636 @@
 
 #include "concurrency/lock_manager.h"
 
+#include <algorithm>
+#include <unordered_set>
 #include <utility>
 #include <vector>
 
 namespace bustub {
 
 bool LockManager::LockShared(Transaction *txn, const RID &rid) {
+  if (!CanLock(txn)) {
+    return false;
+  }
+  if (txn->IsSharedLocked(rid) || txn->IsExclusiveLocked(rid)) {
+    return true;
+  }
+  if (!Acquire(txn, LockTarget{LockLevel::ROW, rid}, LockMode::SHARED, false)) {
+    return false;
+  }
   txn->GetSharedLockSet()->emplace(rid);
   return true;
 }
 
 bool LockManager::LockExclusive(Transaction *txn, const RID &rid) {
+  if (!CanLock(txn)) {
+    return false;
+  }
+  if (txn->IsExclusiveLocked(rid)) {
+    return true;
+  }
+  if (txn->IsSharedLocked(rid)) {
+    return LockUpgrade(txn, rid);
+  }
+  if (!Acquire(txn, LockTarget{LockLevel::ROW, rid}, LockMode::EXCLUSIVE, false)) {
+    return false;
+  }
   txn->GetExclusiveLockSet()->emplace(rid);
   return true;
 }
 
 bool LockManager::LockUpgrade(Transaction *txn, const RID &rid) {
+  if (!CanLock(txn)) {
+    return false;
+  }
+  if (txn->IsExclusiveLocked(rid)) {
+    return true;
+  }
+  if (!txn->IsSharedLocked(rid)) {
+    return false;
+  }
   txn->GetSharedLockSet()->erase(rid);
+  if (!Acquire(txn, LockTarget{LockLevel::ROW, rid}, LockMode::EXCLUSIVE, true)) {
+    return false;
+  }
   txn->GetExclusiveLockSet()->emplace(rid);
   return true;
 }
 
 bool LockManager::Unlock(Transaction *txn, const RID &rid) {
+  if (!Release(txn, LockTarget{LockLevel::ROW, rid})) {
+    return false;
+  }
   txn->GetSharedLockSet()->erase(rid);
   txn->GetExclusiveLockSet()->erase(rid);
   return true;
 }
 
-void LockManager::AddEdge(txn_id_t t1, txn_id_t t2) { assert(Detection()); }
+bool LockManager::LockTable(Transaction *txn, page_id_t table_id, LockMode lock_mode) {
+  return LockCoarse(txn, LockTarget{LockLevel::TABLE, RID(table_id, 0)}, txn->GetTableLockMap().get(), lock_mode);
+}
 
-void LockManager::RemoveEdge(txn_id_t t1, txn_id_t t2) { assert(Detection()); }
+bool LockManager::LockPage(Transaction *txn, page_id_t page_id, LockMode lock_mode) {
+  return LockCoarse(txn, LockTarget{LockLevel::PAGE, RID(page_id, 0)}, txn->GetPageLockMap().get(), lock_mode);
+}
 
+bool LockManager::LockRow(Transaction *txn, page_id_t table_id, const RID &rid, LockMode lock_mode) {
+  BUSTUB_ASSERT(lock_mode == LockMode::SHARED || lock_mode == LockMode::EXCLUSIVE, "Rows are locked S or X.");
+  // Checked first, so that a transaction that rolls back its own writes finds its locks even though it is aborted.
+  if (txn->IsExclusiveLocked(rid) || (lock_mode == LockMode::SHARED && txn->IsSharedLocked(rid))) {
+    return true;
+  }
+  auto table_lock = txn->GetTableLockMap()->find(table_id);
+  if (table_lock != txn->GetTableLockMap()->end() && Covers(table_lock->second, lock_mode)) {
+    return true;
+  }
+  LockMode intention = lock_mode == LockMode::SHARED ? LockMode::INTENTION_SHARED : LockMode::INTENTION_EXCLUSIVE;
+  if (!LockTable(txn, table_id, intention)) {
+    return false;
+  }
+  auto page_lock = txn->GetPageLockMap()->find(rid.GetPageId());
+  if (page_lock != txn->GetPageLockMap()->end() && Covers(page_lock->second, lock_mode)) {
+    return true;
+  }
+  if (!LockPage(txn, rid.GetPageId(), intention)) {
+    return false;
+  }
+  bool locked = lock_mode == LockMode::SHARED ? LockShared(txn, rid) : LockExclusive(txn, rid);
+  if (!locked) {
+    return false;
+  }
+  if (++(*txn->GetRowLockCount())[table_id] % escalation_threshold_ == 0) {
+    Escalate(txn, table_id);
+  }
+  return true;
+}
+
+bool LockManager::TryLockRow(Transaction *txn, page_id_t table_id, const RID &rid) {
+  if (!CanLock(txn)) {
+    return false;
+  }
+  if (txn->IsExclusiveLocked(rid)) {
+    return true;
+  }
+  // A shared lock would have to be upgraded, which may wait.
+  if (txn->IsSharedLocked(rid)) {
+    return false;
+  }
+  auto table_lock = txn->GetTableLockMap()->find(table_id);
+  BUSTUB_ASSERT(table_lock != txn->GetTableLockMap()->end() &&
+                    Covers(table_lock->second, LockMode::INTENTION_EXCLUSIVE),
+                "The table is locked intention exclusive first.");
+  if (Covers(table_lock->second, LockMode::EXCLUSIVE)) {
+    return true;
+  }
+  auto page_lock = txn->GetPageLockMap()->find(rid.GetPageId());
+  if (page_lock == txn->GetPageLockMap()->end()) {
+    if (!TryAcquire(txn, LockTarget{LockLevel::PAGE, RID(rid.GetPageId(), 0)}, LockMode::INTENTION_EXCLUSIVE)) {
+      return false;
+    }
+    txn->GetPageLockMap()->emplace(rid.GetPageId(), LockMode::INTENTION_EXCLUSIVE);
+  } else if (Covers(page_lock->second, LockMode::EXCLUSIVE)) {
+    return true;
+  } else if (!Covers(page_lock->second, LockMode::INTENTION_EXCLUSIVE)) {
+    // Strengthening the page lock may wait too.
+    return false;
+  }
+  if (!TryAcquire(txn, LockTarget{LockLevel::ROW, rid}, LockMode::EXCLUSIVE)) {
+    return false;
+  }
+  txn->GetExclusiveLockSet()->emplace(rid);
+  if (++(*txn->GetRowLockCount())[table_id] % escalation_threshold_ == 0) {
+    Escalate(txn, table_id);
+  }
+  return true;
+}
+
+bool LockManager::UnlockTable(Transaction *txn, page_id_t table_id) {
+  if (!Release(txn, LockTarget{LockLevel::TABLE, RID(table_id, 0)})) {
+    return false;
+  }
+  txn->GetTableLockMap()->erase(table_id);
+  txn->GetRowLockCount()->erase(table_id);
+  return true;
+}
+
+bool LockManager::UnlockPage(Transaction *txn, page_id_t page_id) {
+  if (!Release(txn, LockTarget{LockLevel::PAGE, RID(page_id, 0)})) {
+    return false;
+  }
+  txn->GetPageLockMap()->erase(page_id);
+  return true;
+}
+
+bool LockManager::Covers(LockMode held, LockMode wanted) {
+  switch (held) {
+    case LockMode::EXCLUSIVE:
+      return true;
+    case LockMode::SHARED_INTENTION_EXCLUSIVE:
+      return wanted != LockMode::EXCLUSIVE;
+    case LockMode::SHARED:
+      return wanted == LockMode::SHARED || wanted == LockMode::INTENTION_SHARED;
+    case LockMode::INTENTION_EXCLUSIVE:
+      return wanted == LockMode::INTENTION_EXCLUSIVE || wanted == LockMode::INTENTION_SHARED;
+    case LockMode::INTENTION_SHARED:
+      return wanted == LockMode::INTENTION_SHARED;
+  }
+  return false;
+}
+
+LockMode LockManager::Combine(LockMode held, LockMode wanted) {
+  if (Covers(held, wanted)) {
+    return held;
+  }
+  if (Covers(wanted, held)) {
+    return wanted;
+  }
+  // what is left is S together with IX
+  return LockMode::SHARED_INTENTION_EXCLUSIVE;
+}
+
+bool LockManager::LockCoarse(Transaction *txn, const LockTarget &target,
+                             std::unordered_map<page_id_t, LockMode> *held_locks, LockMode lock_mode) {
+  if (!CanLock(txn)) {
+    return false;
+  }
+  auto held = held_locks->find(target.rid_.GetPageId());
+  if (held == held_locks->end()) {
+    if (!Acquire(txn, target, lock_mode, false)) {
+      return false;
+    }
+    held_locks->emplace(target.rid_.GetPageId(), lock_mode);
+    return true;
+  }
+  if (Covers(held->second, lock_mode)) {
+    return true;
+  }
+  LockMode combined = Combine(held->second, lock_mode);
+  held_locks->erase(held);
+  if (!Acquire(txn, target, combined, true)) {
+    return false;
+  }
+  held_locks->emplace(target.rid_.GetPageId(), combined);
+  return true;
+}
+
+bool LockManager::Acquire(Transaction *txn, const LockTarget &target, LockMode lock_mode, bool upgrade) {
+  auto *partition = PartitionOf(target);
+  std::unique_lock<std::mutex> guard(partition->latch_);
+  auto *queue = GetQueue(partition, target);
+  auto &requests = queue->request_queue_;
+  if (!upgrade) {
+    auto request = NewRequest(partition, queue, requests.end(), txn, lock_mode);
+    return WaitForGrant(txn, target, partition, queue, request, false, &guard);
+  }
+  bool row_upgrade = target.level_ == LockLevel::ROW;
+  if (row_upgrade && queue->upgrading_) {
+    // Two upgrades on one RID wait for each other's shared lock forever. The shared lock goes too.
+    txn->SetState(TransactionState::ABORTED);
+    auto held = std::find_if(requests.begin(), requests.end(),
+                             [txn](const LockRequest &r) { return r.txn_id_ == txn->GetTransactionId(); });
+    if (held != requests.end()) {
+      DropRequest(partition, target, queue, held);
+    }
+    return false;
+  }
+  // Drop the held request, and queue the stronger one right behind the granted requests.
+  auto held = std::find_if(requests.begin(), requests.end(),
+                           [txn](const LockRequest &r) { return r.txn_id_ == txn->GetTransactionId(); });
+  if (held != requests.end()) {
+    if (Detection()) {
+      ClearWaitsFor(queue, held);
+    }
+    partition->free_requests_.splice(partition->free_requests_.end(), requests, held);
+  }
+  auto position = requests.begin();
+  for (auto it = requests.begin(); it != requests.end(); ++it) {
+    if (it->granted_) {
+      position = std::next(it);
+    }
+  }
+  auto request = NewRequest(partition, queue, position, txn, lock_mode);
+  if (Detection()) {
+    for (auto it = std::next(request); it != requests.end(); ++it) {
+      if (Conflicts(*it, *request)) {
+        AddEdge(it->txn_id_, txn->GetTransactionId());
+      }
+    }
+  }
+  // The held request may have been in someone's way.
+  queue->cv_.notify_all();
+  if (row_upgrade) {
+    queue->upgrading_ = true;
+  }
+  return WaitForGrant(txn, target, partition, queue, request, row_upgrade, &guard);
+}
+
+bool LockManager::TryAcquire(Transaction *txn, const LockTarget &target, LockMode lock_mode) {
+  auto *partition = PartitionOf(target);
+  std::lock_guard<std::mutex> guard(partition->latch_);
+  auto *queue = GetQueue(partition, target);
+  auto request = NewRequest(partition, queue, queue->request_queue_.end(), txn, lock_mode);
+  if (!Grantable(queue, request)) {
+    DropRequest(partition, target, queue, request);
+    return false;
+  }
+  request->granted_ = true;
+  return true;
+}
+
+bool LockManager::Release(Transaction *txn, const LockTarget &target) {
+  if (two_pl_mode_ == TwoPLMode::STRICT && txn->GetState() != TransactionState::COMMITTED &&
+      txn->GetState() != TransactionState::ABORTED) {
+    return false;
+  }
+  if (txn->GetState() == TransactionState::GROWING) {
+    txn->SetState(TransactionState::SHRINKING);
+  }
+
+  auto *partition = PartitionOf(target);
+  std::lock_guard<std::mutex> guard(partition->latch_);
+  auto queue = partition->queues_.find(target);
+  if (queue == partition->queues_.end()) {
+    return false;
+  }
+  auto &requests = queue->second.request_queue_;
+  auto request = std::find_if(requests.begin(), requests.end(),
+                              [txn](const LockRequest &r) { return r.txn_id_ == txn->GetTransactionId(); });
+  if (request == requests.end()) {
+    return false;
+  }
+  DropRequest(partition, target, &queue->second, request);
+  return true;
+}
+
+/*
+ * escalation never waits: it happens while the transaction may hold page latches, and it is only worth it if nobody
+ * else uses the table in a conflicting way; otherwise the transaction keeps taking row locks and tries again later
+ */
+void LockManager::Escalate(Transaction *txn, page_id_t table_id) {
+  auto held = txn->GetTableLockMap()->find(table_id);
+  if (held == txn->GetTableLockMap()->end()) {
+    return;
+  }
+  LockMode escalated = held->second == LockMode::INTENTION_SHARED ? LockMode::SHARED : LockMode::EXCLUSIVE;
+  if (Covers(held->second, escalated)) {
+    return;
+  }
+  LockTarget target{LockLevel::TABLE, RID(table_id, 0)};
+  auto *partition = PartitionOf(target);
+  std::lock_guard<std::mutex> guard(partition->latch_);
+  auto queue = partition->queues_.find(target);
+  if (queue == partition->queues_.end()) {
+    return;
+  }
+  auto &requests = queue->second.request_queue_;
+  auto own = requests.end();
+  for (auto it = requests.begin(); it != requests.end(); ++it) {
+    if (it->txn_id_ == txn->GetTransactionId()) {
+      own = it;
+    } else if (!Compatible(it->lock_mode_, escalated)) {
+      return;
+    }
+  }
+  if (own == requests.end() || !own->granted_) {
+    return;
+  }
+  // Nobody else conflicts with the stronger mode, so the request stays where it is, granted.
+  own->lock_mode_ = escalated;
+  held->second = escalated;
+}
+
+bool LockManager::CanLock(Transaction *txn) {
+  if (txn->GetState() == TransactionState::ABORTED) {
+    return false;
+  }
+  if (txn->GetState() == TransactionState::SHRINKING) {
+    txn->SetState(TransactionState::ABORTED);
+    return false;
+  }
+  return true;
+}
+
+bool LockManager::Compatible(LockMode mode1, LockMode mode2) {
+  switch (mode1) {
+    case LockMode::INTENTION_SHARED:
+      return mode2 != LockMode::EXCLUSIVE;
+    case LockMode::INTENTION_EXCLUSIVE:
+      return mode2 == LockMode::INTENTION_SHARED || mode2 == LockMode::INTENTION_EXCLUSIVE;
+    case LockMode::SHARED:
+      return mode2 == LockMode::INTENTION_SHARED || mode2 == LockMode::SHARED;
+    case LockMode::SHARED_INTENTION_EXCLUSIVE:
+      return mode2 == LockMode::INTENTION_SHARED;
+    case LockMode::EXCLUSIVE:
+      return false;
+  }
+  return false;
+}
+
+bool LockManager::Conflicts(const LockRequest &r1, const LockRequest &r2) {
+  return r1.txn_id_ != r2.txn_id_ && !Compatible(r1.lock_mode_, r2.lock_mode_);
+}
+
+LockManager::LockTablePartition *LockManager::PartitionOf(const LockTarget &target) {
+  // RIDs hash to themselves, so the hash is mixed before its top bits pick the partition
+  uint64_t hash = LockTargetHash()(target) * 0x9E3779B97F4A7C15ULL;
+  return &partitions_[(hash >> 32) % LOCK_TABLE_PARTITIONS];
+}
+
+LockManager::LockRequestQueue *LockManager::GetQueue(LockTablePartition *partition, const LockTarget &target) {
+  auto queue = partition->queues_.find(target);
+  if (queue != partition->queues_.end()) {
+    return &queue->second;
+  }
+  if (partition->free_queues_.empty()) {
+    return &partition->queues_[target];
+  }
+  auto node = std::move(partition->free_queues_.back());
+  partition->free_queues_.pop_back();
+  node.key() = target;
+  return &partition->queues_.insert(std::move(node)).position->second;
+}
+
+LockManager::RequestIterator LockManager::NewRequest(LockTablePartition *partition, LockRequestQueue *queue,
+                                                     RequestIterator position, Transaction *txn, LockMode lock_mode) {
+  auto &requests = queue->request_queue_;
+  if (partition->free_requests_.empty()) {
+    return requests.emplace(position, txn, lock_mode);
+  }
+  auto request = partition->free_requests_.begin();
+  *request = LockRequest(txn, lock_mode);
+  requests.splice(position, partition->free_requests_, request);
+  return request;
+}
+
+bool LockManager::Grantable(LockRequestQueue *queue, RequestIterator request) {
+  for (auto it = queue->request_queue_.begin(); it != request; ++it) {
+    if (Conflicts(*it, *request)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+std::vector<txn_id_t> LockManager::Wound(Transaction *txn, LockRequestQueue *queue, RequestIterator request) {
+  std::vector<txn_id_t> victims;
+  for (auto it = queue->request_queue_.begin(); it != request; ++it) {
+    if (!Conflicts(*it, *request) || it->txn_id_ < txn->GetTransactionId()) {
+      continue;
+    }
+    // Transactions that already finished release their locks without being told.
+    if (it->txn_->AbortIfRunning()) {
+      victims.push_back(it->txn_id_);
+    }
+  }
+  return victims;
+}
+
+/*
+ * the waiter registers in waiting_ before it checks its state under its partition latch, so it either sees that it
+ * was aborted, or it is found here and notified under the same latch
+ */
+void LockManager::WakeUp(txn_id_t txn_id) {
+  LockTarget target;
+  {
+    std::lock_guard<std::mutex> guard(waiting_latch_);
+    auto waiting = waiting_.find(txn_id);
+    if (waiting == waiting_.end()) {
+      return;
+    }
+    target = waiting->second.second;
+  }
+  auto *partition = PartitionOf(target);
+  std::lock_guard<std::mutex> guard(partition->latch_);
+  auto queue = partition->queues_.find(target);
+  if (queue != partition->queues_.end()) {
+    queue->second.cv_.notify_all();
+  }
+}
+
+bool LockManager::WaitForGrant(Transaction *txn, const LockTarget &target, LockTablePartition *partition,
+                               LockRequestQueue *queue, RequestIterator request, bool upgrade,
+                               std::unique_lock<std::mutex> *guard) {
+  if (!Grantable(queue, request)) {
+    {
+      std::lock_guard<std::mutex> waiting_guard(waiting_latch_);
+      waiting_[txn->GetTransactionId()] = {txn, target};
+    }
+    if (Detection()) {
+      // The transaction waits for everyone ahead of it that it conflicts with.
+      for (auto it = queue->request_queue_.begin(); it != request; ++it) {
+        if (Conflicts(*it, *request)) {
+          AddEdge(txn->GetTransactionId(), it->txn_id_);
+        }
+      }
+    }
+    while (txn->GetState() != TransactionState::ABORTED && !Grantable(queue, request)) {
+      if (Prevention()) {
+        // Wound again after every wake up, since an upgrade may have moved a younger request ahead of this one.
+        std::vector<txn_id_t> victims = Wound(txn, queue, request);
+        if (!victims.empty()) {
+          // The victims may wait in other partitions. The request keeps the queue alive meanwhile.
+          guard->unlock();
+          for (txn_id_t victim : victims) {
+            WakeUp(victim);
+          }
+          guard->lock();
+          continue;
+        }
+      }
+      queue->cv_.wait(*guard);
+    }
+    {
+      std::lock_guard<std::mutex> waiting_guard(waiting_latch_);
+      waiting_.erase(txn->GetTransactionId());
+    }
+    if (Detection()) {
+      RemoveEdges(txn->GetTransactionId());
+    }
+  }
+  if (upgrade) {
+    queue->upgrading_ = false;
+  }
+  if (txn->GetState() == TransactionState::ABORTED) {
+    DropRequest(partition, target, queue, request);
+    return false;
+  }
+  request->granted_ = true;
+  return true;
+}
+
+void LockManager::DropRequest(LockTablePartition *partition, const LockTarget &target, LockRequestQueue *queue,
+                              RequestIterator request) {
+  if (Detection()) {
+    ClearWaitsFor(queue, request);
+  }
+  partition->free_requests_.splice(partition->free_requests_.end(), queue->request_queue_, request);
+  if (queue->request_queue_.empty()) {
+    queue->upgrading_ = false;
+    partition->free_queues_.push_back(partition->queues_.extract(target));
+  } else {
+    queue->cv_.notify_all();
+  }
+}
+
+void LockManager::ClearWaitsFor(LockRequestQueue *queue, RequestIterator request) {
+  for (auto it = std::next(request); it != queue->request_queue_.end(); ++it) {
+    if (!it->granted_ && Conflicts(*it, *request)) {
+      RemoveEdge(it->txn_id_, request->txn_id_);
+    }
+  }
+}
+
+void LockManager::AddEdge(txn_id_t t1, txn_id_t t2) {
+  BUSTUB_ASSERT(Detection(), "Detection should be enabled!");
+  std::lock_guard<std::mutex> guard(waits_for_latch_);
+  // Edges are kept sorted, so that the search for cycles is deterministic.
+  auto &edges = waits_for_[t1];
+  auto it = std::lower_bound(edges.begin(), edges.end(), t2);
+  if (it == edges.end() || *it != t2) {
+    edges.insert(it, t2);
+    changed_.insert(t1);
+  }
+}
+
+void LockManager::RemoveEdge(txn_id_t t1, txn_id_t t2) {
+  BUSTUB_ASSERT(Detection(), "Detection should be enabled!");
+  std::lock_guard<std::mutex> guard(waits_for_latch_);
+  auto edges = waits_for_.find(t1);
+  if (edges == waits_for_.end()) {
+    return;
+  }
+  auto it = std::lower_bound(edges->second.begin(), edges->second.end(), t2);
+  if (it != edges->second.end() && *it == t2) {
+    edges->second.erase(it);
+  }
+  if (edges->second.empty()) {
+    waits_for_.erase(edges);
+  }
+}
+
+void LockManager::RemoveEdges(txn_id_t t1) {
+  std::lock_guard<std::mutex> guard(waits_for_latch_);
+  waits_for_.erase(t1);
+}
+
+/*
+ * a new cycle goes through an edge added since the last search, so the search starts only from the transactions
+ * that got new edges, and skips everything it already found to be free of cycles
+ */
 bool LockManager::HasCycle(txn_id_t *txn_id) {
   BUSTUB_ASSERT(Detection(), "Detection should be enabled!");
+  std::lock_guard<std::mutex> guard(waits_for_latch_);
+  // the transactions that lead to no cycle
+  std::unordered_set<txn_id_t> done;
+  // the path of the depth-first search, with the next edge to follow from each transaction on it
+  std::vector<std::pair<txn_id_t, size_t>> path;
+  std::unordered_set<txn_id_t> on_path;
+  for (auto start = changed_.begin(); start != changed_.end(); start = changed_.erase(start)) {
+    if (done.count(*start) > 0) {
+      continue;
+    }
+    path.emplace_back(*start, 0);
+    on_path.insert(*start);
+    while (!path.empty()) {
+      txn_id_t current = path.back().first;
+      auto edges = waits_for_.find(current);
+      size_t next = path.back().second++;
+      if (edges == waits_for_.end() || next >= edges->second.size()) {
+        done.insert(current);
+        on_path.erase(current);
+        path.pop_back();
+        continue;
+      }
+      txn_id_t target = edges->second[next];
+      if (on_path.count(target) > 0) {
+        // The cycle is the path from the target on. Its youngest transaction is the victim.
+        *txn_id = target;
+        for (auto it = path.rbegin(); it->first != target; ++it) {
+          *txn_id = std::max(*txn_id, it->first);
+        }
+        return true;
+      }
+      if (done.count(target) == 0) {
+        path.emplace_back(target, 0);
+        on_path.insert(target);
+      }
+    }
+  }
   return false;
 }
 
 std::vector<std::pair<txn_id_t, txn_id_t>> LockManager::GetEdgeList() {
   BUSTUB_ASSERT(Detection(), "Detection should be enabled!");
-  return {};
+  std::lock_guard<std::mutex> guard(waits_for_latch_);
+  std::vector<std::pair<txn_id_t, txn_id_t>> edge_list;
+  for (const auto &edges : waits_for_) {
+    for (txn_id_t t2 : edges.second) {
+      edge_list.emplace_back(edges.first, t2);
+    }
+  }
+  std::sort(edge_list.begin(), edge_list.end());
+  return edge_list;
 }
 
 void LockManager::RunCycleDetection() {
   BUSTUB_ASSERT(Detection(), "Detection should be enabled!");
   while (enable_cycle_detection_) {
     std::this_thread::sleep_for(cycle_detection_interval);
-    {
-      std::unique_lock<std::mutex> l(latch_);
-      // TODO(student): remove the continue and add your cycle detection and abort code here
-      continue;
+    txn_id_t victim;
+    while (HasCycle(&victim)) {
+      {
+        // Every transaction on a cycle waits for a lock, unless the edges were added by hand.
+        std::lock_guard<std::mutex> guard(waiting_latch_);
+        auto waiting = waiting_.find(victim);
+        if (waiting == waiting_.end()) {
+          break;
+        }
+        waiting->second.first->SetState(TransactionState::ABORTED);
+      }
+      // Without its edges, the victim is on no cycle anymore. It drops its request once it wakes up.
+      RemoveEdges(victim);
+      WakeUp(victim);
     }
   }
 }
@@ -0,0 +1,52 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// row_version_table.cpp
+//
+// Identification: src/concurrency/row_version_table.cpp
+//
+// Copyright (c) 2015-2019, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include "concurrency/row_version_table.h"
+
+namespace bustub {
+
+uint64_t RowVersionTable::GetVersion(const RID &rid) {
+  Partition *partition = PartitionOf(rid);
+  std::lock_guard<std::mutex> guard(partition->latch_);
+  auto version = partition->versions_.find(rid);
+  return version == partition->versions_.end() ? 0 : version->second;
+}
+
+bool RowVersionTable::TryLock(const RID &rid) {
+  Partition *partition = PartitionOf(rid);
+  std::lock_guard<std::mutex> guard(partition->latch_);
+  uint64_t &version = partition->versions_[rid];
+  if ((version & LOCK_BIT) != 0) {
+    return false;
+  }
+  version |= LOCK_BIT;
+  return true;
+}
+
+void RowVersionTable::Unlock(const RID &rid, bool changed) {
+  Partition *partition = PartitionOf(rid);
+  std::lock_guard<std::mutex> guard(partition->latch_);
+  uint64_t &version = partition->versions_[rid];
+  BUSTUB_ASSERT((version & LOCK_BIT) != 0, "The row is not locked.");
+  version &= ~LOCK_BIT;
+  if (changed) {
+    version++;
+  }
+}
+
+RowVersionTable::Partition *RowVersionTable::PartitionOf(const RID &rid) {
+  // RIDs hash to themselves, so the hash is mixed before its top bits pick the partition
+  uint64_t hash = std::hash<RID>()(rid) * 0x9E3779B97F4A7C15ULL;
+  return &partitions_[(hash >> 32) % ROW_VERSION_PARTITIONS];
+}
+
+}  // namespace bustub
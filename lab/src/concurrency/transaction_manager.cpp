@@ -12,8 +12,10 @@
 
 #include "concurrency/transaction_manager.h"
 
+#include <algorithm>
 #include <unordered_map>
 #include <unordered_set>
+#include <vector>
 
 #include "storage/table/table_heap.h"
 
@@ -29,20 +31,49 @@ Transaction *TransactionManager::Begin(Transaction *txn) {
     txn = new Transaction(next_txn_id_++);
   }
 
+  // The transaction is in the table before its BEGIN record is appended, so that a checkpoint that comes before the
+  // record cannot miss it.
+  txn->SetBeginLSN(enable_logging ? PENDING_LSN : INVALID_LSN);
+  txn->SetEndLSN(INVALID_LSN);
+  {
+    std::lock_guard<std::mutex> guard(active_txns_latch_);
+    active_txns_[txn->GetTransactionId()] = txn;
+    if (version_store_ != nullptr) {
+      // The snapshot is taken while active_txns_latch_ is held, so that garbage collection accounts for it.
+      txn->SetSnapshot(version_store_.get(), version_store_->GetLastCommitTimestamp());
+    }
+  }
   if (enable_logging) {
     // TODO(student): Add logging here.
-    LogRecord log_record(txn->GetTransactionId(), txn->GetPrevLSN(), LogRecordType::BEGIN);
-    lsn_t lsn = log_manager_->AppendLogRecord(&log_record);
-    txn->SetPrevLSN(lsn);
+    txn->SetPrevLSN(AppendTransactionRecord(txn, LogRecordType::BEGIN, &Transaction::SetBeginLSN));
+  }
+  if (row_version_table_ != nullptr) {
+    txn->SetRowVersionTable(row_version_table_.get());
   }
 
   txn_map[txn->GetTransactionId()] = txn;
   return txn;
 }
 
-void TransactionManager::Commit(Transaction *txn) {
+bool TransactionManager::Commit(Transaction *txn) {
+  if (row_version_table_ != nullptr && !Validate(txn)) {
+    Abort(txn);
+    return false;
+  }
+
+  // An optimistic transaction writes once it is validated, through the same paths as everyone else. It only counts
+  // as committed once all of them went through, since a failed write still aborts it.
+  if (row_version_table_ != nullptr && !ApplyBufferedWrites(txn)) {
+    Abort(txn);
+    return false;
+  }
   txn->SetState(TransactionState::COMMITTED);
 
+  // New snapshots see the transaction's writes from here on. The deleted tuples are still visible to older ones.
+  if (version_store_ != nullptr) {
+    version_store_->Commit(txn);
+  }
+
   // Perform all deletes before we commit.
   auto write_set = txn->GetWriteSet();
   while (!write_set->empty()) {
@@ -56,20 +87,29 @@ void TransactionManager::Commit(Transaction *txn) {
   }
   write_set->clear();
 
+  lsn_t lsn = INVALID_LSN;
   if (enable_logging) {
     // TODO(student): add logging here
-    LogRecord log_record(txn->GetTransactionId(), txn->GetPrevLSN(), LogRecordType::COMMIT);
-    lsn_t lsn = log_manager_->AppendLogRecord(&log_record);
-    while (lsn > log_manager_->GetPersistentLSN()) {
-      std::this_thread::yield();
-    }
+    lsn = AppendTransactionRecord(txn, LogRecordType::COMMIT, &Transaction::SetEndLSN);
+  }
+  {
+    // A checkpoint that still sees the transaction leaves it out if the COMMIT record comes before the checkpoint.
+    std::lock_guard<std::mutex> guard(active_txns_latch_);
+    active_txns_.erase(txn->GetTransactionId());
+  }
+  if (lsn != INVALID_LSN) {
+    // Sleep until the flush thread has written this record, together with everyone else's.
+    log_manager_->WaitForFlush(lsn);
     txn->SetPrevLSN(lsn);
   }
 
   // Release all the locks.
   ReleaseLocks(txn);
+  ReleaseRowVersions(txn, true);
+  MaybeCollectGarbage();
   // Release the global transaction latch.
   global_txn_latch_.RUnlock();
+  return true;
 }
 
 void TransactionManager::Abort(Transaction *txn) {
@@ -91,23 +131,146 @@ void TransactionManager::Abort(Transaction *txn) {
     write_set->pop_back();
   }
   write_set->clear();
+  if (version_store_ != nullptr) {
+    version_store_->Abort(txn);
+  }
 
+  lsn_t lsn = INVALID_LSN;
   if (enable_logging) {
     // TODO(student): add logging here
-    LogRecord log_record(txn->GetTransactionId(), txn->GetPrevLSN(), LogRecordType::ABORT);
-    lsn_t lsn = log_manager_->AppendLogRecord(&log_record);
-    while (lsn > log_manager_->GetPersistentLSN()) {
-      std::this_thread::yield();
-    }
+    lsn = AppendTransactionRecord(txn, LogRecordType::ABORT, &Transaction::SetEndLSN);
+  }
+  {
+    // A checkpoint that still sees the transaction leaves it out if the ABORT record comes before the checkpoint.
+    std::lock_guard<std::mutex> guard(active_txns_latch_);
+    active_txns_.erase(txn->GetTransactionId());
+  }
+  if (lsn != INVALID_LSN) {
+    // Sleep until the flush thread has written this record, together with everyone else's.
+    log_manager_->WaitForFlush(lsn);
     txn->SetPrevLSN(lsn);
   }
 
   // Release all the locks.
   ReleaseLocks(txn);
+  ReleaseRowVersions(txn, false);
+  MaybeCollectGarbage();
   // Release the global transaction latch.
   global_txn_latch_.RUnlock();
 }
 
+lsn_t TransactionManager::GetActiveTransactionTable(lsn_t checkpoint_lsn,
+                                                    std::vector<std::pair<txn_id_t, lsn_t>> *active_txns) {
+  // Transactions leave the table only after their COMMIT or ABORT record, so none is missed. Those whose record is
+  // still pending wait for its LSN, which tells on which side of the checkpoint it is. A record that is not even
+  // pending yet gets an LSN after the checkpoint's.
+  std::lock_guard<std::mutex> guard(active_txns_latch_);
+  lsn_waiters_++;
+  lsn_t oldest_begin_lsn = INVALID_LSN;
+  for (const auto &active_txn : active_txns_) {
+    Transaction *txn = active_txn.second;
+    lsn_t begin_lsn = WaitForLSN([txn] { return txn->GetBeginLSN(); });
+    lsn_t end_lsn = WaitForLSN([txn] { return txn->GetEndLSN(); });
+    if (begin_lsn > checkpoint_lsn || (end_lsn != INVALID_LSN && end_lsn < checkpoint_lsn)) {
+      continue;
+    }
+    // The previous LSN may not have caught up with the BEGIN record yet.
+    active_txns->emplace_back(active_txn.first, std::max(txn->GetPrevLSN(), begin_lsn));
+    if (begin_lsn != INVALID_LSN && (oldest_begin_lsn == INVALID_LSN || begin_lsn < oldest_begin_lsn)) {
+      oldest_begin_lsn = begin_lsn;
+    }
+  }
+  lsn_waiters_--;
+  return oldest_begin_lsn;
+}
+
+lsn_t TransactionManager::AppendTransactionRecord(Transaction *txn, LogRecordType type,
+                                                  void (Transaction::*set_lsn)(lsn_t)) {
+  (txn->*set_lsn)(PENDING_LSN);
+  LogRecord log_record(txn->GetTransactionId(), txn->GetPrevLSN(), type);
+  lsn_t lsn = log_manager_->AppendLogRecord(&log_record);
+  (txn->*set_lsn)(lsn);
+  // A checkpoint counts itself as a waiter before it looks at the LSN, so either it sees the LSN or it is woken up.
+  if (lsn_waiters_ > 0) {
+    std::lock_guard<std::mutex> guard(lsn_latch_);
+    lsn_cv_.notify_all();
+  }
+  return lsn;
+}
+
+lsn_t TransactionManager::WaitForLSN(const std::function<lsn_t()> &get_lsn) {
+  lsn_t lsn = get_lsn();
+  if (lsn == PENDING_LSN) {
+    std::unique_lock<std::mutex> latch(lsn_latch_);
+    lsn_cv_.wait(latch, [&] { return (lsn = get_lsn()) != PENDING_LSN; });
+  }
+  return lsn;
+}
+
+size_t TransactionManager::CollectGarbage() {
+  if (version_store_ == nullptr) {
+    return 0;
+  }
+  std::vector<timestamp_t> snapshots;
+  {
+    // Snapshots are taken under the same latch, so none is missed.
+    std::lock_guard<std::mutex> guard(active_txns_latch_);
+    for (const auto &active_txn : active_txns_) {
+      Transaction *txn = active_txn.second;
+      if (txn->GetVersionStore() != nullptr) {
+        snapshots.push_back(txn->GetReadTimestamp());
+      }
+    }
+  }
+  return version_store_->GarbageCollect(snapshots);
+}
+
+bool TransactionManager::Validate(Transaction *txn) {
+  if (txn->GetState() == TransactionState::ABORTED) {
+    return false;
+  }
+  // Lock the rows to write. Locks are not waited for, so commits cannot deadlock, and a row someone else is writing
+  // fails the commit like a changed one would. The inserted rows are locked already.
+  auto *locked_rows = txn->GetLockedRows();
+  for (const WriteRecord &write : *txn->GetBufferedWrites()) {
+    if (locked_rows->count(write.rid_) != 0) {
+      continue;
+    }
+    if (!row_version_table_->TryLock(write.rid_)) {
+      return false;
+    }
+    locked_rows->insert(write.rid_);
+  }
+  // Every row read must still have the version it had, and not be locked by anyone else. The read set holds no
+  // versions that someone else had locked, since those reads abort right away.
+  for (const auto &read : *txn->GetReadSet()) {
+    uint64_t version = row_version_table_->GetVersion(read.first);
+    if ((version & ~RowVersionTable::LOCK_BIT) != (read.second & ~RowVersionTable::LOCK_BIT)) {
+      return false;
+    }
+    if ((version & RowVersionTable::LOCK_BIT) != 0 && locked_rows->count(read.first) == 0) {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool TransactionManager::ApplyBufferedWrites(Transaction *txn) {
+  // The writes go into the write set as they are applied, so that a failure rolls back the ones before it.
+  txn->SetApplyingBufferedWrites(true);
+  for (const WriteRecord &write : *txn->GetBufferedWrites()) {
+    bool applied = write.wtype_ == WType::DELETE ? write.table_->MarkDelete(write.rid_, txn)
+                                                  : write.table_->UpdateTuple(write.tuple_, write.rid_, txn);
+    if (!applied) {
+      txn->SetApplyingBufferedWrites(false);
+      return false;
+    }
+  }
+  txn->SetApplyingBufferedWrites(false);
+  txn->GetBufferedWrites()->clear();
+  return true;
+}
+
 void TransactionManager::BlockAllTransactions() { global_txn_latch_.WLock(); }
 
 void TransactionManager::ResumeTransactions() { global_txn_latch_.WUnlock(); }
@@ -0,0 +1,174 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// version_store.cpp
+//
+// Identification: src/concurrency/version_store.cpp
+//
+// Copyright (c) 2015-2019, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include "concurrency/version_store.h"
+
+#include "common/macros.h"
+
+namespace bustub {
+
+bool VersionStore::CheckWrite(Transaction *txn, const RID &rid) {
+  latch_.RLock();
+  auto chain = chains_.find(rid);
+  bool allowed = chain == chains_.end() || chain->second.writer_ == txn->GetTransactionId() ||
+                 (chain->second.writer_ == INVALID_TXN_ID && chain->second.ts_ <= txn->GetReadTimestamp());
+  latch_.RUnlock();
+  if (!allowed) {
+    txn->SetState(TransactionState::ABORTED);
+  }
+  return allowed;
+}
+
+void VersionStore::AddVersion(Transaction *txn, const RID &rid, const Tuple *old_tuple) {
+  latch_.WLock();
+  auto &chain = chains_[rid];
+  if (chain.writer_ != txn->GetTransactionId()) {
+    BUSTUB_ASSERT(chain.writer_ == INVALID_TXN_ID, "A tuple has one uncommitted writer at a time.");
+    chain.undo_.push_back(UndoVersion{old_tuple != nullptr, old_tuple != nullptr ? *old_tuple : Tuple{}, chain.ts_});
+    chain.writer_ = txn->GetTransactionId();
+    write_sets_[txn->GetTransactionId()].push_back(rid);
+  }
+  latch_.WUnlock();
+}
+
+bool VersionStore::ReadVersion(Transaction *txn, const RID &rid, bool exists, Tuple *tuple) {
+  latch_.RLock();
+  auto chain = chains_.find(rid);
+  if (chain == chains_.end() || chain->second.writer_ == txn->GetTransactionId() ||
+      (chain->second.writer_ == INVALID_TXN_ID && chain->second.ts_ <= txn->GetReadTimestamp())) {
+    latch_.RUnlock();
+    return exists;
+  }
+  // The newest older version that was committed when the snapshot was taken.
+  const auto &undo = chain->second.undo_;
+  for (auto version = undo.rbegin(); version != undo.rend(); ++version) {
+    if (version->ts_ <= txn->GetReadTimestamp()) {
+      if (version->exists_) {
+        *tuple = version->tuple_;
+        tuple->rid_ = rid;
+      }
+      latch_.RUnlock();
+      return version->exists_;
+    }
+  }
+  latch_.RUnlock();
+  return false;
+}
+
+timestamp_t VersionStore::Commit(Transaction *txn) {
+  latch_.WLock();
+  auto write_set = write_sets_.find(txn->GetTransactionId());
+  if (write_set == write_sets_.end()) {
+    latch_.WUnlock();
+    return last_commit_ts_;
+  }
+  // Readers see every version of the commit at once, since they resolve versions under the latch.
+  timestamp_t commit_ts = last_commit_ts_ + 1;
+  for (const RID &rid : write_set->second) {
+    auto chain = chains_.find(rid);
+    if (chain != chains_.end() && chain->second.writer_ == txn->GetTransactionId()) {
+      chain->second.writer_ = INVALID_TXN_ID;
+      chain->second.ts_ = commit_ts;
+    }
+  }
+  write_sets_.erase(write_set);
+  last_commit_ts_ = commit_ts;
+  latch_.WUnlock();
+  return commit_ts;
+}
+
+void VersionStore::Abort(Transaction *txn) {
+  latch_.WLock();
+  auto write_set = write_sets_.find(txn->GetTransactionId());
+  if (write_set != write_sets_.end()) {
+    for (const RID &rid : write_set->second) {
+      auto chain = chains_.find(rid);
+      if (chain != chains_.end() && chain->second.writer_ == txn->GetTransactionId()) {
+        Revert(chain);
+      }
+    }
+    write_sets_.erase(write_set);
+  }
+  latch_.WUnlock();
+}
+
+void VersionStore::RevertVersion(Transaction *txn, const RID &rid) {
+  latch_.WLock();
+  auto chain = chains_.find(rid);
+  if (chain != chains_.end() && chain->second.writer_ == txn->GetTransactionId()) {
+    Revert(chain);
+  }
+  latch_.WUnlock();
+}
+
+void VersionStore::Revert(std::unordered_map<RID, VersionChain>::iterator chain) {
+  // The page holds the image from before the transaction's changes again.
+  chain->second.writer_ = INVALID_TXN_ID;
+  chain->second.ts_ = chain->second.undo_.back().ts_;
+  chain->second.undo_.pop_back();
+  if (chain->second.undo_.empty() && chain->second.ts_ == 0) {
+    chains_.erase(chain);
+  }
+}
+
+size_t VersionStore::GarbageCollect(const std::vector<timestamp_t> &snapshots) {
+  size_t dropped = 0;
+  latch_.WLock();
+  for (auto chain = chains_.begin(); chain != chains_.end();) {
+    auto &undo = chain->second.undo_;
+    bool committed = chain->second.writer_ == INVALID_TXN_ID;
+    // Keep the version each snapshot sees. Snapshots taken from now on see the newest committed image.
+    std::vector<bool> needed(undo.size(), false);
+    if (!committed && !undo.empty()) {
+      needed.back() = true;
+    }
+    for (timestamp_t read_ts : snapshots) {
+      if (committed && chain->second.ts_ <= read_ts) {
+        continue;
+      }
+      for (size_t i = undo.size(); i-- > 0;) {
+        if (undo[i].ts_ <= read_ts) {
+          needed[i] = true;
+          break;
+        }
+      }
+    }
+    std::vector<UndoVersion> kept;
+    for (size_t i = 0; i < undo.size(); i++) {
+      if (needed[i]) {
+        kept.push_back(undo[i]);
+      }
+    }
+    dropped += undo.size() - kept.size();
+    undo.swap(kept);
+    if (committed && undo.empty()) {
+      // Every snapshot sees the image in the page.
+      chain = chains_.erase(chain);
+    } else {
+      ++chain;
+    }
+  }
+  latch_.WUnlock();
+  return dropped;
+}
+
+size_t VersionStore::GetVersionCount() {
+  size_t count = 0;
+  latch_.RLock();
+  for (const auto &chain : chains_) {
+    count += chain.second.undo_.size();
+  }
+  latch_.RUnlock();
+  return count;
+}
+
+}  // namespace bustub
@@ -30,8 +30,11 @@ template <typename KeyType, typename ValueType, typename KeyComparator>
 HASH_TABLE_TYPE::LinearProbeHashTable(const std::string &name, BufferPoolManager *buffer_pool_manager,
                                       const KeyComparator &comparator, size_t num_buckets,
                                       HashFunction<KeyType> hash_fn)
-    : buffer_pool_manager_(buffer_pool_manager), comparator_(comparator), hash_fn_(std::move(hash_fn)) {
-  Page *page = buffer_pool_manager_->NewPage(&header_page_id_);
+    : buffer_pool_manager_(buffer_pool_manager),
+      extent_(buffer_pool_manager->GetExtentReservation()),
+      comparator_(comparator),
+      hash_fn_(std::move(hash_fn)) {
+  Page *page = buffer_pool_manager_->NewPage(&header_page_id_, nullptr, nullptr, extent_.get());
   page->WLatch();
   auto *hash_table_header = reinterpret_cast<HashTableHeaderPage *>(page->GetData());
   hash_table_header->SetPageId(header_page_id_);
@@ -119,7 +122,7 @@ begin:
     header_page->WLatch();
     if (block_idx >= header->NumBlocks()) {
       for (auto i = header->NumBlocks(); i <= block_idx; ++i) {
-        if (buffer_pool_manager_->NewPage(&page_id) == nullptr) {
+        if (buffer_pool_manager_->NewPage(&page_id, nullptr, nullptr, extent_.get()) == nullptr) {
           header_page->WUnlatch();
           buffer_pool_manager_->UnpinPage(header_page_id_, header_modify);
           table_latch_.RUnlock();
@@ -175,7 +178,7 @@ begin:
         header_page->RUnlatch();
         header_page->WLatch();
         if (block_idx >= header->NumBlocks()) {
-          if (buffer_pool_manager_->NewPage(&block_page_id) == nullptr) {
+          if (buffer_pool_manager_->NewPage(&block_page_id, nullptr, nullptr, extent_.get()) == nullptr) {
             header_page->WUnlatch();
             buffer_pool_manager_->UnpinPage(header_page_id_, header_modify);
             table_latch_.RUnlock();
@@ -261,14 +264,14 @@ void HASH_TABLE_TYPE::Resize(size_t initial_size) {
   size_t new_size = initial_size << 1;
   size_t new_num_blocks = new_size / BLOCK_ARRAY_SIZE;
   page_id_t old_header_page_id = header_page_id_;
-  Page *header_page = buffer_pool_manager_->NewPage(&header_page_id_);
+  Page *header_page = buffer_pool_manager_->NewPage(&header_page_id_, nullptr, nullptr, extent_.get());
   header_page->WLatch();
   auto *header = reinterpret_cast<HashTableHeaderPage *>(header_page->GetData());
   header->SetPageId(header_page_id_);
   header->SetSize(new_size);
   for (size_t i = 0; i < new_num_blocks; ++i) {
     page_id_t block_page_id;
-    buffer_pool_manager_->NewPage(&block_page_id);
+    buffer_pool_manager_->NewPage(&block_page_id, nullptr, nullptr, extent_.get());
     header->AddBlockPageId(block_page_id);
     buffer_pool_manager_->UnpinPage(block_page_id, false);
   }
@@ -29,6 +29,7 @@ void HashJoinExecutor::Init() {
   left_->Init();
   right_->Init();
   Tuple tuple;
+  build_strategy_ = exec_ctx_->GetBufferPoolManager()->GetAccessStrategy(AccessStrategyType::BULK_WRITE);
   TmpTuplePage *tmp_tuple_page = GetNewTmpTuplePage();
   TmpTuple tmp_tuple{};
   while (left_->Next(&tuple)) {
@@ -39,6 +40,7 @@ void HashJoinExecutor::Init() {
     hash_t hash_value = HashValues(&tuple, plan_->GetLeftPlan()->OutputSchema(), plan_->GetLeftKeys());
     jht_.Insert(exec_ctx_->GetTransaction(), hash_value, tmp_tuple);
   }
+  exec_ctx_->GetBufferPoolManager()->UnpinPage(tmp_tuple_pages_.back(), true);
 }
 
 
@@ -25,6 +25,7 @@ void InsertExecutor::Init() {
   SimpleCatalog *catalog = exec_ctx_->GetCatalog();
   table_oid_t table_oid = plan_->TableOid();
   table_metadata_ = catalog->GetTable(table_oid);
+  strategy_ = exec_ctx_->GetBufferPoolManager()->GetAccessStrategy(AccessStrategyType::BULK_WRITE);
 }
 
 bool InsertExecutor::Next([[maybe_unused]] Tuple *tuple) {
@@ -33,7 +34,7 @@ bool InsertExecutor::Next([[maybe_unused]] Tuple *tuple) {
     auto row_values = plan_->RawValues();
     for (size_t i = 0; i < row_values.size(); ++i) {
       Tuple tuple1(plan_->RawValuesAt(i), &table_metadata_->schema_);
-      if (!table_metadata_->table_->InsertTuple(tuple1, &rid, exec_ctx_->GetTransaction())) {
+      if (!table_metadata_->table_->InsertTuple(tuple1, &rid, exec_ctx_->GetTransaction(), strategy_.get())) {
         return false;
       }
     }
@@ -41,7 +42,7 @@ bool InsertExecutor::Next([[maybe_unused]] Tuple *tuple) {
     Tuple tuple2;
     child_executor_->Init();
     while (child_executor_->Next(&tuple2)) {
-      if (!table_metadata_->table_->InsertTuple(tuple2, &rid, exec_ctx_->GetTransaction())) {
+      if (!table_metadata_->table_->InsertTuple(tuple2, &rid, exec_ctx_->GetTransaction(), strategy_.get())) {
         return false;
       }
     }
@@ -20,7 +20,10 @@ void SeqScanExecutor::Init() {
   SimpleCatalog *catalog = exec_ctx_->GetCatalog();
   table_oid_t table_oid = plan_->GetTableOid();
   table_metadata_ = catalog->GetTable(table_oid);
-  iter_ = table_metadata_->table_->Begin(exec_ctx_->GetTransaction());
+  strategy_ = exec_ctx_->GetBufferPoolManager()->GetAccessStrategy(AccessStrategyType::BULK_READ);
+  // The scan reads every row, so one table lock replaces all the row locks.
+  table_metadata_->table_->LockTable(exec_ctx_->GetTransaction(), LockMode::SHARED);
+  iter_ = table_metadata_->table_->Begin(exec_ctx_->GetTransaction(), strategy_.get());
 }
 
 bool SeqScanExecutor::Next(Tuple *tuple) {
@@ -35,7 +38,7 @@ bool SeqScanExecutor::Next(Tuple *tuple) {
 
   if (iter_ != table_metadata_->table_->End()) {
     for (size_t i = 0; i < values.size(); ++i) {
-      values[i] = output_column[i].GetExpr()->Evaluate(tuple, &table_metadata_->schema_);
+      values[i] = output_column[i].GetExpr()->Evaluate(&(*iter_), &table_metadata_->schema_);
     }
     *tuple = Tuple(values, output_schema);
     ++iter_;
@@ -0,0 +1,126 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// buffer_access_strategy.h
+//
+// Identification: src/include/buffer/buffer_access_strategy.h
+//
+// Copyright (c) 2015-2019, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>  // NOLINT
+#include <mutex>               // NOLINT
+#include <vector>
+
+#include "common/config.h"
+#include "common/macros.h"
+
+namespace bustub {
+
+/** The kinds of bulk access that get a private ring of frames. */
+enum class AccessStrategyType {
+  /** Large sequential reads. Dirty frames are left to the shared pool rather than written back by the reader. */
+  BULK_READ,
+  /** Bulk loads. The loader writes back the dirty frames of its own ring. */
+  BULK_WRITE
+};
+
+static constexpr size_t BULK_READ_RING_SIZE = 32;   // frames in the ring of a sequential scan
+static constexpr size_t BULK_WRITE_RING_SIZE = 64;  // frames in the ring of a bulk load
+static constexpr size_t MIN_RING_SIZE = 2;          // frames per shard in any ring
+
+/**
+ * BufferAccessStrategy lets a bulk operation recycle a small ring of frames instead of pushing the whole buffer pool
+ * out, like PostgreSQL's BAS_BULKREAD and BAS_BULKWRITE.
+ *
+ * A miss made through a strategy first tries to reuse the frame in the current slot of the ring of the page's shard.
+ * The frame is only reused if it still holds the page the ring put there and nobody has it pinned. Otherwise the miss
+ * takes a frame from the shared pool as usual and that frame replaces the slot. Hits do not touch the ring.
+ *
+ * A strategy belongs to a single operator. Its rings are only touched under the latch of their shard, so the
+ * operator may hand it to the buffer pool's prefetcher as well. Get one from BufferPoolManager::GetAccessStrategy.
+ */
+class BufferAccessStrategy {
+  friend class BufferPoolManager;
+
+ public:
+  /**
+   * Create a new BufferAccessStrategy with empty rings.
+   * @param type the kind of access
+   * @param num_instances the number of shards of the buffer pool
+   * @param ring_size the number of frames in the ring of each shard
+   */
+  BufferAccessStrategy(AccessStrategyType type, size_t num_instances, size_t ring_size);
+
+  /**
+   * Destroys the strategy. Waits for the prefetches that use it to finish, and cancels the pages they have not
+   * loaded yet.
+   */
+  ~BufferAccessStrategy();
+
+  DISALLOW_COPY_AND_MOVE(BufferAccessStrategy);
+
+  /** @return the kind of access */
+  AccessStrategyType GetType() const { return type_; }
+
+  /** @return the number of frames in the ring of each shard */
+  size_t GetRingSize() const { return ring_size_; }
+
+  /** @return the number of frames in all rings together */
+  size_t GetCapacity() const { return ring_size_ * rings_.size(); }
+
+ private:
+  /** A frame of a ring, and the page the ring last put in it. */
+  struct RingSlot {
+    frame_id_t frame_id_{-1};
+    page_id_t page_id_{INVALID_PAGE_ID};
+  };
+
+  /** The ring of frames of one shard. */
+  struct Ring {
+    std::vector<RingSlot> slots_;
+    size_t current_{0};
+  };
+
+  /**
+   * Advance the ring of a shard to its next slot.
+   * @param shard_index the shard
+   * @return the new current slot
+   */
+  RingSlot *NextSlot(size_t shard_index);
+
+  /**
+   * Remember the frame a miss loaded a page into, in the current slot of the shard's ring.
+   * @param shard_index the shard
+   * @param frame_id the frame, relative to the shard
+   * @param page_id the page that was loaded
+   */
+  void SetCurrentSlot(size_t shard_index, frame_id_t frame_id, page_id_t page_id);
+
+  /** Count a prefetch request that uses this strategy. */
+  void AddPendingPrefetch();
+
+  /** Count a prefetch request as finished, and wake up the destructor when it was the last one. */
+  void FinishPendingPrefetch();
+
+  /** @return true if dirty frames of the ring are written back and reused */
+  bool ReusesDirtyFrames() const { return type_ == AccessStrategyType::BULK_WRITE; }
+
+  AccessStrategyType type_;
+  size_t ring_size_;
+  std::vector<Ring> rings_;
+  /** Prefetch requests that use this strategy and have not finished yet, protected by pending_latch_. */
+  size_t pending_prefetches_{0};
+  std::mutex pending_latch_;
+  /** Signaled when pending_prefetches_ drops to zero. */
+  std::condition_variable pending_cv_;
+  /** Set when the strategy is being destroyed, so that its pending prefetches stop early. */
+  std::atomic<bool> closing_{false};
+};
+
+}  // namespace bustub
@@ -12,19 +12,72 @@
 
 #pragma once
 
+#include <atomic>
+#include <chrono>  // NOLINT
+#include <climits>
+#include <condition_variable>  // NOLINT
+#include <deque>
+#include <functional>
 #include <list>
-#include <mutex>  // NOLINT
+#include <memory>
+#include <mutex>   // NOLINT
+#include <thread>  // NOLINT
 #include <unordered_map>
+#include <utility>
+#include <vector>
 
+#include "buffer/buffer_access_strategy.h"
 #include "buffer/clock_replacer.h"
+#include "buffer/lru_k_replacer.h"
+#include "buffer/page_table.h"
 #include "recovery/log_manager.h"
 #include "storage/disk/disk_manager.h"
+#include "storage/disk/extent_reservation.h"
 #include "storage/page/page.h"
 
 namespace bustub {
 
+static constexpr size_t BG_WRITER_CLEAN_TARGET = 4;  // clean frames the background writer keeps ready per shard
+static constexpr std::chrono::milliseconds BG_WRITER_INTERVAL{10};  // background writer sleep when idle
+static constexpr size_t PREFETCH_QUEUE_DEPTH = 16;  // prefetch requests that may wait; more are dropped
+static constexpr size_t PREFETCH_WORKERS = 4;       // prefetcher threads, and so page reads a prefetch keeps in flight
+
+/** Counters of the background writer, see BufferPoolManager::RunBackgroundWriter. */
+struct BackgroundWriterStats {
+  /** Pages the background writer wrote back. */
+  uint64_t pages_written_{0};
+  /** Pages the background writer wrote back per second while it was running. */
+  double flush_rate_{0};
+  /** Evictions that found a victim the background writer had cleaned, i.e. foreground writes it saved. */
+  uint64_t stalls_avoided_{0};
+  /** Evictions that had to write a dirty victim back in the foreground. */
+  uint64_t foreground_writes_{0};
+};
+
 /**
  * BufferPoolManager reads disk pages to and from its internal buffer pool.
+ *
+ * The pool is split into one or more shards. Every page id maps to exactly one shard, and each shard has its own
+ * frames, page table, free list, replacer and latch, so operations on pages in different shards never contend.
+ *
+ * Disk I/O never happens under a shard latch. A miss claims a frame, publishes it in the page table pinned and marked
+ * as doing I/O, and then drops the latch to write back the victim and read in the page. Other requesters of either
+ * page wait on the frame's condition variable until the I/O is done.
+ *
+ * Hits and unpins take no latch at all. The page table supports lock-free lookups, and pin counts are atomic. A hit
+ * pins the frame it found and then checks that the frame still holds the page. To reclaim a frame, the latch holder
+ * swings its pin count from 0 to FRAME_LOCKED, which makes concurrent hits back off to the latched path. Hits also
+ * bypass the replacer's Pin: resident frames always stay in it, and victims whose pin count is not 0 are skipped. LRU-K
+ * records the time of each hit through its latch-free RecordAccess; for CLOCK, a hit sets a bit that is passed on when
+ * the replacer offers the frame as a victim.
+ *
+ * An optional background writer keeps the frames that the replacer is going to evict next clean, so that eviction
+ * rarely has to write back a dirty victim in the foreground.
+ *
+ * Prefetch requests are served by PREFETCH_WORKERS prefetcher threads that are started on the first request. They
+ * load the pages like a fetch would and unpin them right away, so that a later fetch hits. A list of pages is split
+ * among the prefetchers, so that its reads overlap. A chain is followed one page at a time, since each page names
+ * the next, but different chains overlap.
  */
 class BufferPoolManager {
  public:
@@ -36,14 +89,58 @@ class BufferPoolManager {
    * @param pool_size the size of the buffer pool
    * @param disk_manager the disk manager
    * @param log_manager the log manager (for testing only: nullptr = disable logging)
+   * @param num_instances the number of independent shards the pool is split into
+   * @param replacer_policy the replacement policy used by every shard
    */
-  BufferPoolManager(size_t pool_size, DiskManager *disk_manager, LogManager *log_manager = nullptr);
+  BufferPoolManager(size_t pool_size, DiskManager *disk_manager, LogManager *log_manager = nullptr,
+                    size_t num_instances = 1, ReplacerPolicy replacer_policy = ReplacerPolicy::CLOCK);
 
   /**
-   * Destroys an existing BufferPoolManager.
+   * Destroys an existing BufferPoolManager. Stops the background writer and the prefetcher if they are running.
+   * Prefetch requests that were not started yet are dropped.
    */
   ~BufferPoolManager();
 
+  /**
+   * Start the background writer thread. In every round it looks ahead of the replacer in each shard and writes back
+   * dirty, unpinned upcoming victims until the free frames and the clean upcoming victims reach the target. Pages
+   * whose log records are not on disk yet are skipped. The writer sleeps between rounds that write nothing, and is
+   * woken early by evictions that had to write in the foreground.
+   * @param clean_target the number of clean frames to keep ready in every shard
+   * @param interval how long to sleep between idle rounds
+   */
+  void RunBackgroundWriter(size_t clean_target = BG_WRITER_CLEAN_TARGET,
+                           std::chrono::milliseconds interval = BG_WRITER_INTERVAL);
+
+  /** Stop and join the background writer thread, and log its statistics. */
+  void StopBackgroundWriter();
+
+  /** @return the background writer statistics so far */
+  BackgroundWriterStats GetBackgroundWriterStats();
+
+  /**
+   * Load pages into the buffer pool in the background, without leaving them pinned. This is only a hint: the request
+   * is dropped if PREFETCH_QUEUE_DEPTH requests are already waiting, and pages that cannot get a frame are skipped.
+   * @param page_ids the pages to load, in order
+   * @param strategy the buffer access strategy to load the pages through, or nullptr for the shared pool. It must
+   * outlive the request, which its destructor takes care of.
+   */
+  void PrefetchPages(const std::vector<page_id_t> &page_ids, BufferAccessStrategy *strategy = nullptr);
+
+  /**
+   * Load a chain of linked pages into the buffer pool in the background, like PrefetchPages.
+   * @param first_page_id the first page of the chain
+   * @param count the number of pages to load at most
+   * @param next_page_id returns the page after the given one, or INVALID_PAGE_ID at the end of the chain. It is
+   * called with the page read latched.
+   * @param strategy the buffer access strategy to load the pages through, or nullptr for the shared pool
+   */
+  void PrefetchChain(page_id_t first_page_id, size_t count, std::function<page_id_t(Page *)> next_page_id,
+                     BufferAccessStrategy *strategy = nullptr);
+
+  /** Block until every prefetch request issued so far has been served. */
+  void WaitForPrefetches();
+
   /** Grading function. Do not modify! */
   Page *FetchPage(page_id_t page_id, bufferpool_callback_fn callback = nullptr) {
     GradingCallback(callback, CallbackType::BEFORE, page_id);
@@ -52,6 +149,20 @@ class BufferPoolManager {
     return result;
   }
 
+  /**
+   * Fetch a page through a buffer access strategy. A miss recycles the frames of the strategy's ring.
+   * @param page_id id of the page to fetch
+   * @param callback callback function to be invoked, or nullptr
+   * @param strategy the buffer access strategy to load the page through, or nullptr for the shared pool
+   * @return the requested page, or nullptr if it cannot be fetched
+   */
+  Page *FetchPage(page_id_t page_id, bufferpool_callback_fn callback, BufferAccessStrategy *strategy) {
+    GradingCallback(callback, CallbackType::BEFORE, page_id);
+    auto *result = FetchPageImpl(page_id, strategy);
+    GradingCallback(callback, CallbackType::AFTER, page_id);
+    return result;
+  }
+
   /** Grading function. Do not modify! */
   bool UnpinPage(page_id_t page_id, bool is_dirty, bufferpool_callback_fn callback = nullptr) {
     GradingCallback(callback, CallbackType::BEFORE, page_id);
@@ -76,6 +187,23 @@ class BufferPoolManager {
     return result;
   }
 
+  /**
+   * Create a new page through a buffer access strategy or an extent reservation. A page made through a strategy goes
+   * into a frame of its ring, and one made through a reservation gets the next page of the reserved extent.
+   * @param[out] page_id id of the created page
+   * @param callback callback function to be invoked, or nullptr
+   * @param strategy the buffer access strategy to place the page through, or nullptr for the shared pool
+   * @param extent the extent reservation to take the page id from, or nullptr to allocate a single page
+   * @return the new page, or nullptr if all frames are pinned
+   */
+  Page *NewPage(page_id_t *page_id, bufferpool_callback_fn callback, BufferAccessStrategy *strategy,
+                ExtentReservation *extent = nullptr) {
+    GradingCallback(callback, CallbackType::BEFORE, INVALID_PAGE_ID);
+    auto *result = NewPageImpl(page_id, strategy, extent);
+    GradingCallback(callback, CallbackType::AFTER, *page_id);
+    return result;
+  }
+
   /** Grading function. Do not modify! */
   bool DeletePage(page_id_t page_id, bufferpool_callback_fn callback = nullptr) {
     GradingCallback(callback, CallbackType::BEFORE, page_id);
@@ -97,7 +225,247 @@ class BufferPoolManager {
   /** @return size of the buffer pool */
   size_t GetPoolSize() { return pool_size_; }
 
+  /** @return the number of shards in the buffer pool */
+  size_t GetNumInstances() { return num_instances_; }
+
+  /** @return the replacement policy of the buffer pool */
+  ReplacerPolicy GetReplacerPolicy() { return replacer_policy_; }
+
+  /**
+   * Make a buffer access strategy for a bulk operation on this buffer pool.
+   * Like in PostgreSQL, a ring never takes more than an eighth of the pool, but it has at least MIN_RING_SIZE frames
+   * per shard.
+   * @param type the kind of access
+   * @return a strategy with empty rings
+   */
+  std::unique_ptr<BufferAccessStrategy> GetAccessStrategy(AccessStrategyType type);
+
+  /**
+   * Make an extent reservation, so that the pages a table or index creates through it are contiguous on disk.
+   * @param extent_size the number of pages to reserve at a time
+   * @return a reservation without an extent yet
+   */
+  std::unique_ptr<ExtentReservation> GetExtentReservation(size_t extent_size = EXTENT_SIZE);
+
+  /**
+   * Take a snapshot of the dirty page table for a fuzzy checkpoint, without stopping anybody.
+   * @return every page that changed since it was last written or is pinned, with a recLSN that no change to it is
+   * older than
+   */
+  std::vector<std::pair<page_id_t, lsn_t>> GetDirtyPageTable();
+
  protected:
+  /**
+   * A shard owns a contiguous slice of the frames in pages_, plus the bookkeeping for the pages cached there.
+   * Frame ids inside a shard are relative to its first frame.
+   */
+  class Shard {
+   public:
+    /**
+     * Set up a shard over a slice of frames.
+     * @param pages the first frame of this shard
+     * @param pool_size the number of frames in this shard
+     * @param replacer_policy the replacement policy of this shard
+     */
+    Shard(Page *pages, size_t pool_size, ReplacerPolicy replacer_policy)
+        : pages_(pages),
+          pool_size_(pool_size),
+          page_table_(pool_size),
+          io_in_progress_(pool_size),
+          accessed_(pool_size),
+          cleaned_(pool_size),
+          io_cv_(pool_size) {
+      if (replacer_policy == ReplacerPolicy::LRU_K) {
+        replacer_ = new LRUKReplacer(pool_size, LRUK_REPLACER_K, LRUK_CORRELATED_PERIOD);
+      } else {
+        replacer_ = new ClockReplacer(pool_size);
+      }
+      // Initially, every page is in the free list.
+      for (size_t i = 0; i < pool_size_; ++i) {
+        free_list_.push_back(i);
+      }
+    }
+
+    ~Shard() { delete replacer_; }
+
+    DISALLOW_COPY_AND_MOVE(Shard);
+
+    /** First frame of this shard. */
+    Page *pages_{nullptr};
+    /** Number of frames in this shard. */
+    size_t pool_size_{0};
+    /** Page table for keeping track of the pages in this shard. Lookups do not need the latch, changes do. */
+    PageTable page_table_;
+    /** Replacer to find frames of this shard for replacement. Holds every resident frame that is not doing I/O. */
+    Replacer *replacer_{nullptr};
+    /** List of free frames of this shard. */
+    std::list<frame_id_t> free_list_;
+    /** Dirty victims that are still being written back, and the frame they are being written from. */
+    std::unordered_map<page_id_t, frame_id_t> evicting_;
+    /** True while a frame is being written back or read in. Such a frame is always pinned. Read without the latch. */
+    std::vector<std::atomic<bool>> io_in_progress_;
+    /** Set by hits the replacer does not record itself, and consumed when the replacer offers the frame as a victim. */
+    std::vector<std::atomic<bool>> accessed_;
+    /** Set when the background writer cleans a frame, and cleared when the frame is claimed. */
+    std::vector<std::atomic<bool>> cleaned_;
+    /** Signalled when the I/O on a frame finishes. */
+    std::vector<std::condition_variable> io_cv_;
+    /** Protects everything above except for lookups, as well as reclaiming and loading the frames of this shard. */
+    std::mutex latch_;
+  };
+
+  /** @return the index of the shard that page_id belongs to */
+  size_t GetShardIndex(page_id_t page_id) { return static_cast<size_t>(page_id) % num_instances_; }
+
+  /** @return the shard that page_id belongs to */
+  Shard *GetShard(page_id_t page_id) { return shards_[GetShardIndex(page_id)].get(); }
+
+  /** Pin count of a frame that is being reclaimed. Far enough below 0 that racing hits cannot bring it back up. */
+  static constexpr int FRAME_LOCKED = INT_MIN / 2;
+
+  /**
+   * Lock a frame for reclaiming, if nobody has it pinned. The caller must hold the shard latch.
+   * @param page the frame
+   * @return true if the frame was unpinned and is now locked
+   */
+  static bool LockFrame(Page *page);
+
+  /**
+   * Unlock a frame locked by LockFrame.
+   * @param page the frame
+   * @param pin_count the pin count the frame is left with
+   */
+  static void UnlockFrame(Page *page, int pin_count);
+
+  /**
+   * Pin a page that the page table maps to a frame, without the shard latch.
+   * @param shard the shard that page_id belongs to
+   * @param page_id the page
+   * @param frame_id the frame the page table returned for the page
+   * @return false if the frame no longer holds the page, is being reclaimed or is still reading the page in
+   */
+  bool TryPinResident(Shard *shard, page_id_t page_id, frame_id_t frame_id);
+
+  /**
+   * Record a hit on a frame that was pinned without the replacer: in the replacer if it keeps the time of such hits,
+   * otherwise in accessed_, for FindVictim to pass on. Does not need the shard latch.
+   * @param shard the shard the frame belongs to
+   * @param frame_id the frame that was hit
+   */
+  static void RecordHit(Shard *shard, frame_id_t frame_id);
+
+  /**
+   * Ask the replacer for victims until one can be locked. The caller must hold the shard latch.
+   * @param shard the shard to find a victim in
+   * @param[out] frame_id the victim, locked
+   * @return false if every frame in the shard is pinned
+   */
+  bool FindVictim(Shard *shard, frame_id_t *frame_id);
+
+  /**
+   * Claim a frame for page_id, from the strategy's ring first, then from the free list and then from the replacer,
+   * and publish it in the page table pinned and marked as doing I/O. The caller must hold the shard latch, and must
+   * call FinishIO once the frame holds the right data.
+   * @param shard the shard that page_id belongs to
+   * @param page_id the page that will live in the frame
+   * @param[out] frame_id the frame that was claimed
+   * @param[out] victim_page_id the dirty victim that still has to be written back, or INVALID_PAGE_ID
+   * @param strategy the buffer access strategy of the caller, or nullptr
+   * @return false if every frame in the shard is pinned
+   */
+  bool ClaimFrame(Shard *shard, page_id_t page_id, frame_id_t *frame_id, page_id_t *victim_page_id,
+                  BufferAccessStrategy *strategy);
+
+  /**
+   * Lock the frame in the next slot of the strategy's ring, if it can be reused. The caller must hold the shard
+   * latch.
+   * @param shard the shard whose ring is used
+   * @param shard_index the index of that shard
+   * @param strategy the buffer access strategy of the caller
+   * @param[out] frame_id the reusable frame
+   * @return false if the slot is empty, or its frame is in use or was taken over by another page
+   */
+  bool TakeRingFrame(Shard *shard, size_t shard_index, BufferAccessStrategy *strategy, frame_id_t *frame_id);
+
+  /**
+   * Drop the page in a locked frame from the page table. The caller must hold the shard latch.
+   * @param shard the shard that owns the frame
+   * @param frame_id the frame being reclaimed
+   * @param[out] victim_page_id the page if it is dirty and has to be written back, otherwise left alone
+   */
+  void EvictFrame(Shard *shard, frame_id_t frame_id, page_id_t *victim_page_id);
+
+  /**
+   * Write a dirty victim back from a claimed frame and let its waiters retry. Called without the shard latch.
+   * @param shard the shard that owns the frame
+   * @param frame_id the frame claimed by ClaimFrame
+   * @param victim_page_id the page whose data the frame still holds
+   */
+  void WriteBackVictim(Shard *shard, frame_id_t frame_id, page_id_t victim_page_id);
+
+  /**
+   * Clear the I/O mark on a claimed frame and wake its waiters. The caller must hold the shard latch.
+   * @param shard the shard that owns the frame
+   * @param frame_id the frame claimed by ClaimFrame
+   */
+  void FinishIO(Shard *shard, frame_id_t frame_id);
+
+  /**
+   * A prefetch request. A chain request holds only the first page in page_ids_ and finds the rest with
+   * next_page_id_.
+   */
+  struct PrefetchRequest {
+    std::vector<page_id_t> page_ids_;
+    size_t count_{0};
+    std::function<page_id_t(Page *)> next_page_id_;
+    BufferAccessStrategy *strategy_{nullptr};
+  };
+
+  /**
+   * Queue a prefetch request, starting the prefetcher if needed.
+   * @param request the request
+   */
+  void EnqueuePrefetch(PrefetchRequest &&request);
+
+  /** Stop and join the prefetchers, dropping the requests that have not started. */
+  void StopPrefetcher();
+
+  /** Body of the prefetcher threads. */
+  void PrefetchLoop();
+
+  /**
+   * Load the pages of a prefetch request. Called without any latch.
+   * @param request the request
+   */
+  void RunPrefetch(const PrefetchRequest &request);
+
+  /** Body of the background writer thread. */
+  void BackgroundWriterLoop(size_t clean_target, std::chrono::milliseconds interval);
+
+  /**
+   * Write back dirty upcoming victims of a shard until it has enough clean frames. Called without the shard latch.
+   * @param shard the shard to clean
+   * @param clean_target the number of clean frames to keep ready
+   * @return the number of pages written
+   */
+  size_t CleanShard(Shard *shard, size_t clean_target);
+
+  /**
+   * Write a page image to disk, waiting for the log to cover its LSN first. Called without the shard latch.
+   * @param page_id the page to write
+   * @param page_data the page image
+   */
+  void WritePageData(page_id_t page_id, const char *page_data);
+
+  /** @return the LSN the next log record will get, or 0 without a log manager */
+  lsn_t GetNextLSN() { return log_manager_ != nullptr ? log_manager_->GetNextLSN() : 0; }
+
+  /** Clear the dirty flag and the recLSN of a page that is about to be written or dropped. */
+  static void MarkClean(Page *page) {
+    page->is_dirty_ = false;
+    page->rec_lsn_ = INVALID_LSN;
+  }
+
   /**
    * Grading function. Do not modify!
    * Invokes the callback function if it is not null.
@@ -114,9 +482,10 @@ class BufferPoolManager {
   /**
    * Fetch the requested page from the buffer pool.
    * @param page_id id of page to be fetched
+   * @param strategy the buffer access strategy to use on a miss, or nullptr for the shared pool
    * @return the requested page
    */
-  Page *FetchPageImpl(page_id_t page_id);
+  Page *FetchPageImpl(page_id_t page_id, BufferAccessStrategy *strategy = nullptr);
 
   /**
    * Unpin the target page from the buffer pool.
@@ -136,9 +505,11 @@ class BufferPoolManager {
   /**
    * Creates a new page in the buffer pool.
    * @param[out] page_id id of created page
+   * @param strategy the buffer access strategy to take the frame from, or nullptr for the shared pool
+   * @param extent the extent reservation to take the page id from, or nullptr to allocate a single page
    * @return nullptr if no new pages could be created, otherwise pointer to new page
    */
-  Page *NewPageImpl(page_id_t *page_id);
+  Page *NewPageImpl(page_id_t *page_id, BufferAccessStrategy *strategy = nullptr, ExtentReservation *extent = nullptr);
 
   /**
    * Deletes a page from the buffer pool.
@@ -154,19 +525,43 @@ class BufferPoolManager {
 
   /** Number of pages in the buffer pool. */
   size_t pool_size_;
+  /** Number of shards in the buffer pool. */
+  size_t num_instances_;
+  /** Replacement policy of every shard. */
+  ReplacerPolicy replacer_policy_;
   /** Array of buffer pool pages. */
   Page *pages_;
+  /** Shards, each owning a slice of pages_. */
+  std::vector<std::unique_ptr<Shard>> shards_;
   /** Pointer to the disk manager. */
   DiskManager *disk_manager_ __attribute__((__unused__));
   /** Pointer to the log manager. */
   LogManager *log_manager_ __attribute__((__unused__));
-  /** Page table for keeping track of buffer pool pages. */
-  std::unordered_map<page_id_t, frame_id_t> page_table_;
-  /** Replacer to find unpinned pages for replacement. */
-  Replacer *replacer_;
-  /** List of free pages. */
-  std::list<frame_id_t> free_list_;
-  /** This latch protects shared data structures. We recommend updating this comment to describe what it protects. */
-  std::mutex latch_;
+
+  /** The background writer thread, or nullptr if it is not running. */
+  std::thread *bg_writer_thread_{nullptr};
+  /** True while the background writer should keep running. */
+  std::atomic<bool> bg_writer_running_{false};
+  /** Protects the background writer's sleep, so that it can be woken early. */
+  std::mutex bg_writer_latch_;
+  std::condition_variable bg_writer_cv_;
+  /** When the background writer was started and, once it stopped, when it stopped. */
+  std::chrono::steady_clock::time_point bg_writer_start_;
+  std::chrono::steady_clock::time_point bg_writer_stop_;
+  std::atomic<uint64_t> bg_pages_written_{0};
+  std::atomic<uint64_t> stalls_avoided_{0};
+  std::atomic<uint64_t> foreground_writes_{0};
+
+  /** The prefetcher threads, empty if they were not started. */
+  std::vector<std::thread> prefetch_threads_;
+  /** True while the prefetchers should keep running. Protected by prefetch_latch_. */
+  bool prefetch_running_{false};
+  /** The number of prefetchers serving a request. Protected by prefetch_latch_. */
+  size_t prefetch_busy_{0};
+  /** Requests waiting for a prefetcher. Protected by prefetch_latch_. */
+  std::deque<PrefetchRequest> prefetch_queue_;
+  std::mutex prefetch_latch_;
+  /** Signalled when a request is queued, when a prefetcher goes idle and when they should stop. */
+  std::condition_variable prefetch_cv_;
 };
 }  // namespace bustub
@@ -43,6 +43,8 @@ class ClockReplacer : public Replacer {
 
   void Unpin(frame_id_t frame_id) override;
 
+  void UpcomingVictims(size_t count, std::vector<frame_id_t> *frame_ids) override;
+
   size_t Size() override;
 
  private:
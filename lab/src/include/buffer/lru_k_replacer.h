@@ -0,0 +1,114 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// lru_k_replacer.h
+//
+// Identification: src/include/buffer/lru_k_replacer.h
+//
+// Copyright (c) 2015-2019, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+#include <atomic>
+#include <deque>
+#include <mutex>  // NOLINT
+#include <tuple>
+#include <vector>
+
+#include "buffer/replacer.h"
+#include "common/config.h"
+
+namespace bustub {
+
+static constexpr size_t LRUK_REPLACER_K = 2;         // references tracked per frame by the buffer pool's LRU-K
+static constexpr size_t LRUK_CORRELATED_PERIOD = 0;  // correlated reference period of the buffer pool's LRU-K
+
+/**
+ * LRUKReplacer implements the LRU-K replacement policy (O'Neil et al., SIGMOD 1993).
+ *
+ * The victim is the evictable frame whose K-th most recent reference lies furthest in the past. Frames with fewer than
+ * K references have an infinite backward K-distance and are evicted first, least recently used first, so pages that
+ * a sequential scan touches once do not push out pages that are referenced repeatedly.
+ *
+ * References that follow the previous one within the correlated reference period count as a single reference. Time is
+ * logical: every recorded reference advances it by one.
+ *
+ * References recorded through RecordAccess take no latch. Each frame keeps the times of its last K such references in
+ * a small ring, which is merged into the frame's history the next time the replacer looks at the frame.
+ */
+class LRUKReplacer : public Replacer {
+ public:
+  /**
+   * Create a new LRUKReplacer.
+   * @param num_pages the maximum number of pages the LRUKReplacer will be required to store
+   * @param k the number of references tracked per frame
+   * @param correlated_reference_period references closer than this to the previous one are treated as correlated
+   */
+  LRUKReplacer(size_t num_pages, size_t k, size_t correlated_reference_period = 0);
+
+  /**
+   * Destroys the LRUKReplacer.
+   */
+  ~LRUKReplacer() override;
+
+  bool Victim(frame_id_t *frame_id) override;
+
+  /** Pins a frame and records a reference to it. */
+  void Pin(frame_id_t frame_id) override;
+
+  void Unpin(frame_id_t frame_id) override;
+
+  /** Records a reference to a frame at the current time, without the latch. */
+  bool RecordAccess(frame_id_t frame_id) override;
+
+  void Remove(frame_id_t frame_id) override;
+
+  void UpcomingVictims(size_t count, std::vector<frame_id_t> *frame_ids) override;
+
+  size_t Size() override;
+
+ private:
+  /** Reference history of a single frame. */
+  struct FrameHistory {
+    /** Times of the last K uncorrelated references, most recent first. */
+    std::deque<uint64_t> history_;
+    /** Time of the last reference, correlated or not. */
+    uint64_t last_reference_{0};
+    /** Number of references recorded through RecordAccess that are already in history_. */
+    uint64_t merged_accesses_{0};
+    bool evictable_{false};
+  };
+
+  /**
+   * Eviction order of an evictable frame; smaller keys are evicted first. The caller must hold the latch.
+   * @param frame_id the frame
+   * @return (correlated, finite K-distance, time the K-distance is measured from)
+   */
+  std::tuple<bool, bool, uint64_t> EvictionKey(frame_id_t frame_id) const;
+
+  /**
+   * Record a reference to a frame. The caller must hold the latch.
+   * @param frame_id the frame
+   * @param now the time of the reference, no earlier than the frame's last reference
+   */
+  void RecordReference(frame_id_t frame_id, uint64_t now);
+
+  /** Move the references recorded through RecordAccess into the history of a frame. The caller must hold the latch. */
+  void MergeAccesses(frame_id_t frame_id);
+
+  size_t k_;
+  size_t correlated_reference_period_;
+  std::atomic<uint64_t> current_time_{0};
+  size_t num_evictable_{0};
+  std::vector<FrameHistory> frames_;
+  /** Number of references recorded through RecordAccess, per frame. */
+  std::vector<std::atomic<uint64_t>> num_accesses_;
+  /** Times of the last K references recorded through RecordAccess, as a ring of K slots per frame. */
+  std::vector<std::atomic<uint64_t>> access_times_;
+  std::mutex latch_;
+};
+
+}  // namespace bustub
@@ -0,0 +1,92 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// page_table.h
+//
+// Identification: src/include/buffer/page_table.h
+//
+// Copyright (c) 2015-2019, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+
+#include "common/config.h"
+#include "common/macros.h"
+
+namespace bustub {
+
+/**
+ * PageTable maps the pages of a buffer pool shard to their frames.
+ *
+ * It is a fixed-capacity open-addressing table with linear probing. Each slot is a single atomic word holding both
+ * the page id and the frame id, so lookups never take a latch and never see a torn entry. Writers must be serialized
+ * by the caller. Deletion shifts the following entries back instead of leaving tombstones, so the table never fills
+ * up with dead slots.
+ *
+ * A lookup that races with a writer may miss an entry that is present, or return an entry that was just removed.
+ * Callers of Find must therefore treat a miss as "retry under the writers' latch" and validate a hit against the frame.
+ */
+class PageTable {
+ public:
+  /**
+   * Create an empty page table.
+   * @param max_entries the maximum number of pages that will be in the table at once
+   */
+  explicit PageTable(size_t max_entries);
+
+  DISALLOW_COPY_AND_MOVE(PageTable);
+
+  /**
+   * Look up the frame of a page. Does not need the writers' latch.
+   * @param page_id the page to look up
+   * @param[out] frame_id the frame the page is in
+   * @return true if the page was found
+   */
+  bool Find(page_id_t page_id, frame_id_t *frame_id) const;
+
+  /**
+   * Map a page to a frame, replacing its previous mapping if it has one. The caller must hold the writers' latch.
+   * @param page_id the page
+   * @param frame_id the frame the page is in
+   */
+  void Insert(page_id_t page_id, frame_id_t frame_id);
+
+  /**
+   * Remove the mapping of a page. The caller must hold the writers' latch.
+   * @param page_id the page
+   * @return true if the page was in the table
+   */
+  bool Remove(page_id_t page_id);
+
+ private:
+  /** Marks an unused slot. Never a valid entry, since INVALID_PAGE_ID is never inserted. */
+  static constexpr uint64_t EMPTY_SLOT = UINT64_MAX;
+
+  static uint64_t MakeEntry(page_id_t page_id, frame_id_t frame_id) {
+    return (static_cast<uint64_t>(static_cast<uint32_t>(page_id)) << 32) | static_cast<uint32_t>(frame_id);
+  }
+
+  static page_id_t EntryPageId(uint64_t entry) { return static_cast<page_id_t>(entry >> 32); }
+
+  static frame_id_t EntryFrameId(uint64_t entry) { return static_cast<frame_id_t>(entry & UINT32_MAX); }
+
+  /** @return the slot at which the probe for page_id starts */
+  size_t HomeSlot(page_id_t page_id) const {
+    // Fibonacci hashing, so that the page ids of one shard, which share a residue, still spread over the table.
+    return (static_cast<uint64_t>(static_cast<uint32_t>(page_id)) * 11400714819323198485ULL) >> shift_;
+  }
+
+  /** Number of slots minus one. The number of slots is a power of two. */
+  size_t mask_;
+  /** 64 minus the log2 of the number of slots. */
+  size_t shift_;
+  std::unique_ptr<std::atomic<uint64_t>[]> slots_;
+};
+
+}  // namespace bustub
@@ -12,10 +12,15 @@
 
 #pragma once
 
+#include <vector>
+
 #include "common/config.h"
 
 namespace bustub {
 
+/** The replacement policies that a buffer pool can be constructed with. */
+enum class ReplacerPolicy { CLOCK, LRU_K };
+
 /**
  * Replacer is an abstract class that tracks page usage.
  */
@@ -43,6 +48,28 @@ class Replacer {
    */
   virtual void Unpin(frame_id_t frame_id) = 0;
 
+  /**
+   * Records a reference to a frame that was pinned without going through the replacer, such as a buffer pool hit that
+   * took no latch. Safe to call concurrently with everything else.
+   * @param frame_id the id of the frame that was referenced
+   * @return false if the replacer does not keep the time of such references, so the caller has to track them itself
+   */
+  virtual bool RecordAccess(frame_id_t frame_id) { return false; }
+
+  /**
+   * Forgets a frame whose page was deleted. The frame is no longer a victim candidate and its usage history is dropped.
+   * @param frame_id the id of the frame to remove
+   */
+  virtual void Remove(frame_id_t frame_id) { Pin(frame_id); }
+
+  /**
+   * Lists the frames that Victim would return next, in order, without removing them. Replacers that cannot look
+   * ahead list nothing.
+   * @param count the maximum number of frames to list
+   * @param[out] frame_ids the upcoming victims
+   */
+  virtual void UpcomingVictims(size_t count, std::vector<frame_id_t> *frame_ids) { frame_ids->clear(); }
+
   /** @return the number of elements in the replacer that can be victimized */
   virtual size_t Size() = 0;
 };
@@ -15,6 +15,7 @@
 #include "buffer/buffer_pool_manager.h"
 #include "common/config.h"
 #include "concurrency/lock_manager.h"
+#include "concurrency/transaction_manager.h"
 #include "recovery/checkpoint_manager.h"
 #include "recovery/log_manager.h"
 #include "storage/disk/disk_manager.h"
@@ -23,7 +24,12 @@ namespace bustub {
 
 class BustubInstance {
  public:
-  explicit BustubInstance(const std::string &db_file_name) {
+  /**
+   * @param db_file_name the database file
+   * @param concurrency_mode how transactions are isolated from each other
+   */
+  explicit BustubInstance(const std::string &db_file_name,
+                          ConcurrencyMode concurrency_mode = ConcurrencyMode::TWO_PHASE_LOCKING) {
     enable_logging = false;
 
     // storage related
@@ -36,17 +42,17 @@ class BustubInstance {
 
     // txn related
     lock_manager_ = new LockManager(TwoPLMode::STRICT, DeadlockMode::PREVENTION);  // S2PL
-    transaction_manager_ = new TransactionManager(lock_manager_, log_manager_);
+    transaction_manager_ = new TransactionManager(lock_manager_, log_manager_, concurrency_mode);
 
     // checkpoints
-    checkpoint_manager_ = new CheckpointManager(transaction_manager_, log_manager_, buffer_pool_manager_);
+    checkpoint_manager_ = new CheckpointManager(transaction_manager_, log_manager_, buffer_pool_manager_, disk_manager_);
   }
 
   ~BustubInstance() {
+    delete checkpoint_manager_;
     if (enable_logging) {
       log_manager_->StopFlushThread();
     }
-    delete checkpoint_manager_;
     delete log_manager_;
     delete buffer_pool_manager_;
     delete lock_manager_;
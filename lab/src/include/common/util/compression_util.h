@@ -0,0 +1,46 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// compression_util.h
+//
+// Identification: src/include/common/util/compression_util.h
+//
+// Copyright (c) 2015-2019, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+#include <cstddef>
+
+namespace bustub {
+
+/**
+ * CompressionUtil compresses blocks of bytes in the LZ4 block format: a sequence of literal runs, each followed by a
+ * match that copies earlier output. It favors speed over ratio, and keeps no state between blocks.
+ */
+class CompressionUtil {
+ public:
+  /**
+   * Compress a block.
+   * @param src the bytes to compress
+   * @param size the number of bytes to compress
+   * @param[out] dest where the compressed block goes
+   * @param capacity the size of dest
+   * @return the size of the compressed block, or 0 if it does not fit into capacity
+   */
+  static size_t Compress(const char *src, size_t size, char *dest, size_t capacity);
+
+  /**
+   * Decompress a block.
+   * @param src the compressed block
+   * @param size the size of the compressed block
+   * @param[out] dest where the bytes go
+   * @param dest_size the number of bytes the block decompresses to
+   * @return false if the block is malformed or does not decompress to exactly dest_size bytes
+   */
+  static bool Decompress(const char *src, size_t size, char *dest, size_t dest_size);
+};
+
+}  // namespace bustub
@@ -13,10 +13,12 @@
 #pragma once
 
 #include <algorithm>
+#include <array>
 #include <condition_variable>  // NOLINT
 #include <list>
 #include <memory>
 #include <mutex>  // NOLINT
+#include <set>
 #include <unordered_map>
 #include <utility>
 #include <vector>
@@ -34,26 +36,84 @@ enum class TwoPLMode { REGULAR, STRICT };
 /** Deadlock mode. */
 enum class DeadlockMode { PREVENTION, DETECTION };
 
+static constexpr size_t LOCK_ESCALATION_THRESHOLD = 1000;  // row locks in one table before it is locked whole
+static constexpr size_t LOCK_TABLE_PARTITIONS = 64;         // independently latched partitions of the lock table
+
 /**
- * LockManager handles transactions asking for locks on records.
+ * LockManager handles transactions asking for locks on tables, pages and records.
+ *
+ * Locks form a hierarchy: a row lock taken with LockRow first takes an intention lock (IS or IX) on its table and its
+ * page, unless a lock on either already covers the row. Once a transaction took LOCK_ESCALATION_THRESHOLD row locks
+ * in a table, its table lock is escalated to S or X if nobody else is in the way, so that it needs no more row locks
+ * there. Tables are identified by the id of their first page.
+ *
+ * Every locked table, page and RID has a queue of requests. A request is granted once it is compatible with every
+ * request ahead of it, so requests are granted in FIFO order and a shared request does not pass a waiting exclusive
+ * one. An upgrade moves the transaction's request right behind the granted ones.
+ *
+ * The queues are spread over LOCK_TABLE_PARTITIONS partitions by the hash of their target, each with its own latch, so
+ * that locks on unrelated targets do not wait for each other. Each partition keeps the request nodes and the queues
+ * that were released, and reuses them for new ones instead of allocating.
+ *
+ * With DeadlockMode::PREVENTION, deadlocks are prevented with wound-wait: a transaction that asks for a lock wounds
+ * (aborts) every younger transaction ahead of it in the queue whose request conflicts with its own, and waits for the
+ * older ones. A wounded transaction notices at its next lock request, or right away if it is waiting for a lock.
+ *
+ * With DeadlockMode::DETECTION, the waits-for graph is kept up to date as requests wait and leave their queues, and
+ * a background thread aborts the youngest transaction on each cycle. The search for cycles only starts from the
+ * transactions that got new edges since the last search.
  */
 class LockManager {
-  enum class LockMode { SHARED, EXCLUSIVE };
+  /** The granularity of a lock. */
+  enum class LockLevel { TABLE, PAGE, ROW };
+
+  /** What a lock is on. Tables and pages only use the page id of rid_. */
+  struct LockTarget {
+    LockLevel level_;
+    RID rid_;
+
+    bool operator==(const LockTarget &other) const { return level_ == other.level_ && rid_ == other.rid_; }
+  };
+
+  struct LockTargetHash {
+    size_t operator()(const LockTarget &target) const {
+      return std::hash<RID>()(target.rid_) * 3 + static_cast<size_t>(target.level_);
+    }
+  };
 
   class LockRequest {
    public:
-    LockRequest(txn_id_t txn_id, LockMode lock_mode) : txn_id_(txn_id), lock_mode_(lock_mode), granted_(false) {}
+    LockRequest(Transaction *txn, LockMode lock_mode)
+        : txn_(txn), txn_id_(txn->GetTransactionId()), lock_mode_(lock_mode), granted_(false) {}
 
+    Transaction *txn_;
     txn_id_t txn_id_;
     LockMode lock_mode_;
     bool granted_;
   };
 
+  using RequestList = std::list<LockRequest>;
+
   class LockRequestQueue {
    public:
-    std::list<LockRequest> request_queue_;
+    RequestList request_queue_;
     std::condition_variable cv_;  // for notifying blocked transactions on this rid
-    bool upgrading_ = false;
+    bool upgrading_ = false;      // a row lock is being upgraded from shared to exclusive
+  };
+
+  using RequestIterator = RequestList::iterator;
+  using QueueMap = std::unordered_map<LockTarget, LockRequestQueue, LockTargetHash>;
+
+  /** A partition of the lock table. */
+  struct LockTablePartition {
+    /** Protects the partition. Waiting requests wait on their queue's cv_ with it. */
+    std::mutex latch_;
+    /** The queues of the targets in the partition. A queue is removed once it is empty. */
+    QueueMap queues_;
+    /** Request nodes that left their queue. New requests are spliced out of here. */
+    RequestList free_requests_;
+    /** Map nodes of removed queues, reused for new queues. */
+    std::vector<QueueMap::node_type> free_queues_;
   };
 
  public:
@@ -114,13 +174,69 @@ class LockManager {
   bool LockUpgrade(Transaction *txn, const RID &rid);
 
   /**
-   * Release the lock held by the transaction.
+   * Release the lock held by the transaction. With TwoPLMode::STRICT, locks are only released once the transaction
+   * committed or aborted.
    * @param txn the transaction releasing the lock, it should actually hold the lock
    * @param rid the RID that is locked by the transaction
    * @return true if the unlock is successful, false otherwise
    */
   bool Unlock(Transaction *txn, const RID &rid);
 
+  /**
+   * Acquire a lock on a table, or strengthen the one the transaction holds.
+   * @param txn the transaction requesting the lock
+   * @param table_id the id of the first page of the table
+   * @param lock_mode the lock mode
+   * @return true if the lock is granted, false otherwise
+   */
+  bool LockTable(Transaction *txn, page_id_t table_id, LockMode lock_mode);
+
+  /**
+   * Acquire a lock on a page, or strengthen the one the transaction holds. The caller holds the matching intention
+   * lock on the table.
+   * @param txn the transaction requesting the lock
+   * @param page_id the id of the page
+   * @param lock_mode the lock mode
+   * @return true if the lock is granted, false otherwise
+   */
+  bool LockPage(Transaction *txn, page_id_t page_id, LockMode lock_mode);
+
+  /**
+   * Acquire a lock on a row of a table, with the intention locks above it. Nothing is locked if a table or page lock
+   * already covers the row.
+   * @param txn the transaction requesting the lock
+   * @param table_id the id of the first page of the table
+   * @param rid the row
+   * @param lock_mode LockMode::SHARED or LockMode::EXCLUSIVE
+   * @return true if the lock is granted, false otherwise
+   */
+  bool LockRow(Transaction *txn, page_id_t table_id, const RID &rid, LockMode lock_mode);
+
+  /**
+   * Lock a row exclusively, with the intention lock on its page, unless that would wait. Never waits, so it may be
+   * called while holding a page latch. The caller holds an intention exclusive lock on the table.
+   * @param txn the transaction requesting the lock
+   * @param table_id the id of the first page of the table
+   * @param rid the row
+   * @return true if the lock is granted, false if another transaction is in the way or the transaction is aborted
+   */
+  bool TryLockRow(Transaction *txn, page_id_t table_id, const RID &rid);
+
+  /**
+   * Release a table lock held by the transaction. See Unlock.
+   * @return true if the unlock is successful, false otherwise
+   */
+  bool UnlockTable(Transaction *txn, page_id_t table_id);
+
+  /**
+   * Release a page lock held by the transaction. See Unlock.
+   * @return true if the unlock is successful, false otherwise
+   */
+  bool UnlockPage(Transaction *txn, page_id_t page_id);
+
+  /** Set how many row locks a transaction takes in a table before the table lock is escalated. */
+  inline void SetEscalationThreshold(size_t threshold) { escalation_threshold_ = threshold; }
+
   /*** Graph API ***/
   /**
    * Adds edge t1->t2
@@ -146,20 +262,120 @@ class LockManager {
   void RunCycleDetection();
 
  private:
-  TwoPLMode two_pl_mode_ __attribute__((__unused__));
+  TwoPLMode two_pl_mode_;
   DeadlockMode deadlock_mode_;
 
   bool Detection() { return deadlock_mode_ == DeadlockMode::DETECTION; }
   bool Prevention() { return deadlock_mode_ == DeadlockMode::PREVENTION; }
 
-  std::mutex latch_;
+  /**
+   * Check that the transaction may ask for a lock. Asking for one while shrinking aborts the transaction.
+   * @return true if the transaction may ask for a lock
+   */
+  bool CanLock(Transaction *txn);
+
+  /** @return true if holding a lock in mode held also grants mode wanted */
+  static bool Covers(LockMode held, LockMode wanted);
+
+  /** @return the weakest mode that covers both modes */
+  static LockMode Combine(LockMode held, LockMode wanted);
+
+  /**
+   * Lock a table or page, recording the lock in the transaction's map of them.
+   * @return true if the lock is granted
+   */
+  bool LockCoarse(Transaction *txn, const LockTarget &target, std::unordered_map<page_id_t, LockMode> *held_locks,
+                  LockMode lock_mode);
+
+  /**
+   * Queue a request and wait for it. If upgrade is true, the request replaces the one the transaction holds.
+   * @return true if the request was granted
+   */
+  bool Acquire(Transaction *txn, const LockTarget &target, LockMode lock_mode, bool upgrade);
+
+  /**
+   * Grant a request right away if nobody is in its way, or drop it.
+   * @return true if the request was granted
+   */
+  bool TryAcquire(Transaction *txn, const LockTarget &target, LockMode lock_mode);
+
+  /**
+   * Release the transaction's request on the target. Handles the two-phase locking rules.
+   * @return true if the transaction had a request there
+   */
+  bool Release(Transaction *txn, const LockTarget &target);
+
+  /** Escalate the transaction's table lock to S or X, unless another transaction's request is in the way. */
+  void Escalate(Transaction *txn, page_id_t table_id);
+  /** @return true if two transactions can hold locks in these modes on the same target at once */
+  static bool Compatible(LockMode mode1, LockMode mode2);
+
+  /** @return true if the requests are from different transactions and cannot be granted together */
+  static bool Conflicts(const LockRequest &r1, const LockRequest &r2);
+
+  /** @return the partition of the lock table the target belongs to */
+  LockTablePartition *PartitionOf(const LockTarget &target);
+
+  /** @return the queue of the target, which is created if there is none. The partition's latch is held. */
+  static LockRequestQueue *GetQueue(LockTablePartition *partition, const LockTarget &target);
+
+  /**
+   * Put a new request into a queue, reusing a free request node of the partition if there is one. The partition's
+   * latch is held.
+   * @param position the request goes right before this one
+   * @return the new request
+   */
+  static RequestIterator NewRequest(LockTablePartition *partition, LockRequestQueue *queue, RequestIterator position,
+                                    Transaction *txn, LockMode lock_mode);
+
+  /** @return true if the request is compatible with every request ahead of it in its queue */
+  static bool Grantable(LockRequestQueue *queue, RequestIterator request);
+
+  /**
+   * Abort every younger transaction ahead of the request whose request conflicts with it.
+   * @return the ids of the transactions that were aborted
+   */
+  static std::vector<txn_id_t> Wound(Transaction *txn, LockRequestQueue *queue, RequestIterator request);
+
+  /** Wake up the transaction if it waits for a lock. No partition latch may be held. */
+  void WakeUp(txn_id_t txn_id);
+
+  /**
+   * Wait until the request is granted, or the transaction is aborted, in which case the request is dropped.
+   * @param upgrade true if the request is the upgrade of the queue
+   * @return true if the request was granted
+   */
+  bool WaitForGrant(Transaction *txn, const LockTarget &target, LockTablePartition *partition,
+                    LockRequestQueue *queue, RequestIterator request, bool upgrade,
+                    std::unique_lock<std::mutex> *guard);
+
+  /** Remove a request from its queue, and the queue from the lock table if it is empty. */
+  void DropRequest(LockTablePartition *partition, const LockTarget &target, LockRequestQueue *queue,
+                   RequestIterator request);
+
+  /** Remove the edges of the waiters behind a request that leaves its place in the queue. */
+  void ClearWaitsFor(LockRequestQueue *queue, RequestIterator request);
+
+  /** Removes every edge from t1. */
+  void RemoveEdges(txn_id_t t1);
+
   std::atomic<bool> enable_cycle_detection_;
   std::thread *cycle_detection_thread_;
 
+  size_t escalation_threshold_{LOCK_ESCALATION_THRESHOLD};
+
   /** Lock table for lock requests. */
-  std::unordered_map<RID, LockRequestQueue> lock_table_;
-  /** Waits-for graph representation. */
+  std::array<LockTablePartition, LOCK_TABLE_PARTITIONS> partitions_;
+  /** Each waiting transaction and the target it waits for, so that aborting it can wake it up. */
+  std::unordered_map<txn_id_t, std::pair<Transaction *, LockTarget>> waiting_;
+  /** Protects waiting_. Taken after a partition latch, never before one. */
+  std::mutex waiting_latch_;
+  /** Waits-for graph representation, with the edges from each transaction sorted. */
   std::unordered_map<txn_id_t, std::vector<txn_id_t>> waits_for_;
+  /** The transactions that got new edges since the last search for cycles. */
+  std::set<txn_id_t> changed_;
+  /** Protects the graph. Taken after a partition latch. */
+  std::mutex waits_for_latch_;
 };
 
 }  // namespace bustub
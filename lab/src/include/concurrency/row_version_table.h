@@ -0,0 +1,77 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// row_version_table.h
+//
+// Identification: src/include/concurrency/row_version_table.h
+//
+// Copyright (c) 2015-2019, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+#include <array>
+#include <mutex>  // NOLINT
+#include <unordered_map>
+
+#include "common/macros.h"
+#include "common/rid.h"
+
+namespace bustub {
+
+static constexpr size_t ROW_VERSION_PARTITIONS = 64;  // independently latched partitions of the row version table
+
+/**
+ * RowVersionTable keeps a version word for every row, for optimistic concurrency control in the style of Silo.
+ *
+ * A version word counts the committed changes of its row, and has a lock bit that a committing transaction sets
+ * while it writes the row. Transactions remember the version words of the rows they read, and buffer their writes.
+ * At commit, a transaction locks the rows it writes, checks that the words of the rows it read did not change, and
+ * writes; unlocking a written row moves its version on. Rows that were never written have version 0.
+ *
+ * Rows are locked without waiting: a commit that finds one of its rows locked fails, so commits never wait for each
+ * other. Words are never removed, since a row that went back to version 0 would pass the check of a reader that saw
+ * it at version 0 before.
+ */
+class RowVersionTable {
+ public:
+  /** The bit of a version word that is set while the row is locked. */
+  static constexpr uint64_t LOCK_BIT = uint64_t{1} << 63;
+
+  RowVersionTable() = default;
+  ~RowVersionTable() = default;
+
+  DISALLOW_COPY_AND_MOVE(RowVersionTable);
+
+  /** @return the version word of the row */
+  uint64_t GetVersion(const RID &rid);
+
+  /**
+   * Lock a row, unless someone else holds it.
+   * @return true if the row was locked
+   */
+  bool TryLock(const RID &rid);
+
+  /**
+   * Unlock a row the caller locked.
+   * @param rid the row
+   * @param changed true if the row was written, so that it gets a new version
+   */
+  void Unlock(const RID &rid, bool changed);
+
+ private:
+  /** A partition of the table, picked by the hash of the RID. */
+  struct Partition {
+    std::mutex latch_;
+    std::unordered_map<RID, uint64_t> versions_;
+  };
+
+  /** @return the partition the row belongs to */
+  Partition *PartitionOf(const RID &rid);
+
+  std::array<Partition, ROW_VERSION_PARTITIONS> partitions_;
+};
+
+}  // namespace bustub
@@ -16,7 +16,10 @@
 #include <deque>
 #include <memory>
 #include <thread>  // NOLINT
+#include <unordered_map>
 #include <unordered_set>
+#include <utility>
+#include <vector>
 
 #include "common/config.h"
 #include "common/logger.h"
@@ -36,12 +39,22 @@ namespace bustub {
  **/
 enum class TransactionState { GROWING, SHRINKING, COMMITTED, ABORTED };
 
+/**
+ * Lock modes. Tables and pages also take the intention modes, which announce shared or exclusive locks below them.
+ */
+enum class LockMode { SHARED, EXCLUSIVE, INTENTION_SHARED, INTENTION_EXCLUSIVE, SHARED_INTENTION_EXCLUSIVE };
+
+/** Commit timestamps order the commits of snapshot isolation transactions. */
+using timestamp_t = uint64_t;
+
 /**
  * Type of write operation.
  */
 enum class WType { INSERT = 0, DELETE, UPDATE };
 
+class RowVersionTable;
 class TableHeap;
+class VersionStore;
 
 /**
  * WriteRecord tracks information related to a write.
@@ -70,7 +83,10 @@ class Transaction {
         txn_id_(txn_id),
         prev_lsn_(INVALID_LSN),
         shared_lock_set_{new std::unordered_set<RID>},
-        exclusive_lock_set_{new std::unordered_set<RID>} {
+        exclusive_lock_set_{new std::unordered_set<RID>},
+        table_lock_map_{new std::unordered_map<page_id_t, LockMode>},
+        page_lock_map_{new std::unordered_map<page_id_t, LockMode>},
+        row_lock_count_{new std::unordered_map<page_id_t, size_t>} {
     // Initialize the sets that will be tracked.
     write_set_ = std::make_shared<std::deque<WriteRecord>>();
     page_set_ = std::make_shared<std::deque<bustub::Page *>>();
@@ -120,6 +136,15 @@ class Transaction {
   /** @return true if rid is exclusively locked by this transaction */
   bool IsExclusiveLocked(const RID &rid) { return exclusive_lock_set_->find(rid) != exclusive_lock_set_->end(); }
 
+  /** @return the mode of each table lock, by the id of the table's first page */
+  inline std::shared_ptr<std::unordered_map<page_id_t, LockMode>> GetTableLockMap() { return table_lock_map_; }
+
+  /** @return the mode of each page lock, by page id */
+  inline std::shared_ptr<std::unordered_map<page_id_t, LockMode>> GetPageLockMap() { return page_lock_map_; }
+
+  /** @return the number of row locks taken in each table, by the id of the table's first page */
+  inline std::shared_ptr<std::unordered_map<page_id_t, size_t>> GetRowLockCount() { return row_lock_count_; }
+
   /** @return the current state of the transaction */
   inline TransactionState GetState() { return state_; }
 
@@ -129,6 +154,69 @@ class Transaction {
    */
   inline void SetState(TransactionState state) { state_ = state; }
 
+  /**
+   * Abort the transaction from another thread, unless it already committed or aborted. A committing transaction is
+   * only releasing its locks, and its COMMIT record may already be durable.
+   * @return true if the transaction was running and is now aborted
+   */
+  inline bool AbortIfRunning() {
+    TransactionState state = state_;
+    while (state == TransactionState::GROWING || state == TransactionState::SHRINKING) {
+      if (state_.compare_exchange_weak(state, TransactionState::ABORTED)) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  /** @return the version store the transaction reads its snapshot from, or nullptr if it reads under locks */
+  inline VersionStore *GetVersionStore() { return version_store_; }
+
+  /** @return the commit timestamp of the newest commit the transaction's snapshot includes */
+  inline timestamp_t GetReadTimestamp() { return read_ts_; }
+
+  /**
+   * Make the transaction read from a snapshot instead of taking shared locks.
+   * @param version_store the version store that keeps the older versions of tuples
+   * @param read_ts the commit timestamp of the newest commit the snapshot includes
+   */
+  inline void SetSnapshot(VersionStore *version_store, timestamp_t read_ts) {
+    version_store_ = version_store;
+    read_ts_ = read_ts;
+  }
+
+  /** @return the row versions the transaction validates against, or nullptr if it does not run optimistically */
+  inline RowVersionTable *GetRowVersionTable() { return row_version_table_; }
+
+  /**
+   * Make the transaction run optimistically: it takes no locks, buffers its writes and is validated at commit.
+   * @param row_version_table the version words of the rows
+   */
+  inline void SetRowVersionTable(RowVersionTable *row_version_table) { row_version_table_ = row_version_table; }
+
+  /** @return true if the transaction reads under shared locks, rather than from a snapshot or optimistically */
+  inline bool ReadsUnderLocks() { return version_store_ == nullptr && row_version_table_ == nullptr; }
+
+  /** @return the rows the transaction read, with the version word each had */
+  inline std::vector<std::pair<RID, uint64_t>> *GetReadSet() { return &read_set_; }
+
+  /** @return the updates and deletes the transaction holds back until it commits, oldest first */
+  inline std::vector<WriteRecord> *GetBufferedWrites() { return &buffered_writes_; }
+
+  /** @return the rows whose version word the transaction holds locked */
+  inline std::unordered_set<RID> *GetLockedRows() { return &locked_rows_; }
+
+  /** @return true while the transaction applies its buffered writes at commit, after it was validated */
+  inline bool IsApplyingBufferedWrites() { return applying_buffered_writes_; }
+
+  /**
+   * Mark the start or the end of applying the buffered writes.
+   * @param applying_buffered_writes true while the writes are applied
+   */
+  inline void SetApplyingBufferedWrites(bool applying_buffered_writes) {
+    applying_buffered_writes_ = applying_buffered_writes;
+  }
+
   /** @return the previous LSN */
   inline lsn_t GetPrevLSN() { return prev_lsn_; }
 
@@ -138,9 +226,27 @@ class Transaction {
    */
   inline void SetPrevLSN(lsn_t prev_lsn) { prev_lsn_ = prev_lsn; }
 
+  /** @return the LSN of the transaction's BEGIN record */
+  inline lsn_t GetBeginLSN() { return begin_lsn_; }
+
+  /**
+   * Set the LSN of the transaction's BEGIN record.
+   * @param begin_lsn the LSN of the BEGIN record
+   */
+  inline void SetBeginLSN(lsn_t begin_lsn) { begin_lsn_ = begin_lsn; }
+
+  /** @return the LSN of the transaction's COMMIT or ABORT record, or INVALID_LSN while it runs */
+  inline lsn_t GetEndLSN() { return end_lsn_; }
+
+  /**
+   * Set the LSN of the transaction's COMMIT or ABORT record.
+   * @param end_lsn the LSN of the COMMIT or ABORT record
+   */
+  inline void SetEndLSN(lsn_t end_lsn) { end_lsn_ = end_lsn; }
+
  private:
-  /** The current transaction state. */
-  TransactionState state_;
+  /** The current transaction state. Atomic, since the lock manager aborts transactions from other threads. */
+  std::atomic<TransactionState> state_;
   /** The thread ID, used in single-threaded transactions. */
   std::thread::id thread_id_;
   /** The ID of this transaction. */
@@ -148,18 +254,43 @@ class Transaction {
 
   /** The undo set of the transaction. */
   std::shared_ptr<std::deque<WriteRecord>> write_set_;
-  /** The LSN of the last record written by the transaction. */
-  lsn_t prev_lsn_;
+  /** The LSN of the last record written by the transaction. Atomic, since checkpoints read it while it runs. */
+  std::atomic<lsn_t> prev_lsn_;
+  /** The LSNs of the BEGIN record and of the COMMIT or ABORT record. Atomic, since checkpoints read them too. */
+  std::atomic<lsn_t> begin_lsn_{INVALID_LSN};
+  std::atomic<lsn_t> end_lsn_{INVALID_LSN};
 
   /** Concurrent index: the pages that were latched during index operation. */
   std::shared_ptr<std::deque<Page *>> page_set_;
   /** Concurrent index: the page IDs that were deleted during index operation.*/
   std::shared_ptr<std::unordered_set<page_id_t>> deleted_page_set_;
 
+  /** Snapshot isolation: the version store of the snapshot, or nullptr. */
+  VersionStore *version_store_{nullptr};
+  /** Snapshot isolation: the commit timestamp of the newest commit in the snapshot. */
+  timestamp_t read_ts_{0};
+
+  /** Optimistic concurrency control: the version words of the rows, or nullptr. */
+  RowVersionTable *row_version_table_{nullptr};
+  /** Optimistic concurrency control: the rows read, with the version word each had. */
+  std::vector<std::pair<RID, uint64_t>> read_set_;
+  /** Optimistic concurrency control: the updates and deletes to apply at commit. */
+  std::vector<WriteRecord> buffered_writes_;
+  /** Optimistic concurrency control: the rows whose version word is locked, the inserted ones and at commit all. */
+  std::unordered_set<RID> locked_rows_;
+  /** Optimistic concurrency control: true while the buffered writes are applied, so that they are not buffered again. */
+  bool applying_buffered_writes_{false};
+
   /** LockManager: the set of shared-locked tuples held by this transaction. */
   std::shared_ptr<std::unordered_set<RID>> shared_lock_set_;
   /** LockManager: the set of exclusive-locked tuples held by this transaction. */
   std::shared_ptr<std::unordered_set<RID>> exclusive_lock_set_;
+  /** LockManager: the table locks held by this transaction. */
+  std::shared_ptr<std::unordered_map<page_id_t, LockMode>> table_lock_map_;
+  /** LockManager: the page locks held by this transaction. */
+  std::shared_ptr<std::unordered_map<page_id_t, LockMode>> page_lock_map_;
+  /** LockManager: the row locks taken in each table, which decides when they are escalated. */
+  std::shared_ptr<std::unordered_map<page_id_t, size_t>> row_lock_count_;
 };
 
 }  // namespace bustub
@@ -13,24 +13,51 @@
 #pragma once
 
 #include <atomic>
+#include <condition_variable>  // NOLINT
+#include <functional>
+#include <memory>
+#include <mutex>  // NOLINT
 #include <unordered_map>
 #include <unordered_set>
+#include <utility>
+#include <vector>
 
 #include "common/config.h"
 #include "concurrency/lock_manager.h"
+#include "concurrency/row_version_table.h"
 #include "concurrency/transaction.h"
+#include "concurrency/version_store.h"
 #include "recovery/log_manager.h"
 
 namespace bustub {
 class LockManager;
 
+/** How transactions are isolated from each other. */
+enum class ConcurrencyMode {
+  /** Readers and writers lock what they use. */
+  TWO_PHASE_LOCKING,
+  /** Readers read a snapshot without locks. Writers lock what they change, and keep the versions they replace. */
+  SNAPSHOT_ISOLATION,
+  /** Nothing is locked. Writes are buffered, and applied at commit if nothing the transaction read has changed. */
+  OPTIMISTIC
+};
+
+static constexpr size_t VERSION_GC_INTERVAL = 64;  // finished transactions between garbage collections of versions
+
 /**
  * TransactionManager keeps track of all the transactions running in the system.
  */
 class TransactionManager {
  public:
-  explicit TransactionManager(LockManager *lock_manager, LogManager *log_manager = nullptr)
-      : lock_manager_(lock_manager), log_manager_(log_manager) {}
+  explicit TransactionManager(LockManager *lock_manager, LogManager *log_manager = nullptr,
+                              ConcurrencyMode concurrency_mode = ConcurrencyMode::TWO_PHASE_LOCKING)
+      : lock_manager_(lock_manager), log_manager_(log_manager) {
+    if (concurrency_mode == ConcurrencyMode::SNAPSHOT_ISOLATION) {
+      version_store_ = std::make_unique<VersionStore>();
+    } else if (concurrency_mode == ConcurrencyMode::OPTIMISTIC) {
+      row_version_table_ = std::make_unique<RowVersionTable>();
+    }
+  }
 
   ~TransactionManager() = default;
 
@@ -42,10 +69,11 @@ class TransactionManager {
   Transaction *Begin(Transaction *txn = nullptr);
 
   /**
-   * Commits a transaction.
+   * Commits a transaction. An optimistic transaction is validated first, and aborted if that fails.
    * @param txn the transaction to commit
+   * @return true if the transaction committed
    */
-  void Commit(Transaction *txn);
+  bool Commit(Transaction *txn);
 
   /**
    * Aborts a transaction
@@ -72,6 +100,24 @@ class TransactionManager {
     return res;
   }
 
+  /**
+   * Take a snapshot of the running transactions for a fuzzy checkpoint, without stopping them. The snapshot holds the
+   * transactions that began before the checkpoint and did not finish before it, judged by the LSNs of their records.
+   * @param checkpoint_lsn the LSN of the BEGIN_CHECKPOINT record
+   * @param[out] active_txns every running transaction with the LSN of its last log record
+   * @return the LSN of the BEGIN record of the oldest running transaction, or INVALID_LSN if none is running
+   */
+  lsn_t GetActiveTransactionTable(lsn_t checkpoint_lsn, std::vector<std::pair<txn_id_t, lsn_t>> *active_txns);
+
+  /** @return the version store of snapshot isolation, or nullptr */
+  inline VersionStore *GetVersionStore() { return version_store_.get(); }
+
+  /**
+   * Drop the versions of tuples that none of the running transactions' snapshots sees anymore.
+   * @return the number of versions that were dropped
+   */
+  size_t CollectGarbage();
+
   /** Prevents all transactions from performing operations, used for checkpointing. */
   void BlockAllTransactions();
 
@@ -79,6 +125,59 @@ class TransactionManager {
   void ResumeTransactions();
 
  private:
+  /** Collect garbage every VERSION_GC_INTERVAL finished transactions. */
+  void MaybeCollectGarbage() {
+    if (version_store_ != nullptr && ++finished_txns_ % VERSION_GC_INTERVAL == 0) {
+      CollectGarbage();
+    }
+  }
+
+  /**
+   * Lock the rows an optimistic transaction writes, and check that the rows it read have not changed since.
+   * @return false if the transaction must abort
+   */
+  bool Validate(Transaction *txn);
+
+  /**
+   * Apply the buffered writes of a validated optimistic transaction, like a transaction that locked its rows would.
+   * @return false if a write failed, and the transaction must abort
+   */
+  bool ApplyBufferedWrites(Transaction *txn);
+
+  /**
+   * Append a BEGIN, COMMIT or ABORT record. The LSN is PENDING_LSN while the record is appended, so that a checkpoint
+   * that sees it can wait for it.
+   * @param txn the transaction
+   * @param type the type of the record
+   * @param set_lsn the setter of the transaction's begin or end LSN
+   * @return the LSN of the record
+   */
+  lsn_t AppendTransactionRecord(Transaction *txn, LogRecordType type, void (Transaction::*set_lsn)(lsn_t));
+
+  /**
+   * Wait until a BEGIN, COMMIT or ABORT record that is being appended has its LSN.
+   * @param get_lsn returns the LSN of the record
+   * @return the LSN
+   */
+  lsn_t WaitForLSN(const std::function<lsn_t()> &get_lsn);
+
+  /**
+   * Unlock the version words an optimistic transaction still holds, and forget what it read and buffered.
+   * @param txn the transaction
+   * @param changed true if the transaction committed, so that the rows it wrote get new versions
+   */
+  void ReleaseRowVersions(Transaction *txn, bool changed) {
+    if (row_version_table_ == nullptr) {
+      return;
+    }
+    for (const RID &rid : *txn->GetLockedRows()) {
+      row_version_table_->Unlock(rid, changed);
+    }
+    txn->GetLockedRows()->clear();
+    txn->GetReadSet()->clear();
+    txn->GetBufferedWrites()->clear();
+  }
+
   /**
    * Releases all the locks held by the given transaction.
    * @param txn the transaction whose locks should be released
@@ -94,14 +193,47 @@ class TransactionManager {
     for (auto locked_rid : lock_set) {
       lock_manager_->Unlock(txn, locked_rid);
     }
+    // Locks are released from the bottom of the hierarchy up.
+    std::vector<page_id_t> locked_ids;
+    for (const auto &item : *txn->GetPageLockMap()) {
+      locked_ids.push_back(item.first);
+    }
+    for (page_id_t page_id : locked_ids) {
+      lock_manager_->UnlockPage(txn, page_id);
+    }
+    locked_ids.clear();
+    for (const auto &item : *txn->GetTableLockMap()) {
+      locked_ids.push_back(item.first);
+    }
+    for (page_id_t table_id : locked_ids) {
+      lock_manager_->UnlockTable(txn, table_id);
+    }
   }
 
   std::atomic<txn_id_t> next_txn_id_{0};
   LockManager *lock_manager_ __attribute__((__unused__));
   LogManager *log_manager_ __attribute__((__unused__));
 
+  /** The older versions of tuples under snapshot isolation, or nullptr. */
+  std::unique_ptr<VersionStore> version_store_;
+  std::atomic<size_t> finished_txns_{0};
+  /** The version words of optimistic concurrency control, or nullptr. */
+  std::unique_ptr<RowVersionTable> row_version_table_;
+
   /** The global transaction latch is used for checkpointing. */
   ReaderWriterLatch global_txn_latch_;
+
+  /** The LSN of a BEGIN, COMMIT or ABORT record that is being appended. */
+  static constexpr lsn_t PENDING_LSN = INVALID_LSN - 1;
+
+  /** The running transactions. */
+  std::unordered_map<txn_id_t, Transaction *> active_txns_;
+  /** Protects active_txns_. Not held while records are logged; checkpoints order transactions by their LSNs. */
+  std::mutex active_txns_latch_;
+  /** The number of checkpoints waiting for a pending LSN, which the transaction appending the record wakes up. */
+  std::atomic<int> lsn_waiters_{0};
+  std::mutex lsn_latch_;
+  std::condition_variable lsn_cv_;
 };
 
 }  // namespace bustub
@@ -0,0 +1,142 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// version_store.h
+//
+// Identification: src/include/concurrency/version_store.h
+//
+// Copyright (c) 2015-2019, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+#include <atomic>
+#include <unordered_map>
+#include <vector>
+
+#include "common/macros.h"
+#include "common/rid.h"
+#include "common/rwlatch.h"
+#include "concurrency/transaction.h"
+#include "storage/table/tuple.h"
+
+namespace bustub {
+
+/**
+ * VersionStore keeps the older versions of tuples for snapshot isolation.
+ *
+ * A table page only holds the newest image of a tuple, which may be uncommitted. When a snapshot transaction
+ * changes a tuple, the image it replaces goes into the tuple's version chain, stamped with the commit timestamp of
+ * the transaction that wrote it. A transaction reads from the snapshot of everything committed when it began: it
+ * sees the newest image that was committed by then, or its own writes. Tuples without a chain are visible to every
+ * snapshot.
+ *
+ * Writers still lock the tuples they change, but the first one to change a tuple wins: a transaction that changes a
+ * tuple that someone else committed after its snapshot was taken is aborted. Readers take no locks at all.
+ *
+ * Tuple images and version chains must change together, so writers add versions while they hold the page's write
+ * latch, and readers resolve versions while they hold its read latch. Commits stamp all their versions at once.
+ */
+class VersionStore {
+ public:
+  VersionStore() = default;
+  ~VersionStore() = default;
+
+  DISALLOW_COPY(VersionStore);
+
+  /** @return the commit timestamp of the newest commit, which a snapshot taken now includes */
+  inline timestamp_t GetLastCommitTimestamp() const { return last_commit_ts_; }
+
+  /**
+   * Check that the transaction may change a tuple. If it may not, the transaction is aborted.
+   * @param txn the writing transaction
+   * @param rid the tuple
+   * @return false if another transaction changed the tuple after the transaction's snapshot was taken
+   */
+  bool CheckWrite(Transaction *txn, const RID &rid);
+
+  /**
+   * Keep the image a transaction replaced in a tuple. Only the image from before the transaction's first change to
+   * the tuple is kept.
+   * @param txn the writing transaction
+   * @param rid the tuple
+   * @param old_tuple the replaced image, or nullptr if the tuple did not exist before
+   */
+  void AddVersion(Transaction *txn, const RID &rid, const Tuple *old_tuple);
+
+  /**
+   * Find the version of a tuple the transaction's snapshot sees.
+   * @param txn the reading transaction
+   * @param rid the tuple
+   * @param exists whether the tuple's page holds a tuple there
+   * @param[in,out] tuple the image in the page, replaced by an older version if the snapshot sees one
+   * @return true if the snapshot sees a version of the tuple
+   */
+  bool ReadVersion(Transaction *txn, const RID &rid, bool exists, Tuple *tuple);
+
+  /**
+   * Stamp every version the transaction wrote with a new commit timestamp.
+   * @return the commit timestamp
+   */
+  timestamp_t Commit(Transaction *txn);
+
+  /**
+   * Forget the versions of an aborted transaction, once its changes were rolled back in the pages.
+   * @param txn the aborted transaction
+   */
+  void Abort(Transaction *txn);
+
+  /**
+   * Forget the version of one tuple right away, once its page holds the image from before the transaction's changes
+   * again. A rolled back insert frees its slot for other inserts, so it cannot wait for Abort.
+   * @param txn the aborted transaction
+   * @param rid the tuple
+   */
+  void RevertVersion(Transaction *txn, const RID &rid);
+
+  /**
+   * Drop the versions no snapshot can see anymore. A version is kept while a snapshot in use sees it, or while it is
+   * the newest committed image of a tuple with an uncommitted change.
+   * @param snapshots the read timestamps of the snapshots in use
+   * @return the number of versions that were dropped
+   */
+  size_t GarbageCollect(const std::vector<timestamp_t> &snapshots);
+
+  /** @return the number of older versions the store keeps */
+  size_t GetVersionCount();
+
+ private:
+  /** An older image of a tuple. */
+  struct UndoVersion {
+    /** Whether the tuple existed. */
+    bool exists_;
+    Tuple tuple_;
+    /** The commit timestamp of the transaction that wrote the image. */
+    timestamp_t ts_;
+  };
+
+  /** The versions of a tuple. */
+  struct VersionChain {
+    /** The transaction that changed the tuple and did not commit yet, or INVALID_TXN_ID. */
+    txn_id_t writer_{INVALID_TXN_ID};
+    /** The commit timestamp of the image in the page, once it is committed. */
+    timestamp_t ts_{0};
+    /** The older images, the newest last. */
+    std::vector<UndoVersion> undo_;
+  };
+
+  /** Make the image before the uncommitted change of a chain its newest image again. The latch is held. */
+  void Revert(std::unordered_map<RID, VersionChain>::iterator chain);
+
+  /** The chains of the tuples that have older versions, or uncommitted ones. */
+  std::unordered_map<RID, VersionChain> chains_;
+  /** The tuples each running transaction changed. */
+  std::unordered_map<txn_id_t, std::vector<RID>> write_sets_;
+  std::atomic<timestamp_t> last_commit_ts_{0};
+  /** Protects everything above. Readers share it, writers and commits take it exclusively. */
+  ReaderWriterLatch latch_;
+};
+
+}  // namespace bustub
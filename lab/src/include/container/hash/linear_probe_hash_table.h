@@ -12,6 +12,7 @@
 
 #pragma once
 
+#include <memory>
 #include <queue>
 #include <string>
 #include <vector>
@@ -97,6 +98,8 @@ class LinearProbeHashTable : public HashTable<KeyType, ValueType, KeyComparator>
   // member variable
   page_id_t header_page_id_;
   BufferPoolManager *buffer_pool_manager_;
+  // Extents the pages of this table come from, so that its blocks are contiguous on disk
+  std::unique_ptr<ExtentReservation> extent_;
   KeyComparator comparator_;
 
   // Readers includes inserts and removes, writer is only resize
@@ -110,8 +110,12 @@ class HashJoinExecutor : public AbstractExecutor {
 
   TmpTuplePage *GetNewTmpTuplePage(){
     BufferPoolManager *bmp = exec_ctx_->GetBufferPoolManager();
+    // The page that just filled up is not written to anymore, so the build ring may recycle its frame.
+    if (!tmp_tuple_pages_.empty()) {
+      bmp->UnpinPage(tmp_tuple_pages_.back(), true);
+    }
     page_id_t page_id;
-    auto *tmp_tuple_page = reinterpret_cast<TmpTuplePage *>(bmp->NewPage(&page_id));
+    auto *tmp_tuple_page = reinterpret_cast<TmpTuplePage *>(bmp->NewPage(&page_id, nullptr, build_strategy_.get()));
     tmp_tuple_page->Init(page_id, PAGE_SIZE);
     tmp_tuple_pages_.push_back(page_id);
     return tmp_tuple_page;
@@ -124,6 +128,7 @@ class HashJoinExecutor : public AbstractExecutor {
       Page *page = exec_ctx_->GetBufferPoolManager()->FetchPage(tmp_tuple.GetPageId());
       auto *tmp_tuple_page = reinterpret_cast<TmpTuplePage *>(page);
       tmp_tuple_page->GetTuple(tmp_tuple.GetOffset(), &tuple);
+      exec_ctx_->GetBufferPoolManager()->UnpinPage(tmp_tuple.GetPageId(), false);
     }
   }
 
@@ -167,5 +172,7 @@ class HashJoinExecutor : public AbstractExecutor {
   std::unique_ptr<AbstractExecutor> right_;
   std::vector<Tuple> stage_output_tuples_;
   std::vector<page_id_t> tmp_tuple_pages_;
+  /** The ring of frames that the build side writes its tmp tuple pages through. */
+  std::unique_ptr<BufferAccessStrategy> build_strategy_;
 };
 }  // namespace bustub
@@ -24,6 +24,7 @@ namespace bustub {
 /**
  * InsertExecutor executes an insert into a table.
  * Inserted values can either be embedded in the plan itself ("raw insert") or come from a child executor.
+ * The table pages are written through a bulk write ring, so a large load does not push the rest of the buffer pool out.
  */
 class InsertExecutor : public AbstractExecutor {
  public:
@@ -51,5 +52,7 @@ class InsertExecutor : public AbstractExecutor {
   std::unique_ptr<AbstractExecutor> child_executor_;
 
   TableMetadata * table_metadata_;
+  /** The ring of frames the insert writes through. */
+  std::unique_ptr<BufferAccessStrategy> strategy_;
 };
 }  // namespace bustub
@@ -12,6 +12,7 @@
 
 #pragma once
 
+#include <memory>
 #include <vector>
 
 #include "execution/executor_context.h"
@@ -23,6 +24,7 @@ namespace bustub {
 
 /**
  * SeqScanExecutor executes a sequential scan over a table.
+ * The scan reads through a bulk read ring, so it does not push the rest of the buffer pool out.
  */
 class SeqScanExecutor : public AbstractExecutor {
  public:
@@ -43,6 +45,8 @@ class SeqScanExecutor : public AbstractExecutor {
   /** The sequential scan plan node to be executed. */
   const SeqScanPlanNode *plan_;
   TableMetadata *table_metadata_;
+  /** The ring of frames the scan reads through. Must outlive iter_. */
+  std::unique_ptr<BufferAccessStrategy> strategy_;
   TableIterator iter_{};
 };
 }  // namespace bustub
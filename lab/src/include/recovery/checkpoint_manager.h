@@ -12,32 +12,58 @@
 
 #pragma once
 
+#include <thread>  // NOLINT
+
 #include "buffer/buffer_pool_manager.h"
 #include "concurrency/transaction_manager.h"
 #include "recovery/log_manager.h"
+#include "storage/disk/disk_manager.h"
 
 namespace bustub {
 
 /**
- * CheckpointManager creates consistent checkpoints by blocking all other transactions temporarily.
+ * CheckpointManager takes fuzzy checkpoints, which never block transactions.
+ *
+ * A checkpoint logs a BEGIN_CHECKPOINT record, then an END_CHECKPOINT record with snapshots of the active transaction
+ * table and the dirty page table. Once the END_CHECKPOINT record is durable, the disk manager remembers where the
+ * checkpoint starts, so recovery can find it. The dirty pages are then written in the background, and the log that
+ * neither redo nor undo can need any more is truncated.
  */
 class CheckpointManager {
  public:
   CheckpointManager(TransactionManager *transaction_manager, LogManager *log_manager,
-                    BufferPoolManager *buffer_pool_manager)
+                    BufferPoolManager *buffer_pool_manager, DiskManager *disk_manager)
       : transaction_manager_(transaction_manager),
         log_manager_(log_manager),
-        buffer_pool_manager_(buffer_pool_manager) {}
+        buffer_pool_manager_(buffer_pool_manager),
+        disk_manager_(disk_manager) {}
 
-  ~CheckpointManager() = default;
+  /** Waits for the background work of the last checkpoint. */
+  ~CheckpointManager();
 
+  /**
+   * Take a checkpoint. Returns once the checkpoint is durable, while its dirty pages are still being written.
+   */
   void BeginCheckpoint();
+
+  /**
+   * Wait until the dirty pages of the last checkpoint are written and the log is truncated.
+   */
   void EndCheckpoint();
 
  private:
-  TransactionManager *transaction_manager_ __attribute__((__unused__));
-  LogManager *log_manager_ __attribute__((__unused__));
-  BufferPoolManager *buffer_pool_manager_ __attribute__((__unused__));
+  /**
+   * Write the dirty pages and truncate the log, in the background.
+   * @param truncate_lsn LSN of the oldest log record that recovery still needs after that
+   */
+  void FlushAndTruncate(lsn_t truncate_lsn);
+
+  TransactionManager *transaction_manager_;
+  LogManager *log_manager_;
+  BufferPoolManager *buffer_pool_manager_;
+  DiskManager *disk_manager_;
+  /** Runs FlushAndTruncate for the last checkpoint. */
+  std::thread flush_thread_;
 };
 
 }  // namespace bustub
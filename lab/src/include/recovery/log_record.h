@@ -12,10 +12,14 @@
 
 #pragma once
 
+#include <algorithm>
 #include <cassert>
 #include <string>
+#include <utility>
+#include <vector>
 
 #include "common/config.h"
+#include "recovery/tuple_delta.h"
 #include "storage/table/tuple.h"
 
 namespace bustub {
@@ -32,8 +36,15 @@ enum class LogRecordType {
   ABORT,
   /** Creating a new page in the table heap. */
   NEWPAGE,
+  /** Start of a fuzzy checkpoint. */
+  BEGIN_CHECKPOINT,
+  /** End of a fuzzy checkpoint, with the active transaction table and the dirty page table. */
+  END_CHECKPOINT,
 };
 
+/** Set in the LogType of a record whose body is compressed, see below. */
+static constexpr int32_t LOG_RECORD_COMPRESSED = 1 << 16;
+
 /**
  * For every write operation on the table page, you should write ahead a corresponding log record.
  *
@@ -45,18 +56,35 @@ enum class LogRecordType {
  *---------------------------------------------------------------
  * | HEADER | tuple_rid | tuple_size | tuple_data(char[] array) |
  *---------------------------------------------------------------
- * For delete type (including markdelete, rollbackdelete, applydelete)
+ * For applydelete type log record, which keeps the tuple for undo
  *----------------------------------------------------------------
  * | HEADER | tuple_rid | tuple_size | tuple_data(char[] array) |
  *---------------------------------------------------------------
- * For update type log record
- *-----------------------------------------------------------------------------------
- * | HEADER | tuple_rid | tuple_size | old_tuple_data | tuple_size | new_tuple_data |
- *-----------------------------------------------------------------------------------
+ * For markdelete and rollbackdelete type log record, which only flip the delete bit
+ *----------------------
+ * | HEADER | tuple_rid |
+ *----------------------
+ * For update type log record, with only the bytes that changed (see TupleDelta)
+ *-------------------------------
+ * | HEADER | tuple_rid | delta |
+ *-------------------------------
  * For new page type log record
  *------------------------------------
  * | HEADER | prev_page_id | page_id |
  *------------------------------------
+ * For begin checkpoint type log record, there is only the HEADER
+ * For end checkpoint type log record, whose prevLSN is the LSN of its begin checkpoint record
+ *--------------------------------------------------------------------------------------------------------
+ * | HEADER | redo_lsn | txn_count | (txn_id, last_lsn) ... | page_count | (page_id, rec_lsn) ... |
+ *--------------------------------------------------------------------------------------------------------
+ * page_count is -1 if the dirty page table does not fit into a log buffer. Every page then counts as dirty since
+ * redo_lsn, the smallest rec_lsn of the dirty page table, or the begin checkpoint LSN if no page is dirty.
+ *
+ * The log manager may compress the part after the HEADER of a big record. The record then has LOG_RECORD_COMPRESSED
+ * set in its LogType and its size is the compressed size
+ *-------------------------------------------------
+ * | HEADER | body_size | compressed body (LZ4) |
+ *-------------------------------------------------
  */
 class LogRecord {
   friend class LogManager;
@@ -81,8 +109,11 @@ class LogRecord {
       delete_rid_ = rid;
       delete_tuple_ = tuple;
     }
-    // calculate log record size
-    size_ = HEADER_SIZE + sizeof(RID) + sizeof(int32_t) + tuple.GetLength();
+    // calculate log record size; only applydelete needs the tuple
+    size_ = HEADER_SIZE + sizeof(RID);
+    if (log_record_type != LogRecordType::MARKDELETE && log_record_type != LogRecordType::ROLLBACKDELETE) {
+      size_ += sizeof(int32_t) + tuple.GetLength();
+    }
   }
 
   // constructor for UPDATE type
@@ -92,10 +123,9 @@ class LogRecord {
         prev_lsn_(prev_lsn),
         log_record_type_(log_record_type),
         update_rid_(update_rid),
-        old_tuple_(old_tuple),
-        new_tuple_(new_tuple) {
+        update_delta_(old_tuple, new_tuple) {
     // calculate log record size
-    size_ = HEADER_SIZE + sizeof(RID) + old_tuple.GetLength() + new_tuple.GetLength() + 2 * sizeof(int32_t);
+    size_ = HEADER_SIZE + sizeof(RID) + update_delta_.GetSerializedSize();
   }
 
   // constructor for NEWPAGE type
@@ -110,6 +140,26 @@ class LogRecord {
     size_ = HEADER_SIZE + sizeof(page_id_t) * 2;
   }
 
+  // constructor for END_CHECKPOINT type
+  LogRecord(lsn_t begin_checkpoint_lsn, std::vector<std::pair<txn_id_t, lsn_t>> active_txns,
+            std::vector<std::pair<page_id_t, lsn_t>> dirty_pages)
+      : prev_lsn_(begin_checkpoint_lsn),
+        log_record_type_(LogRecordType::END_CHECKPOINT),
+        redo_lsn_(begin_checkpoint_lsn),
+        active_txns_(std::move(active_txns)),
+        dirty_pages_(std::move(dirty_pages)) {
+    for (const auto &dirty_page : dirty_pages_) {
+      redo_lsn_ = std::min(redo_lsn_, dirty_page.second);
+    }
+    // calculate log record size, header size + redo_lsn + both tables with their counts
+    size_ = HEADER_SIZE + sizeof(lsn_t) + 2 * sizeof(int32_t) + active_txns_.size() * sizeof(active_txns_[0]);
+    if (size_ + dirty_pages_.size() * sizeof(dirty_pages_[0]) > static_cast<size_t>(LOG_BUFFER_SIZE)) {
+      has_dirty_page_table_ = false;
+    } else {
+      size_ += dirty_pages_.size() * sizeof(dirty_pages_[0]);
+    }
+  }
+
   ~LogRecord() = default;
 
   inline RID &GetDeleteRID() { return delete_rid_; }
@@ -120,6 +170,15 @@ class LogRecord {
 
   inline page_id_t GetNewPageRecord() { return prev_page_id_; }
 
+  inline lsn_t GetRedoLSN() { return redo_lsn_; }
+
+  inline std::vector<std::pair<txn_id_t, lsn_t>> &GetActiveTxns() { return active_txns_; }
+
+  inline std::vector<std::pair<page_id_t, lsn_t>> &GetDirtyPages() { return dirty_pages_; }
+
+  /** @return false if the dirty page table was left out of an END_CHECKPOINT record, see above */
+  inline bool HasDirtyPageTable() { return has_dirty_page_table_; }
+
   inline int32_t GetSize() { return size_; }
 
   inline lsn_t GetLSN() { return lsn_; }
@@ -160,14 +219,20 @@ class LogRecord {
   RID insert_rid_;
   Tuple insert_tuple_;
 
-  // case3: for update opeartion
+  // case3: for update opeartion, the bytes that changed
   RID update_rid_;
-  Tuple old_tuple_;
-  Tuple new_tuple_;
+  TupleDelta update_delta_;
 
   // case4: for new page opeartion
   page_id_t prev_page_id_{INVALID_PAGE_ID};
   page_id_t page_id_{INVALID_PAGE_ID};
+
+  // case5: for end checkpoint opeartion
+  lsn_t redo_lsn_{INVALID_LSN};
+  std::vector<std::pair<txn_id_t, lsn_t>> active_txns_;
+  std::vector<std::pair<page_id_t, lsn_t>> dirty_pages_;
+  bool has_dirty_page_table_{true};
+
   static const int HEADER_SIZE = 20;
 };  // namespace bustub
 
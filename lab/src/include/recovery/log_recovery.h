@@ -13,8 +13,13 @@
 #pragma once
 
 #include <algorithm>
-#include <mutex>  // NOLINT
+#include <condition_variable>  // NOLINT
+#include <deque>
+#include <mutex>   // NOLINT
+#include <thread>  // NOLINT
 #include <unordered_map>
+#include <utility>
+#include <vector>
 
 #include "buffer/buffer_pool_manager.h"
 #include "concurrency/lock_manager.h"
@@ -22,14 +27,31 @@
 
 namespace bustub {
 
+static constexpr size_t REDO_BATCH_SIZE = 64;          // records the reader hands to a redo worker at a time
+static constexpr size_t REDO_QUEUE_DEPTH = 16;         // batches that may wait for a redo worker
+static constexpr size_t RECOVERY_PREFETCH_PAGES = 64;  // most pages recovery prefetches at a time
+
 /**
  * Read log file from disk, redo and undo.
+ *
+ * Recovery starts from the last checkpoint that the disk manager remembers. Its END_CHECKPOINT record gives the
+ * active transaction table and the dirty page table, and redo starts at the smallest recLSN of the dirty page table.
+ * A change from before the checkpoint is only redone if its page is in the dirty page table and the change is not
+ * older than the page's recLSN, so pages that were written before the checkpoint are not even read. Without a
+ * checkpoint, the whole log that is left is redone.
+ *
+ * Redo can replay changes on several threads. The calling thread reads the log, keeps the active transaction table
+ * and sends every change to the worker that owns its page, so the changes to a page keep their order.
+ *
+ * While redo runs, the pages that the next records in the log buffer change are loaded in the background, a window
+ * at a time, so that redo mostly finds its pages in the buffer pool. Undo does the same with the pages the losers
+ * changed.
  */
 class LogRecovery {
  public:
   LogRecovery(DiskManager *disk_manager, BufferPoolManager *buffer_pool_manager)
       : disk_manager_(disk_manager), buffer_pool_manager_(buffer_pool_manager), offset_(0) {
-    log_buffer_ = new char[LOG_BUFFER_SIZE];
+    log_buffer_ = new char[LOG_BUFFER_SIZE]();
   }
 
   ~LogRecovery() {
@@ -37,20 +59,102 @@ class LogRecovery {
     log_buffer_ = nullptr;
   }
 
-  void Redo();
+  /**
+   * Redo the log from the last checkpoint on.
+   * @param num_workers the number of threads that replay changes, each owning the pages that hash to it while this
+   * thread reads the log; 0 to replay everything on this thread
+   */
+  void Redo(size_t num_workers = 0);
   void Undo();
   bool DeserializeLogRecord(const char *data, LogRecord *log_record);
 
  private:
+  /** A thread that replays the changes to the pages that hash to it, in log order. */
+  struct RedoWorker {
+    std::thread thread_;
+    /** Records the reader is collecting for the next batch, with the page to replay each of them on. */
+    std::vector<std::pair<page_id_t, LogRecord>> batch_;
+    /** Batches waiting to be replayed. */
+    std::deque<std::vector<std::pair<page_id_t, LogRecord>>> batches_;
+    /** Set by the reader once the whole log is dispatched. */
+    bool done_{false};
+    /** Protects batches_ and done_. */
+    std::mutex latch_;
+    /** Signalled when a batch is queued or taken, and when the reader is done. */
+    std::condition_variable cv_;
+  };
+
+  /** Replay the part of a record that changes the given page, unless the page already has it. */
+  void RedoPage(LogRecord *log_record, page_id_t page_id);
+
+  /** Body of a redo worker. */
+  void RedoLoop(RedoWorker *worker);
+
+  /** Queue the batch the reader collected for a worker. Blocks while REDO_QUEUE_DEPTH batches are waiting. */
+  void Dispatch(RedoWorker *worker);
+
+  /** Get the pages a record changes: one, two for NEWPAGE, or none. The rest of page_ids[2] is INVALID_PAGE_ID. */
+  void GetPageIds(LogRecord *log_record, page_id_t *page_ids);
+
+  /** @return the number of pages the recovery prefetcher loads at a time */
+  size_t PrefetchWindow();
+
+  /**
+   * Find the next pages that redo will change, as far as the log buffer reaches, and load them in the background.
+   * @param redo_lsn the LSN redo starts at
+   */
+  void PrefetchAhead(lsn_t redo_lsn);
+
+  /**
+   * Find the END_CHECKPOINT record of the last checkpoint, and load its active transaction table and dirty page table.
+   * @return the LSN to start redo at, or INVALID_LSN if there is no checkpoint
+   */
+  lsn_t LoadCheckpoint();
+
+  /**
+   * @return false if the checkpoint shows that the page already has the change with the given LSN
+   */
+  bool NeedsRedo(page_id_t page_id, lsn_t lsn);
+
+  /**
+   * Read the log record at a log offset. log_buffer_ holds the log around it, so reading the log in order is cheap.
+   * @return false past the end of the log
+   */
+  bool ReadLogRecord(int offset, LogRecord *log_record);
+
+  /**
+   * Find the log offset of a record of a running transaction. Records older than redo are looked for from the start
+   * of their log segment, and the offsets of the other running transactions' records seen on the way are kept.
+   * @return the offset, or -1 if the record is not in the log
+   */
+  int FindLogOffset(lsn_t lsn);
+
   DiskManager *disk_manager_ __attribute__((__unused__));
   BufferPoolManager *buffer_pool_manager_ __attribute__((__unused__));
 
   /** Maintain active transactions and its corresponding latest lsn. */
   std::unordered_map<txn_id_t, lsn_t> active_txn_;
-  /** Mapping the log sequence number to log file offset for undos. */
+  /**
+   * The LSN and the page of the records of each active transaction, so that lsn_mapping_ forgets them when it ends,
+   * and undo knows which pages to prefetch.
+   */
+  std::unordered_map<txn_id_t, std::vector<std::pair<lsn_t, page_id_t>>> txn_records_;
+  /** Mapping the log sequence number to log file offset for undos, for the records of active transactions only. */
   std::unordered_map<lsn_t, int> lsn_mapping_;
+  /** The dirty page table of the checkpoint, with the recLSN of every page. */
+  std::unordered_map<page_id_t, lsn_t> dirty_page_table_;
+  /** LSN of the BEGIN_CHECKPOINT record of the checkpoint, or INVALID_LSN if there is none. */
+  lsn_t checkpoint_lsn_{INVALID_LSN};
+  /** False if the checkpoint left its dirty page table out, so that every page counts as dirty. */
+  bool has_dirty_page_table_{false};
+
+  /** Log offset up to which PrefetchAhead has looked. */
+  int prefetch_offset_{0};
+  /** Log offset that redo has to get to for PrefetchAhead to look further. */
+  int prefetch_trigger_{0};
 
-  int offset_ __attribute__((__unused__));
+  /** Log offset of the contents of log_buffer_. */
+  int offset_;
   char *log_buffer_;
 };
 
@@ -0,0 +1,84 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// tuple_delta.h
+//
+// Identification: src/include/recovery/tuple_delta.h
+//
+// Copyright (c) 2015-2019, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "storage/table/tuple.h"
+
+namespace bustub {
+
+static constexpr uint32_t DELTA_MERGE_GAP = 12;  // unchanged bytes that are cheaper to repeat than to start a range
+
+/**
+ * TupleDelta is the difference between two versions of a tuple: the byte ranges that changed, with their old and new
+ * bytes. It turns either version into the other, so an UPDATE log record can carry it instead of both tuples.
+ *
+ * If both versions have the same size, every run of changed bytes is a range. Otherwise, the one range is everything
+ * between the common prefix and the common suffix. Either way, a range starts at the same offset in both versions.
+ *
+ * Serialized format:
+ * ------------------------------------------------------------------------------------------------
+ * | old_size | new_size | range_count | (offset, old_length, new_length, old bytes, new bytes) ... |
+ * ------------------------------------------------------------------------------------------------
+ */
+class TupleDelta {
+ public:
+  TupleDelta() = default;
+
+  /** Compute the delta between two versions of a tuple. */
+  TupleDelta(const Tuple &old_tuple, const Tuple &new_tuple);
+
+  /** @return the size of the serialized delta */
+  uint32_t GetSerializedSize() const;
+
+  /** Serialize the delta into storage, which holds GetSerializedSize bytes. */
+  void SerializeTo(char *storage) const;
+
+  /** Deserialize a delta that SerializeTo wrote. */
+  void DeserializeFrom(const char *storage);
+
+  /**
+   * Turn the old version of the tuple into the new one.
+   * @param old_tuple the old version
+   * @param[out] new_tuple the new version
+   * @return false if old_tuple is not the version the delta was computed from, e.g. because it was applied already
+   */
+  bool Apply(const Tuple &old_tuple, Tuple *new_tuple) const;
+
+  /**
+   * Turn the new version of the tuple into the old one.
+   * @param new_tuple the new version
+   * @param[out] old_tuple the old version
+   * @return false if new_tuple is not the version the delta leads to, e.g. because it was reverted already
+   */
+  bool Revert(const Tuple &new_tuple, Tuple *old_tuple) const;
+
+ private:
+  /** A run of changed bytes. */
+  struct Range {
+    uint32_t offset_;
+    std::string old_data_;
+    std::string new_data_;
+  };
+
+  /** Replace the ranges of one version with those of the other, unless the tuple does not have them. */
+  bool Splice(const Tuple &tuple, bool forward, Tuple *result) const;
+
+  uint32_t old_size_{0};
+  uint32_t new_size_{0};
+  std::vector<Range> ranges_;
+};
+
+}  // namespace bustub
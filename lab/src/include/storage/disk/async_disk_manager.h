@@ -0,0 +1,176 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// async_disk_manager.h
+//
+// Identification: src/include/storage/disk/async_disk_manager.h
+//
+// Copyright (c) 2015-2019, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+#include <sys/types.h>
+
+#include <condition_variable>  // NOLINT
+#include <deque>
+#include <mutex>  // NOLINT
+#include <string>
+#include <thread>  // NOLINT
+#include <unordered_map>
+#include <vector>
+
+#include "common/macros.h"
+#include "storage/disk/disk_manager.h"
+
+namespace bustub {
+
+static constexpr size_t ASYNC_DISK_QUEUE_DEPTH = 64;     // I/Os that may be in flight at once
+static constexpr size_t ASYNC_DISK_FALLBACK_THREADS = 4;  // threads that serve I/Os when io_uring is not available
+static constexpr size_t DIRECT_IO_ALIGNMENT = 4096;       // alignment of O_DIRECT buffers, offsets and sizes
+
+class IoUring;
+
+/**
+ * AsyncDiskManager is a DiskManager backend that keeps many I/Os in flight.
+ *
+ * Page reads, page writes and log appends are submitted with the Submit* functions, which return right away, and
+ * collected with Wait. The synchronous DiskManager interface is built on top of them, so the buffer pool can use this
+ * backend unchanged.
+ *
+ * I/Os go through an io_uring when the kernel allows it. Otherwise, a few threads serve them with pread/pwrite. The
+ * page file is opened with O_DIRECT where the file system supports it, so pages bypass the page cache. Every I/O uses
+ * its own aligned buffer: writes copy the data in when they are submitted, and reads copy the data out when they
+ * complete.
+ */
+class AsyncDiskManager : public DiskManager {
+ public:
+  /** Handle of a submitted I/O. */
+  using request_id_t = uint64_t;
+
+  /**
+   * Creates a new asynchronous disk manager that writes to the specified database file.
+   * @param db_file the file name of the database file to write to
+   * @param use_io_uring false to always use the pread/pwrite threads
+   */
+  explicit AsyncDiskManager(const std::string &db_file, bool use_io_uring = true);
+
+  /** Waits for the outstanding I/Os and shuts the disk manager down if that did not happen yet. */
+  ~AsyncDiskManager() override;
+
+  DISALLOW_COPY_AND_MOVE(AsyncDiskManager);
+
+  void ShutDown() override;
+
+  void WritePage(page_id_t page_id, const char *page_data) override;
+
+  void ReadPage(page_id_t page_id, char *page_data) override;
+
+  void WriteLog(char *log_data, int size) override;
+
+  /**
+   * Start reading a page. Pages past the end of the file read as zeros.
+   * @param page_id id of the page
+   * @param[out] page_data output buffer, which must stay valid until the read is waited for
+   * @return the handle of the read
+   */
+  request_id_t SubmitReadPage(page_id_t page_id, char *page_data);
+
+  /**
+   * Start writing a page.
+   * @param page_id id of the page
+   * @param page_data raw page data, which may be reused as soon as this returns
+   * @return the handle of the write
+   */
+  request_id_t SubmitWritePage(page_id_t page_id, const char *page_data);
+
+  /**
+   * Start appending to the log file. Appends land in the file in the order they were submitted.
+   * @param log_data raw log data, which may be reused as soon as this returns
+   * @param size size of the log data
+   * @return the handle of the append
+   */
+  request_id_t SubmitWriteLog(const char *log_data, int size);
+
+  /**
+   * Wait for a submitted I/O to complete. Every I/O must be waited for exactly once, here or with WaitAll.
+   * @param request_id the handle of the I/O
+   * @return true if the I/O succeeded
+   */
+  bool Wait(request_id_t request_id);
+
+  /**
+   * Wait for every submitted I/O to complete.
+   * @return true if all of them succeeded
+   */
+  bool WaitAll();
+
+  /** @return true if I/Os go through an io_uring */
+  bool UsesIoUring() const { return ring_ != nullptr; }
+
+  /** @return true if the page file bypasses the page cache */
+  bool UsesDirectIO() const { return direct_io_; }
+
+ private:
+  enum class IoType { READ_PAGE, WRITE_PAGE, WRITE_LOG };
+
+  /** A submitted I/O. */
+  struct IoRequest {
+    IoType type_;
+    int fd_;
+    off_t offset_;
+    /** Aligned buffer the I/O reads into or writes from. */
+    char *buffer_;
+    size_t size_;
+    /** Where a page read delivers its data. */
+    char *page_data_;
+    bool done_{false};
+    bool ok_{false};
+  };
+
+  /**
+   * Register an I/O and hand it to the io_uring or the fallback threads. Blocks while the queue is full.
+   * @return the handle of the I/O
+   */
+  request_id_t Submit(IoType type, int fd, off_t offset, size_t size, const char *data, char *page_data);
+
+  /**
+   * Finish an I/O: deliver the data of a read and wake up its waiters.
+   * @param request_id the handle of the I/O
+   * @param result the number of bytes transferred, or -errno
+   */
+  void Complete(request_id_t request_id, ssize_t result);
+
+  /** Body of the thread that reaps io_uring completions. */
+  void ReapLoop();
+
+  /** Body of the fallback threads. */
+  void FallbackLoop();
+
+  bool direct_io_{false};
+  bool shut_down_{false};
+
+  /** The io_uring, or nullptr when the fallback threads serve the I/Os. */
+  IoUring *ring_{nullptr};
+  std::thread *reaper_thread_{nullptr};
+  std::vector<std::thread> fallback_threads_;
+  /** I/Os waiting for a fallback thread. */
+  std::deque<request_id_t> fallback_queue_;
+  bool fallback_running_{false};
+
+  /** Submitted I/Os that were not waited for yet. */
+  std::unordered_map<request_id_t, IoRequest> requests_;
+  /** I/Os that have not completed yet. */
+  size_t in_flight_{0};
+  request_id_t next_request_id_{1};
+  /** Protects everything above. */
+  std::mutex latch_;
+  /** Serializes submissions to the io_uring, so that latch_ is not held across the system call. */
+  std::mutex submit_latch_;
+  /** Signalled when an I/O completes, and when a fallback I/O is queued. */
+  std::condition_variable cv_;
+};
+
+}  // namespace bustub
@@ -12,18 +12,47 @@
 
 #pragma once
 
+#include <sys/types.h>
+
 #include <atomic>
-#include <fstream>
+#include <deque>
 #include <future>  // NOLINT
+#include <mutex>   // NOLINT
+#include <set>
 #include <string>
+#include <vector>
 
 #include "common/config.h"
 
 namespace bustub {
 
+static constexpr int LOG_SEGMENT_SIZE = 1 << 20;     // size of a log segment file, header included
+static constexpr int LOG_SEGMENT_HEADER_SIZE = 512;  // one sector, so that the header is written atomically
+static constexpr int LOG_SEGMENT_DATA_SIZE = LOG_SEGMENT_SIZE - LOG_SEGMENT_HEADER_SIZE;
+static constexpr size_t LOG_SEGMENT_SPARES = 2;      // recycled log segments kept for reuse
+static_assert(LOG_BUFFER_SIZE <= LOG_SEGMENT_DATA_SIZE, "a log flush must not span more than two segments");
+
 /**
  * DiskManager takes care of the allocation and deallocation of pages within a database. It performs the reading and
  * writing of pages to and from disk, providing a logical file layer within the context of a database management system.
+ *
+ * Pages are read and written with pread/pwrite at their offset in the file, so concurrent page I/O is safe and runs in
+ * parallel.
+ *
+ * Deallocated pages are recorded in a free-space map, a bitmap with one bit per page that lives next to the database
+ * file (test.db gets test.fsm) and is updated on every allocation and deallocation. AllocatePage reuses the lowest
+ * free page before it grows the file. On startup, the next page id is recovered from the size of the database file.
+ *
+ * The log is split into segment files of a fixed size (test.db gets test.log.0, test.log.1, ...). Segment n holds the
+ * log offsets from n * LOG_SEGMENT_DATA_SIZE on, so log offsets stay contiguous across segments. A segment is filled
+ * with zeros when it is created, so appends never extend a file. Its header records the LSN and the offset of the
+ * first record that starts in it, which lets recovery find where to start reading without scanning the log. Once a
+ * checkpoint makes old segments unnecessary, TruncateLog renames them into spares that later segments reuse. The LSN
+ * of the last complete checkpoint is kept in the segment headers as well. On startup, the end of the log is found by
+ * following the records of the last segment while their LSNs are consecutive.
+ *
+ * The page and log I/O functions are virtual, so that other I/O backends such as AsyncDiskManager can stand in for
+ * the default one behind the same interface.
  */
 class DiskManager {
  public:
@@ -33,33 +62,33 @@ class DiskManager {
    */
   explicit DiskManager(const std::string &db_file);
 
-  ~DiskManager() = default;
+  virtual ~DiskManager() = default;
 
   /**
    * Shut down the disk manager and close all the file resources.
    */
-  void ShutDown();
+  virtual void ShutDown();
 
   /**
    * Write a page to the database file.
    * @param page_id id of the page
    * @param page_data raw page data
    */
-  void WritePage(page_id_t page_id, const char *page_data);
+  virtual void WritePage(page_id_t page_id, const char *page_data);
 
   /**
    * Read a page from the database file.
    * @param page_id id of the page
    * @param[out] page_data output buffer
    */
-  void ReadPage(page_id_t page_id, char *page_data);
+  virtual void ReadPage(page_id_t page_id, char *page_data);
 
   /**
    * Flush the entire log buffer into disk.
    * @param log_data raw log data
    * @param size size of log entry
    */
-  void WriteLog(char *log_data, int size);
+  virtual void WriteLog(char *log_data, int size);
 
   /**
    * Read a log entry from the log file.
@@ -68,20 +97,63 @@ class DiskManager {
    * @param offset offset of the log entry in the file
    * @return true if the read was successful, false otherwise
    */
-  bool ReadLog(char *log_data, int size, int offset);
+  virtual bool ReadLog(char *log_data, int size, int offset);
+
+  /** @return the log offset of the oldest record that is still in the log */
+  int GetLogStartOffset();
+
+  /**
+   * Find where to start reading the log to see every record from an LSN on, using the segment headers.
+   * @param lsn the LSN
+   * @return the offset of the first record of the last segment whose first record is at or before lsn
+   */
+  int GetLogOffset(lsn_t lsn);
+
+  /** @return the LSN that follows the last record that was in the log on startup */
+  lsn_t GetRecoveredNextLSN();
 
   /**
-   * Allocate a page on disk.
+   * Recycle the log segments that only hold log before the given offset. The segment being written is kept.
+   * @param offset offset of the oldest log record that is still needed, e.g. the start of the last checkpoint
+   */
+  void TruncateLog(int offset);
+
+  /** @return the number of log segments that are in use */
+  size_t GetNumLogSegments();
+
+  /**
+   * Record where the last complete checkpoint starts. It is kept in the header of the segment being written, and
+   * copied into the header of every new segment, so that it always survives truncation.
+   * @param lsn LSN of the BEGIN_CHECKPOINT record, whose END_CHECKPOINT record is already durable
+   */
+  void SetCheckpointLSN(lsn_t lsn);
+
+  /** @return the LSN of the BEGIN_CHECKPOINT record of the last complete checkpoint, or INVALID_LSN if there is none */
+  lsn_t GetCheckpointLSN();
+
+  /**
+   * Allocate a page on disk, reusing a deallocated page if there is one.
    * @return the id of the allocated page
    */
   page_id_t AllocatePage();
 
   /**
-   * Deallocate a page on disk.
+   * Allocate a run of contiguous pages on disk. A run of free pages is reused if there is one, otherwise the file
+   * grows by the whole run, and its space is reserved with the file system right away.
+   * @param num_pages the number of pages
+   * @return the id of the first page of the run
+   */
+  page_id_t AllocateExtent(size_t num_pages);
+
+  /**
+   * Deallocate a page on disk. Its space is released to the file system and the page will be handed out again.
    * @param page_id id of the page to deallocate
    */
   void DeallocatePage(page_id_t page_id);
 
+  /** @return the number of deallocated pages waiting to be reused */
+  size_t GetNumFreePages();
+
   /** @return the number of disk flushes */
   int GetNumFlushes() const;
 
@@ -100,19 +172,128 @@ class DiskManager {
   /** Checks if the non-blocking flush future was set. */
   inline bool HasFlushLogFuture() { return flush_log_f_ != nullptr; }
 
- private:
+ protected:
   int GetFileSize(const std::string &file_name);
-  // stream to write log file
-  std::fstream log_io_;
+
+  /**
+   * Read or write a whole range of a file with pread/pwrite, retrying short transfers.
+   * @param write true to write, false to read
+   * @param fd the file
+   * @param buffer the data
+   * @param size the number of bytes
+   * @param offset where the range starts in the file
+   * @return the number of bytes transferred, which is short only at the end of the file, or -errno
+   */
+  static ssize_t TransferAll(bool write, int fd, char *buffer, size_t size, off_t offset);
+
+  /** The part of a log read or write that falls into one segment. */
+  struct LogRange {
+    int fd_;
+    /** Where the part is in the segment file. */
+    off_t file_offset_;
+    /** Where the part is in the caller's buffer. */
+    size_t data_offset_;
+    size_t size_;
+  };
+
+  /**
+   * Assign the next log offsets to a log write, opening the segments it reaches. Writes get their offsets in the order
+   * they call this.
+   * @param log_data the records to write, which are needed to fill in the header of a new segment
+   * @param size the size of the write
+   * @return the parts of the write, in order
+   */
+  std::vector<LogRange> ReserveLog(const char *log_data, size_t size);
+
+  // file descriptor of the db file
+  int db_fd_{-1};
   std::string log_name_;
-  // stream to write db file
-  std::fstream db_io_;
   std::string file_name_;
-  std::atomic<page_id_t> next_page_id_;
   int num_flushes_;
-  int num_writes_;
+  std::atomic<int> num_writes_;
   bool flush_log_;
   std::future<void> *flush_log_f_;
+
+ private:
+  /**
+   * Read the free-space map, dropping the pages that are not in the database file.
+   * @param new_file true if the database file was just created, which makes any old map stale
+   */
+  void LoadFreeSpaceMap(bool new_file);
+
+  /**
+   * Mark a page as free or used in the free-space map, in memory and on disk. The caller holds allocation_latch_.
+   * @param page_id the page
+   * @param free true if the page is free
+   */
+  void SetPageFree(page_id_t page_id, bool free);
+
+  /** A log segment that is in use. */
+  struct LogSegment {
+    int64_t number_;
+    int fd_;
+    lsn_t first_lsn_;
+    off_t first_record_offset_;
+  };
+
+  /** What the header at the start of every segment file holds. */
+  struct LogSegmentHeader {
+    uint32_t magic_;
+    /** INVALID_LSN in a spare segment. */
+    lsn_t first_lsn_;
+    int64_t number_;
+    int64_t first_record_offset_;
+    /** The last complete checkpoint when the header was written. */
+    lsn_t checkpoint_lsn_;
+  };
+
+  /**
+   * Find the log segments, recycle the ones that are not part of the log and find the end of the log.
+   * @param new_file true if the database file was just created, which makes any old log stale
+   */
+  void LoadLogSegments(bool new_file);
+
+  /**
+   * Start a new log segment, reusing a spare one if there is one. The caller holds log_latch_.
+   * @param number the number of the segment
+   * @param first_lsn LSN of the first record that starts in the segment
+   * @param first_record_offset log offset of that record
+   */
+  void OpenLogSegment(int64_t number, lsn_t first_lsn, off_t first_record_offset);
+
+  /** Close a segment that is no longer needed, and keep it as a spare or delete it. The caller holds log_latch_. */
+  void RecycleLogSegment(const LogSegment &segment);
+
+  /** Split a range of log offsets into the parts in each segment. The caller holds log_latch_. */
+  std::vector<LogRange> MapLogRange(off_t offset, size_t size);
+
+  /** Read a range of log offsets. The caller holds log_latch_. */
+  bool ReadLogRange(char *log_data, size_t size, off_t offset);
+
+  std::string GetLogSegmentName(int64_t number) const;
+
+  // the segments of the log, oldest first; the last one takes the appends
+  std::deque<LogSegment> log_segments_;
+  // recycled segment files, waiting to be renamed into new segments
+  std::vector<std::string> spare_log_segments_;
+  // where the next log write goes
+  off_t log_offset_{0};
+  lsn_t recovered_next_lsn_{0};
+  // start of the last complete checkpoint
+  lsn_t checkpoint_lsn_{INVALID_LSN};
+  // protects the log segments, log_offset_ and checkpoint_lsn_
+  std::mutex log_latch_;
+
+  // file descriptor and name of the free-space map
+  int fsm_fd_{-1};
+  std::string fsm_name_;
+  // the free-space map, one bit per page, set when the page is free
+  std::vector<uint8_t> free_map_;
+  // the free pages, in order
+  std::set<page_id_t> free_pages_;
+  page_id_t next_page_id_;
+  // protects the free-space map and next_page_id_
+  std::mutex allocation_latch_;
 };
 
 }  // namespace bustub
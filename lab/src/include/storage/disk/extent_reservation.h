@@ -0,0 +1,83 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// extent_reservation.h
+//
+// Identification: src/include/storage/disk/extent_reservation.h
+//
+// Copyright (c) 2015-2019, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+#include <mutex>  // NOLINT
+#include <vector>
+
+#include "common/config.h"
+#include "common/macros.h"
+#include "storage/disk/disk_manager.h"
+
+namespace bustub {
+
+static constexpr size_t EXTENT_SIZE = 64;  // pages a table or index reserves at a time
+
+/**
+ * ExtentReservation hands out pages for a single table or index from extents, runs of contiguous pages that it
+ * reserves from the DiskManager one at a time. The pages of a table then sit next to each other in the file, so
+ * scanning them reads the file sequentially, and a bulk load goes to the DiskManager once per extent instead of once
+ * per page.
+ *
+ * The rest of the current extent stays reserved until Release is called or the reservation is destroyed, so a
+ * reservation must not outlive its DiskManager. Reserved pages past the end of the file are recovered by the next
+ * startup either way. Get one from BufferPoolManager::GetExtentReservation, and pass it to BufferPoolManager::NewPage.
+ */
+class ExtentReservation {
+ public:
+  /**
+   * Create a reservation that has no extent yet.
+   * @param disk_manager the disk manager to reserve extents from
+   * @param extent_size the number of pages in every extent
+   */
+  ExtentReservation(DiskManager *disk_manager, size_t extent_size);
+
+  /** Give the pages that were not handed out back to the disk manager. */
+  ~ExtentReservation();
+
+  DISALLOW_COPY_AND_MOVE(ExtentReservation);
+
+  /**
+   * @return the lowest page given back by ReturnPage, else the next page of the current extent, after reserving a new
+   * extent if the current one is used up
+   */
+  page_id_t AllocatePage();
+
+  /**
+   * Take back a page that AllocatePage handed out but that went unused, so that it is handed out again instead of
+   * leaving a hole in its extent.
+   * @param page_id the page to take back
+   */
+  void ReturnPage(page_id_t page_id);
+
+  /** Give the pages that were not handed out back to the disk manager. */
+  void Release();
+
+  /** @return the number of pages in every extent */
+  size_t GetExtentSize() const { return extent_size_; }
+
+  /** @return the number of reserved pages that were not handed out yet */
+  size_t GetNumReservedPages();
+
+ private:
+  DiskManager *disk_manager_;
+  size_t extent_size_;
+  /** The pages of the current extent that were not handed out yet, [next_page_id_, end_page_id_). */
+  page_id_t next_page_id_{0};
+  page_id_t end_page_id_{0};
+  /** The pages given back by ReturnPage, highest first. */
+  std::vector<page_id_t> returned_pages_;
+  std::mutex latch_;
+};
+
+}  // namespace bustub
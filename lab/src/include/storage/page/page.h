@@ -12,6 +12,7 @@
 
 #pragma once
 
+#include <atomic>
 #include <cstring>
 #include <iostream>
 
@@ -80,12 +81,16 @@ class Page {
 
   /** The actual data that is stored within a page. */
   char data_[PAGE_SIZE]{};
-  /** The ID of this page. */
-  page_id_t page_id_ = INVALID_PAGE_ID;
-  /** The pin count of this page. */
-  int pin_count_ = 0;
+  /** The ID of this page. Atomic, since buffer pool hits check it without a latch. */
+  std::atomic<page_id_t> page_id_{INVALID_PAGE_ID};
+  /** The pin count of this page. Atomic, since buffer pool hits pin without a latch. */
+  std::atomic<int> pin_count_{0};
   /** True if the page is dirty, i.e. it is different from its corresponding page on disk. */
-  bool is_dirty_ = false;
+  std::atomic<bool> is_dirty_{false};
+  /** The next LSN when the page was last pinned while unpinned. No change made under the current pins is older. */
+  std::atomic<lsn_t> pin_lsn_{0};
+  /** No change since the page was last written is older than this recLSN. INVALID_LSN if there was no change. */
+  std::atomic<lsn_t> rec_lsn_{INVALID_LSN};
   /** Page latch. */
   ReaderWriterLatch rwlatch_;
 };
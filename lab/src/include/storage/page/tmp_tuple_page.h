@@ -29,7 +29,7 @@ class TmpTuplePage : public Page {
 
   bool Insert(const Tuple &tuple, TmpTuple *out) {
     BUSTUB_ASSERT(tuple.GetLength() > 0, "Cannot have empty tuples.");
-    if (GetFreeSpaceRemaining() < tuple.GetLength() + SIZE_TUPLE) {
+    if (GetFreeSpaceRemaining() < tuple.GetLength() + SIZE_TUPLE + SIZE_TABLE_PAGE_HEADER) {
       return false;
     }
     uint32_t tuple_len = tuple.GetLength();
@@ -57,7 +57,7 @@ class TmpTuplePage : public Page {
   }
 
   uint32_t GetFreeSpaceOffset() {
-    return GetFreeSpaceRemaining() + SIZE_TABLE_PAGE_HEADER;
+    return GetFreeSpaceRemaining();
   }
 
   void SetFreeSpaceRemaining(uint32_t free_space_remaining) {
@@ -12,6 +12,8 @@
 
 #pragma once
 
+#include <memory>
+
 #include "buffer/buffer_pool_manager.h"
 #include "recovery/log_manager.h"
 #include "storage/page/table_page.h"
@@ -20,9 +22,12 @@
 
 namespace bustub {
 
+static constexpr size_t TABLE_HEAP_READ_AHEAD = 8;  // pages a sequential scan loads ahead of itself by default
+
 /**
  * TableHeap represents a physical table on disk.
- * This is just a doubly-linked list of pages.
+ * This is just a doubly-linked list of pages. New pages come from extents reserved for the table, so that the list
+ * mostly runs through contiguous pages.
  */
 class TableHeap {
   friend class TableIterator;
@@ -55,9 +60,10 @@ class TableHeap {
    * @param tuple tuple to insert
    * @param[out] rid the rid of the inserted tuple
    * @param txn the transaction performing the insert
+   * @param strategy the buffer access strategy of a bulk load, or nullptr
    * @return true iff the insert is successful
    */
-  bool InsertTuple(const Tuple &tuple, RID *rid, Transaction *txn);
+  bool InsertTuple(const Tuple &tuple, RID *rid, Transaction *txn, BufferAccessStrategy *strategy = nullptr);
 
   /**
    * Mark the tuple as deleted. The actual delete will occur when ApplyDelete is called.
@@ -91,28 +97,83 @@ class TableHeap {
   void RollbackDelete(const RID &rid, Transaction *txn);
 
   /**
-   * Read a tuple from the table.
+   * Read a tuple from the table. A transaction that reads a snapshot takes no lock, and gets the version of the
+   * tuple its snapshot sees. An optimistic transaction takes no lock either, sees its own buffered writes, and
+   * otherwise records the version word of the tuple in its read set.
    * @param rid rid of the tuple to read
    * @param tuple output variable for the tuple
    * @param txn transaction performing the read
+   * @param strategy the buffer access strategy of a scan, or nullptr
    * @return true if the read was successful (i.e. the tuple exists)
    */
-  bool GetTuple(const RID &rid, Tuple *tuple, Transaction *txn);
+  bool GetTuple(const RID &rid, Tuple *tuple, Transaction *txn, BufferAccessStrategy *strategy = nullptr);
 
-  /** @return the begin iterator of this table */
-  TableIterator Begin(Transaction *txn);
+  /**
+   * @param txn the transaction performing the scan
+   * @param strategy the buffer access strategy the scan reads pages through, or nullptr for the shared pool
+   * @return the begin iterator of this table
+   */
+  TableIterator Begin(Transaction *txn, BufferAccessStrategy *strategy = nullptr);
 
   /** @return the end iterator of this table */
   TableIterator End();
 
+  /**
+   * Lock the whole table, so that the transaction needs no row locks in it. Without logging, nothing is locked,
+   * transactions that read a snapshot take no shared locks, and optimistic transactions take no locks at all.
+   * @param txn the transaction
+   * @param lock_mode the lock mode
+   * @return false if the lock could not be granted
+   */
+  bool LockTable(Transaction *txn, LockMode lock_mode);
+
   /** @return the id of the first page of this table */
   inline page_id_t GetFirstPageId() const { return first_page_id_; }
 
+  /**
+   * Set how many pages ahead of itself an iterator of this table asks the buffer pool to prefetch. A scan through
+   * a strategy stays a couple of pages below the size of the strategy's rings, so that it does not recycle pages it
+   * prefetched before reaching them.
+   * @param distance the number of pages, 0 disables read-ahead
+   */
+  inline void SetReadAheadDistance(size_t distance) { read_ahead_distance_ = distance; }
+
+  /** @return how many pages ahead of itself an iterator of this table prefetches */
+  inline size_t GetReadAheadDistance() const { return read_ahead_distance_; }
+
  private:
+  /**
+   * Lock a tuple for the transaction, with the intention locks on the table and its page, unless the transaction
+   * holds a lock that covers it. Tuples are locked before their page is latched, so that the transaction never waits
+   * for a lock while holding a latch.
+   * @return false if the lock could not be granted
+   */
+  bool LockTuple(const RID &rid, Transaction *txn, bool exclusive);
+
+  /**
+   * Lock a tuple exclusively for the transaction, unless another transaction is in the way. Never waits, so that
+   * inserts can lock the slot they pick while they hold its page latch.
+   * @return false if the lock could not be granted right away
+   */
+  bool TryLockTuple(const RID &rid, Transaction *txn);
+
+  /** @return true if the transaction is optimistic and still holds its updates and deletes back */
+  bool BuffersWrites(Transaction *txn);
+
+  /**
+   * Unlock the version word of a tuple, if the transaction holds it. Called under the tuple's page latch.
+   * @param rid the tuple
+   * @param txn the transaction
+   * @param changed true if the transaction changed the tuple
+   */
+  void UnlockRowVersion(const RID &rid, Transaction *txn, bool changed);
+
   BufferPoolManager *buffer_pool_manager_;
   LockManager *lock_manager_;
   LogManager *log_manager_;
   page_id_t first_page_id_{};
+  size_t read_ahead_distance_{TABLE_HEAP_READ_AHEAD};
+  std::unique_ptr<ExtentReservation> extent_;
 };
 
 }  // namespace bustub
@@ -20,6 +20,7 @@
 
 namespace bustub {
 
+class BufferAccessStrategy;
 class TableHeap;
 
 /**
@@ -31,10 +32,11 @@ class TableIterator {
  public:
   TableIterator() = default;
 
-  TableIterator(TableHeap *table_heap, RID rid, Transaction *txn);
+  TableIterator(TableHeap *table_heap, RID rid, Transaction *txn, BufferAccessStrategy *strategy = nullptr);
 
   TableIterator(const TableIterator &other)
-  :table_heap_(other.table_heap_), tuple_(new Tuple(*other.tuple_)), txn_(other.txn_) {}
+  :table_heap_(other.table_heap_), tuple_(new Tuple(*other.tuple_)), txn_(other.txn_), strategy_(other.strategy_),
+   pages_until_read_ahead_(other.pages_until_read_ahead_) {}
 
   ~TableIterator() { delete tuple_; }
 
@@ -57,13 +59,38 @@ class TableIterator {
     table_heap_ = other.table_heap_;
     tuple_ = new Tuple(*other.tuple_);
     txn_ = other.txn_;
+    strategy_ = other.strategy_;
+    pages_until_read_ahead_ = other.pages_until_read_ahead_;
     return *this;
   }
 
  private:
+  /**
+   * Move to the next tuple, or to the next slot that may hold a version of one if the transaction reads a snapshot.
+   * @return true if there is a tuple the transaction sees there, or the iterator reached the end
+   */
+  bool Advance();
+
+  /** @return true if the transaction reads a snapshot */
+  inline bool ReadsSnapshot() const { return txn_ != nullptr && txn_->GetVersionStore() != nullptr; }
+
+  /** @return true if the transaction reads without locks, and skips the tuples it does not see */
+  inline bool ReadsUnlocked() const { return txn_ != nullptr && !txn_->ReadsUnderLocks(); }
+
+  /**
+   * Called whenever the iterator arrives on a page. Every so often, asks the buffer pool to prefetch the pages after
+   * it, so that the scan finds them loaded.
+   * @param page_id the page the iterator arrived on
+   */
+  void ReadAhead(page_id_t page_id);
+
   TableHeap *table_heap_;
   Tuple *tuple_;
   Transaction *txn_;
+  /** The buffer access strategy that pages are read through, or nullptr for the shared pool. */
+  BufferAccessStrategy *strategy_{nullptr};
+  /** Pages to go until the next read-ahead request. */
+  size_t pages_until_read_ahead_{0};
 };
 
 }  // namespace bustub
@@ -36,6 +36,8 @@ class Tuple {
 
   friend class TmpTuplePage;
 
+  friend class VersionStore;
+
  public:
   // Default constructor (to create a dummy tuple)
   Tuple() = default;
@@ -12,20 +12,52 @@
 
 #include "recovery/checkpoint_manager.h"
 
+#include <algorithm>
+#include <utility>
+#include <vector>
+
 namespace bustub {
 
+CheckpointManager::~CheckpointManager() { EndCheckpoint(); }
+
 void CheckpointManager::BeginCheckpoint() {
-  // Block all the transactions and ensure that both the WAL and all dirty buffer pool pages are persisted to disk,
-  // creating a consistent checkpoint. Do NOT allow transactions to resume at the end of this method, resume them
-  // in CheckpointManager::EndCheckpoint() instead. This is for grading purposes.
-  transaction_manager_->BlockAllTransactions();
-  log_manager_->GetCv().notify_one();
-  buffer_pool_manager_->FlushAllPages();
+  // One checkpoint at a time.
+  EndCheckpoint();
+  if (!enable_logging) {
+    flush_thread_ = std::thread(&CheckpointManager::FlushAndTruncate, this, INVALID_LSN);
+    return;
+  }
+
+  LogRecord begin_record(INVALID_TXN_ID, INVALID_LSN, LogRecordType::BEGIN_CHECKPOINT);
+  lsn_t begin_lsn = log_manager_->AppendLogRecord(&begin_record);
+
+  // Both tables are taken after BEGIN_CHECKPOINT, so whatever they miss is in the log that follows it.
+  std::vector<std::pair<txn_id_t, lsn_t>> active_txns;
+  lsn_t oldest_begin_lsn = transaction_manager_->GetActiveTransactionTable(begin_lsn, &active_txns);
+  LogRecord end_record(begin_lsn, std::move(active_txns), buffer_pool_manager_->GetDirtyPageTable());
+  lsn_t end_lsn = log_manager_->AppendLogRecord(&end_record);
+  log_manager_->WaitForFlush(end_lsn);
+  disk_manager_->SetCheckpointLSN(begin_lsn);
+
+  // Redo starts at the redo LSN, and undo goes back to the BEGIN record of the oldest running transaction.
+  lsn_t truncate_lsn = end_record.GetRedoLSN();
+  if (oldest_begin_lsn != INVALID_LSN) {
+    truncate_lsn = std::min(truncate_lsn, oldest_begin_lsn);
+  }
+  flush_thread_ = std::thread(&CheckpointManager::FlushAndTruncate, this, truncate_lsn);
 }
 
 void CheckpointManager::EndCheckpoint() {
-  // Allow transactions to resume, completing the checkpoint.
-  transaction_manager_->ResumeTransactions();
+  if (flush_thread_.joinable()) {
+    flush_thread_.join();
+  }
+}
+
+void CheckpointManager::FlushAndTruncate(lsn_t truncate_lsn) {
+  buffer_pool_manager_->FlushAllPages();
+  if (truncate_lsn != INVALID_LSN) {
+    disk_manager_->TruncateLog(disk_manager_->GetLogOffset(truncate_lsn));
+  }
 }
 
 }  // namespace bustub
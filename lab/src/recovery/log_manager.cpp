@@ -12,6 +12,14 @@
 
 #include "recovery/log_manager.h"
 
+#include <cstring>
+#include <functional>
+#include <thread>  // NOLINT
+#include <vector>
+
+#include "common/macros.h"
+#include "common/util/compression_util.h"
+
 namespace bustub {
 /*
  * set enable_logging = true
@@ -34,98 +42,211 @@ void LogManager::RunFlushThread() {
  */
 void LogManager::StopFlushThread() {
   if (enable_logging) {
-    enable_logging = false;
+    {
+      std::lock_guard<std::mutex> guard(latch_);
+      enable_logging = false;
+    }
+    cv_.notify_one();
     flush_thread_->join();
     delete flush_thread_;
   }
 }
 
+/*
+ * Block until the log is persistent up to lsn
+ * The flush thread batches every waiter it finds into a single write and sync
+ */
+void LogManager::WaitForFlush(lsn_t lsn) {
+  std::unique_lock<std::mutex> latch(latch_);
+  if (lsn <= persistent_lsn_ || !enable_logging) {
+    return;
+  }
+  flush_requested_lsn_ = std::max(flush_requested_lsn_, lsn);
+  cv_.notify_one();
+  flushed_cv_.wait(latch, [&] { return lsn <= persistent_lsn_ || !enable_logging; });
+}
+
 /*
  * append a log record into log buffer
- * you MUST set the log record's lsn within this method
+ * the record's lsn and its space in the buffer are reserved together with one compare-and-swap, so that the order
+ * of the records in the buffer is the order of their lsns. the record is then serialized without any latch
  * @return: lsn that is assigned to this log record
- *
- *
+ */
+lsn_t LogManager::AppendLogRecord(LogRecord *log_record) {
+  // A record is compressed before its space is reserved, since the reservation needs its final size. The compressed
+  // image carries that size in its own HEADER, so the caller's record keeps its uncompressed size.
+  std::vector<char> compressed;
+  if (log_compression_ && log_record->GetSize() - LogRecord::HEADER_SIZE >= LOG_COMPRESSION_MIN_SIZE) {
+    compressed = CompressLogRecord(*log_record);
+  }
+  auto size = static_cast<uint64_t>(compressed.empty() ? log_record->GetSize() : compressed.size());
+  BUSTUB_ASSERT(size <= static_cast<uint64_t>(LOG_BUFFER_SIZE), "Log record is larger than the log buffer.");
+  uint64_t state = reserve_state_.load();
+  while (true) {
+    if (StateOffset(state) + size > static_cast<uint64_t>(LOG_BUFFER_SIZE)) {
+      state = WaitForBufferSpace(size);
+      continue;
+    }
+    uint64_t reserved = state + (uint64_t{1} << STATE_LSN_SHIFT) + size;
+    if (reserve_state_.compare_exchange_weak(state, reserved)) {
+      break;
+    }
+  }
+  log_record->lsn_ = StateLSN(state);
+  size_t buffer = StateBuffer(state);
+  char *dest = log_buffers_[buffer] + StateOffset(state);
+  if (compressed.empty()) {
+    SerializeLogRecord(*log_record, dest);
+  } else {
+    memcpy(dest, compressed.data(), size);
+    // The LSN follows the size in the HEADER.
+    memcpy(dest + sizeof(int32_t), &log_record->lsn_, sizeof(lsn_t));
+  }
+  // Publish the record to the flush thread.
+  filled_[buffer].fetch_add(size, std::memory_order_release);
+  return log_record->lsn_;
+}
+
+uint64_t LogManager::WaitForBufferSpace(uint64_t size) {
+  std::unique_lock<std::mutex> latch(latch_);
+  // The flush thread seals the buffer under the latch, so checking the state under the latch cannot miss the seal.
+  uint64_t state = reserve_state_.load();
+  while (StateOffset(state) + size > static_cast<uint64_t>(LOG_BUFFER_SIZE)) {
+    flush_requested_lsn_ = std::max(flush_requested_lsn_, StateLSN(state) - 1);
+    cv_.notify_one();
+    space_cv_.wait(latch);
+    state = reserve_state_.load();
+  }
+  return state;
+}
+
+/*
  * example below
  * // First, serialize the must have fields(20 bytes in total)
- * log_record.lsn_ = next_lsn_++;
- * memcpy(log_buffer_ + offset_, &log_record, 20);
- * int pos = offset_ + 20;
+ * memcpy(dest, &log_record, 20);
+ * int pos = 20;
  *
  * if (log_record.log_record_type_ == LogRecordType::INSERT) {
- *    memcpy(log_buffer_ + pos, &log_record.insert_rid_, sizeof(RID));
+ *    memcpy(dest + pos, &log_record.insert_rid_, sizeof(RID));
  *    pos += sizeof(RID);
  *    // we have provided serialize function for tuple class
- *    log_record.insert_tuple_.SerializeTo(log_buffer_ + pos);
+ *    log_record.insert_tuple_.SerializeTo(dest + pos);
  *  }
- *
  */
-lsn_t LogManager::AppendLogRecord(LogRecord *log_record) {
-  latch_.lock();
-  while (log_offset_ + log_record->GetSize() > LOG_BUFFER_SIZE){
-    latch_.unlock();
-    cv_.notify_one();
-    std::this_thread::yield();
-    latch_.lock();
-  }
-  log_record->lsn_ = next_lsn_++;
-  memcpy(log_buffer_ + log_offset_, log_record, 20);
-  int pos = log_offset_ + 20;
-  switch(log_record->log_record_type_){
+void LogManager::SerializeLogRecord(const LogRecord &log_record, char *dest) {
+  memcpy(dest, &log_record, LogRecord::HEADER_SIZE);
+  int pos = LogRecord::HEADER_SIZE;
+  switch (log_record.log_record_type_) {
     case LogRecordType::INVALID:
       break;
     case LogRecordType::INSERT:
-      memcpy(log_buffer_ + pos, &log_record->insert_rid_, sizeof(RID));
+      memcpy(dest + pos, &log_record.insert_rid_, sizeof(RID));
       pos += sizeof(RID);
-      log_record->insert_tuple_.SerializeTo(log_buffer_ + pos);
-      pos += sizeof(int32_t) + log_record->insert_tuple_.GetLength();
+      log_record.insert_tuple_.SerializeTo(dest + pos);
       break;
     case LogRecordType::MARKDELETE:
     case LogRecordType::ROLLBACKDELETE:
+      memcpy(dest + pos, &log_record.delete_rid_, sizeof(RID));
+      break;
     case LogRecordType::APPLYDELETE:
-      memcpy(log_buffer_ + pos, &log_record->delete_rid_,sizeof(RID));
+      memcpy(dest + pos, &log_record.delete_rid_, sizeof(RID));
       pos += sizeof(RID);
-      log_record->delete_tuple_.SerializeTo(log_buffer_ + pos);
-      pos += sizeof(int32_t) + log_record->delete_tuple_.GetLength();
+      log_record.delete_tuple_.SerializeTo(dest + pos);
       break;
     case LogRecordType::UPDATE:
-      memcpy(log_buffer_ + pos, &log_record->update_rid_, sizeof(RID));
+      memcpy(dest + pos, &log_record.update_rid_, sizeof(RID));
       pos += sizeof(RID);
-      log_record->old_tuple_.SerializeTo(log_buffer_ + pos);
-      pos += sizeof(int32_t) + log_record->old_tuple_.GetLength();
-      log_record->new_tuple_.SerializeTo(log_buffer_ + pos);
-      pos += sizeof(int32_t) + log_record->new_tuple_.GetLength();
+      log_record.update_delta_.SerializeTo(dest + pos);
       break;
     case LogRecordType::NEWPAGE:
-      memcpy(log_buffer_ + pos, &log_record->prev_page_id_, 2 * sizeof(page_id_t));
-      pos += 2 * sizeof(page_id_t);
+      memcpy(dest + pos, &log_record.prev_page_id_, 2 * sizeof(page_id_t));
       break;
-    case LogRecordType::BEGIN:
+    case LogRecordType::END_CHECKPOINT: {
+      memcpy(dest + pos, &log_record.redo_lsn_, sizeof(lsn_t));
+      pos += sizeof(lsn_t);
+      auto txn_count = static_cast<int32_t>(log_record.active_txns_.size());
+      memcpy(dest + pos, &txn_count, sizeof(int32_t));
+      pos += sizeof(int32_t);
+      memcpy(dest + pos, log_record.active_txns_.data(), txn_count * sizeof(log_record.active_txns_[0]));
+      pos += txn_count * sizeof(log_record.active_txns_[0]);
+      auto page_count = log_record.has_dirty_page_table_ ? static_cast<int32_t>(log_record.dirty_pages_.size()) : -1;
+      memcpy(dest + pos, &page_count, sizeof(int32_t));
+      pos += sizeof(int32_t);
+      if (page_count > 0) {
+        memcpy(dest + pos, log_record.dirty_pages_.data(), page_count * sizeof(log_record.dirty_pages_[0]));
+      }
       break;
+    }
+    case LogRecordType::BEGIN:
     case LogRecordType::COMMIT:
-      break;
     case LogRecordType::ABORT:
+    case LogRecordType::BEGIN_CHECKPOINT:
       break;
   }
-  log_offset_ = pos;
-  latch_.unlock();
-  return log_record->lsn_;
+}
+
+/*
+ * serialize a record, then compress everything after its header
+ * the result is | HEADER | body_size | compressed body |, with the compressed flag in the type
+ */
+std::vector<char> LogManager::CompressLogRecord(const LogRecord &log_record) {
+  std::vector<char> record(log_record.size_);
+  SerializeLogRecord(log_record, record.data());
+  int32_t body_size = log_record.size_ - LogRecord::HEADER_SIZE;
+  int32_t prefix_size = LogRecord::HEADER_SIZE + sizeof(int32_t);
+  // only worth it if the result is smaller than the record
+  std::vector<char> compressed(log_record.size_ - 1);
+  size_t compressed_size = CompressionUtil::Compress(record.data() + LogRecord::HEADER_SIZE, body_size,
+                                                     compressed.data() + prefix_size, compressed.size() - prefix_size);
+  if (compressed_size == 0) {
+    return {};
+  }
+  auto size = static_cast<int32_t>(prefix_size + compressed_size);
+  auto type = static_cast<int32_t>(log_record.log_record_type_) | LOG_RECORD_COMPRESSED;
+  memcpy(compressed.data(), record.data(), LogRecord::HEADER_SIZE);
+  memcpy(compressed.data(), &size, sizeof(int32_t));
+  // The type is the last field of the HEADER.
+  memcpy(compressed.data() + LogRecord::HEADER_SIZE - sizeof(int32_t), &type, sizeof(int32_t));
+  memcpy(compressed.data() + LogRecord::HEADER_SIZE, &body_size, sizeof(int32_t));
+  compressed.resize(size);
+  return compressed;
 }
 
 void LogManager::FlushLog() {
+  std::unique_lock<std::mutex> latch(latch_);
   while (enable_logging) {
-    lsn_t persistent_lsn;
-      {
-        std::unique_lock<std::mutex> latch(latch_);
-        cv_.wait_for(latch, log_timeout);
-        persistent_lsn = next_lsn_ - 1;
-        std::swap(log_buffer_, flush_buffer_);
-        std::swap(log_offset_, flush_offset_);
-      }
-    disk_manager_->WriteLog(flush_buffer_, flush_offset_);
-    flush_offset_ = 0;
-    SetPersistentLSN(persistent_lsn);
+    // Sleep until the timeout or a notification, unless somebody asked for a flush while we were writing.
+    if (flush_requested_lsn_ <= persistent_lsn_) {
+      cv_.wait_for(latch, log_timeout);
+    }
+    if (flush_requested_lsn_ > persistent_lsn_ && group_commit_window_.count() > 0) {
+      // Give more committers a chance to join this flush.
+      latch.unlock();
+      std::this_thread::sleep_for(group_commit_window_);
+      latch.lock();
+    }
+    // Seal the current buffer. New records go to the other buffer, which the previous flush emptied.
+    uint64_t state = reserve_state_.load();
+    while (!reserve_state_.compare_exchange_weak(
+        state, (state & ~(STATE_BUFFER_BIT | STATE_OFFSET_MASK)) | ((state & STATE_BUFFER_BIT) ^ STATE_BUFFER_BIT))) {
+    }
+    space_cv_.notify_all();
+    latch.unlock();
+
+    size_t buffer = StateBuffer(state);
+    uint64_t size = StateOffset(state);
+    // Writers that reserved space in the sealed buffer may still be copying their records in.
+    while (filled_[buffer].load(std::memory_order_acquire) != size) {
+      std::this_thread::yield();
+    }
+    disk_manager_->WriteLog(log_buffers_[buffer], static_cast<int>(size));
+    filled_[buffer].store(0);
+
+    latch.lock();
+    SetPersistentLSN(StateLSN(state) - 1);
+    flushed_cv_.notify_all();
   }
+  flushed_cv_.notify_all();
 }
 
 }  // namespace bustub
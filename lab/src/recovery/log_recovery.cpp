@@ -11,7 +11,12 @@
 //===----------------------------------------------------------------------===//
 
 #include "recovery/log_recovery.h"
+#include <memory>
 #include <set>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+#include "common/util/compression_util.h"
 #include "storage/page/table_page.h"
 
 namespace bustub {
@@ -30,6 +35,26 @@ bool LogRecovery::DeserializeLogRecord(const char *data, LogRecord *log_record)
     return false;
   }
   data += LogRecord::HEADER_SIZE;
+  // A compressed record carries its body size, then the compressed body.
+  std::vector<char> body;
+  auto type = static_cast<int32_t>(log_record->log_record_type_);
+  if ((type & LOG_RECORD_COMPRESSED) != 0) {
+    log_record->log_record_type_ = static_cast<LogRecordType>(type & ~LOG_RECORD_COMPRESSED);
+    int32_t body_size;
+    if (log_size < LogRecord::HEADER_SIZE + static_cast<int32_t>(sizeof(int32_t))) {
+      return false;
+    }
+    memcpy(&body_size, data, sizeof(int32_t));
+    if (body_size <= 0 || body_size > LOG_BUFFER_SIZE) {
+      return false;
+    }
+    body.resize(body_size);
+    if (!CompressionUtil::Decompress(data + sizeof(int32_t), log_size - LogRecord::HEADER_SIZE - sizeof(int32_t),
+                                     body.data(), body_size)) {
+      return false;
+    }
+    data = body.data();
+  }
   switch (log_record->log_record_type_) {
     case LogRecordType::INVALID:
       return false;
@@ -40,24 +65,49 @@ bool LogRecovery::DeserializeLogRecord(const char *data, LogRecord *log_record)
       log_record->insert_tuple_.DeserializeFrom(data);
       break;
     case LogRecordType::MARKDELETE:
-    case LogRecordType::APPLYDELETE:
     case LogRecordType::ROLLBACKDELETE:
+      memcpy(&log_record->delete_rid_, data, sizeof(RID));
+      break;
+    case LogRecordType::APPLYDELETE:
       memcpy(&log_record->delete_rid_, data, sizeof(RID));
       // log_record->delete_rid_ = *reinterpret_cast<const RID *>(data);
       data += sizeof(RID);
-      log_record->insert_tuple_.DeserializeFrom(data);
+      log_record->delete_tuple_.DeserializeFrom(data);
       break;
     case LogRecordType::UPDATE:
       memcpy(&log_record->update_rid_, data, sizeof(RID));
       // log_record->update_rid_ = *reinterpret_cast<const RID *>(data);
-      log_record->old_tuple_.DeserializeFrom(data + sizeof(RID));
-      data += sizeof(RID) + sizeof(uint32_t) + log_record->old_tuple_.GetLength();
-      log_record->new_tuple_.DeserializeFrom(data);
+      log_record->update_delta_.DeserializeFrom(data + sizeof(RID));
       break;
     case LogRecordType::BEGIN:
     case LogRecordType::COMMIT:
     case LogRecordType::ABORT:
+    case LogRecordType::BEGIN_CHECKPOINT:
+      break;
+    case LogRecordType::END_CHECKPOINT: {
+      memcpy(&log_record->redo_lsn_, data, sizeof(lsn_t));
+      data += sizeof(lsn_t);
+      int32_t txn_count;
+      memcpy(&txn_count, data, sizeof(int32_t));
+      data += sizeof(int32_t);
+      log_record->active_txns_.resize(txn_count);
+      for (auto &active_txn : log_record->active_txns_) {
+        memcpy(&active_txn.first, data, sizeof(txn_id_t));
+        memcpy(&active_txn.second, data + sizeof(txn_id_t), sizeof(lsn_t));
+        data += sizeof(txn_id_t) + sizeof(lsn_t);
+      }
+      int32_t page_count;
+      memcpy(&page_count, data, sizeof(int32_t));
+      data += sizeof(int32_t);
+      log_record->has_dirty_page_table_ = page_count >= 0;
+      log_record->dirty_pages_.resize(std::max(page_count, 0));
+      for (auto &dirty_page : log_record->dirty_pages_) {
+        memcpy(&dirty_page.first, data, sizeof(page_id_t));
+        memcpy(&dirty_page.second, data + sizeof(page_id_t), sizeof(lsn_t));
+        data += sizeof(page_id_t) + sizeof(lsn_t);
+      }
       break;
+    }
     case LogRecordType::NEWPAGE:
       memcpy(&log_record->prev_page_id_, data, 2 * sizeof(page_id_t));
       // log_record->prev_page_id_ = *reinterpret_cast<const page_id_t *>(data);
@@ -68,105 +118,305 @@ bool LogRecovery::DeserializeLogRecord(const char *data, LogRecord *log_record)
   return true;
 }
 
+/*
+ * find the last checkpoint and load its tables
+ * the begin checkpoint record is in the segment that GetLogOffset points to, and the end checkpoint record follows it
+ */
+lsn_t LogRecovery::LoadCheckpoint() {
+  lsn_t checkpoint_lsn = disk_manager_->GetCheckpointLSN();
+  if (checkpoint_lsn == INVALID_LSN) {
+    return INVALID_LSN;
+  }
+  LogRecord log_record;
+  int offset = disk_manager_->GetLogOffset(checkpoint_lsn);
+  while (ReadLogRecord(offset, &log_record)) {
+    if (log_record.GetLogRecordType() == LogRecordType::END_CHECKPOINT && log_record.GetPrevLSN() == checkpoint_lsn) {
+      for (const auto &active_txn : log_record.GetActiveTxns()) {
+        active_txn_[active_txn.first] = active_txn.second;
+      }
+      dirty_page_table_.insert(log_record.GetDirtyPages().begin(), log_record.GetDirtyPages().end());
+      has_dirty_page_table_ = log_record.HasDirtyPageTable();
+      checkpoint_lsn_ = checkpoint_lsn;
+      return log_record.GetRedoLSN();
+    }
+    offset += log_record.GetSize();
+  }
+  return INVALID_LSN;
+}
+
+/*
+ * a change from before the checkpoint is missing from its page only if the page was dirty when the checkpoint was
+ * taken, and the change is not older than the first change the page was missing
+ */
+bool LogRecovery::NeedsRedo(page_id_t page_id, lsn_t lsn) {
+  if (checkpoint_lsn_ == INVALID_LSN || !has_dirty_page_table_ || lsn >= checkpoint_lsn_) {
+    return true;
+  }
+  auto it = dirty_page_table_.find(page_id);
+  return it != dirty_page_table_.end() && lsn >= it->second;
+}
+
+/*
+ * read the log record at offset, refilling the log buffer from offset on if the record is not all in it
+ */
+bool LogRecovery::ReadLogRecord(int offset, LogRecord *log_record) {
+  if (offset >= offset_ && offset < offset_ + LOG_BUFFER_SIZE &&
+      DeserializeLogRecord(log_buffer_ + (offset - offset_), log_record)) {
+    return true;
+  }
+  if (!disk_manager_->ReadLog(log_buffer_, LOG_BUFFER_SIZE, offset)) {
+    return false;
+  }
+  offset_ = offset;
+  return DeserializeLogRecord(log_buffer_, log_record);
+}
+
+/*
+ * find where a record of a running transaction is
+ * the records redo saw are in lsn_mapping_; older ones are found by reading their segment up to them
+ */
+int LogRecovery::FindLogOffset(lsn_t lsn) {
+  auto it = lsn_mapping_.find(lsn);
+  if (it != lsn_mapping_.end()) {
+    return it->second;
+  }
+  LogRecord log_record;
+  int offset = disk_manager_->GetLogOffset(lsn);
+  while (ReadLogRecord(offset, &log_record) && log_record.GetLSN() <= lsn) {
+    if (log_record.GetLSN() == lsn) {
+      return offset;
+    }
+    if (active_txn_.count(log_record.GetTxnId()) > 0) {
+      lsn_mapping_[log_record.GetLSN()] = offset;
+    }
+    offset += log_record.GetSize();
+  }
+  return -1;
+}
+
+/*
+ * replay the part of a record that changes the given page, if the page does not have it yet
+ */
+void LogRecovery::RedoPage(LogRecord *log_record, page_id_t page_id) {
+  Page *page = buffer_pool_manager_->FetchPage(page_id);
+  auto *table_page = reinterpret_cast<TablePage *>(page->GetData());
+  bool need_redo = table_page->GetLSN() < log_record->lsn_;
+  if (need_redo) {
+    switch (log_record->log_record_type_) {
+      case LogRecordType::INSERT: {
+        RID rid = log_record->insert_rid_;
+        table_page->InsertTuple(log_record->insert_tuple_, &rid, nullptr, nullptr);
+        break;
+      }
+      case LogRecordType::MARKDELETE:
+        table_page->MarkDelete(log_record->delete_rid_, nullptr, nullptr);
+        break;
+      case LogRecordType::APPLYDELETE:
+        table_page->ApplyDelete(log_record->delete_rid_, nullptr, nullptr);
+        break;
+      case LogRecordType::ROLLBACKDELETE:
+        table_page->RollbackDelete(log_record->delete_rid_, nullptr, nullptr);
+        break;
+      case LogRecordType::UPDATE: {
+        // the record only has the bytes that changed, so they are applied to the version on the page
+        Tuple old_tuple;
+        Tuple new_tuple;
+        if (table_page->GetTuple(log_record->update_rid_, &old_tuple, nullptr) &&
+            log_record->update_delta_.Apply(old_tuple, &new_tuple)) {
+          table_page->UpdateTuple(new_tuple, &old_tuple, log_record->update_rid_, nullptr, nullptr);
+        }
+        break;
+      }
+      case LogRecordType::NEWPAGE:
+        // a new page is initialized, and the page before it is linked to it
+        if (page_id == log_record->page_id_) {
+          table_page->Init(page_id, PAGE_SIZE, log_record->prev_page_id_, nullptr, nullptr);
+        } else {
+          table_page->SetNextPageId(log_record->page_id_);
+        }
+        break;
+      default:
+        break;
+    }
+    table_page->SetLSN(log_record->lsn_);
+  }
+  buffer_pool_manager_->UnpinPage(page_id, need_redo);
+}
+
+/*
+ * body of a redo worker: replay the batches the reader hands over, in order
+ */
+void LogRecovery::RedoLoop(RedoWorker *worker) {
+  std::unique_lock<std::mutex> latch(worker->latch_);
+  while (true) {
+    worker->cv_.wait(latch, [&] { return !worker->batches_.empty() || worker->done_; });
+    if (worker->batches_.empty()) {
+      return;
+    }
+    auto batch = std::move(worker->batches_.front());
+    worker->batches_.pop_front();
+    latch.unlock();
+    // the reader may be waiting for room in the queue
+    worker->cv_.notify_all();
+    for (auto &item : batch) {
+      RedoPage(&item.second, item.first);
+    }
+    latch.lock();
+  }
+}
+
+/*
+ * hand a batch of records to a redo worker, waiting while its queue is full
+ */
+void LogRecovery::Dispatch(RedoWorker *worker) {
+  if (worker->batch_.empty()) {
+    return;
+  }
+  std::unique_lock<std::mutex> latch(worker->latch_);
+  worker->cv_.wait(latch, [&] { return worker->batches_.size() < REDO_QUEUE_DEPTH; });
+  worker->batches_.push_back(std::move(worker->batch_));
+  worker->batch_.clear();
+  latch.unlock();
+  worker->cv_.notify_all();
+}
+
+/*
+ * the pages a record changes, INVALID_PAGE_ID where there is none
+ */
+void LogRecovery::GetPageIds(LogRecord *log_record, page_id_t *page_ids) {
+  page_ids[0] = INVALID_PAGE_ID;
+  page_ids[1] = INVALID_PAGE_ID;
+  switch (log_record->log_record_type_) {
+    case LogRecordType::INSERT:
+      page_ids[0] = log_record->insert_rid_.GetPageId();
+      break;
+    case LogRecordType::MARKDELETE:
+    case LogRecordType::APPLYDELETE:
+    case LogRecordType::ROLLBACKDELETE:
+      page_ids[0] = log_record->delete_rid_.GetPageId();
+      break;
+    case LogRecordType::UPDATE:
+      page_ids[0] = log_record->update_rid_.GetPageId();
+      break;
+    case LogRecordType::NEWPAGE:
+      page_ids[0] = log_record->page_id_;
+      page_ids[1] = log_record->prev_page_id_;
+      break;
+    default:
+      break;
+  }
+}
+
+/*
+ * the number of pages to prefetch at a time; two windows are in the buffer pool at once, the one redo works on and
+ * the one being loaded, so together they take half of it at most
+ */
+size_t LogRecovery::PrefetchWindow() {
+  return std::max<size_t>(1, std::min(RECOVERY_PREFETCH_PAGES, buffer_pool_manager_->GetPoolSize() / 4));
+}
+
+/*
+ * look ahead in the log buffer for the next window of pages that redo will change, and start loading them
+ * once redo gets to the first record of the window, the window after it is loaded
+ */
+void LogRecovery::PrefetchAhead(lsn_t redo_lsn) {
+  prefetch_offset_ = std::max(prefetch_offset_, offset_);
+  size_t window = PrefetchWindow();
+  std::vector<page_id_t> prefetch_page_ids;
+  std::unordered_set<page_id_t> seen;
+  int trigger = -1;
+  LogRecord log_record;
+  while (prefetch_page_ids.size() < window && prefetch_offset_ < offset_ + LOG_BUFFER_SIZE &&
+         DeserializeLogRecord(log_buffer_ + (prefetch_offset_ - offset_), &log_record)) {
+    page_id_t page_ids[2];
+    GetPageIds(&log_record, page_ids);
+    for (page_id_t page_id : page_ids) {
+      if (page_id != INVALID_PAGE_ID && log_record.lsn_ >= redo_lsn && NeedsRedo(page_id, log_record.lsn_) &&
+          seen.insert(page_id).second) {
+        prefetch_page_ids.push_back(page_id);
+        if (trigger < 0) {
+          trigger = prefetch_offset_;
+        }
+      }
+    }
+    prefetch_offset_ += log_record.GetSize();
+  }
+  // the rest of the log is not in the buffer yet; look again once redo has read it
+  prefetch_trigger_ = trigger < 0 ? prefetch_offset_ : trigger;
+  buffer_pool_manager_->PrefetchPages(prefetch_page_ids);
+}
+
 /*
  *redo phase on TABLE PAGE level(table/table_page.h)
- *read log file from the beginning to end (you must prefetch log records into
- *log buffer to reduce unnecessary I/O operations), remember to compare page's
- *LSN with log_record's sequence number, and also build active_txn_ table &
+ *read the log from the redo lsn of the last checkpoint to the end (records are read into the log buffer in big
+ *chunks), remember to compare page's LSN with log_record's sequence number, and also build active_txn_ table &
  *lsn_mapping_ table
+ *with redo workers, this thread only reads the log and keeps the tables, and every change goes to the worker that
+ *owns its page, so the changes to a page are replayed in log order while different pages are replayed in parallel
  */
-void LogRecovery::Redo() {
+void LogRecovery::Redo(size_t num_workers) {
   assert(enable_logging == false);
+  std::vector<std::unique_ptr<RedoWorker>> workers;
+  for (size_t i = 0; i < num_workers; i++) {
+    workers.emplace_back(new RedoWorker);
+    workers.back()->thread_ = std::thread(&LogRecovery::RedoLoop, this, workers.back().get());
+  }
+
   LogRecord log_record;
-  int out_offset = 0;
-  while (disk_manager_->ReadLog(log_buffer_, LOG_BUFFER_SIZE, out_offset)) {
-    int inter_offset = 0;
-    while (DeserializeLogRecord(log_buffer_ + inter_offset, &log_record)) {
+  lsn_t redo_lsn = LoadCheckpoint();
+  // without a checkpoint, segments before the last truncation may have been recycled
+  int offset = redo_lsn == INVALID_LSN ? disk_manager_->GetLogStartOffset() : disk_manager_->GetLogOffset(redo_lsn);
+  prefetch_offset_ = offset;
+  prefetch_trigger_ = offset;
+  for (; ReadLogRecord(offset, &log_record); offset += log_record.GetSize()) {
+    // the segment may start before the redo lsn; transactions that were running there are in the checkpoint
+    if (log_record.lsn_ < redo_lsn) {
+      continue;
+    }
+    if (offset >= prefetch_trigger_) {
+      PrefetchAhead(redo_lsn);
+    }
+    page_id_t page_ids[2];
+    GetPageIds(&log_record, page_ids);
+    if (log_record.txn_id_ != INVALID_TXN_ID) {
       active_txn_[log_record.txn_id_] = log_record.lsn_;
-      lsn_mapping_[log_record.lsn_] = out_offset + inter_offset;
-      switch (log_record.log_record_type_) {
-        case LogRecordType::INVALID:
-          break;
-        case LogRecordType::INSERT:
-        {
-          RID rid = log_record.insert_rid_;
-          Page *page = buffer_pool_manager_->FetchPage(rid.GetPageId());
-          auto *table_page = reinterpret_cast<TablePage *>(page->GetData());
-          bool need_redo = table_page ->GetLSN() < log_record.lsn_;
-          if (need_redo) {
-            table_page->InsertTuple(log_record.insert_tuple_, &rid, nullptr, nullptr, nullptr);
-            table_page->SetLSN(log_record.lsn_);
-          }
-          buffer_pool_manager_->UnpinPage(page->GetPageId(), need_redo);
-        }
-          break;
-        case LogRecordType::MARKDELETE:
-        case LogRecordType::APPLYDELETE:
-        case LogRecordType::ROLLBACKDELETE:
-        {
-          RID rid = log_record.delete_rid_;
-          Page *page = buffer_pool_manager_->FetchPage(rid.GetPageId());
-          auto *table_page = reinterpret_cast<TablePage *>(page->GetData());
-          bool need_redo = table_page ->GetLSN() < log_record.lsn_;
-          if (need_redo) {
-            if(log_record.log_record_type_ == LogRecordType::MARKDELETE) {
-              table_page->MarkDelete(rid, nullptr, nullptr, nullptr);
-            }else if (log_record.log_record_type_ == LogRecordType::APPLYDELETE) {
-              table_page->ApplyDelete(rid, nullptr, nullptr);
-            }else if(log_record.log_record_type_ == LogRecordType::ROLLBACKDELETE) {
-              table_page->RollbackDelete(rid, nullptr, nullptr);
-            }
-            table_page->SetLSN(log_record.lsn_);
-          }
-          buffer_pool_manager_->UnpinPage(page->GetPageId(), need_redo);
-        }
-          break;
-        case LogRecordType::UPDATE:
-        {
-          RID rid = log_record.update_rid_;
-          Page *page = buffer_pool_manager_->FetchPage(rid.GetPageId());
-          auto *table_page = reinterpret_cast<TablePage *>(page->GetData());
-          bool need_redo = table_page ->GetLSN() < log_record.lsn_;
-          if (need_redo) {
-            table_page->UpdateTuple(log_record.new_tuple_, &log_record.old_tuple_, rid, nullptr, nullptr, nullptr);
-            table_page->SetLSN(log_record.lsn_);
-          }
-          buffer_pool_manager_->UnpinPage(page->GetPageId(), need_redo);
-        }
-          break;
-        case LogRecordType::BEGIN:
-          break;
-        case LogRecordType::COMMIT:
-        case LogRecordType::ABORT:
-          active_txn_.erase(log_record.txn_id_);
-          break;
-        case LogRecordType::NEWPAGE: {
-          Page *page = buffer_pool_manager_->FetchPage(log_record.page_id_);
-          auto *table_page = reinterpret_cast<TablePage *>(page->GetData());
-          bool need_redo1 = table_page->GetLSN() < log_record.lsn_;
-          if (need_redo1) {
-            table_page->Init(log_record.page_id_, PAGE_SIZE, log_record.prev_page_id_, nullptr, nullptr);
-            table_page->SetLSN(log_record.lsn_);
-            if(log_record.prev_page_id_ != INVALID_PAGE_ID) {
-              Page *prev_page = buffer_pool_manager_->FetchPage(log_record.prev_page_id_);
-              auto *pre_table_page = reinterpret_cast<TablePage *>(prev_page->GetData());
-              bool need_redo2 = pre_table_page->GetNextPageId() < log_record.lsn_;
-              if(need_redo2) {
-                pre_table_page->SetNextPageId(log_record.page_id_);
-                pre_table_page->SetLSN(log_record.lsn_);
-              }
-              buffer_pool_manager_->UnpinPage(log_record.prev_page_id_, need_redo2);
-            }
-          }
-          buffer_pool_manager_->UnpinPage(log_record.page_id_, need_redo1);
-        }
-          break;
+      txn_records_[log_record.txn_id_].emplace_back(log_record.lsn_, page_ids[0]);
+      lsn_mapping_[log_record.lsn_] = offset;
+    }
+    if (log_record.log_record_type_ == LogRecordType::COMMIT || log_record.log_record_type_ == LogRecordType::ABORT) {
+      active_txn_.erase(log_record.txn_id_);
+      for (const auto &record : txn_records_[log_record.txn_id_]) {
+        lsn_mapping_.erase(record.first);
+      }
+      txn_records_.erase(log_record.txn_id_);
+    }
+    for (page_id_t page_id : page_ids) {
+      if (page_id == INVALID_PAGE_ID || !NeedsRedo(page_id, log_record.lsn_)) {
+        continue;
+      }
+      if (workers.empty()) {
+        RedoPage(&log_record, page_id);
+        continue;
+      }
+      RedoWorker *worker = workers[page_id % workers.size()].get();
+      worker->batch_.emplace_back(page_id, log_record);
+      if (worker->batch_.size() >= REDO_BATCH_SIZE) {
+        Dispatch(worker);
       }
-      inter_offset += log_record.GetSize();
     }
-    out_offset += inter_offset;
   }
 
+  for (auto &worker : workers) {
+    Dispatch(worker.get());
+    {
+      std::lock_guard<std::mutex> guard(worker->latch_);
+      worker->done_ = true;
+    }
+    worker->cv_.notify_all();
+  }
+  for (auto &worker : workers) {
+    worker->thread_.join();
+  }
 }
 
 /*
@@ -178,25 +428,36 @@ void LogRecovery::Undo() {
   for(const auto &txn : active_txn_) {
     undo_set.insert(txn.second);
   }
-  int buffer_off = lsn_mapping_[*undo_set.begin()];
-  disk_manager_->ReadLog(log_buffer_, LOG_BUFFER_SIZE, buffer_off);
+  // the pages the losers changed since redo started, in the order undo gets to them
+  std::vector<std::pair<lsn_t, page_id_t>> records;
+  for (const auto &txn : txn_records_) {
+    records.insert(records.end(), txn.second.begin(), txn.second.end());
+  }
+  std::sort(records.begin(), records.end(), std::greater<>());
+  std::vector<page_id_t> undo_page_ids;
+  std::unordered_set<page_id_t> seen;
+  for (const auto &record : records) {
+    if (record.second != INVALID_PAGE_ID && seen.insert(record.second).second) {
+      undo_page_ids.push_back(record.second);
+    }
+  }
+  size_t window = PrefetchWindow();
+  size_t prefetched = 0;
+  size_t undone = 0;
   while (!undo_set.empty()) {
+    // keep a window of pages loading ahead of undo
+    if (undone++ % window == 0 && prefetched < undo_page_ids.size()) {
+      size_t end = std::min(prefetched + window, undo_page_ids.size());
+      buffer_pool_manager_->PrefetchPages(
+          std::vector<page_id_t>(undo_page_ids.begin() + prefetched, undo_page_ids.begin() + end));
+      prefetched = end;
+    }
     lsn_t lsn = *undo_set.begin();
     undo_set.erase(lsn);
-    int log_offset = lsn_mapping_[lsn];
-    int inter_buff_off;
-    if(log_offset + LogRecord::HEADER_SIZE >= buffer_off + LOG_BUFFER_SIZE || log_offset < buffer_off) {
-      disk_manager_->ReadLog(log_buffer_, LOG_BUFFER_SIZE, log_offset);
-      buffer_off = log_offset;
-      inter_buff_off = 0;
-    } else {
-      inter_buff_off = log_offset - buffer_off;
-    }
+    int log_offset = FindLogOffset(lsn);
     LogRecord log_record;
-    while ( !DeserializeLogRecord(log_buffer_ + inter_buff_off, &log_record)) {
-      disk_manager_->ReadLog(log_buffer_, LOG_BUFFER_SIZE, log_offset);
-      buffer_off = log_offset;
-      inter_buff_off = 0;
+    if (log_offset < 0 || !ReadLogRecord(log_offset, &log_record)) {
+      continue;
     }
     switch (log_record.GetLogRecordType()) {
       case LogRecordType::INVALID:
@@ -220,9 +481,9 @@ void LogRecovery::Undo() {
         if( log_record.log_record_type_ == LogRecordType::MARKDELETE) {
           table_page->RollbackDelete(rid, nullptr, nullptr);
         } else if (log_record.log_record_type_ == LogRecordType::APPLYDELETE) {
-          table_page->InsertTuple(log_record.delete_tuple_, &rid, nullptr, nullptr, nullptr);
+          table_page->InsertTuple(log_record.delete_tuple_, &rid, nullptr, nullptr);
         } else if (log_record.log_record_type_ == LogRecordType::ROLLBACKDELETE) {
-          table_page->MarkDelete(rid, nullptr, nullptr, nullptr);
+          table_page->MarkDelete(rid, nullptr, nullptr);
         }
         buffer_pool_manager_->UnpinPage(rid.GetPageId(), true);
       }
@@ -232,7 +493,12 @@ void LogRecovery::Undo() {
         RID rid = log_record.update_rid_;
         Page *page = buffer_pool_manager_->FetchPage(rid.GetPageId());
         auto *table_page = reinterpret_cast<TablePage *>(page->GetData());
-        table_page->UpdateTuple(log_record.old_tuple_, &log_record.new_tuple_, rid, nullptr, nullptr, nullptr);
+        // undo writes no CLRs, so after a crash during undo the update may be reverted already, and is skipped
+        Tuple new_tuple;
+        Tuple old_tuple;
+        if (table_page->GetTuple(rid, &new_tuple, nullptr) && log_record.update_delta_.Revert(new_tuple, &old_tuple)) {
+          table_page->UpdateTuple(old_tuple, &new_tuple, rid, nullptr, nullptr);
+        }
         buffer_pool_manager_->UnpinPage(rid.GetPageId(), true);
       }
         break;
@@ -243,6 +509,8 @@ void LogRecovery::Undo() {
       case LogRecordType::ABORT:
         break;
       case LogRecordType::NEWPAGE:
+      case LogRecordType::BEGIN_CHECKPOINT:
+      case LogRecordType::END_CHECKPOINT:
         break;
     }
     if (log_record.prev_lsn_ != INVALID_LSN) {
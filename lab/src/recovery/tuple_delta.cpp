@@ -0,0 +1,146 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// tuple_delta.cpp
+//
+// Identification: src/recovery/tuple_delta.cpp
+//
+// Copyright (c) 2015-2019, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include "recovery/tuple_delta.h"
+
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+
+namespace bustub {
+
+TupleDelta::TupleDelta(const Tuple &old_tuple, const Tuple &new_tuple)
+    : old_size_(old_tuple.GetLength()), new_size_(new_tuple.GetLength()) {
+  const char *old_data = old_tuple.GetData();
+  const char *new_data = new_tuple.GetData();
+  if (old_size_ == new_size_) {
+    uint32_t pos = 0;
+    while (pos < old_size_) {
+      if (old_data[pos] == new_data[pos]) {
+        pos++;
+        continue;
+      }
+      // extend the range over short runs of unchanged bytes, which cost less than another range
+      uint32_t end = pos + 1;
+      uint32_t last_change = pos;
+      while (end < old_size_ && end - last_change <= DELTA_MERGE_GAP) {
+        if (old_data[end] != new_data[end]) {
+          last_change = end;
+        }
+        end++;
+      }
+      end = last_change + 1;
+      ranges_.push_back(Range{pos, std::string(old_data + pos, end - pos), std::string(new_data + pos, end - pos)});
+      pos = end;
+    }
+    return;
+  }
+  uint32_t min_size = std::min(old_size_, new_size_);
+  uint32_t prefix = 0;
+  while (prefix < min_size && old_data[prefix] == new_data[prefix]) {
+    prefix++;
+  }
+  uint32_t suffix = 0;
+  while (suffix < min_size - prefix && old_data[old_size_ - suffix - 1] == new_data[new_size_ - suffix - 1]) {
+    suffix++;
+  }
+  ranges_.push_back(Range{prefix, std::string(old_data + prefix, old_size_ - suffix - prefix),
+                          std::string(new_data + prefix, new_size_ - suffix - prefix)});
+}
+
+uint32_t TupleDelta::GetSerializedSize() const {
+  uint32_t size = 3 * sizeof(uint32_t);
+  for (const auto &range : ranges_) {
+    size += 3 * sizeof(uint32_t) + range.old_data_.size() + range.new_data_.size();
+  }
+  return size;
+}
+
+void TupleDelta::SerializeTo(char *storage) const {
+  auto range_count = static_cast<uint32_t>(ranges_.size());
+  memcpy(storage, &old_size_, sizeof(uint32_t));
+  memcpy(storage + sizeof(uint32_t), &new_size_, sizeof(uint32_t));
+  memcpy(storage + 2 * sizeof(uint32_t), &range_count, sizeof(uint32_t));
+  storage += 3 * sizeof(uint32_t);
+  for (const auto &range : ranges_) {
+    auto old_length = static_cast<uint32_t>(range.old_data_.size());
+    auto new_length = static_cast<uint32_t>(range.new_data_.size());
+    memcpy(storage, &range.offset_, sizeof(uint32_t));
+    memcpy(storage + sizeof(uint32_t), &old_length, sizeof(uint32_t));
+    memcpy(storage + 2 * sizeof(uint32_t), &new_length, sizeof(uint32_t));
+    storage += 3 * sizeof(uint32_t);
+    memcpy(storage, range.old_data_.data(), old_length);
+    storage += old_length;
+    memcpy(storage, range.new_data_.data(), new_length);
+    storage += new_length;
+  }
+}
+
+void TupleDelta::DeserializeFrom(const char *storage) {
+  uint32_t range_count;
+  memcpy(&old_size_, storage, sizeof(uint32_t));
+  memcpy(&new_size_, storage + sizeof(uint32_t), sizeof(uint32_t));
+  memcpy(&range_count, storage + 2 * sizeof(uint32_t), sizeof(uint32_t));
+  storage += 3 * sizeof(uint32_t);
+  ranges_.clear();
+  for (uint32_t i = 0; i < range_count; i++) {
+    uint32_t offset;
+    uint32_t old_length;
+    uint32_t new_length;
+    memcpy(&offset, storage, sizeof(uint32_t));
+    memcpy(&old_length, storage + sizeof(uint32_t), sizeof(uint32_t));
+    memcpy(&new_length, storage + 2 * sizeof(uint32_t), sizeof(uint32_t));
+    storage += 3 * sizeof(uint32_t);
+    ranges_.push_back(Range{offset, std::string(storage, old_length), std::string(storage + old_length, new_length)});
+    storage += old_length + new_length;
+  }
+}
+
+bool TupleDelta::Apply(const Tuple &old_tuple, Tuple *new_tuple) const { return Splice(old_tuple, true, new_tuple); }
+
+bool TupleDelta::Revert(const Tuple &new_tuple, Tuple *old_tuple) const { return Splice(new_tuple, false, old_tuple); }
+
+bool TupleDelta::Splice(const Tuple &tuple, bool forward, Tuple *result) const {
+  // a tuple that does not hold the bytes the ranges replace is another version, e.g. one the delta was spliced into
+  if (tuple.GetLength() != (forward ? old_size_ : new_size_)) {
+    return false;
+  }
+  for (const auto &range : ranges_) {
+    const std::string &from = forward ? range.old_data_ : range.new_data_;
+    if (memcmp(tuple.GetData() + range.offset_, from.data(), from.size()) != 0) {
+      return false;
+    }
+  }
+  uint32_t size = forward ? new_size_ : old_size_;
+  // a serialized tuple, which is its size followed by its data
+  std::vector<char> storage(sizeof(uint32_t) + size);
+  memcpy(storage.data(), &size, sizeof(uint32_t));
+  char *dest = storage.data() + sizeof(uint32_t);
+  const char *src = tuple.GetData();
+  // only the last range may change the size, so the unchanged bytes before a range are at the same offset in both
+  uint32_t src_pos = 0;
+  uint32_t dest_pos = 0;
+  for (const auto &range : ranges_) {
+    const std::string &from = forward ? range.old_data_ : range.new_data_;
+    const std::string &to = forward ? range.new_data_ : range.old_data_;
+    memcpy(dest + dest_pos, src + src_pos, range.offset_ - dest_pos);
+    memcpy(dest + range.offset_, to.data(), to.size());
+    src_pos = range.offset_ + from.size();
+    dest_pos = range.offset_ + to.size();
+  }
+  memcpy(dest + dest_pos, src + src_pos, size - dest_pos);
+  result->DeserializeFrom(storage.data());
+  return true;
+}
+
+}  // namespace bustub
@@ -0,0 +1,420 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// async_disk_manager.cpp
+//
+// Identification: src/storage/disk/async_disk_manager.cpp
+//
+// Copyright (c) 2015-2019, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include "storage/disk/async_disk_manager.h"
+
+#include <fcntl.h>
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cassert>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <string>
+#include <thread>  // NOLINT
+#include <vector>
+
+#include "common/logger.h"
+
+namespace bustub {
+
+/** user_data of the no-op that tells the reaper thread to stop. Request ids start at 1. */
+static constexpr uint64_t SHUTDOWN_REQUEST = 0;
+
+/**
+ * A minimal io_uring, set up and driven with the raw system calls. Submissions must be serialized by the caller, and
+ * only one thread may reap completions. There is no kernel polling thread, so the kernel only takes entries from the
+ * submission queue while a submitter is inside io_uring_enter.
+ */
+class IoUring {
+ public:
+  /**
+   * Set up an io_uring. Check IsValid before using it.
+   * @param entries the number of submission queue entries
+   */
+  explicit IoUring(unsigned entries) {
+    io_uring_params params;
+    memset(&params, 0, sizeof(params));
+    ring_fd_ = static_cast<int>(syscall(__NR_io_uring_setup, entries, &params));
+    if (ring_fd_ < 0) {
+      return;
+    }
+    sq_ring_size_ = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    cq_ring_size_ = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+    if ((params.features & IORING_FEAT_SINGLE_MMAP) != 0) {
+      sq_ring_size_ = cq_ring_size_ = std::max(sq_ring_size_, cq_ring_size_);
+    }
+    sq_ring_ = mmap(nullptr, sq_ring_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd_,
+                    IORING_OFF_SQ_RING);
+    if ((params.features & IORING_FEAT_SINGLE_MMAP) != 0) {
+      cq_ring_ = sq_ring_;
+    } else {
+      cq_ring_ = mmap(nullptr, cq_ring_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd_,
+                      IORING_OFF_CQ_RING);
+    }
+    sqes_size_ = params.sq_entries * sizeof(io_uring_sqe);
+    sqes_ = static_cast<io_uring_sqe *>(
+        mmap(nullptr, sqes_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd_, IORING_OFF_SQES));
+    if (sq_ring_ == MAP_FAILED || cq_ring_ == MAP_FAILED || sqes_ == MAP_FAILED) {
+      Release();
+      return;
+    }
+
+    auto *sq = static_cast<char *>(sq_ring_);
+    sq_head_ = reinterpret_cast<unsigned *>(sq + params.sq_off.head);
+    sq_tail_ = reinterpret_cast<unsigned *>(sq + params.sq_off.tail);
+    sq_mask_ = *reinterpret_cast<unsigned *>(sq + params.sq_off.ring_mask);
+    sq_array_ = reinterpret_cast<unsigned *>(sq + params.sq_off.array);
+    auto *cq = static_cast<char *>(cq_ring_);
+    cq_head_ = reinterpret_cast<unsigned *>(cq + params.cq_off.head);
+    cq_tail_ = reinterpret_cast<unsigned *>(cq + params.cq_off.tail);
+    cq_mask_ = *reinterpret_cast<unsigned *>(cq + params.cq_off.ring_mask);
+    cqes_ = reinterpret_cast<io_uring_cqe *>(cq + params.cq_off.cqes);
+  }
+
+  ~IoUring() { Release(); }
+
+  DISALLOW_COPY_AND_MOVE(IoUring);
+
+  /** @return true if the io_uring was set up */
+  bool IsValid() const { return ring_fd_ >= 0; }
+
+  /**
+   * Queue an operation and submit it to the kernel. Waits while the kernel is out of resources or the completion
+   * queue is full, so the caller must not keep the reaper from running.
+   * @return false if the kernel rejected the operation, which is then off the queue and will never complete
+   */
+  bool Submit(uint8_t opcode, int fd, off_t offset, void *buffer, size_t size, uint64_t user_data) {
+    unsigned tail = *sq_tail_;
+    unsigned index = tail & sq_mask_;
+    io_uring_sqe *sqe = &sqes_[index];
+    memset(sqe, 0, sizeof(*sqe));
+    sqe->opcode = opcode;
+    sqe->fd = fd;
+    sqe->off = offset;
+    sqe->addr = reinterpret_cast<uint64_t>(buffer);
+    sqe->len = static_cast<uint32_t>(size);
+    sqe->user_data = user_data;
+    sq_array_[index] = index;
+    __atomic_store_n(sq_tail_, tail + 1, __ATOMIC_RELEASE);
+    // The kernel consumes the entry during the call, so the submission queue never fills up.
+    while (true) {
+      long rc = syscall(__NR_io_uring_enter, ring_fd_, 1, 0, 0, nullptr, 0);  // NOLINT
+      if (rc == 1 || __atomic_load_n(sq_head_, __ATOMIC_ACQUIRE) != tail) {
+        return true;
+      }
+      if (rc < 0 && (errno == EAGAIN || errno == EBUSY)) {
+        // Out of resources, or too many completions that were not reaped yet. The reaper makes room.
+        std::this_thread::yield();
+      } else if (rc < 0 && errno != EINTR) {
+        // Take the entry back, so that a later call does not submit it with a buffer that is gone by then.
+        __atomic_store_n(sq_tail_, tail, __ATOMIC_RELEASE);
+        return false;
+      }
+    }
+  }
+
+  /**
+   * Wait for at least one completion, and hand every available completion to the callback.
+   * @param callback called with the user data and the result of each completed operation
+   */
+  void Reap(const std::function<void(uint64_t, int32_t)> &callback) {
+    unsigned head = *cq_head_;
+    if (head == __atomic_load_n(cq_tail_, __ATOMIC_ACQUIRE)) {
+      syscall(__NR_io_uring_enter, ring_fd_, 0, 1, IORING_ENTER_GETEVENTS, nullptr, 0);
+    }
+    while (head != __atomic_load_n(cq_tail_, __ATOMIC_ACQUIRE)) {
+      io_uring_cqe *cqe = &cqes_[head & cq_mask_];
+      callback(cqe->user_data, cqe->res);
+      head++;
+      __atomic_store_n(cq_head_, head, __ATOMIC_RELEASE);
+    }
+  }
+
+ private:
+  void Release() {
+    if (sqes_ != nullptr && sqes_ != MAP_FAILED) {
+      munmap(sqes_, sqes_size_);
+    }
+    if (cq_ring_ != nullptr && cq_ring_ != MAP_FAILED && cq_ring_ != sq_ring_) {
+      munmap(cq_ring_, cq_ring_size_);
+    }
+    if (sq_ring_ != nullptr && sq_ring_ != MAP_FAILED) {
+      munmap(sq_ring_, sq_ring_size_);
+    }
+    sqes_ = nullptr;
+    cq_ring_ = sq_ring_ = nullptr;
+    if (ring_fd_ >= 0) {
+      close(ring_fd_);
+      ring_fd_ = -1;
+    }
+  }
+
+  int ring_fd_{-1};
+  void *sq_ring_{nullptr};
+  void *cq_ring_{nullptr};
+  size_t sq_ring_size_{0};
+  size_t cq_ring_size_{0};
+  io_uring_sqe *sqes_{nullptr};
+  size_t sqes_size_{0};
+  unsigned *sq_head_{nullptr};
+  unsigned *sq_tail_{nullptr};
+  unsigned sq_mask_{0};
+  unsigned *sq_array_{nullptr};
+  unsigned *cq_head_{nullptr};
+  unsigned *cq_tail_{nullptr};
+  unsigned cq_mask_{0};
+  io_uring_cqe *cqes_{nullptr};
+};
+
+AsyncDiskManager::AsyncDiskManager(const std::string &db_file, bool use_io_uring) : DiskManager(db_file) {
+  // Switch to a descriptor that bypasses the page cache, unless the file system does not support O_DIRECT.
+  int direct_fd = open(file_name_.c_str(), O_RDWR | O_DIRECT);
+  if (direct_fd >= 0) {
+    close(db_fd_);
+    db_fd_ = direct_fd;
+    direct_io_ = true;
+  }
+  if (use_io_uring) {
+    ring_ = new IoUring(ASYNC_DISK_QUEUE_DEPTH);
+    if (ring_->IsValid()) {
+      reaper_thread_ = new std::thread(&AsyncDiskManager::ReapLoop, this);
+    } else {
+      LOG_INFO("io_uring is not available, falling back to pread/pwrite");
+      delete ring_;
+      ring_ = nullptr;
+    }
+  }
+  if (ring_ == nullptr) {
+    fallback_running_ = true;
+    for (size_t i = 0; i < ASYNC_DISK_FALLBACK_THREADS; i++) {
+      fallback_threads_.emplace_back(&AsyncDiskManager::FallbackLoop, this);
+    }
+  }
+}
+
+AsyncDiskManager::~AsyncDiskManager() { ShutDown(); }
+
+void AsyncDiskManager::ShutDown() {
+  if (shut_down_) {
+    return;
+  }
+  shut_down_ = true;
+  WaitAll();
+  if (ring_ != nullptr) {
+    {
+      std::lock_guard<std::mutex> guard(submit_latch_);
+      ring_->Submit(IORING_OP_NOP, -1, 0, nullptr, 0, SHUTDOWN_REQUEST);
+    }
+    reaper_thread_->join();
+    delete reaper_thread_;
+    reaper_thread_ = nullptr;
+    delete ring_;
+    ring_ = nullptr;
+  } else {
+    {
+      std::lock_guard<std::mutex> guard(latch_);
+      fallback_running_ = false;
+    }
+    cv_.notify_all();
+    for (auto &thread : fallback_threads_) {
+      thread.join();
+    }
+    fallback_threads_.clear();
+  }
+  DiskManager::ShutDown();
+}
+
+void AsyncDiskManager::WritePage(page_id_t page_id, const char *page_data) {
+  if (!Wait(SubmitWritePage(page_id, page_data))) {
+    LOG_DEBUG("I/O error while writing");
+  }
+}
+
+void AsyncDiskManager::ReadPage(page_id_t page_id, char *page_data) {
+  if (!Wait(SubmitReadPage(page_id, page_data))) {
+    LOG_DEBUG("I/O error while reading");
+  }
+}
+
+void AsyncDiskManager::WriteLog(char *log_data, int size) {
+  if (size == 0) {  // no effect on num_flushes_ if log buffer is empty
+    return;
+  }
+  flush_log_ = true;
+  if (flush_log_f_ != nullptr) {
+    // used for checking non-blocking flushing
+    assert(flush_log_f_->wait_for(std::chrono::seconds(10)) == std::future_status::ready);
+  }
+  num_flushes_ += 1;
+  // A write that crosses into a new segment goes out as two I/Os, which are in flight together.
+  std::vector<LogRange> ranges = ReserveLog(log_data, size);
+  std::vector<request_id_t> writes;
+  for (const auto &range : ranges) {
+    writes.push_back(
+        Submit(IoType::WRITE_LOG, range.fd_, range.file_offset_, range.size_, log_data + range.data_offset_, nullptr));
+  }
+  for (request_id_t write : writes) {
+    if (!Wait(write)) {
+      LOG_DEBUG("I/O error while writing log");
+    }
+  }
+  for (const auto &range : ranges) {
+    if (fdatasync(range.fd_) != 0) {
+      LOG_DEBUG("I/O error while syncing log");
+    }
+  }
+  flush_log_ = false;
+}
+
+AsyncDiskManager::request_id_t AsyncDiskManager::SubmitReadPage(page_id_t page_id, char *page_data) {
+  return Submit(IoType::READ_PAGE, db_fd_, static_cast<off_t>(page_id) * PAGE_SIZE, PAGE_SIZE, nullptr, page_data);
+}
+
+AsyncDiskManager::request_id_t AsyncDiskManager::SubmitWritePage(page_id_t page_id, const char *page_data) {
+  return Submit(IoType::WRITE_PAGE, db_fd_, static_cast<off_t>(page_id) * PAGE_SIZE, PAGE_SIZE, page_data, nullptr);
+}
+
+AsyncDiskManager::request_id_t AsyncDiskManager::SubmitWriteLog(const char *log_data, int size) {
+  // The offsets are assigned in submission order. The rare append that crosses into a new segment finishes its first
+  // part here, so that the caller has a single I/O to wait for.
+  std::vector<LogRange> ranges = ReserveLog(log_data, size);
+  for (size_t i = 0; i + 1 < ranges.size(); i++) {
+    const auto &range = ranges[i];
+    if (!Wait(Submit(IoType::WRITE_LOG, range.fd_, range.file_offset_, range.size_, log_data + range.data_offset_,
+                     nullptr))) {
+      LOG_DEBUG("I/O error while writing log");
+    }
+  }
+  const auto &range = ranges.back();
+  return Submit(IoType::WRITE_LOG, range.fd_, range.file_offset_, range.size_, log_data + range.data_offset_, nullptr);
+}
+
+AsyncDiskManager::request_id_t AsyncDiskManager::Submit(IoType type, int fd, off_t offset, size_t size,
+                                                        const char *data, char *page_data) {
+  size_t buffer_size = (size + DIRECT_IO_ALIGNMENT - 1) / DIRECT_IO_ALIGNMENT * DIRECT_IO_ALIGNMENT;
+  auto *buffer = static_cast<char *>(std::aligned_alloc(DIRECT_IO_ALIGNMENT, buffer_size));
+  if (data != nullptr) {
+    memcpy(buffer, data, size);
+  }
+
+  std::unique_lock<std::mutex> lock(latch_);
+  cv_.wait(lock, [&] { return in_flight_ < ASYNC_DISK_QUEUE_DEPTH; });
+  if (type == IoType::WRITE_PAGE) {
+    num_writes_ += 1;
+  }
+  request_id_t request_id = next_request_id_++;
+  requests_.emplace(request_id, IoRequest{type, fd, offset, buffer, size, page_data});
+  in_flight_++;
+
+  if (ring_ == nullptr) {
+    fallback_queue_.push_back(request_id);
+    lock.unlock();
+    cv_.notify_all();
+    return request_id;
+  }
+  lock.unlock();
+  // The completion may be reaped before Submit returns, which is fine since the request is registered already.
+  uint8_t opcode = type == IoType::READ_PAGE ? IORING_OP_READ : IORING_OP_WRITE;
+  bool submitted;
+  {
+    std::lock_guard<std::mutex> guard(submit_latch_);
+    submitted = ring_->Submit(opcode, fd, offset, buffer, size, request_id);
+  }
+  if (!submitted) {
+    Complete(request_id, -EIO);
+  }
+  return request_id;
+}
+
+void AsyncDiskManager::Complete(request_id_t request_id, ssize_t result) {
+  {
+    std::lock_guard<std::mutex> guard(latch_);
+    IoRequest &request = requests_.at(request_id);
+    if (request.type_ == IoType::READ_PAGE) {
+      // Pages past the end of the file read as zeros.
+      request.ok_ = result >= 0;
+      size_t read_count = request.ok_ ? result : 0;
+      memcpy(request.page_data_, request.buffer_, read_count);
+      memset(request.page_data_ + read_count, 0, request.size_ - read_count);
+    } else {
+      request.ok_ = result == static_cast<ssize_t>(request.size_);
+    }
+    request.done_ = true;
+    in_flight_--;
+  }
+  cv_.notify_all();
+}
+
+bool AsyncDiskManager::Wait(request_id_t request_id) {
+  std::unique_lock<std::mutex> lock(latch_);
+  BUSTUB_ASSERT(requests_.count(request_id) == 1, "Every I/O is waited for exactly once.");
+  cv_.wait(lock, [&] { return requests_.at(request_id).done_; });
+  IoRequest &request = requests_.at(request_id);
+  bool ok = request.ok_;
+  free(request.buffer_);
+  requests_.erase(request_id);
+  return ok;
+}
+
+bool AsyncDiskManager::WaitAll() {
+  std::vector<request_id_t> request_ids;
+  {
+    std::lock_guard<std::mutex> guard(latch_);
+    for (const auto &request : requests_) {
+      request_ids.push_back(request.first);
+    }
+  }
+  bool ok = true;
+  for (request_id_t request_id : request_ids) {
+    ok = Wait(request_id) && ok;
+  }
+  return ok;
+}
+
+void AsyncDiskManager::ReapLoop() {
+  bool running = true;
+  while (running) {
+    ring_->Reap([&](uint64_t user_data, int32_t result) {
+      if (user_data == SHUTDOWN_REQUEST) {
+        running = false;
+      } else {
+        Complete(user_data, result);
+      }
+    });
+  }
+}
+
+void AsyncDiskManager::FallbackLoop() {
+  std::unique_lock<std::mutex> lock(latch_);
+  while (true) {
+    cv_.wait(lock, [&] { return !fallback_running_ || !fallback_queue_.empty(); });
+    if (fallback_queue_.empty()) {
+      break;
+    }
+    request_id_t request_id = fallback_queue_.front();
+    fallback_queue_.pop_front();
+    IoRequest request = requests_.at(request_id);
+    lock.unlock();
+    ssize_t result =
+        TransferAll(request.type_ != IoType::READ_PAGE, request.fd_, request.buffer_, request.size_, request.offset_);
+    Complete(request_id, result);
+    lock.lock();
+  }
+}
+
+}  // namespace bustub
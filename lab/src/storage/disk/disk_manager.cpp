@@ -10,10 +10,17 @@
 //
 //===----------------------------------------------------------------------===//
 
+#include <dirent.h>
+#include <fcntl.h>
 #include <sys/stat.h>
+#include <linux/falloc.h>
+#include <unistd.h>
+#include <algorithm>
 #include <cassert>
+#include <cerrno>
 #include <cstring>
 #include <iostream>
+#include <map>
 #include <string>
 #include <thread>  // NOLINT
 
@@ -25,46 +32,38 @@ namespace bustub {
 
 static char *buffer_used;
 
+static constexpr uint32_t LOG_SEGMENT_MAGIC = 0x4c425542;
+// every log record starts with its size and its LSN (see recovery/log_record.h), and is at least a header long
+static constexpr int32_t LOG_RECORD_HEADER_SIZE = 20;
+
 /**
  * Constructor: open/create a single database file & log file
  * @input db_file: database file name
  */
 DiskManager::DiskManager(const std::string &db_file)
-    : file_name_(db_file), next_page_id_(0), num_flushes_(0), num_writes_(0), flush_log_(false), flush_log_f_(nullptr) {
+    : file_name_(db_file), num_flushes_(0), num_writes_(0), flush_log_(false), flush_log_f_(nullptr), next_page_id_(0) {
   std::string::size_type n = file_name_.rfind('.');
   if (n == std::string::npos) {
     LOG_DEBUG("wrong file format");
     return;
   }
   log_name_ = file_name_.substr(0, n) + ".log";
+  fsm_name_ = file_name_.substr(0, n) + ".fsm";
 
-  log_io_.open(log_name_, std::ios::binary | std::ios::in | std::ios::app | std::ios::out);
-  // directory or file does not exist
-  if (!log_io_.is_open()) {
-    log_io_.clear();
+  db_fd_ = open(db_file.c_str(), O_RDWR);
+  // file does not exist
+  bool new_file = db_fd_ < 0 && errno == ENOENT;
+  if (new_file) {
     // create a new file
-    log_io_.open(log_name_, std::ios::binary | std::ios::trunc | std::ios::app | std::ios::out);
-    log_io_.close();
-    // reopen with original mode
-    log_io_.open(log_name_, std::ios::binary | std::ios::in | std::ios::app | std::ios::out);
-    if (!log_io_.is_open()) {
-      throw Exception("can't open dblog file");
-    }
+    db_fd_ = open(db_file.c_str(), O_RDWR | O_CREAT, 0644);
   }
-
-  db_io_.open(db_file, std::ios::binary | std::ios::in | std::ios::out);
-  // directory or file does not exist
-  if (!db_io_.is_open()) {
-    db_io_.clear();
-    // create a new file
-    db_io_.open(db_file, std::ios::binary | std::ios::trunc | std::ios::out);
-    db_io_.close();
-    // reopen with original mode
-    db_io_.open(db_file, std::ios::binary | std::ios::in | std::ios::out);
-    if (!db_io_.is_open()) {
-      throw Exception("can't open db file");
-    }
+  if (db_fd_ < 0) {
+    throw Exception("can't open db file");
   }
+  // pages past the end of the file were never written, so they can be handed out again
+  next_page_id_ = (GetFileSize(file_name_) + PAGE_SIZE - 1) / PAGE_SIZE;
+  LoadFreeSpaceMap(new_file);
+  LoadLogSegments(new_file);
   buffer_used = nullptr;
 }
 
@@ -72,59 +71,54 @@ DiskManager::DiskManager(const std::string &db_file)
  * Close all file streams
  */
 void DiskManager::ShutDown() {
-  db_io_.close();
-  log_io_.close();
+  if (db_fd_ >= 0) {
+    close(db_fd_);
+    db_fd_ = -1;
+  }
+  if (fsm_fd_ >= 0) {
+    close(fsm_fd_);
+    fsm_fd_ = -1;
+  }
+  std::lock_guard<std::mutex> guard(log_latch_);
+  for (auto &segment : log_segments_) {
+    close(segment.fd_);
+  }
+  log_segments_.clear();
 }
 
 /**
  * Write the contents of the specified page into disk file
  */
 void DiskManager::WritePage(page_id_t page_id, const char *page_data) {
-  size_t offset = static_cast<size_t>(page_id) * PAGE_SIZE;
-  // set write cursor to offset
+  off_t offset = static_cast<off_t>(page_id) * PAGE_SIZE;
   num_writes_ += 1;
-  db_io_.seekp(offset);
-  db_io_.write(page_data, PAGE_SIZE);
-  // check for I/O error
-  if (db_io_.bad()) {
+  // positional write, so concurrent page I/O does not share a file cursor
+  if (TransferAll(true, db_fd_, const_cast<char *>(page_data), PAGE_SIZE, offset) != PAGE_SIZE) {
     LOG_DEBUG("I/O error while writing");
-    return;
   }
-  // needs to flush to keep disk file in sync
-  db_io_.flush();
 }
 
 /**
  * Read the contents of the specified page into the given memory area
  */
 void DiskManager::ReadPage(page_id_t page_id, char *page_data) {
-  int offset = page_id * PAGE_SIZE;
-  // check if read beyond file length
-  if (offset > GetFileSize(file_name_)) {
-    LOG_DEBUG("I/O error reading past end of file");
-    // std::cerr << "I/O error while reading" << std::endl;
-  } else {
-    // set read cursor to offset
-    db_io_.seekp(offset);
-    db_io_.read(page_data, PAGE_SIZE);
-    if (db_io_.bad()) {
-      LOG_DEBUG("I/O error while reading");
-      return;
-    }
-    // if file ends before reading PAGE_SIZE
-    int read_count = db_io_.gcount();
-    if (read_count < PAGE_SIZE) {
-      LOG_DEBUG("Read less than a page");
-      db_io_.clear();
-      // std::cerr << "Read less than a page" << std::endl;
-      memset(page_data + read_count, 0, PAGE_SIZE - read_count);
-    }
+  off_t offset = static_cast<off_t>(page_id) * PAGE_SIZE;
+  // positional read, so concurrent page I/O does not share a file cursor
+  ssize_t read_count = TransferAll(false, db_fd_, page_data, PAGE_SIZE, offset);
+  if (read_count < 0) {
+    LOG_DEBUG("I/O error while reading");
+    return;
+  }
+  // if file ends before reading PAGE_SIZE
+  if (read_count < PAGE_SIZE) {
+    LOG_DEBUG("Read less than a page");
+    memset(page_data + read_count, 0, PAGE_SIZE - read_count);
   }
 }
 
 /**
  * Write the contents of the log into disk file
- * Only return when sync is done, and only perform sequence write
+ * Only return when sync is done (the data is on stable storage), and only perform sequence write
  */
 void DiskManager::WriteLog(char *log_data, int size) {
   // enforce swap log buffer
@@ -143,16 +137,22 @@ void DiskManager::WriteLog(char *log_data, int size) {
   }
 
   num_flushes_ += 1;
-  // sequence write
-  log_io_.write(log_data, size);
-
-  // check for I/O error
-  if (log_io_.bad()) {
-    LOG_DEBUG("I/O error while writing log");
-    return;
+  // sequence write, which spans two segments when it crosses into a new one
+  std::vector<LogRange> ranges = ReserveLog(log_data, size);
+  for (const auto &range : ranges) {
+    ssize_t write_count = TransferAll(true, range.fd_, log_data + range.data_offset_, range.size_, range.file_offset_);
+    // check for I/O error
+    if (write_count != static_cast<ssize_t>(range.size_)) {
+      LOG_DEBUG("I/O error while writing log");
+      return;
+    }
+  }
+  // one sync per write, which covers every commit in the buffer
+  for (const auto &range : ranges) {
+    if (fdatasync(range.fd_) != 0) {
+      LOG_DEBUG("I/O error while syncing log");
+    }
   }
-  // needs to flush to keep disk file in sync
-  log_io_.flush();
   flush_log_ = false;
 }
 
@@ -162,40 +162,432 @@ void DiskManager::WriteLog(char *log_data, int size) {
  * @return: false means already reach the end
  */
 bool DiskManager::ReadLog(char *log_data, int size, int offset) {
-  if (offset >= GetFileSize(log_name_)) {
-    // LOG_DEBUG("end of log file");
-    LOG_DEBUG("file size is %d", GetFileSize(log_name_));
+  std::lock_guard<std::mutex> guard(log_latch_);
+  // the end of the log is known, so there is no need to look at the file sizes
+  if (offset >= log_offset_ || log_segments_.empty() ||
+      offset < log_segments_.front().number_ * LOG_SEGMENT_DATA_SIZE) {
     return false;
   }
-  log_io_.seekp(offset);
-  log_io_.read(log_data, size);
-
-  if (log_io_.bad()) {
+  size_t read_count = std::min(static_cast<off_t>(size), log_offset_ - offset);
+  if (!ReadLogRange(log_data, read_count, offset)) {
     LOG_DEBUG("I/O error while reading log");
     return false;
   }
-  // if log file ends before reading "size"
-  int read_count = log_io_.gcount();
-  if (read_count < size) {
-    log_io_.clear();
+  // if log ends before reading "size"
+  if (read_count < static_cast<size_t>(size)) {
     memset(log_data + read_count, 0, size - read_count);
   }
 
   return true;
 }
 
+/**
+ * Returns the offset of the oldest record in the log
+ */
+int DiskManager::GetLogStartOffset() {
+  std::lock_guard<std::mutex> guard(log_latch_);
+  return log_segments_.empty() ? log_offset_ : log_segments_.front().first_record_offset_;
+}
+
+/**
+ * Returns where to start reading to see the records from lsn on
+ * A binary search over the segment headers, so the log itself is not read
+ */
+int DiskManager::GetLogOffset(lsn_t lsn) {
+  std::lock_guard<std::mutex> guard(log_latch_);
+  auto it = std::upper_bound(log_segments_.begin(), log_segments_.end(), lsn,
+                             [](lsn_t lsn, const LogSegment &segment) { return lsn < segment.first_lsn_; });
+  if (it == log_segments_.begin()) {
+    return log_segments_.empty() ? log_offset_ : it->first_record_offset_;
+  }
+  return std::prev(it)->first_record_offset_;
+}
+
+/**
+ * Returns the next lsn after the log that was found on startup
+ */
+lsn_t DiskManager::GetRecoveredNextLSN() {
+  std::lock_guard<std::mutex> guard(log_latch_);
+  return recovered_next_lsn_;
+}
+
+/**
+ * Recycle the segments that end before offset, but never the segment being written
+ */
+void DiskManager::TruncateLog(int offset) {
+  std::lock_guard<std::mutex> guard(log_latch_);
+  while (log_segments_.size() > 1 && (log_segments_.front().number_ + 1) * LOG_SEGMENT_DATA_SIZE <= offset) {
+    RecycleLogSegment(log_segments_.front());
+    log_segments_.pop_front();
+  }
+}
+
+/**
+ * Records the start of the last complete checkpoint in the header of the segment being written
+ */
+void DiskManager::SetCheckpointLSN(lsn_t lsn) {
+  std::lock_guard<std::mutex> guard(log_latch_);
+  checkpoint_lsn_ = lsn;
+  if (log_segments_.empty()) {
+    return;
+  }
+  const LogSegment &last = log_segments_.back();
+  LogSegmentHeader header{LOG_SEGMENT_MAGIC, last.first_lsn_, last.number_, last.first_record_offset_, lsn};
+  if (TransferAll(true, last.fd_, reinterpret_cast<char *>(&header), sizeof(header), 0) != sizeof(header) ||
+      fdatasync(last.fd_) != 0) {
+    LOG_DEBUG("I/O error while recording checkpoint");
+  }
+}
+
+/**
+ * Returns the start of the last complete checkpoint
+ */
+lsn_t DiskManager::GetCheckpointLSN() {
+  std::lock_guard<std::mutex> guard(log_latch_);
+  return checkpoint_lsn_;
+}
+
+/**
+ * Returns number of log segments in use
+ */
+size_t DiskManager::GetNumLogSegments() {
+  std::lock_guard<std::mutex> guard(log_latch_);
+  return log_segments_.size();
+}
+
 /**
  * Allocate new page (operations like create index/table)
- * For now just keep an increasing counter
+ * Reuse the lowest free page, or grow the file by one page
  */
-page_id_t DiskManager::AllocatePage() { return next_page_id_++; }
+page_id_t DiskManager::AllocatePage() {
+  std::lock_guard<std::mutex> guard(allocation_latch_);
+  if (free_pages_.empty()) {
+    return next_page_id_++;
+  }
+  page_id_t page_id = *free_pages_.begin();
+  SetPageFree(page_id, false);
+  return page_id;
+}
+
+/**
+ * Allocate a run of pages (reserving space for a table or index)
+ * Reuse the lowest run of free pages that is long enough, or grow the file by the whole run
+ */
+page_id_t DiskManager::AllocateExtent(size_t num_pages) {
+  std::unique_lock<std::mutex> latch(allocation_latch_);
+  page_id_t run_start = INVALID_PAGE_ID;
+  size_t run_length = 0;
+  for (page_id_t page_id : free_pages_) {
+    if (run_length > 0 && page_id == run_start + static_cast<page_id_t>(run_length)) {
+      run_length++;
+    } else {
+      run_start = page_id;
+      run_length = 1;
+    }
+    if (run_length == num_pages) {
+      for (page_id_t i = run_start; i < run_start + static_cast<page_id_t>(num_pages); i++) {
+        SetPageFree(i, false);
+      }
+      return run_start;
+    }
+  }
+  run_start = next_page_id_;
+  next_page_id_ += num_pages;
+  latch.unlock();
+  // best effort: give the run contiguous blocks without changing the file size, so that unused pages past the end
+  // of the file are still recovered by the next startup
+  fallocate(db_fd_, FALLOC_FL_KEEP_SIZE, static_cast<off_t>(run_start) * PAGE_SIZE,
+            static_cast<off_t>(num_pages) * PAGE_SIZE);
+  return run_start;
+}
 
 /**
  * Deallocate page (operations like drop index/table)
- * Need bitmap in header page for tracking pages
- * This does not actually need to do anything for now.
+ * Record the page in the free-space map and give its space back to the file system
+ */
+void DiskManager::DeallocatePage(page_id_t page_id) {
+  {
+    std::lock_guard<std::mutex> guard(allocation_latch_);
+    if (page_id < 0 || page_id >= next_page_id_ || free_pages_.count(page_id) == 1) {
+      LOG_DEBUG("deallocating a page that is not allocated");
+      return;
+    }
+    SetPageFree(page_id, true);
+  }
+  // best effort: the file keeps its size, and the page reads as zeros until it is reused
+  fallocate(db_fd_, FALLOC_FL_PUNCH_HOLE | FALLOC_FL_KEEP_SIZE, static_cast<off_t>(page_id) * PAGE_SIZE, PAGE_SIZE);
+}
+
+/**
+ * Returns number of free pages
+ */
+size_t DiskManager::GetNumFreePages() {
+  std::lock_guard<std::mutex> guard(allocation_latch_);
+  return free_pages_.size();
+}
+
+/**
+ * Private helper function to read the free-space map
+ */
+void DiskManager::LoadFreeSpaceMap(bool new_file) {
+  fsm_fd_ = open(fsm_name_.c_str(), O_RDWR | O_CREAT | (new_file ? O_TRUNC : 0), 0644);
+  if (fsm_fd_ < 0) {
+    throw Exception("can't open free-space map file");
+  }
+  free_map_.assign((next_page_id_ + 7) / 8, 0);
+  ssize_t read_count = TransferAll(false, fsm_fd_, reinterpret_cast<char *>(free_map_.data()), free_map_.size(), 0);
+  if (read_count < 0) {
+    LOG_DEBUG("I/O error while reading free-space map");
+    read_count = 0;
+  }
+  // a map written before a crash may be short or cover pages beyond the end of the file
+  std::fill(free_map_.begin() + read_count, free_map_.end(), 0);
+  for (page_id_t page_id = 0; page_id < next_page_id_; page_id++) {
+    if ((free_map_[page_id / 8] & (1 << (page_id % 8))) != 0) {
+      free_pages_.insert(page_id);
+    }
+  }
+  for (page_id_t page_id = next_page_id_; page_id < static_cast<page_id_t>(free_map_.size() * 8); page_id++) {
+    free_map_[page_id / 8] &= ~(1 << (page_id % 8));
+  }
+  if (ftruncate(fsm_fd_, 0) != 0 ||
+      TransferAll(true, fsm_fd_, reinterpret_cast<char *>(free_map_.data()), free_map_.size(), 0) !=
+          static_cast<ssize_t>(free_map_.size())) {
+    LOG_DEBUG("I/O error while writing free-space map");
+  }
+}
+
+/**
+ * Private helper function to update the free-space map
+ */
+void DiskManager::SetPageFree(page_id_t page_id, bool free) {
+  size_t byte = page_id / 8;
+  if (byte >= free_map_.size()) {
+    free_map_.resize(byte + 1, 0);
+  }
+  if (free) {
+    free_map_[byte] |= 1 << (page_id % 8);
+    free_pages_.insert(page_id);
+  } else {
+    free_map_[byte] &= ~(1 << (page_id % 8));
+    free_pages_.erase(page_id);
+  }
+  // only the byte that changed is written
+  if (TransferAll(true, fsm_fd_, reinterpret_cast<char *>(&free_map_[byte]), 1, byte) != 1) {
+    LOG_DEBUG("I/O error while writing free-space map");
+  }
+}
+
+/**
+ * Reserve the next log offsets for a write
+ * A write that reaches a new segment opens it, and records in its header the first record that starts in it
+ */
+std::vector<DiskManager::LogRange> DiskManager::ReserveLog(const char *log_data, size_t size) {
+  assert(size > 0);
+  std::lock_guard<std::mutex> guard(log_latch_);
+  off_t offset = log_offset_;
+  int64_t last_number = (offset + size - 1) / LOG_SEGMENT_DATA_SIZE;
+  for (int64_t number = offset / LOG_SEGMENT_DATA_SIZE; number <= last_number; number++) {
+    if (!log_segments_.empty() && log_segments_.back().number_ >= number) {
+      continue;
+    }
+    // walk the records of the write up to the start of the segment
+    off_t segment_start = number * LOG_SEGMENT_DATA_SIZE;
+    size_t pos = 0;
+    int32_t record[2];
+    lsn_t first_lsn = INVALID_LSN;
+    while (offset + static_cast<off_t>(pos) < segment_start && pos + sizeof(record) <= size) {
+      memcpy(record, log_data + pos, sizeof(record));
+      if (record[0] <= 0) {
+        break;
+      }
+      first_lsn = record[1] + 1;
+      pos += record[0];
+    }
+    if (pos + sizeof(record) <= size) {
+      memcpy(record, log_data + pos, sizeof(record));
+      first_lsn = record[1];
+    }
+    OpenLogSegment(number, first_lsn, offset + pos);
+  }
+  log_offset_ += size;
+  return MapLogRange(offset, size);
+}
+
+/**
+ * Private helper function to find the log segments on startup
+ */
+void DiskManager::LoadLogSegments(bool new_file) {
+  std::string::size_type slash = log_name_.rfind('/');
+  std::string dir_name = slash == std::string::npos ? "." : log_name_.substr(0, slash + 1);
+  std::string prefix = log_name_.substr(slash == std::string::npos ? 0 : slash + 1) + ".";
+  DIR *dir = opendir(dir_name.c_str());
+  if (dir == nullptr) {
+    throw Exception("can't open log directory");
+  }
+  std::map<int64_t, LogSegment> segments;
+  while (dirent *entry = readdir(dir)) {
+    std::string name = entry->d_name;
+    if (name.size() <= prefix.size() || name.compare(0, prefix.size(), prefix) != 0 ||
+        name.find_first_not_of("0123456789", prefix.size()) != std::string::npos) {
+      continue;
+    }
+    int64_t number = std::stoll(name.substr(prefix.size()));
+    std::string segment_name = GetLogSegmentName(number);
+    if (new_file) {
+      unlink(segment_name.c_str());
+      continue;
+    }
+    int fd = open(segment_name.c_str(), O_RDWR);
+    LogSegmentHeader header{};
+    if (fd >= 0 && TransferAll(false, fd, reinterpret_cast<char *>(&header), sizeof(header), 0) == sizeof(header) &&
+        header.magic_ == LOG_SEGMENT_MAGIC && header.number_ == number && header.first_lsn_ != INVALID_LSN) {
+      segments[number] = LogSegment{number, fd, header.first_lsn_, header.first_record_offset_};
+      continue;
+    }
+    if (fd >= 0) {
+      close(fd);
+    }
+    spare_log_segments_.push_back(segment_name);
+  }
+  closedir(dir);
+
+  // the log is the newest run of consecutive segments; anything older was left behind
+  for (auto it = segments.rbegin(); it != segments.rend(); ++it) {
+    if (log_segments_.empty() || it->first == log_segments_.front().number_ - 1) {
+      log_segments_.push_front(it->second);
+    } else {
+      RecycleLogSegment(it->second);
+    }
+  }
+  if (log_segments_.empty()) {
+    return;
+  }
+
+  // the last segment has the newest checkpoint
+  const LogSegment &last = log_segments_.back();
+  LogSegmentHeader header{};
+  if (TransferAll(false, last.fd_, reinterpret_cast<char *>(&header), sizeof(header), 0) == sizeof(header)) {
+    checkpoint_lsn_ = header.checkpoint_lsn_;
+  }
+
+  // follow the records of the last segment while their lsns are consecutive; what comes after them is zeros or
+  // older log that the segment held before it was recycled
+  off_t segment_end = (last.number_ + 1) * LOG_SEGMENT_DATA_SIZE;
+  off_t offset = last.first_record_offset_;
+  lsn_t lsn = last.first_lsn_;
+  int32_t record[2];
+  while (offset + LOG_RECORD_HEADER_SIZE <= segment_end &&
+         ReadLogRange(reinterpret_cast<char *>(record), sizeof(record), offset) &&
+         record[0] >= LOG_RECORD_HEADER_SIZE && offset + record[0] <= segment_end && record[1] == lsn) {
+    offset += record[0];
+    lsn++;
+  }
+  log_offset_ = offset;
+  recovered_next_lsn_ = lsn;
+}
+
+/**
+ * Private helper function to start a log segment
+ */
+void DiskManager::OpenLogSegment(int64_t number, lsn_t first_lsn, off_t first_record_offset) {
+  std::string segment_name = GetLogSegmentName(number);
+  int fd;
+  if (!spare_log_segments_.empty()) {
+    if (rename(spare_log_segments_.back().c_str(), segment_name.c_str()) != 0) {
+      LOG_DEBUG("can't reuse log segment");
+    }
+    spare_log_segments_.pop_back();
+    fd = open(segment_name.c_str(), O_RDWR);
+  } else {
+    // write the whole segment up front, so that appends never change the size or the block map of the file
+    fd = open(segment_name.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    std::vector<char> zeros(PAGE_SIZE * 16, 0);
+    for (off_t pos = 0; fd >= 0 && pos < LOG_SEGMENT_SIZE; pos += zeros.size()) {
+      if (TransferAll(true, fd, zeros.data(), zeros.size(), pos) != static_cast<ssize_t>(zeros.size())) {
+        LOG_DEBUG("I/O error while preallocating log segment");
+        break;
+      }
+    }
+    if (fd >= 0 && fsync(fd) != 0) {
+      LOG_DEBUG("I/O error while syncing log segment");
+    }
+  }
+  if (fd < 0) {
+    LOG_DEBUG("can't open log segment");
+  }
+  // the new name must survive a crash before any log that depends on it is acknowledged
+  std::string::size_type slash = log_name_.rfind('/');
+  int dir_fd = open(slash == std::string::npos ? "." : log_name_.substr(0, slash + 1).c_str(), O_RDONLY);
+  if (dir_fd >= 0) {
+    fsync(dir_fd);
+    close(dir_fd);
+  }
+  // the header is synced together with the first write into the segment
+  LogSegmentHeader header{LOG_SEGMENT_MAGIC, first_lsn, number, first_record_offset, checkpoint_lsn_};
+  if (TransferAll(true, fd, reinterpret_cast<char *>(&header), sizeof(header), 0) != sizeof(header)) {
+    LOG_DEBUG("I/O error while writing log segment header");
+  }
+  log_segments_.push_back(LogSegment{number, fd, first_lsn, first_record_offset});
+}
+
+/**
+ * Private helper function to retire a log segment
  */
-void DiskManager::DeallocatePage(__attribute__((unused)) page_id_t page_id) {}
+void DiskManager::RecycleLogSegment(const LogSegment &segment) {
+  std::string segment_name = GetLogSegmentName(segment.number_);
+  if (spare_log_segments_.size() >= LOG_SEGMENT_SPARES) {
+    close(segment.fd_);
+    unlink(segment_name.c_str());
+    return;
+  }
+  // mark it as spare, so that it is not mistaken for log on startup
+  LogSegmentHeader header{LOG_SEGMENT_MAGIC, INVALID_LSN, segment.number_, 0, INVALID_LSN};
+  if (TransferAll(true, segment.fd_, reinterpret_cast<char *>(&header), sizeof(header), 0) != sizeof(header) ||
+      fdatasync(segment.fd_) != 0) {
+    LOG_DEBUG("I/O error while recycling log segment");
+  }
+  close(segment.fd_);
+  spare_log_segments_.push_back(segment_name);
+}
+
+/**
+ * Private helper function to find the segments of a range of log offsets
+ */
+std::vector<DiskManager::LogRange> DiskManager::MapLogRange(off_t offset, size_t size) {
+  std::vector<LogRange> ranges;
+  size_t done = 0;
+  while (done < size && !log_segments_.empty()) {
+    off_t pos = offset + done;
+    int64_t index = pos / LOG_SEGMENT_DATA_SIZE - log_segments_.front().number_;
+    if (index < 0 || index >= static_cast<int64_t>(log_segments_.size())) {
+      break;
+    }
+    const LogSegment &segment = log_segments_[index];
+    off_t segment_offset = pos - segment.number_ * LOG_SEGMENT_DATA_SIZE;
+    size_t part = std::min(size - done, static_cast<size_t>(LOG_SEGMENT_DATA_SIZE - segment_offset));
+    ranges.push_back(LogRange{segment.fd_, LOG_SEGMENT_HEADER_SIZE + segment_offset, done, part});
+    done += part;
+  }
+  return ranges;
+}
+
+/**
+ * Private helper function to read a range of log offsets
+ */
+bool DiskManager::ReadLogRange(char *log_data, size_t size, off_t offset) {
+  size_t read_count = 0;
+  for (const auto &range : MapLogRange(offset, size)) {
+    if (TransferAll(false, range.fd_, log_data + range.data_offset_, range.size_, range.file_offset_) !=
+        static_cast<ssize_t>(range.size_)) {
+      return false;
+    }
+    read_count += range.size_;
+  }
+  return read_count == size;
+}
+
+std::string DiskManager::GetLogSegmentName(int64_t number) const { return log_name_ + "." + std::to_string(number); }
 
 /**
  * Returns number of flushes made so far
@@ -212,6 +604,28 @@ int DiskManager::GetNumWrites() const { return num_writes_; }
  */
 bool DiskManager::GetFlushState() const { return flush_log_; }
 
+/**
+ * Helper function for positional I/O, retrying short transfers
+ */
+ssize_t DiskManager::TransferAll(bool write, int fd, char *buffer, size_t size, off_t offset) {
+  size_t done = 0;
+  while (done < size) {
+    ssize_t n = write ? pwrite(fd, buffer + done, size - done, offset + done)
+                      : pread(fd, buffer + done, size - done, offset + done);
+    if (n < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      return -errno;
+    }
+    if (n == 0) {
+      break;
+    }
+    done += n;
+  }
+  return done;
+}
+
 /**
  * Private helper function to get disk file size
  */
@@ -0,0 +1,64 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// extent_reservation.cpp
+//
+// Identification: src/storage/disk/extent_reservation.cpp
+//
+// Copyright (c) 2015-2019, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include "storage/disk/extent_reservation.h"
+
+#include <algorithm>
+#include <functional>
+
+namespace bustub {
+
+ExtentReservation::ExtentReservation(DiskManager *disk_manager, size_t extent_size)
+    : disk_manager_(disk_manager), extent_size_(extent_size) {
+  BUSTUB_ASSERT(extent_size_ > 0, "An extent has at least one page.");
+}
+
+ExtentReservation::~ExtentReservation() { Release(); }
+
+page_id_t ExtentReservation::AllocatePage() {
+  std::lock_guard<std::mutex> guard(latch_);
+  if (!returned_pages_.empty()) {
+    page_id_t page_id = returned_pages_.back();
+    returned_pages_.pop_back();
+    return page_id;
+  }
+  if (next_page_id_ == end_page_id_) {
+    next_page_id_ = disk_manager_->AllocateExtent(extent_size_);
+    end_page_id_ = next_page_id_ + static_cast<page_id_t>(extent_size_);
+  }
+  return next_page_id_++;
+}
+
+void ExtentReservation::ReturnPage(page_id_t page_id) {
+  std::lock_guard<std::mutex> guard(latch_);
+  returned_pages_.insert(std::upper_bound(returned_pages_.begin(), returned_pages_.end(), page_id, std::greater<>()),
+                         page_id);
+}
+
+void ExtentReservation::Release() {
+  std::lock_guard<std::mutex> guard(latch_);
+  for (page_id_t page_id : returned_pages_) {
+    disk_manager_->DeallocatePage(page_id);
+  }
+  returned_pages_.clear();
+  for (page_id_t page_id = next_page_id_; page_id < end_page_id_; page_id++) {
+    disk_manager_->DeallocatePage(page_id);
+  }
+  next_page_id_ = end_page_id_;
+}
+
+size_t ExtentReservation::GetNumReservedPages() {
+  std::lock_guard<std::mutex> guard(latch_);
+  return end_page_id_ - next_page_id_ + returned_pages_.size();
+}
+
+}  // namespace bustub
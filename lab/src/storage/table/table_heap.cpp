@@ -13,6 +13,8 @@
 #include <cassert>
 
 #include "common/logger.h"
+#include "concurrency/row_version_table.h"
+#include "concurrency/version_store.h"
 #include "storage/table/table_heap.h"
 
 namespace bustub {
@@ -22,13 +24,18 @@ TableHeap::TableHeap(BufferPoolManager *buffer_pool_manager, LockManager *lock_m
     : buffer_pool_manager_(buffer_pool_manager),
       lock_manager_(lock_manager),
       log_manager_(log_manager),
-      first_page_id_(first_page_id) {}
+      first_page_id_(first_page_id),
+      extent_(buffer_pool_manager->GetExtentReservation()) {}
 
 TableHeap::TableHeap(BufferPoolManager *buffer_pool_manager, LockManager *lock_manager, LogManager *log_manager,
                      Transaction *txn)
-    : buffer_pool_manager_(buffer_pool_manager), lock_manager_(lock_manager), log_manager_(log_manager) {
+    : buffer_pool_manager_(buffer_pool_manager),
+      lock_manager_(lock_manager),
+      log_manager_(log_manager),
+      extent_(buffer_pool_manager->GetExtentReservation()) {
   // Initialize the first table page.
-  auto first_page = reinterpret_cast<TablePage *>(buffer_pool_manager_->NewPage(&first_page_id_));
+  auto first_page =
+      reinterpret_cast<TablePage *>(buffer_pool_manager_->NewPage(&first_page_id_, nullptr, nullptr, extent_.get()));
   BUSTUB_ASSERT(first_page != nullptr, "Couldn't create a page for the table heap.");
   first_page->WLatch();
   first_page->Init(first_page_id_, PAGE_SIZE, INVALID_LSN, log_manager_, txn);
@@ -36,22 +43,34 @@ TableHeap::TableHeap(BufferPoolManager *buffer_pool_manager, LockManager *lock_m
   buffer_pool_manager_->UnpinPage(first_page_id_, true);
 }
 
-bool TableHeap::InsertTuple(const Tuple &tuple, RID *rid, Transaction *txn) {
+bool TableHeap::InsertTuple(const Tuple &tuple, RID *rid, Transaction *txn, BufferAccessStrategy *strategy) {
   if (tuple.size_ + 32 > PAGE_SIZE) {  // larger than one page size
     txn->SetState(TransactionState::ABORTED);
     return false;
   }
+  // Announce the insert on the table before latching a page, since this lock may have to wait.
+  if (!LockTable(txn, LockMode::INTENTION_EXCLUSIVE)) {
+    return false;
+  }
 
-  auto cur_page = static_cast<TablePage *>(buffer_pool_manager_->FetchPage(first_page_id_));
+  auto cur_page = static_cast<TablePage *>(buffer_pool_manager_->FetchPage(first_page_id_, nullptr, strategy));
   if (cur_page == nullptr) {
     txn->SetState(TransactionState::ABORTED);
     return false;
   }
 
+  // Lock the new tuple before anyone can see it, without waiting, since its page is latched by then. A reused slot may
+  // still be locked by a transaction that read or deleted its last tuple, so such slots are skipped. If the
+  // transaction was aborted by another one, the tuple goes in anyway, and is removed when the transaction rolls back
+  // like its other writes.
+  auto claim = [this, txn](const RID &slot) {
+    return TryLockTuple(slot, txn) || txn->GetState() == TransactionState::ABORTED;
+  };
+
   cur_page->WLatch();
   // Insert into the first page with enough space. If no such page exists, create a new page and insert into that.
   // INVARIANT: cur_page is WLatched if you leave the loop normally.
-  while (!cur_page->InsertTuple(tuple, rid, txn, lock_manager_, log_manager_)) {
+  while (!cur_page->InsertTuple(tuple, rid, txn, log_manager_, claim)) {
     auto next_page_id = cur_page->GetNextPageId();
     // If the next page is a valid page,
     if (next_page_id != INVALID_PAGE_ID) {
@@ -59,11 +78,12 @@ bool TableHeap::InsertTuple(const Tuple &tuple, RID *rid, Transaction *txn) {
       cur_page->WUnlatch();
       buffer_pool_manager_->UnpinPage(cur_page->GetTablePageId(), false);
       // And repeat the process with the next page.
-      cur_page = static_cast<TablePage *>(buffer_pool_manager_->FetchPage(next_page_id));
+      cur_page = static_cast<TablePage *>(buffer_pool_manager_->FetchPage(next_page_id, nullptr, strategy));
       cur_page->WLatch();
     } else {
       // Otherwise we have run out of valid pages. We need to create a new page.
-      auto new_page = static_cast<TablePage *>(buffer_pool_manager_->NewPage(&next_page_id));
+      auto new_page =
+          static_cast<TablePage *>(buffer_pool_manager_->NewPage(&next_page_id, nullptr, strategy, extent_.get()));
       // If we could not create a new page,
       if (new_page == nullptr) {
         // Then life sucks and we abort the transaction.
@@ -86,16 +106,41 @@ bool TableHeap::InsertTuple(const Tuple &tuple, RID *rid, Transaction *txn) {
       cur_page = new_page;
     }
   }
+  // Older snapshots do not see the new tuple.
+  if (txn->GetVersionStore() != nullptr) {
+    txn->GetVersionStore()->AddVersion(txn, *rid, nullptr);
+  }
+  // Optimistic transactions insert right away, but lock the new tuple's version word until they finish, so that no
+  // one else validates a read of it. The word is only held by someone else if the slot's last tuple was just deleted
+  // by a commit that did not unlock it yet.
+  RowVersionTable *row_versions = txn->GetRowVersionTable();
+  bool row_locked = row_versions == nullptr || row_versions->TryLock(*rid);
+  if (row_versions != nullptr && row_locked) {
+    txn->GetLockedRows()->insert(*rid);
+  }
   // This line has caused most of us to double-take and "whoa double unlatch".
   // We are not, in fact, double unlatching. See the invariant above.
   cur_page->WUnlatch();
   buffer_pool_manager_->UnpinPage(cur_page->GetTablePageId(), true);
   // Update the transaction's write set.
   txn->GetWriteSet()->emplace_back(*rid, WType::INSERT, Tuple{}, this);
+  if (!row_locked) {
+    txn->SetState(TransactionState::ABORTED);
+    return false;
+  }
   return true;
 }
 
 bool TableHeap::MarkDelete(const RID &rid, Transaction *txn) {
+  // An optimistic transaction holds the delete back until it commits. The read makes validation check the tuple.
+  if (BuffersWrites(txn)) {
+    Tuple tuple;
+    if (!GetTuple(rid, &tuple, txn)) {
+      return false;
+    }
+    txn->GetBufferedWrites()->emplace_back(rid, WType::DELETE, Tuple{}, this);
+    return true;
+  }
   // TODO(Amadou): remove empty page
   // Find the page which contains the tuple.
   auto page = reinterpret_cast<TablePage *>(buffer_pool_manager_->FetchPage(rid.GetPageId()));
@@ -104,9 +149,25 @@ bool TableHeap::MarkDelete(const RID &rid, Transaction *txn) {
     txn->SetState(TransactionState::ABORTED);
     return false;
   }
+  // Lock the tuple first, so that the transaction never waits for a lock while holding a latch.
+  if (!LockTuple(rid, txn, true)) {
+    buffer_pool_manager_->UnpinPage(page->GetTablePageId(), false);
+    return false;
+  }
   // Otherwise, mark the tuple as deleted.
   page->WLatch();
-  page->MarkDelete(rid, txn, lock_manager_, log_manager_);
+  VersionStore *version_store = txn->GetVersionStore();
+  if (version_store != nullptr && !version_store->CheckWrite(txn, rid)) {
+    page->WUnlatch();
+    buffer_pool_manager_->UnpinPage(page->GetTablePageId(), false);
+    return false;
+  }
+  // Older snapshots still see the tuple.
+  Tuple old_tuple;
+  if (version_store != nullptr && page->GetTuple(rid, &old_tuple, txn)) {
+    version_store->AddVersion(txn, rid, &old_tuple);
+  }
+  page->MarkDelete(rid, txn, log_manager_);
   page->WUnlatch();
   buffer_pool_manager_->UnpinPage(page->GetTablePageId(), true);
   // Update the transaction's write set.
@@ -115,6 +176,15 @@ bool TableHeap::MarkDelete(const RID &rid, Transaction *txn) {
 }
 
 bool TableHeap::UpdateTuple(const Tuple &tuple, const RID &rid, Transaction *txn) {
+  // An optimistic transaction holds the update back until it commits. The read makes validation check the tuple.
+  if (BuffersWrites(txn)) {
+    Tuple old_tuple;
+    if (!GetTuple(rid, &old_tuple, txn)) {
+      return false;
+    }
+    txn->GetBufferedWrites()->emplace_back(rid, WType::UPDATE, tuple, this);
+    return true;
+  }
   // Find the page which contains the tuple.
   auto page = reinterpret_cast<TablePage *>(buffer_pool_manager_->FetchPage(rid.GetPageId()));
   // If the page could not be found, then abort the transaction.
@@ -122,10 +192,24 @@ bool TableHeap::UpdateTuple(const Tuple &tuple, const RID &rid, Transaction *txn
     txn->SetState(TransactionState::ABORTED);
     return false;
   }
+  if (!LockTuple(rid, txn, true)) {
+    buffer_pool_manager_->UnpinPage(page->GetTablePageId(), false);
+    return false;
+  }
   // Update the tuple; but first save the old value for rollbacks.
   Tuple old_tuple;
   page->WLatch();
-  bool is_updated = page->UpdateTuple(tuple, &old_tuple, rid, txn, lock_manager_, log_manager_);
+  VersionStore *version_store = txn->GetVersionStore();
+  if (version_store != nullptr && !version_store->CheckWrite(txn, rid)) {
+    page->WUnlatch();
+    buffer_pool_manager_->UnpinPage(page->GetTablePageId(), false);
+    return false;
+  }
+  bool is_updated = page->UpdateTuple(tuple, &old_tuple, rid, txn, log_manager_);
+  // Older snapshots still see the old image.
+  if (is_updated && version_store != nullptr) {
+    version_store->AddVersion(txn, rid, &old_tuple);
+  }
   page->WUnlatch();
   buffer_pool_manager_->UnpinPage(page->GetTablePageId(), is_updated);
   // Update the transaction's write set.
@@ -142,6 +226,13 @@ void TableHeap::ApplyDelete(const RID &rid, Transaction *txn) {
   // Delete the tuple from the page.
   page->WLatch();
   page->ApplyDelete(rid, txn, log_manager_);
+  // A rolled back insert frees its slot, so its version goes before the slot can be reused.
+  if (txn->GetVersionStore() != nullptr && txn->GetState() == TransactionState::ABORTED) {
+    txn->GetVersionStore()->RevertVersion(txn, rid);
+  }
+  // Likewise for the version word of an optimistic transaction's tuple. A committed delete changes the tuple, a
+  // rolled back insert leaves the slot as it was before.
+  UnlockRowVersion(rid, txn, txn->GetState() != TransactionState::ABORTED);
   lock_manager_->Unlock(txn, rid);
   page->WUnlatch();
   buffer_pool_manager_->UnpinPage(page->GetTablePageId(), true);
@@ -158,34 +249,102 @@ void TableHeap::RollbackDelete(const RID &rid, Transaction *txn) {
   buffer_pool_manager_->UnpinPage(page->GetTablePageId(), true);
 }
 
-bool TableHeap::GetTuple(const RID &rid, Tuple *tuple, Transaction *txn) {
+bool TableHeap::GetTuple(const RID &rid, Tuple *tuple, Transaction *txn, BufferAccessStrategy *strategy) {
+  // An optimistic transaction sees its own latest write of the tuple.
+  if (BuffersWrites(txn)) {
+    auto *buffered_writes = txn->GetBufferedWrites();
+    for (auto write = buffered_writes->rbegin(); write != buffered_writes->rend(); ++write) {
+      if (write->rid_ == rid && write->table_ == this) {
+        if (write->wtype_ == WType::DELETE) {
+          return false;
+        }
+        // rid may refer to the tuple's own RID, which the copy overwrites.
+        *tuple = write->tuple_;
+        tuple->rid_ = write->rid_;
+        return true;
+      }
+    }
+  }
   // Find the page which contains the tuple.
-  auto page = static_cast<TablePage *>(buffer_pool_manager_->FetchPage(rid.GetPageId()));
+  auto page = static_cast<TablePage *>(buffer_pool_manager_->FetchPage(rid.GetPageId(), nullptr, strategy));
   // If the page could not be found, then abort the transaction.
   if (page == nullptr) {
     txn->SetState(TransactionState::ABORTED);
     return false;
   }
+  // Snapshot and optimistic reads take no locks.
+  VersionStore *version_store = txn->GetVersionStore();
+  if (txn->ReadsUnderLocks() && !LockTuple(rid, txn, false)) {
+    buffer_pool_manager_->UnpinPage(rid.GetPageId(), false);
+    return false;
+  }
   // Read the tuple from the page.
   page->RLatch();
-  bool res = page->GetTuple(rid, tuple, txn, lock_manager_);
+  bool res = page->GetTuple(rid, tuple, txn);
+  if (version_store != nullptr) {
+    res = version_store->ReadVersion(txn, rid, res, tuple);
+  }
+  // The version word is read under the latch too, so that it matches the image. A word someone else holds locked
+  // belongs to a tuple that is being written, so the transaction would fail validation anyway.
+  RowVersionTable *row_versions = txn->GetRowVersionTable();
+  if (row_versions != nullptr) {
+    uint64_t version = row_versions->GetVersion(rid);
+    auto *locked_rows = txn->GetLockedRows();
+    if ((version & RowVersionTable::LOCK_BIT) != 0 && locked_rows->count(rid) == 0) {
+      txn->SetState(TransactionState::ABORTED);
+      res = false;
+    } else {
+      txn->GetReadSet()->emplace_back(rid, version);
+    }
+  }
   page->RUnlatch();
   buffer_pool_manager_->UnpinPage(rid.GetPageId(), false);
   return res;
 }
 
-TableIterator TableHeap::Begin(Transaction *txn) {
+TableIterator TableHeap::Begin(Transaction *txn, BufferAccessStrategy *strategy) {
   // Start an iterator from the first page.
-  auto page = static_cast<TablePage *>(buffer_pool_manager_->FetchPage(first_page_id_));
+  auto page = static_cast<TablePage *>(buffer_pool_manager_->FetchPage(first_page_id_, nullptr, strategy));
   page->RLatch();
   RID rid;
   // If this fails because there is no tuple, then RID will be the default-constructed value, which means EOF.
-  page->GetFirstTupleRid(&rid);
+  page->GetFirstTupleRid(&rid, txn->GetVersionStore() != nullptr);
   page->RUnlatch();
   buffer_pool_manager_->UnpinPage(first_page_id_, false);
-  return TableIterator(this, rid, txn);
+  return TableIterator(this, rid, txn, strategy);
 }
 
 TableIterator TableHeap::End() { return TableIterator(this, RID(INVALID_PAGE_ID, 0), nullptr); }
 
+bool TableHeap::LockTable(Transaction *txn, LockMode lock_mode) {
+  if (txn->GetRowVersionTable() != nullptr || (lock_mode == LockMode::SHARED && txn->GetVersionStore() != nullptr)) {
+    return true;
+  }
+  return !enable_logging || lock_manager_->LockTable(txn, first_page_id_, lock_mode);
+}
+
+bool TableHeap::LockTuple(const RID &rid, Transaction *txn, bool exclusive) {
+  return !enable_logging || txn->GetRowVersionTable() != nullptr ||
+         lock_manager_->LockRow(txn, first_page_id_, rid, exclusive ? LockMode::EXCLUSIVE : LockMode::SHARED);
+}
+
+bool TableHeap::TryLockTuple(const RID &rid, Transaction *txn) {
+  return !enable_logging || txn->GetRowVersionTable() != nullptr || lock_manager_->TryLockRow(txn, first_page_id_, rid);
+}
+
+bool TableHeap::BuffersWrites(Transaction *txn) {
+  return txn->GetRowVersionTable() != nullptr && txn->GetState() == TransactionState::GROWING &&
+         !txn->IsApplyingBufferedWrites();
+}
+
+void TableHeap::UnlockRowVersion(const RID &rid, Transaction *txn, bool changed) {
+  RowVersionTable *row_versions = txn->GetRowVersionTable();
+  if (row_versions == nullptr) {
+    return;
+  }
+  if (txn->GetLockedRows()->erase(rid) != 0) {
+    row_versions->Unlock(rid, changed);
+  }
+}
+
 }  // namespace bustub
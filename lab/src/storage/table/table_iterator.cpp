@@ -10,17 +10,41 @@
 //
 //===----------------------------------------------------------------------===//
 
+#include <algorithm>
 #include <cassert>
 
 #include "storage/table/table_heap.h"
 
 namespace bustub {
 
-TableIterator::TableIterator(TableHeap *table_heap, RID rid, Transaction *txn)
-    : table_heap_(table_heap), tuple_(new Tuple(rid)), txn_(txn) {
+TableIterator::TableIterator(TableHeap *table_heap, RID rid, Transaction *txn, BufferAccessStrategy *strategy)
+    : table_heap_(table_heap), tuple_(new Tuple(rid)), txn_(txn), strategy_(strategy) {
   if (rid.GetPageId() != INVALID_PAGE_ID) {
-    table_heap_->GetTuple(tuple_->rid_, tuple_, txn_);
+    ReadAhead(rid.GetPageId());
+    if (!table_heap_->GetTuple(tuple_->rid_, tuple_, txn_, strategy_) && ReadsUnlocked()) {
+      ++(*this);
+    }
+  }
+}
+
+void TableIterator::ReadAhead(page_id_t page_id) {
+  size_t distance = table_heap_->read_ahead_distance_;
+  if (strategy_ != nullptr) {
+    size_t capacity = strategy_->GetCapacity();
+    distance = std::min(distance, capacity > 2 ? capacity - 2 : 0);
   }
+  if (distance == 0) {
+    return;
+  }
+  if (pages_until_read_ahead_ > 0) {
+    pages_until_read_ahead_--;
+    return;
+  }
+  // Prefetch the window after this page, and come back when half of it is used up. The pages that are still
+  // resident from the previous window are cheap hits for the prefetcher.
+  table_heap_->buffer_pool_manager_->PrefetchChain(
+      page_id, distance + 1, [](Page *page) { return static_cast<TablePage *>(page)->GetNextPageId(); }, strategy_);
+  pages_until_read_ahead_ = (distance - 1) / 2;
 }
 
 const Tuple &TableIterator::operator*() {
@@ -34,34 +58,45 @@ Tuple *TableIterator::operator->() {
 }
 
 TableIterator &TableIterator::operator++() {
+  // Transactions that read without locks skip the tuples they do not see.
+  while (!Advance() && ReadsUnlocked()) {
+  }
+  return *this;
+}
+
+bool TableIterator::Advance() {
+  // A snapshot also stops at empty slots, where it may still see a deleted tuple.
+  bool include_empty = ReadsSnapshot();
   BufferPoolManager *buffer_pool_manager = table_heap_->buffer_pool_manager_;
-  auto cur_page = static_cast<TablePage *>(buffer_pool_manager->FetchPage(tuple_->rid_.GetPageId()));
+  auto cur_page =
+      static_cast<TablePage *>(buffer_pool_manager->FetchPage(tuple_->rid_.GetPageId(), nullptr, strategy_));
   cur_page->RLatch();
   assert(cur_page != nullptr);  // all pages are pinned
 
   RID next_tuple_rid;
-  if (!cur_page->GetNextTupleRid(tuple_->rid_,
-                                 &next_tuple_rid)) {  // end of this page
+  if (!cur_page->GetNextTupleRid(tuple_->rid_, &next_tuple_rid, include_empty)) {  // end of this page
     while (cur_page->GetNextPageId() != INVALID_PAGE_ID) {
-      auto next_page = static_cast<TablePage *>(buffer_pool_manager->FetchPage(cur_page->GetNextPageId()));
+      auto next_page =
+          static_cast<TablePage *>(buffer_pool_manager->FetchPage(cur_page->GetNextPageId(), nullptr, strategy_));
       cur_page->RUnlatch();
       buffer_pool_manager->UnpinPage(cur_page->GetTablePageId(), false);
       cur_page = next_page;
+      ReadAhead(cur_page->GetTablePageId());
       cur_page->RLatch();
-      if (cur_page->GetFirstTupleRid(&next_tuple_rid)) {
+      if (cur_page->GetFirstTupleRid(&next_tuple_rid, include_empty)) {
         break;
       }
     }
   }
   tuple_->rid_ = next_tuple_rid;
-
-  if (*this != table_heap_->End()) {
-    table_heap_->GetTuple(tuple_->rid_, tuple_, txn_);
-  }
-  // release until copy the tuple
+  // GetTuple may wait for a row lock and latches the page itself, so the page is released first.
   cur_page->RUnlatch();
   buffer_pool_manager->UnpinPage(cur_page->GetTablePageId(), false);
-  return *this;
+
+  if (*this == table_heap_->End()) {
+    return true;
+  }
+  return table_heap_->GetTuple(tuple_->rid_, tuple_, txn_, strategy_);
 }
 
 TableIterator TableIterator::operator++(int) {
@@ -0,0 +1,90 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// buffer_pool_manager_benchmark_test.cpp
+//
+// Identification: test/buffer/buffer_pool_manager_benchmark_test.cpp
+//
+// Copyright (c) 2015-2019, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include <atomic>
+#include <chrono>  // NOLINT
+#include <cstdio>
+#include <random>
+#include <string>
+#include <thread>  // NOLINT
+#include <vector>
+
+#include "buffer/buffer_pool_manager.h"
+#include "gtest/gtest.h"
+#include "storage/disk/database_files.h"
+
+namespace bustub {
+
+// Measures the throughput of FetchPage/UnpinPage on resident pages from 1 to 32 threads. All pages live in a single
+// shard, so the numbers show how far hits scale without any latch.
+TEST(BufferPoolManagerBenchmark, HitThroughputTest) {
+  const std::string db_name = "test.db";
+  const size_t buffer_pool_size = 256;
+  const auto duration = std::chrono::milliseconds(100);
+
+  auto *disk_manager = new DiskManager(db_name);
+  auto *bpm = new BufferPoolManager(buffer_pool_size, disk_manager);
+  std::vector<page_id_t> page_ids;
+  for (size_t i = 0; i < buffer_pool_size; i++) {
+    page_id_t page_id;
+    ASSERT_NE(nullptr, bpm->NewPage(&page_id));
+    ASSERT_TRUE(bpm->UnpinPage(page_id, false));
+    page_ids.push_back(page_id);
+  }
+
+  double single_thread_throughput = 0;
+  for (size_t num_threads = 1; num_threads <= 32; num_threads *= 2) {
+    std::atomic<bool> stop{false};
+    std::atomic<uint64_t> total_ops{0};
+    std::vector<std::thread> threads;
+    for (size_t tid = 0; tid < num_threads; tid++) {
+      threads.emplace_back([bpm, &page_ids, &stop, &total_ops, tid] {
+        std::mt19937 rng(tid);
+        std::uniform_int_distribution<size_t> dist(0, page_ids.size() - 1);
+        uint64_t ops = 0;
+        while (!stop) {
+          page_id_t page_id = page_ids[dist(rng)];
+          Page *page = bpm->FetchPage(page_id);
+          EXPECT_NE(nullptr, page);
+          EXPECT_TRUE(bpm->UnpinPage(page_id, false));
+          ops++;
+        }
+        total_ops += ops;
+      });
+    }
+    auto start = std::chrono::steady_clock::now();
+    std::this_thread::sleep_for(duration);
+    stop = true;
+    for (auto &thread : threads) {
+      thread.join();
+    }
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    double throughput = static_cast<double>(total_ops) / elapsed.count();
+    if (num_threads == 1) {
+      single_thread_throughput = throughput;
+    }
+    printf("%2zu threads: %12.0f hits/s (%.2fx)\n", num_threads, throughput, throughput / single_thread_throughput);
+  }
+
+  // Every pin was dropped again, and nothing was evicted.
+  for (size_t i = 0; i < buffer_pool_size; i++) {
+    EXPECT_EQ(0, bpm->GetPages()[i].GetPinCount());
+  }
+
+  disk_manager->ShutDown();
+  RemoveDatabaseFiles("test.db");
+
+  delete bpm;
+  delete disk_manager;
+}
+
+}  // namespace bustub
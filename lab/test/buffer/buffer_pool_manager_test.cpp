@@ -11,9 +11,15 @@
 //===----------------------------------------------------------------------===//
 
 #include "buffer/buffer_pool_manager.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>  // NOLINT
 #include <cstdio>
 #include <string>
+#include <thread>  // NOLINT
+#include <vector>
 #include "gtest/gtest.h"
+#include "storage/disk/database_files.h"
 
 namespace bustub {
 
@@ -76,7 +82,7 @@ TEST(BufferPoolManagerTest, BinaryDataTest) {
 
   // Shutdown the disk manager and remove the temporary file we created.
   disk_manager->ShutDown();
-  remove("test.db");
+  RemoveDatabaseFiles("test.db");
 
   delete bpm;
   delete disk_manager;
@@ -133,7 +139,378 @@ TEST(BufferPoolManagerTest, SampleTest) {
 
   // Shutdown the disk manager and remove the temporary file we created.
   disk_manager->ShutDown();
-  remove("test.db");
+  RemoveDatabaseFiles("test.db");
+
+  delete bpm;
+  delete disk_manager;
+}
+
+// NOLINTNEXTLINE
+TEST(BufferPoolManagerTest, ShardedTest) {
+  const std::string db_name = "test.db";
+  const size_t buffer_pool_size = 16;
+  const size_t num_instances = 4;
+  const int num_pages = 64;
+
+  auto *disk_manager = new DiskManager(db_name);
+  auto *bpm = new BufferPoolManager(buffer_pool_size, disk_manager, nullptr, num_instances);
+  EXPECT_EQ(num_instances, bpm->GetNumInstances());
+
+  // Scenario: New pages are spread over the shards, so we can fill the whole pool.
+  std::vector<page_id_t> page_ids;
+  page_id_t page_id_temp;
+  for (size_t i = 0; i < buffer_pool_size; ++i) {
+    auto *page = bpm->NewPage(&page_id_temp);
+    ASSERT_NE(nullptr, page);
+    snprintf(page->GetData(), PAGE_SIZE, "page %d", page_id_temp);
+    page_ids.push_back(page_id_temp);
+  }
+  EXPECT_EQ(nullptr, bpm->NewPage(&page_id_temp));
+  for (auto page_id : page_ids) {
+    EXPECT_TRUE(bpm->UnpinPage(page_id, true));
+  }
+
+  // Scenario: Create many more pages than fit in the pool, forcing evictions in every shard.
+  while (page_ids.size() < static_cast<size_t>(num_pages)) {
+    auto *page = bpm->NewPage(&page_id_temp);
+    ASSERT_NE(nullptr, page);
+    snprintf(page->GetData(), PAGE_SIZE, "page %d", page_id_temp);
+    page_ids.push_back(page_id_temp);
+    EXPECT_TRUE(bpm->UnpinPage(page_id_temp, true));
+  }
+
+  // Scenario: Concurrent fetches of every page return the data written to it.
+  std::vector<std::thread> threads;
+  for (int tid = 0; tid < 8; tid++) {
+    threads.emplace_back([bpm, &page_ids, tid]() {
+      for (int round = 0; round < 10; round++) {
+        for (size_t i = tid % 2; i < page_ids.size(); i += 2) {
+          auto *page = bpm->FetchPage(page_ids[i]);
+          if (page == nullptr) {
+            continue;
+          }
+          char expected[PAGE_SIZE];
+          snprintf(expected, PAGE_SIZE, "page %d", page_ids[i]);
+          EXPECT_EQ(0, strcmp(page->GetData(), expected));
+          EXPECT_TRUE(bpm->UnpinPage(page_ids[i], false));
+        }
+      }
+    });
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+
+  disk_manager->ShutDown();
+  RemoveDatabaseFiles("test.db");
+
+  delete bpm;
+  delete disk_manager;
+}
+
+// NOLINTNEXTLINE
+TEST(BufferPoolManagerTest, ExtentRejectTest) {
+  const std::string db_name = "test.db";
+  const size_t num_instances = 4;
+
+  auto *disk_manager = new DiskManager(db_name);
+  auto *bpm = new BufferPoolManager(num_instances, disk_manager, nullptr, num_instances);
+  auto extent = bpm->GetExtentReservation(8);
+
+  // Scenario: Fill every shard with a page of the extent.
+  std::vector<page_id_t> page_ids;
+  page_id_t page_id_temp;
+  for (size_t i = 0; i < num_instances; ++i) {
+    ASSERT_NE(nullptr, bpm->NewPage(&page_id_temp, nullptr, nullptr, extent.get()));
+    page_ids.push_back(page_id_temp);
+  }
+
+  // Scenario: No shard has room, so the ids that were tried stay with the reservation.
+  EXPECT_EQ(nullptr, bpm->NewPage(&page_id_temp, nullptr, nullptr, extent.get()));
+  EXPECT_EQ(4, extent->GetNumReservedPages());
+
+  // Scenario: Once there is room, the rejected ids are handed out again, so the extent has no holes.
+  for (size_t i = 0; i < 2; ++i) {
+    EXPECT_TRUE(bpm->UnpinPage(page_ids[i], false));
+    ASSERT_NE(nullptr, bpm->NewPage(&page_id_temp, nullptr, nullptr, extent.get()));
+    EXPECT_EQ(page_ids[0] + static_cast<page_id_t>(num_instances + i), page_id_temp);
+  }
+  EXPECT_EQ(2, extent->GetNumReservedPages());
+
+  extent.reset();
+  disk_manager->ShutDown();
+  RemoveDatabaseFiles("test.db");
+
+  delete bpm;
+  delete disk_manager;
+}
+
+// NOLINTNEXTLINE
+TEST(BufferPoolManagerTest, ConcurrentMissTest) {
+  const std::string db_name = "test.db";
+  const size_t buffer_pool_size = 4;
+  const int num_pages = 16;
+
+  auto *disk_manager = new DiskManager(db_name);
+  auto *bpm = new BufferPoolManager(buffer_pool_size, disk_manager);
+
+  page_id_t page_id_temp;
+  for (int i = 0; i < num_pages; ++i) {
+    auto *page = bpm->NewPage(&page_id_temp);
+    ASSERT_NE(nullptr, page);
+    snprintf(page->GetData(), PAGE_SIZE, "page %d", page_id_temp);
+    EXPECT_TRUE(bpm->UnpinPage(page_id_temp, true));
+  }
+
+  // Scenario: Threads keep missing on the same pages, so requesters pile up behind reads and dirty write-backs.
+  std::vector<std::thread> threads;
+  for (int tid = 0; tid < 8; tid++) {
+    threads.emplace_back([bpm, tid]() {
+      for (int round = 0; round < 50; round++) {
+        page_id_t page_id = (round + tid) % num_pages;
+        auto *page = bpm->FetchPage(page_id);
+        if (page == nullptr) {
+          continue;
+        }
+        char expected[PAGE_SIZE];
+        snprintf(expected, PAGE_SIZE, "page %d", page_id);
+        EXPECT_EQ(0, strcmp(page->GetData(), expected));
+        EXPECT_TRUE(bpm->UnpinPage(page_id, round % 3 == 0));
+      }
+    });
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+
+  // Scenario: Every pin was released, so every page can be deleted.
+  for (int i = 0; i < num_pages; ++i) {
+    EXPECT_TRUE(bpm->DeletePage(i));
+  }
+
+  disk_manager->ShutDown();
+  RemoveDatabaseFiles("test.db");
+
+  delete bpm;
+  delete disk_manager;
+}
+
+// A scan through a bulk read strategy only recycles the frames of its ring.
+TEST(BufferPoolManagerTest, AccessStrategyTest) {
+  const std::string db_name = "test.db";
+  const size_t buffer_pool_size = 16;
+  const page_id_t num_pages = 100;
+  const page_id_t scan_begin = 10;
+  // Creating the pages leaves the last buffer_pool_size of them in the pool.
+  const page_id_t scan_end = num_pages - buffer_pool_size;
+
+  auto *disk_manager = new DiskManager(db_name);
+  auto *bpm = new BufferPoolManager(buffer_pool_size, disk_manager);
+
+  for (page_id_t i = 0; i < num_pages; i++) {
+    page_id_t page_id;
+    ASSERT_NE(nullptr, bpm->NewPage(&page_id));
+    ASSERT_TRUE(bpm->UnpinPage(page_id, true));
+  }
+  bpm->FlushAllPages();
+
+  auto strategy = bpm->GetAccessStrategy(AccessStrategyType::BULK_READ);
+  EXPECT_EQ(AccessStrategyType::BULK_READ, strategy->GetType());
+  EXPECT_EQ(MIN_RING_SIZE, strategy->GetRingSize());
+
+  // Scenario: scan pages the pool does not hold, holding on to the previous page while fetching the next one.
+  page_id_t prev_page_id = INVALID_PAGE_ID;
+  for (page_id_t page_id = scan_begin; page_id < scan_end; page_id++) {
+    Page *page = bpm->FetchPage(page_id, nullptr, strategy.get());
+    ASSERT_NE(nullptr, page);
+    EXPECT_EQ(page_id, page->GetPageId());
+    if (prev_page_id != INVALID_PAGE_ID) {
+      ASSERT_TRUE(bpm->UnpinPage(prev_page_id, false));
+    }
+    prev_page_id = page_id;
+  }
+  ASSERT_TRUE(bpm->UnpinPage(prev_page_id, false));
+
+  // The scan took no more frames than its ring has, so the rest of the pool still holds what it held before.
+  size_t scan_frames = 0;
+  size_t old_frames = 0;
+  for (size_t i = 0; i < buffer_pool_size; i++) {
+    page_id_t page_id = bpm->GetPages()[i].GetPageId();
+    if (page_id >= scan_begin && page_id < scan_end) {
+      scan_frames++;
+    } else if (page_id >= scan_end) {
+      old_frames++;
+    }
+  }
+  EXPECT_EQ(strategy->GetRingSize(), scan_frames);
+  EXPECT_EQ(buffer_pool_size - strategy->GetRingSize(), old_frames);
+
+  disk_manager->ShutDown();
+  RemoveDatabaseFiles("test.db");
+
+  delete bpm;
+  delete disk_manager;
+}
+
+// The background writer cleans the upcoming victims, so that evicting them does not write in the foreground.
+TEST(BufferPoolManagerTest, BackgroundWriterTest) {
+  const std::string db_name = "test.db";
+  const size_t buffer_pool_size = 10;
+  const size_t clean_target = 4;
+
+  auto *disk_manager = new DiskManager(db_name);
+  auto *bpm = new BufferPoolManager(buffer_pool_size, disk_manager);
+
+  // Scenario: fill the buffer pool with dirty, unpinned pages.
+  for (size_t i = 0; i < buffer_pool_size; i++) {
+    page_id_t page_id;
+    Page *page = bpm->NewPage(&page_id);
+    ASSERT_NE(nullptr, page);
+    snprintf(page->GetData(), PAGE_SIZE, "page %d", page_id);
+    ASSERT_TRUE(bpm->UnpinPage(page_id, true));
+  }
+
+  bpm->RunBackgroundWriter(clean_target, std::chrono::milliseconds(1));
+  for (int i = 0; i < 1000 && bpm->GetBackgroundWriterStats().pages_written_ < clean_target; i++) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  ASSERT_LE(clean_target, bpm->GetBackgroundWriterStats().pages_written_);
+
+  // Scenario: new pages evict the victims the writer cleaned.
+  for (size_t i = 0; i < clean_target; i++) {
+    page_id_t page_id;
+    ASSERT_NE(nullptr, bpm->NewPage(&page_id));
+  }
+  bpm->StopBackgroundWriter();
+  BackgroundWriterStats stats = bpm->GetBackgroundWriterStats();
+  EXPECT_EQ(0, stats.foreground_writes_);
+  EXPECT_EQ(clean_target, stats.stalls_avoided_);
+  EXPECT_LT(0, stats.flush_rate_);
+
+  // The evicted pages made it to disk.
+  for (page_id_t page_id = 0; page_id < static_cast<page_id_t>(buffer_pool_size); page_id++) {
+    Page *page = bpm->FetchPage(page_id);
+    if (page == nullptr) {
+      continue;
+    }
+    EXPECT_EQ("page " + std::to_string(page_id), std::string(page->GetData()));
+    bpm->UnpinPage(page_id, false);
+  }
+
+  disk_manager->ShutDown();
+  RemoveDatabaseFiles("test.db");
+
+  delete bpm;
+  delete disk_manager;
+}
+
+// Prefetched pages end up in the pool unpinned, and later fetches hit them.
+TEST(BufferPoolManagerTest, PrefetchTest) {
+  const std::string db_name = "test.db";
+  const size_t buffer_pool_size = 10;
+  const page_id_t num_pages = 30;
+
+  auto *disk_manager = new DiskManager(db_name);
+  auto *bpm = new BufferPoolManager(buffer_pool_size, disk_manager);
+
+  for (page_id_t i = 0; i < num_pages; i++) {
+    page_id_t page_id;
+    Page *page = bpm->NewPage(&page_id);
+    ASSERT_NE(nullptr, page);
+    snprintf(page->GetData(), PAGE_SIZE, "%d", page_id + 1);
+    ASSERT_TRUE(bpm->UnpinPage(page_id, true));
+  }
+
+  // Scenario: prefetch pages that were evicted.
+  bpm->PrefetchPages({0, 1, 2, 3});
+  bpm->WaitForPrefetches();
+  std::vector<page_id_t> resident;
+  for (size_t i = 0; i < buffer_pool_size; i++) {
+    EXPECT_EQ(0, bpm->GetPages()[i].GetPinCount());
+    resident.push_back(bpm->GetPages()[i].GetPageId());
+  }
+  for (page_id_t page_id = 0; page_id < 4; page_id++) {
+    EXPECT_NE(resident.end(), std::find(resident.begin(), resident.end(), page_id));
+  }
+
+  // Scenario: prefetch a chain, where every page holds the id of the next one.
+  bpm->PrefetchChain(
+      10, 5, [](Page *page) { return static_cast<page_id_t>(std::stoi(page->GetData())); }, nullptr);
+  bpm->WaitForPrefetches();
+  resident.clear();
+  for (size_t i = 0; i < buffer_pool_size; i++) {
+    EXPECT_EQ(0, bpm->GetPages()[i].GetPinCount());
+    resident.push_back(bpm->GetPages()[i].GetPageId());
+  }
+  for (page_id_t page_id = 10; page_id < 15; page_id++) {
+    EXPECT_NE(resident.end(), std::find(resident.begin(), resident.end(), page_id));
+  }
+  EXPECT_EQ(resident.end(), std::find(resident.begin(), resident.end(), 15));
+
+  // The prefetched pages hold the right data.
+  for (page_id_t page_id = 10; page_id < 15; page_id++) {
+    Page *page = bpm->FetchPage(page_id);
+    ASSERT_NE(nullptr, page);
+    EXPECT_EQ(std::to_string(page_id + 1), std::string(page->GetData()));
+    ASSERT_TRUE(bpm->UnpinPage(page_id, false));
+  }
+
+  disk_manager->ShutDown();
+  RemoveDatabaseFiles("test.db");
+
+  delete bpm;
+  delete disk_manager;
+}
+
+/** A disk whose page reads take a while, and which records how many of them were in flight at once. */
+class SlowReadDiskManager : public DiskManager {
+ public:
+  explicit SlowReadDiskManager(const std::string &db_file) : DiskManager(db_file) {}
+
+  void ReadPage(page_id_t page_id, char *page_data) override {
+    size_t in_flight = ++in_flight_;
+    size_t max_in_flight = max_in_flight_;
+    while (in_flight > max_in_flight && !max_in_flight_.compare_exchange_weak(max_in_flight, in_flight)) {
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    DiskManager::ReadPage(page_id, page_data);
+    in_flight_--;
+  }
+
+  std::atomic<size_t> in_flight_{0};
+  std::atomic<size_t> max_in_flight_{0};
+};
+
+// The reads of a prefetched list of pages overlap.
+TEST(BufferPoolManagerTest, PrefetchInFlightTest) {
+  const std::string db_name = "test.db";
+  const size_t buffer_pool_size = 20;
+  const page_id_t num_pages = 40;
+
+  auto *disk_manager = new SlowReadDiskManager(db_name);
+  auto *bpm = new BufferPoolManager(buffer_pool_size, disk_manager);
+  for (page_id_t i = 0; i < num_pages; i++) {
+    page_id_t page_id;
+    ASSERT_NE(nullptr, bpm->NewPage(&page_id));
+    ASSERT_TRUE(bpm->UnpinPage(page_id, true));
+  }
+
+  // Pages 0 to 7 were evicted.
+  disk_manager->max_in_flight_ = 0;
+  bpm->PrefetchPages({0, 1, 2, 3, 4, 5, 6, 7});
+  bpm->WaitForPrefetches();
+  EXPECT_LT(1, disk_manager->max_in_flight_.load());
+  EXPECT_GE(PREFETCH_WORKERS, disk_manager->max_in_flight_.load());
+  for (page_id_t page_id = 0; page_id < 8; page_id++) {
+    bool resident = false;
+    for (size_t i = 0; i < buffer_pool_size; i++) {
+      resident = resident || bpm->GetPages()[i].GetPageId() == page_id;
+    }
+    EXPECT_TRUE(resident);
+  }
+
+  disk_manager->ShutDown();
+  RemoveDatabaseFiles("test.db");
 
   delete bpm;
   delete disk_manager;
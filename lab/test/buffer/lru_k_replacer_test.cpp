@@ -0,0 +1,172 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// lru_k_replacer_test.cpp
+//
+// Identification: test/buffer/lru_k_replacer_test.cpp
+//
+// Copyright (c) 2015-2019, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include <algorithm>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "buffer/buffer_pool_manager.h"
+#include "buffer/lru_k_replacer.h"
+#include "gtest/gtest.h"
+#include "storage/disk/database_files.h"
+
+namespace bustub {
+
+TEST(LRUKReplacerTest, SampleTest) {
+  LRUKReplacer lru_k_replacer(7, 2);
+
+  // Scenario: reference six frames once each, then frame 1 a second time.
+  for (frame_id_t frame_id = 1; frame_id <= 6; frame_id++) {
+    lru_k_replacer.Pin(frame_id);
+    lru_k_replacer.Unpin(frame_id);
+  }
+  lru_k_replacer.Pin(1);
+  lru_k_replacer.Unpin(1);
+  EXPECT_EQ(6, lru_k_replacer.Size());
+
+  // Scenario: frames with fewer than K references go first, least recently used first.
+  int value;
+  lru_k_replacer.Victim(&value);
+  EXPECT_EQ(2, value);
+  lru_k_replacer.Victim(&value);
+  EXPECT_EQ(3, value);
+
+  // Scenario: pinned frames are not victims; removed frames are forgotten.
+  lru_k_replacer.Pin(4);
+  lru_k_replacer.Remove(5);
+  EXPECT_EQ(2, lru_k_replacer.Size());
+  lru_k_replacer.Victim(&value);
+  EXPECT_EQ(6, value);
+
+  // Scenario: frame 4 now has two references as well, but its second-to-last one is more recent than frame 1's.
+  lru_k_replacer.Unpin(4);
+  lru_k_replacer.Victim(&value);
+  EXPECT_EQ(1, value);
+  lru_k_replacer.Victim(&value);
+  EXPECT_EQ(4, value);
+  EXPECT_EQ(0, lru_k_replacer.Size());
+  EXPECT_FALSE(lru_k_replacer.Victim(&value));
+}
+
+TEST(LRUKReplacerTest, CorrelatedReferenceTest) {
+  LRUKReplacer lru_k_replacer(3, 2, 1);
+
+  // Scenario: frame 0 is referenced twice in a row, which is one correlated reference. Frame 1 is referenced twice
+  // with enough time in between, frame 2 once.
+  lru_k_replacer.Pin(0);
+  lru_k_replacer.Pin(0);
+  lru_k_replacer.Pin(1);
+  lru_k_replacer.Pin(2);
+  lru_k_replacer.Pin(1);
+  for (frame_id_t frame_id = 0; frame_id < 3; frame_id++) {
+    lru_k_replacer.Unpin(frame_id);
+  }
+
+  int value;
+  // Frames 1 and 2 are still inside their correlated reference period, so frame 0 goes first. Of the two, frame 2
+  // has an infinite K-distance.
+  lru_k_replacer.Victim(&value);
+  EXPECT_EQ(0, value);
+  lru_k_replacer.Victim(&value);
+  EXPECT_EQ(2, value);
+  lru_k_replacer.Victim(&value);
+  EXPECT_EQ(1, value);
+}
+
+// Hits that take no latch are recorded when they happen, so they order the victims by their backward K-distance.
+TEST(LRUKReplacerTest, LatchFreeHitTest) {
+  const std::string db_name = "test.db";
+  const size_t buffer_pool_size = 3;
+
+  auto *disk_manager = new DiskManager(db_name);
+  auto *bpm = new BufferPoolManager(buffer_pool_size, disk_manager, nullptr, 1, ReplacerPolicy::LRU_K);
+
+  page_id_t page_ids[3];
+  for (auto &page_id : page_ids) {
+    ASSERT_NE(nullptr, bpm->NewPage(&page_id));
+    ASSERT_TRUE(bpm->UnpinPage(page_id, true));
+  }
+
+  // Scenario: page 2 is hit once, then pages 0 and 1 twice each. Only page 2 still has its creation as its second
+  // most recent reference. Replaying the hits when the victim is picked would order them by creation and evict page 0.
+  for (int page : {2, 0, 1}) {
+    for (int hit = 0; hit < (page < 2 ? 2 : 1); hit++) {
+      ASSERT_NE(nullptr, bpm->FetchPage(page_ids[page]));
+      ASSERT_TRUE(bpm->UnpinPage(page_ids[page], false));
+    }
+  }
+  page_id_t new_page_id;
+  ASSERT_NE(nullptr, bpm->NewPage(&new_page_id));
+  ASSERT_TRUE(bpm->UnpinPage(new_page_id, true));
+
+  std::vector<page_id_t> resident;
+  for (size_t i = 0; i < buffer_pool_size; i++) {
+    resident.push_back(bpm->GetPages()[i].GetPageId());
+  }
+  EXPECT_NE(resident.end(), std::find(resident.begin(), resident.end(), page_ids[0]));
+  EXPECT_NE(resident.end(), std::find(resident.begin(), resident.end(), page_ids[1]));
+  EXPECT_EQ(resident.end(), std::find(resident.begin(), resident.end(), page_ids[2]));
+
+  disk_manager->ShutDown();
+  RemoveDatabaseFiles("test.db");
+
+  delete bpm;
+  delete disk_manager;
+}
+
+// Pages that are referenced repeatedly stay resident while a sequential scan streams through the buffer pool.
+TEST(LRUKReplacerTest, ScanResistanceTest) {
+  const std::string db_name = "test.db";
+  const size_t buffer_pool_size = 10;
+  const size_t hot_pages = 5;
+  const size_t scan_pages = 50;
+
+  auto *disk_manager = new DiskManager(db_name);
+  auto *bpm = new BufferPoolManager(buffer_pool_size, disk_manager, nullptr, 1, ReplacerPolicy::LRU_K);
+
+  std::vector<page_id_t> hot_page_ids;
+  for (size_t i = 0; i < hot_pages; i++) {
+    page_id_t page_id;
+    ASSERT_NE(nullptr, bpm->NewPage(&page_id));
+    ASSERT_TRUE(bpm->UnpinPage(page_id, true));
+    hot_page_ids.push_back(page_id);
+  }
+  for (auto page_id : hot_page_ids) {
+    ASSERT_NE(nullptr, bpm->FetchPage(page_id));
+    ASSERT_TRUE(bpm->UnpinPage(page_id, false));
+  }
+
+  // Scenario: a full scan touches many more pages than the pool holds, each exactly once.
+  for (size_t i = 0; i < scan_pages; i++) {
+    page_id_t page_id;
+    ASSERT_NE(nullptr, bpm->NewPage(&page_id));
+    ASSERT_TRUE(bpm->UnpinPage(page_id, true));
+  }
+
+  // The hot pages must still be in the buffer pool.
+  for (auto page_id : hot_page_ids) {
+    bool resident = false;
+    for (size_t i = 0; i < buffer_pool_size; i++) {
+      resident = resident || bpm->GetPages()[i].GetPageId() == page_id;
+    }
+    EXPECT_TRUE(resident) << "hot page " << page_id << " was evicted by the scan";
+  }
+
+  disk_manager->ShutDown();
+  RemoveDatabaseFiles("test.db");
+
+  delete bpm;
+  delete disk_manager;
+}
+
+}  // namespace bustub
@@ -0,0 +1,93 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// page_table_test.cpp
+//
+// Identification: test/buffer/page_table_test.cpp
+//
+// Copyright (c) 2015-2019, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include <atomic>
+#include <thread>  // NOLINT
+#include <vector>
+
+#include "buffer/page_table.h"
+#include "gtest/gtest.h"
+
+namespace bustub {
+
+TEST(PageTableTest, SampleTest) {
+  const size_t max_entries = 16;
+  PageTable page_table(max_entries);
+
+  // Scenario: fill the table with page ids that share a residue, like the pages of one shard.
+  for (size_t i = 0; i < max_entries; i++) {
+    page_table.Insert(static_cast<page_id_t>(i * 4 + 1), static_cast<frame_id_t>(i));
+  }
+  frame_id_t frame_id;
+  for (size_t i = 0; i < max_entries; i++) {
+    ASSERT_TRUE(page_table.Find(static_cast<page_id_t>(i * 4 + 1), &frame_id));
+    EXPECT_EQ(static_cast<frame_id_t>(i), frame_id);
+  }
+  EXPECT_FALSE(page_table.Find(0, &frame_id));
+
+  // Scenario: remove every other page. The rest must stay reachable after the backward shifts.
+  for (size_t i = 0; i < max_entries; i += 2) {
+    EXPECT_TRUE(page_table.Remove(static_cast<page_id_t>(i * 4 + 1)));
+  }
+  EXPECT_FALSE(page_table.Remove(1));
+  for (size_t i = 0; i < max_entries; i++) {
+    bool found = page_table.Find(static_cast<page_id_t>(i * 4 + 1), &frame_id);
+    EXPECT_EQ(i % 2 == 1, found);
+    if (found) {
+      EXPECT_EQ(static_cast<frame_id_t>(i), frame_id);
+    }
+  }
+
+  // Scenario: remap a page.
+  page_table.Insert(5, 42);
+  ASSERT_TRUE(page_table.Find(5, &frame_id));
+  EXPECT_EQ(42, frame_id);
+}
+
+// Lookups racing with a writer never return another page's frame.
+TEST(PageTableTest, ConcurrentLookupTest) {
+  const size_t max_entries = 64;
+  PageTable page_table(max_entries);
+  std::atomic<bool> done{false};
+
+  std::vector<std::thread> readers;
+  for (int tid = 0; tid < 4; tid++) {
+    readers.emplace_back([&page_table, &done] {
+      while (!done) {
+        for (page_id_t page_id = 0; page_id < 256; page_id++) {
+          frame_id_t frame_id;
+          if (page_table.Find(page_id, &frame_id)) {
+            // The writer always maps a page to its id modulo the number of entries.
+            EXPECT_EQ(page_id % static_cast<page_id_t>(max_entries), frame_id);
+          }
+        }
+      }
+    });
+  }
+  for (int round = 0; round < 200; round++) {
+    for (page_id_t page_id = 0; page_id < 256; page_id++) {
+      if (page_id >= static_cast<page_id_t>(max_entries)) {
+        page_table.Remove(page_id - static_cast<page_id_t>(max_entries));
+      }
+      page_table.Insert(page_id, page_id % static_cast<page_id_t>(max_entries));
+    }
+    for (page_id_t page_id = 256 - static_cast<page_id_t>(max_entries); page_id < 256; page_id++) {
+      page_table.Remove(page_id);
+    }
+  }
+  done = true;
+  for (auto &reader : readers) {
+    reader.join();
+  }
+}
+
+}  // namespace bustub
@@ -17,6 +17,7 @@
 #include "buffer/buffer_pool_manager.h"
 #include "catalog/simple_catalog.h"
 #include "gtest/gtest.h"
+#include "storage/disk/database_files.h"
 #include "type/value_factory.h"
 
 namespace bustub {
@@ -46,7 +47,9 @@ TEST(CatalogTest, CreateTableTest) {
 
   delete catalog;
   delete bpm;
+  disk_manager->ShutDown();
   delete disk_manager;
+  RemoveDatabaseFiles("catalog_test.db");
 }
 
 }  // namespace bustub
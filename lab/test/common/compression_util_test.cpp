@@ -0,0 +1,70 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// compression_util_test.cpp
+//
+// Identification: test/common/compression_util_test.cpp
+//
+// Copyright (c) 2015-2019, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include <random>
+#include <string>
+#include <vector>
+
+#include "common/util/compression_util.h"
+#include "gtest/gtest.h"
+
+namespace bustub {
+
+// NOLINTNEXTLINE
+TEST(CompressionUtilTest, RoundTripTest) {
+  std::string data;
+  for (int i = 0; i < 1000; i++) {
+    data += "tuple " + std::to_string(i % 37) + " has the same bytes as many others; ";
+  }
+  std::vector<char> compressed(data.size());
+  size_t compressed_size = CompressionUtil::Compress(data.data(), data.size(), compressed.data(), compressed.size());
+  ASSERT_GT(compressed_size, 0);
+  EXPECT_LT(compressed_size, data.size() / 4);
+
+  std::string result(data.size(), '\0');
+  ASSERT_TRUE(CompressionUtil::Decompress(compressed.data(), compressed_size, &result[0], result.size()));
+  EXPECT_EQ(data, result);
+
+  // the output size has to match exactly
+  EXPECT_FALSE(CompressionUtil::Decompress(compressed.data(), compressed_size, &result[0], result.size() - 1));
+  // and a cut off input is rejected
+  EXPECT_FALSE(CompressionUtil::Decompress(compressed.data(), compressed_size / 2, &result[0], result.size()));
+}
+
+// NOLINTNEXTLINE
+TEST(CompressionUtilTest, IncompressibleTest) {
+  std::mt19937 generator(15445);
+  std::string data(4096, '\0');
+  for (auto &c : data) {
+    c = static_cast<char>(generator());
+  }
+  // random bytes do not fit in fewer bytes
+  std::vector<char> compressed(data.size() * 2);
+  EXPECT_EQ(0, CompressionUtil::Compress(data.data(), data.size(), compressed.data(), data.size() - 1));
+
+  // but they still round trip when there is room
+  size_t compressed_size = CompressionUtil::Compress(data.data(), data.size(), compressed.data(), compressed.size());
+  ASSERT_GT(compressed_size, 0);
+  std::string result(data.size(), '\0');
+  ASSERT_TRUE(CompressionUtil::Decompress(compressed.data(), compressed_size, &result[0], result.size()));
+  EXPECT_EQ(data, result);
+
+  // short inputs are only literals
+  for (size_t size = 1; size < 20; size++) {
+    compressed_size = CompressionUtil::Compress(data.data(), size, compressed.data(), compressed.size());
+    ASSERT_GT(compressed_size, 0);
+    ASSERT_TRUE(CompressionUtil::Decompress(compressed.data(), compressed_size, &result[0], size));
+    EXPECT_EQ(data.substr(0, size), result.substr(0, size));
+  }
+}
+
+}  // namespace bustub
@@ -0,0 +1,121 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// lock_manager_benchmark_test.cpp
+//
+// Identification: test/concurrency/lock_manager_benchmark_test.cpp
+//
+// Copyright (c) 2015-2019, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include <atomic>
+#include <chrono>  // NOLINT
+#include <cstdio>
+#include <functional>
+#include <random>
+#include <thread>  // NOLINT
+#include <unordered_set>
+#include <vector>
+
+#include "concurrency/lock_manager.h"
+#include "gtest/gtest.h"
+
+namespace bustub {
+
+namespace {
+
+const size_t ROWS_PER_TRANSACTION = 4;
+
+/**
+ * Run transactions that each lock ROWS_PER_TRANSACTION rows and release them again, on 1 to 64 threads, and print the
+ * number of committed transactions per second.
+ * @param pick_row picks the next row a thread locks, and whether it is locked exclusively
+ */
+void RunLockBenchmark(const char *name,
+                      const std::function<RID(size_t tid, std::mt19937 *rng, bool *exclusive)> &pick_row) {
+  const auto duration = std::chrono::milliseconds(100);
+  LockManager lock_mgr{TwoPLMode::REGULAR, DeadlockMode::PREVENTION};
+  std::atomic<txn_id_t> next_txn_id{0};
+
+  printf("%s\n", name);
+  double single_thread_throughput = 0;
+  for (size_t num_threads = 1; num_threads <= 64; num_threads *= 2) {
+    std::atomic<bool> stop{false};
+    std::atomic<uint64_t> committed{0};
+    std::atomic<uint64_t> aborted{0};
+    std::vector<std::thread> threads;
+    for (size_t tid = 0; tid < num_threads; tid++) {
+      threads.emplace_back([&, tid] {
+        std::mt19937 rng(tid);
+        while (!stop) {
+          Transaction txn(next_txn_id++);
+          for (size_t i = 0; i < ROWS_PER_TRANSACTION && txn.GetState() != TransactionState::ABORTED; i++) {
+            bool exclusive = false;
+            RID rid = pick_row(tid, &rng, &exclusive);
+            if (exclusive) {
+              lock_mgr.LockExclusive(&txn, rid);
+            } else {
+              lock_mgr.LockShared(&txn, rid);
+            }
+          }
+          if (txn.GetState() == TransactionState::ABORTED) {
+            aborted++;
+          } else {
+            txn.SetState(TransactionState::COMMITTED);
+            committed++;
+          }
+          std::unordered_set<RID> lock_set;
+          lock_set.insert(txn.GetSharedLockSet()->begin(), txn.GetSharedLockSet()->end());
+          lock_set.insert(txn.GetExclusiveLockSet()->begin(), txn.GetExclusiveLockSet()->end());
+          for (const RID &rid : lock_set) {
+            EXPECT_TRUE(lock_mgr.Unlock(&txn, rid));
+          }
+        }
+      });
+    }
+    auto start = std::chrono::steady_clock::now();
+    std::this_thread::sleep_for(duration);
+    stop = true;
+    for (auto &thread : threads) {
+      thread.join();
+    }
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    double throughput = static_cast<double>(committed) / elapsed.count();
+    if (num_threads == 1) {
+      single_thread_throughput = throughput;
+    }
+    printf("%2zu threads: %10.0f txns/s (%.2fx), %lu aborted\n", num_threads, throughput,
+           throughput / single_thread_throughput, static_cast<uint64_t>(aborted));
+    EXPECT_GT(committed, 0);
+  }
+}
+
+}  // namespace
+
+// Every thread locks its own rows exclusively, so nothing conflicts and only the latches are shared.
+TEST(LockManagerBenchmark, DisjointThroughputTest) {
+  RunLockBenchmark("disjoint rows", [](size_t tid, std::mt19937 *rng, bool *exclusive) {
+    std::uniform_int_distribution<uint32_t> slot(0, 1023);
+    *exclusive = true;
+    return RID(static_cast<page_id_t>(tid), slot(*rng));
+  });
+}
+
+// Half of the locks go to 16 hot rows, and one lock in five is exclusive.
+TEST(LockManagerBenchmark, SkewedThroughputTest) {
+  RunLockBenchmark("skewed rows", [](size_t tid, std::mt19937 *rng, bool *exclusive) {
+    std::uniform_int_distribution<uint32_t> percent(0, 99);
+    std::uniform_int_distribution<uint32_t> hot(0, 15);
+    std::uniform_int_distribution<uint32_t> cold(0, 65535);
+    *exclusive = percent(*rng) < 20;
+    if (percent(*rng) < 50) {
+      return RID(0, hot(*rng));
+    }
+    uint32_t row = cold(*rng);
+    return RID(1 + static_cast<page_id_t>(row / 256), row % 256);
+  });
+}
+
+}  // namespace bustub
@@ -0,0 +1,322 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// optimistic_concurrency_test.cpp
+//
+// Identification: test/concurrency/optimistic_concurrency_test.cpp
+//
+// Copyright (c) 2015-2019, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>  // NOLINT
+#include <cstdio>
+#include <memory>
+#include <random>
+#include <string>
+#include <thread>  // NOLINT
+#include <vector>
+
+#include "buffer/buffer_pool_manager.h"
+#include "catalog/schema.h"
+#include "common/bustub_instance.h"
+#include "concurrency/transaction_manager.h"
+#include "gtest/gtest.h"
+#include "storage/disk/database_files.h"
+#include "storage/table/table_heap.h"
+#include "type/value_factory.h"
+
+namespace bustub {
+
+class OptimisticConcurrencyTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    disk_manager_ = std::make_unique<DiskManager>("test.db");
+    bpm_ = std::make_unique<BufferPoolManager>(50, disk_manager_.get());
+    lock_manager_ = std::make_unique<LockManager>(TwoPLMode::STRICT);
+    txn_mgr_ = std::make_unique<TransactionManager>(lock_manager_.get(), nullptr, ConcurrencyMode::OPTIMISTIC);
+
+    // Ten committed tuples with the values 0 to 9.
+    Transaction *txn = txn_mgr_->Begin();
+    table_ = std::make_unique<TableHeap>(bpm_.get(), lock_manager_.get(), nullptr, txn);
+    for (int i = 0; i < 10; i++) {
+      RID rid;
+      ASSERT_TRUE(table_->InsertTuple(MakeTuple(i), &rid, txn));
+      rids_.push_back(rid);
+    }
+    ASSERT_TRUE(txn_mgr_->Commit(txn));
+    delete txn;
+  }
+
+  void TearDown() override {
+    table_.reset();
+    disk_manager_->ShutDown();
+    RemoveDatabaseFiles("test.db");
+  }
+
+  Tuple MakeTuple(int value) { return Tuple({ValueFactory::GetIntegerValue(value)}, &schema_); }
+
+  /** @return the value of the tuple the transaction sees, or -1 if it sees none */
+  int Read(const RID &rid, Transaction *txn) {
+    Tuple tuple;
+    if (!table_->GetTuple(rid, &tuple, txn)) {
+      return -1;
+    }
+    return tuple.GetValue(&schema_, 0).GetAs<int32_t>();
+  }
+
+  /** @return the values the transaction sees in a scan */
+  std::vector<int> Scan(Transaction *txn) {
+    std::vector<int> values;
+    for (auto it = table_->Begin(txn); it != table_->End(); ++it) {
+      values.push_back(it->GetValue(&schema_, 0).GetAs<int32_t>());
+    }
+    return values;
+  }
+
+  Schema schema_{std::vector<Column>{Column{"a", TypeId::INTEGER}}};
+  std::unique_ptr<DiskManager> disk_manager_;
+  std::unique_ptr<BufferPoolManager> bpm_;
+  std::unique_ptr<LockManager> lock_manager_;
+  std::unique_ptr<TransactionManager> txn_mgr_;
+  std::unique_ptr<TableHeap> table_;
+  std::vector<RID> rids_;
+};
+
+// NOLINTNEXTLINE
+TEST_F(OptimisticConcurrencyTest, BufferedWritesTest) {
+  Transaction *writer = txn_mgr_->Begin();
+  ASSERT_TRUE(table_->UpdateTuple(MakeTuple(100), rids_[0], writer));
+  ASSERT_TRUE(table_->MarkDelete(rids_[1], writer));
+  RID new_rid;
+  ASSERT_TRUE(table_->InsertTuple(MakeTuple(200), &new_rid, writer));
+  EXPECT_FALSE(table_->UpdateTuple(MakeTuple(101), rids_[1], writer));
+
+  // The writer sees its own writes. The others do not see the buffered ones, nor can they read the new tuple.
+  EXPECT_EQ(100, Read(rids_[0], writer));
+  EXPECT_EQ(-1, Read(rids_[1], writer));
+  EXPECT_EQ(200, Read(new_rid, writer));
+  EXPECT_EQ((std::vector<int>{100, 2, 3, 4, 5, 6, 7, 8, 9, 200}), Scan(writer));
+  Transaction *reader = txn_mgr_->Begin();
+  EXPECT_EQ(0, Read(rids_[0], reader));
+  EXPECT_EQ(1, Read(rids_[1], reader));
+  Transaction *dirty_reader = txn_mgr_->Begin();
+  EXPECT_EQ(-1, Read(new_rid, dirty_reader));
+  EXPECT_EQ(TransactionState::ABORTED, dirty_reader->GetState());
+  txn_mgr_->Abort(dirty_reader);
+
+  // Once the writer committed, the reader's reads are out of date.
+  EXPECT_TRUE(txn_mgr_->Commit(writer));
+  EXPECT_FALSE(txn_mgr_->Commit(reader));
+  EXPECT_EQ(TransactionState::ABORTED, reader->GetState());
+
+  Transaction *late_reader = txn_mgr_->Begin();
+  EXPECT_EQ((std::vector<int>{100, 2, 3, 4, 5, 6, 7, 8, 9, 200}), Scan(late_reader));
+  EXPECT_TRUE(txn_mgr_->Commit(late_reader));
+  delete late_reader;
+  delete dirty_reader;
+  delete reader;
+  delete writer;
+}
+
+// NOLINTNEXTLINE
+TEST_F(OptimisticConcurrencyTest, ValidationTest) {
+  // A transaction whose reads were overwritten fails, and none of its writes are applied.
+  Transaction *txn0 = txn_mgr_->Begin();
+  Transaction *txn1 = txn_mgr_->Begin();
+  EXPECT_EQ(0, Read(rids_[0], txn0));
+  ASSERT_TRUE(table_->UpdateTuple(MakeTuple(300), rids_[2], txn0));
+  ASSERT_TRUE(table_->UpdateTuple(MakeTuple(100), rids_[0], txn1));
+  EXPECT_TRUE(txn_mgr_->Commit(txn1));
+  EXPECT_FALSE(txn_mgr_->Commit(txn0));
+
+  // Of two transactions that write the same tuple, the first to commit wins.
+  Transaction *txn2 = txn_mgr_->Begin();
+  Transaction *txn3 = txn_mgr_->Begin();
+  ASSERT_TRUE(table_->UpdateTuple(MakeTuple(101), rids_[0], txn2));
+  ASSERT_TRUE(table_->MarkDelete(rids_[0], txn3));
+  EXPECT_TRUE(txn_mgr_->Commit(txn2));
+  EXPECT_FALSE(txn_mgr_->Commit(txn3));
+
+  // Transactions on different tuples do not get in each other's way.
+  Transaction *txn4 = txn_mgr_->Begin();
+  Transaction *txn5 = txn_mgr_->Begin();
+  EXPECT_EQ(3, Read(rids_[3], txn4));
+  ASSERT_TRUE(table_->UpdateTuple(MakeTuple(104), rids_[4], txn4));
+  EXPECT_EQ(4, Read(rids_[4], txn5));
+  EXPECT_EQ(5, Read(rids_[5], txn5));
+  EXPECT_TRUE(txn_mgr_->Commit(txn5));
+  EXPECT_TRUE(txn_mgr_->Commit(txn4));
+
+  Transaction *reader = txn_mgr_->Begin();
+  EXPECT_EQ((std::vector<int>{101, 1, 2, 3, 104, 5, 6, 7, 8, 9}), Scan(reader));
+  EXPECT_TRUE(txn_mgr_->Commit(reader));
+  delete reader;
+  delete txn5;
+  delete txn4;
+  delete txn3;
+  delete txn2;
+  delete txn1;
+  delete txn0;
+}
+
+// NOLINTNEXTLINE
+TEST_F(OptimisticConcurrencyTest, AbortTest) {
+  Transaction *writer = txn_mgr_->Begin();
+  ASSERT_TRUE(table_->UpdateTuple(MakeTuple(100), rids_[0], writer));
+  ASSERT_TRUE(table_->MarkDelete(rids_[1], writer));
+  RID new_rid;
+  ASSERT_TRUE(table_->InsertTuple(MakeTuple(200), &new_rid, writer));
+  txn_mgr_->Abort(writer);
+
+  // Nothing of the writer is left, and the slot of its insert can be reused.
+  Transaction *reader = txn_mgr_->Begin();
+  EXPECT_EQ((std::vector<int>{0, 1, 2, 3, 4, 5, 6, 7, 8, 9}), Scan(reader));
+  EXPECT_TRUE(txn_mgr_->Commit(reader));
+  Transaction *inserter = txn_mgr_->Begin();
+  RID reused_rid;
+  ASSERT_TRUE(table_->InsertTuple(MakeTuple(300), &reused_rid, inserter));
+  EXPECT_EQ(new_rid, reused_rid);
+  EXPECT_TRUE(txn_mgr_->Commit(inserter));
+  delete inserter;
+  delete reader;
+  delete writer;
+}
+
+// NOLINTNEXTLINE
+TEST_F(OptimisticConcurrencyTest, FailedApplyTest) {
+  Schema schema{std::vector<Column>{Column{"a", TypeId::VARCHAR, PAGE_SIZE}}};
+  auto make_tuple = [&schema](size_t length) {
+    return Tuple({ValueFactory::GetVarcharValue(std::string(length, 'a'))}, &schema);
+  };
+  auto read = [&schema](TableHeap *table, const RID &rid, Transaction *txn) {
+    Tuple tuple;
+    EXPECT_TRUE(table->GetTuple(rid, &tuple, txn));
+    return tuple.GetValue(&schema, 0).ToString().size();
+  };
+
+  // Two short tuples on a page that is filled up with long ones.
+  Transaction *txn = txn_mgr_->Begin();
+  TableHeap table(bpm_.get(), lock_manager_.get(), nullptr, txn);
+  RID rid0;
+  RID rid1;
+  ASSERT_TRUE(table.InsertTuple(make_tuple(1), &rid0, txn));
+  ASSERT_TRUE(table.InsertTuple(make_tuple(1), &rid1, txn));
+  RID rid;
+  do {
+    ASSERT_TRUE(table.InsertTuple(make_tuple(500), &rid, txn));
+  } while (rid.GetPageId() == rid0.GetPageId());
+  ASSERT_TRUE(txn_mgr_->Commit(txn));
+
+  // The second update no longer fits on the page when it is applied, which rolls back the first one.
+  Transaction *writer = txn_mgr_->Begin();
+  ASSERT_TRUE(table.UpdateTuple(make_tuple(2), rid0, writer));
+  ASSERT_TRUE(table.UpdateTuple(make_tuple(PAGE_SIZE / 2), rid1, writer));
+  EXPECT_FALSE(txn_mgr_->Commit(writer));
+  EXPECT_EQ(TransactionState::ABORTED, writer->GetState());
+  EXPECT_TRUE(writer->GetWriteSet()->empty());
+
+  Transaction *reader = txn_mgr_->Begin();
+  EXPECT_EQ(1, read(&table, rid0, reader));
+  EXPECT_EQ(1, read(&table, rid1, reader));
+  EXPECT_TRUE(txn_mgr_->Commit(reader));
+  delete reader;
+  delete writer;
+  delete txn;
+}
+
+/**
+ * Run short transactions over a table of 1000 rows on 1 to 8 threads, with two phase locking and optimistically, and
+ * print the number of committed transactions per second. Each transaction reads four random rows and increments two
+ * of them, so the rows add up to twice the number of committed transactions. Logging is on in both modes, since
+ * transactions only lock with logging on.
+ */
+// NOLINTNEXTLINE
+TEST(OptimisticConcurrencyBenchmarkTest, ThroughputTest) {
+  const int num_rows = 1000;
+  const auto duration = std::chrono::milliseconds(100);
+  Schema schema{std::vector<Column>{Column{"a", TypeId::INTEGER}}};
+  auto make_tuple = [&](int value) { return Tuple({ValueFactory::GetIntegerValue(value)}, &schema); };
+
+  for (ConcurrencyMode mode : {ConcurrencyMode::TWO_PHASE_LOCKING, ConcurrencyMode::OPTIMISTIC}) {
+    auto *bustub_instance = new BustubInstance("test.db", mode);
+    TransactionManager *txn_mgr = bustub_instance->transaction_manager_;
+    bustub_instance->log_manager_->RunFlushThread();
+
+    Transaction *txn = txn_mgr->Begin();
+    TableHeap table(bustub_instance->buffer_pool_manager_, bustub_instance->lock_manager_,
+                    bustub_instance->log_manager_, txn);
+    std::vector<RID> rids(num_rows);
+    for (int i = 0; i < num_rows; i++) {
+      ASSERT_TRUE(table.InsertTuple(make_tuple(0), &rids[i], txn));
+    }
+    ASSERT_TRUE(txn_mgr->Commit(txn));
+    delete txn;
+
+    printf("%s\n", mode == ConcurrencyMode::OPTIMISTIC ? "optimistic" : "two phase locking");
+    uint64_t total_committed = 0;
+    for (size_t num_threads = 1; num_threads <= 8; num_threads *= 2) {
+      std::atomic<bool> stop{false};
+      std::atomic<uint64_t> committed{0};
+      std::atomic<uint64_t> aborted{0};
+      std::vector<std::thread> threads;
+      for (size_t tid = 0; tid < num_threads; tid++) {
+        threads.emplace_back([&, tid] {
+          std::mt19937 rng(tid);
+          std::uniform_int_distribution<int> pick_row(0, num_rows - 1);
+          while (!stop) {
+            Transaction *txn = txn_mgr->Begin();
+            bool ok = true;
+            for (int i = 0; i < 4 && ok; i++) {
+              const RID &rid = rids[pick_row(rng)];
+              Tuple tuple;
+              ok = table.GetTuple(rid, &tuple, txn);
+              if (ok && i % 2 == 1) {
+                ok = table.UpdateTuple(make_tuple(tuple.GetValue(&schema, 0).GetAs<int32_t>() + 1), rid, txn);
+              }
+            }
+            if (!ok || txn->GetState() == TransactionState::ABORTED) {
+              txn_mgr->Abort(txn);
+              aborted++;
+            } else if (txn_mgr->Commit(txn)) {
+              committed++;
+            } else {
+              aborted++;
+            }
+            delete txn;
+          }
+        });
+      }
+      auto start = std::chrono::steady_clock::now();
+      std::this_thread::sleep_for(duration);
+      stop = true;
+      for (auto &thread : threads) {
+        thread.join();
+      }
+      std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+      printf("  %2zu threads: %9.0f txns/s, %5.1f%% aborted\n", num_threads, committed / elapsed.count(),
+             100.0 * aborted / std::max<uint64_t>(committed + aborted, 1));
+      total_committed += committed;
+    }
+
+    // Every committed increment is there, and no other.
+    txn = txn_mgr->Begin();
+    int64_t sum = 0;
+    for (const RID &rid : rids) {
+      Tuple tuple;
+      ASSERT_TRUE(table.GetTuple(rid, &tuple, txn));
+      sum += tuple.GetValue(&schema, 0).GetAs<int32_t>();
+    }
+    ASSERT_TRUE(txn_mgr->Commit(txn));
+    delete txn;
+    EXPECT_EQ(2 * total_committed, static_cast<uint64_t>(sum));
+
+    delete bustub_instance;
+    RemoveDatabaseFiles("test.db");
+  }
+}
+
+}  // namespace bustub
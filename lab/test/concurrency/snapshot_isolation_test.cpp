@@ -0,0 +1,204 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// snapshot_isolation_test.cpp
+//
+// Identification: test/concurrency/snapshot_isolation_test.cpp
+//
+// Copyright (c) 2015-2019, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include <cstdio>
+#include <memory>
+#include <vector>
+
+#include "buffer/buffer_pool_manager.h"
+#include "catalog/schema.h"
+#include "concurrency/transaction_manager.h"
+#include "gtest/gtest.h"
+#include "storage/disk/database_files.h"
+#include "storage/table/table_heap.h"
+#include "type/value_factory.h"
+
+namespace bustub {
+
+class SnapshotIsolationTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    disk_manager_ = std::make_unique<DiskManager>("test.db");
+    bpm_ = std::make_unique<BufferPoolManager>(50, disk_manager_.get());
+    lock_manager_ = std::make_unique<LockManager>(TwoPLMode::STRICT);
+    txn_mgr_ = std::make_unique<TransactionManager>(lock_manager_.get(), nullptr, ConcurrencyMode::SNAPSHOT_ISOLATION);
+
+    // Ten committed tuples with the values 0 to 9.
+    Transaction *txn = txn_mgr_->Begin();
+    table_ = std::make_unique<TableHeap>(bpm_.get(), lock_manager_.get(), nullptr, txn);
+    for (int i = 0; i < 10; i++) {
+      RID rid;
+      ASSERT_TRUE(table_->InsertTuple(MakeTuple(i), &rid, txn));
+      rids_.push_back(rid);
+    }
+    txn_mgr_->Commit(txn);
+    delete txn;
+    txn_mgr_->CollectGarbage();
+  }
+
+  void TearDown() override {
+    disk_manager_->ShutDown();
+    RemoveDatabaseFiles("test.db");
+  }
+
+  Tuple MakeTuple(int value) { return Tuple({ValueFactory::GetIntegerValue(value)}, &schema_); }
+
+  /** @return the value of the tuple the transaction sees, or -1 if it sees none */
+  int Read(const RID &rid, Transaction *txn) {
+    Tuple tuple;
+    if (!table_->GetTuple(rid, &tuple, txn)) {
+      return -1;
+    }
+    return tuple.GetValue(&schema_, 0).GetAs<int32_t>();
+  }
+
+  /** @return the values the transaction sees in a scan */
+  std::vector<int> Scan(Transaction *txn) {
+    std::vector<int> values;
+    for (auto it = table_->Begin(txn); it != table_->End(); ++it) {
+      values.push_back(it->GetValue(&schema_, 0).GetAs<int32_t>());
+    }
+    return values;
+  }
+
+  Schema schema_{std::vector<Column>{Column{"a", TypeId::INTEGER}}};
+  std::unique_ptr<DiskManager> disk_manager_;
+  std::unique_ptr<BufferPoolManager> bpm_;
+  std::unique_ptr<LockManager> lock_manager_;
+  std::unique_ptr<TransactionManager> txn_mgr_;
+  std::unique_ptr<TableHeap> table_;
+  std::vector<RID> rids_;
+};
+
+// NOLINTNEXTLINE
+TEST_F(SnapshotIsolationTest, SnapshotReadTest) {
+  Transaction *reader = txn_mgr_->Begin();
+  Transaction *writer = txn_mgr_->Begin();
+  ASSERT_TRUE(table_->UpdateTuple(MakeTuple(100), rids_[0], writer));
+  ASSERT_TRUE(table_->MarkDelete(rids_[1], writer));
+  RID new_rid;
+  ASSERT_TRUE(table_->InsertTuple(MakeTuple(200), &new_rid, writer));
+
+  // The writer sees its own writes, the reader sees none of them.
+  EXPECT_EQ(100, Read(rids_[0], writer));
+  EXPECT_EQ(-1, Read(rids_[1], writer));
+  EXPECT_EQ(200, Read(new_rid, writer));
+  EXPECT_EQ(0, Read(rids_[0], reader));
+  EXPECT_EQ(1, Read(rids_[1], reader));
+  EXPECT_EQ(-1, Read(new_rid, reader));
+  EXPECT_EQ((std::vector<int>{0, 1, 2, 3, 4, 5, 6, 7, 8, 9}), Scan(reader));
+
+  // Nor after the writer committed and the deleted tuple is gone from its page.
+  txn_mgr_->Commit(writer);
+  EXPECT_EQ((std::vector<int>{0, 1, 2, 3, 4, 5, 6, 7, 8, 9}), Scan(reader));
+  EXPECT_EQ(1, Read(rids_[1], reader));
+
+  Transaction *late_reader = txn_mgr_->Begin();
+  EXPECT_EQ((std::vector<int>{100, 2, 3, 4, 5, 6, 7, 8, 9, 200}), Scan(late_reader));
+  txn_mgr_->Commit(late_reader);
+  txn_mgr_->Commit(reader);
+
+  delete late_reader;
+  delete reader;
+  delete writer;
+}
+
+// NOLINTNEXTLINE
+TEST_F(SnapshotIsolationTest, FirstUpdaterWinsTest) {
+  Transaction *txn0 = txn_mgr_->Begin();
+  Transaction *txn1 = txn_mgr_->Begin();
+  ASSERT_TRUE(table_->UpdateTuple(MakeTuple(100), rids_[0], txn0));
+  // The tuple has an uncommitted change.
+  EXPECT_FALSE(table_->UpdateTuple(MakeTuple(101), rids_[0], txn1));
+  EXPECT_EQ(TransactionState::ABORTED, txn1->GetState());
+  txn_mgr_->Abort(txn1);
+  txn_mgr_->Commit(txn0);
+
+  // The tuple has a change committed after the snapshot was taken.
+  Transaction *txn2 = txn_mgr_->Begin();
+  Transaction *txn3 = txn_mgr_->Begin();
+  ASSERT_TRUE(table_->UpdateTuple(MakeTuple(102), rids_[1], txn2));
+  txn_mgr_->Commit(txn2);
+  EXPECT_FALSE(table_->MarkDelete(rids_[1], txn3));
+  EXPECT_EQ(TransactionState::ABORTED, txn3->GetState());
+  txn_mgr_->Abort(txn3);
+
+  Transaction *reader = txn_mgr_->Begin();
+  EXPECT_EQ(100, Read(rids_[0], reader));
+  EXPECT_EQ(102, Read(rids_[1], reader));
+  txn_mgr_->Commit(reader);
+  delete reader;
+  delete txn3;
+  delete txn2;
+  delete txn1;
+  delete txn0;
+}
+
+// NOLINTNEXTLINE
+TEST_F(SnapshotIsolationTest, AbortTest) {
+  Transaction *reader = txn_mgr_->Begin();
+  Transaction *writer = txn_mgr_->Begin();
+  ASSERT_TRUE(table_->UpdateTuple(MakeTuple(100), rids_[0], writer));
+  ASSERT_TRUE(table_->UpdateTuple(MakeTuple(101), rids_[0], writer));
+  ASSERT_TRUE(table_->MarkDelete(rids_[1], writer));
+  RID new_rid;
+  ASSERT_TRUE(table_->InsertTuple(MakeTuple(200), &new_rid, writer));
+  txn_mgr_->Abort(writer);
+
+  EXPECT_EQ((std::vector<int>{0, 1, 2, 3, 4, 5, 6, 7, 8, 9}), Scan(reader));
+  txn_mgr_->Commit(reader);
+  Transaction *late_reader = txn_mgr_->Begin();
+  EXPECT_EQ((std::vector<int>{0, 1, 2, 3, 4, 5, 6, 7, 8, 9}), Scan(late_reader));
+  txn_mgr_->Commit(late_reader);
+
+  // Nothing of the writer is left, and the slot of its insert can be reused.
+  EXPECT_EQ(0, txn_mgr_->GetVersionStore()->GetVersionCount());
+  Transaction *inserter = txn_mgr_->Begin();
+  RID reused_rid;
+  ASSERT_TRUE(table_->InsertTuple(MakeTuple(300), &reused_rid, inserter));
+  EXPECT_EQ(new_rid, reused_rid);
+  txn_mgr_->Commit(inserter);
+  delete inserter;
+  delete late_reader;
+  delete reader;
+  delete writer;
+}
+
+// NOLINTNEXTLINE
+TEST_F(SnapshotIsolationTest, GarbageCollectionTest) {
+  Transaction *reader = txn_mgr_->Begin();
+  for (int i = 0; i < 5; i++) {
+    Transaction *writer = txn_mgr_->Begin();
+    ASSERT_TRUE(table_->UpdateTuple(MakeTuple(100 + i), rids_[0], writer));
+    ASSERT_TRUE(table_->UpdateTuple(MakeTuple(100 + i), rids_[1], writer));
+    txn_mgr_->Commit(writer);
+    delete writer;
+  }
+  // The reader needs the first version of each tuple, the versions in between are seen by nobody.
+  EXPECT_EQ(10, txn_mgr_->GetVersionStore()->GetVersionCount());
+  EXPECT_EQ(8, txn_mgr_->CollectGarbage());
+  EXPECT_EQ(0, Read(rids_[0], reader));
+  EXPECT_EQ(1, Read(rids_[1], reader));
+  txn_mgr_->Commit(reader);
+
+  // Once the reader is gone, every snapshot sees the tuples in the pages.
+  EXPECT_EQ(2, txn_mgr_->CollectGarbage());
+  EXPECT_EQ(0, txn_mgr_->GetVersionStore()->GetVersionCount());
+  Transaction *late_reader = txn_mgr_->Begin();
+  EXPECT_EQ(104, Read(rids_[0], late_reader));
+  EXPECT_EQ(104, Read(rids_[1], late_reader));
+  txn_mgr_->Commit(late_reader);
+  delete late_reader;
+  delete reader;
+}
+
+}  // namespace bustub
@@ -16,6 +16,7 @@
 #include "buffer/buffer_pool_manager.h"
 #include "common/logger.h"
 #include "gtest/gtest.h"
+#include "storage/disk/database_files.h"
 #include "storage/disk/disk_manager.h"
 #include "storage/page/hash_table_block_page.h"
 #include "storage/page/hash_table_header_page.h"
@@ -56,7 +57,7 @@ TEST(HashTablePageTest, HeaderPageSampleTest) {
   // unpin the header page now that we are done
   bpm->UnpinPage(header_page_id, true, nullptr);
   disk_manager->ShutDown();
-  remove("test.db");
+  RemoveDatabaseFiles("test.db");
   delete disk_manager;
   delete bpm;
 }
@@ -109,7 +110,7 @@ TEST(HashTablePageTest, BlockPageSampleTest) {
     // unpin the header page now that we are done
     bpm->UnpinPage(block_page_id, true, nullptr);
     disk_manager->ShutDown();
-    remove("test.db");
+    RemoveDatabaseFiles("test.db");
     delete disk_manager;
     delete bpm;
   }
@@ -17,6 +17,7 @@
 #include "container/hash/linear_probe_hash_table.h"
 #include "gtest/gtest.h"
 #include "murmur3/MurmurHash3.h"
+#include "storage/disk/database_files.h"
 
 namespace bustub {
 
@@ -26,13 +27,13 @@ TEST(HashTableTest, SampleTest) {
   auto *disk_manager = new DiskManager("test.db");
   auto *bpm = new BufferPoolManager(50, disk_manager);
 
-  LinearProbeHashTable<int, int, IntComparator> ht("blah", bpm, IntComparator(), 1000, HashFunction<int>());
+  auto *ht = new LinearProbeHashTable<int, int, IntComparator>("blah", bpm, IntComparator(), 1000, HashFunction<int>());
 
   // insert a few values
   for (int i = 0; i < 5; i++) {
-    ht.Insert(nullptr, i, i);
+    ht->Insert(nullptr, i, i);
     std::vector<int> res;
-    ht.GetValue(nullptr, i, &res);
+    ht->GetValue(nullptr, i, &res);
     EXPECT_EQ(1, res.size()) << "Failed to insert " << i << std::endl;
     EXPECT_EQ(i, res[0]);
   }
@@ -40,7 +41,7 @@ TEST(HashTableTest, SampleTest) {
   // check if the inserted values are all there
   for (int i = 0; i < 5; i++) {
     std::vector<int> res;
-    ht.GetValue(nullptr, i, &res);
+    ht->GetValue(nullptr, i, &res);
     EXPECT_EQ(1, res.size()) << "Failed to keep " << i << std::endl;
     EXPECT_EQ(i, res[0]);
   }
@@ -49,13 +50,13 @@ TEST(HashTableTest, SampleTest) {
   for (int i = 0; i < 5; i++) {
     if (i == 0) {
       // duplicate values for the same key are not allowed
-      EXPECT_FALSE(ht.Insert(nullptr, i, 2 * i));
+      EXPECT_FALSE(ht->Insert(nullptr, i, 2 * i));
     } else {
-      EXPECT_TRUE(ht.Insert(nullptr, i, 2 * i));
+      EXPECT_TRUE(ht->Insert(nullptr, i, 2 * i));
     }
-    ht.Insert(nullptr, i, 2 * i);
+    ht->Insert(nullptr, i, 2 * i);
     std::vector<int> res;
-    ht.GetValue(nullptr, i, &res);
+    ht->GetValue(nullptr, i, &res);
     if (i == 0) {
       // duplicate values for the same key are not allowed
       EXPECT_EQ(1, res.size());
@@ -73,14 +74,14 @@ TEST(HashTableTest, SampleTest) {
 
   // look for a key that does not exist
   std::vector<int> res;
-  ht.GetValue(nullptr, 20, &res);
+  ht->GetValue(nullptr, 20, &res);
   EXPECT_EQ(0, res.size());
 
   // delete some values
   for (int i = 0; i < 5; i++) {
-    EXPECT_TRUE(ht.Remove(nullptr, i, i));
+    EXPECT_TRUE(ht->Remove(nullptr, i, i));
     std::vector<int> res;
-    ht.GetValue(nullptr, i, &res);
+    ht->GetValue(nullptr, i, &res);
     if (i == 0) {
       // (0, 0) is the only pair with key 0
       EXPECT_EQ(0, res.size());
@@ -94,13 +95,15 @@ TEST(HashTableTest, SampleTest) {
   for (int i = 0; i < 5; i++) {
     if (i == 0) {
       // (0, 0) has been deleted
-      EXPECT_FALSE(ht.Remove(nullptr, i, 2 * i));
+      EXPECT_FALSE(ht->Remove(nullptr, i, 2 * i));
     } else {
-      EXPECT_TRUE(ht.Remove(nullptr, i, 2 * i));
+      EXPECT_TRUE(ht->Remove(nullptr, i, 2 * i));
     }
   }
+  // The hash table gives back the rest of its extent, so it goes before the disk manager.
+  delete ht;
   disk_manager->ShutDown();
-  remove("test.db");
+  RemoveDatabaseFiles("test.db");
   delete disk_manager;
   delete bpm;
 }
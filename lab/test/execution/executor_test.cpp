@@ -31,6 +31,7 @@
 #include "execution/expressions/constant_value_expression.h"
 #include "execution/plans/seq_scan_plan.h"
 #include "gtest/gtest.h"
+#include "storage/disk/database_files.h"
 #include "type/value_factory.h"
 
 namespace bustub {
@@ -59,7 +60,7 @@ class ExecutorTest : public ::testing::Test {
     txn_mgr_->Commit(txn_);
     // Shut down the disk manager and clean up the transaction.
     disk_manager_->ShutDown();
-    remove("executor_test.db");
+    RemoveDatabaseFiles("executor_test.db");
     delete txn_;
   };
 
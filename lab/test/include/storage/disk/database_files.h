@@ -0,0 +1,53 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// database_files.h
+//
+// Identification: test/include/storage/disk/database_files.h
+//
+// Copyright (c) 2015-2019, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+#include <dirent.h>
+
+#include <cstdio>
+#include <string>
+#include <vector>
+
+namespace bustub {
+
+/**
+ * Remove a database file and everything the DiskManager keeps next to it: the free-space map and every log segment,
+ * spares included. Tests call this before and after they run, so that none of them recovers the log of another.
+ * @param db_file the database file, e.g. "test.db"
+ */
+inline void RemoveDatabaseFiles(const std::string &db_file) {
+  std::string base = db_file.substr(0, db_file.rfind('.'));
+  remove(db_file.c_str());
+  remove((base + ".fsm").c_str());
+
+  std::string::size_type slash = base.rfind('/');
+  std::string dir_name = slash == std::string::npos ? "./" : base.substr(0, slash + 1);
+  std::string prefix = base.substr(slash == std::string::npos ? 0 : slash + 1) + ".log.";
+  DIR *dir = opendir(dir_name.c_str());
+  if (dir == nullptr) {
+    return;
+  }
+  std::vector<std::string> segments;
+  while (dirent *entry = readdir(dir)) {
+    std::string name = entry->d_name;
+    if (name.compare(0, prefix.size(), prefix) == 0) {
+      segments.push_back(dir_name + name);
+    }
+  }
+  closedir(dir);
+  for (const auto &segment : segments) {
+    remove(segment.c_str());
+  }
+}
+
+}  // namespace bustub
@@ -0,0 +1,78 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// group_commit_test.cpp
+//
+// Identification: test/recovery/group_commit_test.cpp
+//
+// Copyright (c) 2015-2019, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include <atomic>
+#include <chrono>  // NOLINT
+#include <cstdio>
+#include <thread>  // NOLINT
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "recovery/log_manager.h"
+#include "storage/disk/database_files.h"
+#include "storage/disk/disk_manager.h"
+
+namespace bustub {
+
+// 64 clients commit at the same time. Every commit waits until its record is on disk, and the flush thread serves
+// many of them with a single write and sync.
+TEST(GroupCommitTest, ConcurrentCommitTest) {
+  const size_t num_clients = 64;
+  const size_t commits_per_client = 20;
+
+  for (auto window : {std::chrono::microseconds(0), std::chrono::microseconds(500)}) {
+    RemoveDatabaseFiles("test.db");
+    auto *disk_manager = new DiskManager("test.db");
+    auto *log_manager = new LogManager(disk_manager);
+    log_manager->SetGroupCommitWindow(window);
+    log_manager->RunFlushThread();
+
+    std::atomic<uint64_t> total_latency_us{0};
+    std::vector<std::thread> clients;
+    auto start = std::chrono::steady_clock::now();
+    for (size_t client = 0; client < num_clients; client++) {
+      clients.emplace_back([log_manager, client, &total_latency_us] {
+        for (size_t i = 0; i < commits_per_client; i++) {
+          auto commit_start = std::chrono::steady_clock::now();
+          LogRecord log_record(static_cast<txn_id_t>(client), INVALID_LSN, LogRecordType::COMMIT);
+          lsn_t lsn = log_manager->AppendLogRecord(&log_record);
+          log_manager->WaitForFlush(lsn);
+          EXPECT_LE(lsn, log_manager->GetPersistentLSN());
+          total_latency_us += std::chrono::duration_cast<std::chrono::microseconds>(
+                                  std::chrono::steady_clock::now() - commit_start)
+                                  .count();
+        }
+      });
+    }
+    for (auto &client : clients) {
+      client.join();
+    }
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    log_manager->StopFlushThread();
+
+    size_t num_commits = num_clients * commits_per_client;
+    EXPECT_EQ(static_cast<lsn_t>(num_commits - 1), log_manager->GetPersistentLSN());
+    // Far fewer syncs than commits.
+    EXPECT_GT(num_commits / 2, static_cast<size_t>(disk_manager->GetNumFlushes()));
+    printf("window %4ld us: %8.0f commits/s, %6.0f us average latency, %4.1f commits per flush\n",
+           static_cast<long>(window.count()), num_commits / elapsed.count(),  // NOLINT
+           static_cast<double>(total_latency_us) / num_commits,
+           static_cast<double>(num_commits) / disk_manager->GetNumFlushes());
+
+    delete log_manager;
+    disk_manager->ShutDown();
+    delete disk_manager;
+    RemoveDatabaseFiles("test.db");
+  }
+}
+
+}  // namespace bustub
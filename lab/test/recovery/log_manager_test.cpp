@@ -0,0 +1,136 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// log_manager_test.cpp
+//
+// Identification: test/recovery/log_manager_test.cpp
+//
+// Copyright (c) 2015-2019, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include <chrono>  // NOLINT
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <thread>  // NOLINT
+#include <vector>
+
+#include "catalog/schema.h"
+#include "gtest/gtest.h"
+#include "recovery/log_manager.h"
+#include "storage/disk/database_files.h"
+#include "storage/disk/disk_manager.h"
+#include "storage/table/tuple.h"
+
+namespace bustub {
+
+// Many writers append at once. Every record must reach the log file exactly once, in LSN order and intact, and the
+// append throughput is printed for each number of writers.
+TEST(LogManagerTest, ConcurrentAppendTest) {
+  const int records_per_thread = 20000;
+  const int header_size = 20;
+
+  for (int num_threads : {1, 2, 4, 8, 16}) {
+    RemoveDatabaseFiles("test.db");
+    auto *disk_manager = new DiskManager("test.db");
+    auto *log_manager = new LogManager(disk_manager);
+    log_manager->RunFlushThread();
+
+    std::vector<std::thread> threads;
+    auto start = std::chrono::steady_clock::now();
+    for (int thread = 0; thread < num_threads; thread++) {
+      threads.emplace_back([log_manager, thread] {
+        lsn_t prev_lsn = INVALID_LSN;
+        for (int i = 0; i < records_per_thread; i++) {
+          // Alternate record sizes, and remember the writer and the sequence number in the record.
+          if (i % 2 == 0) {
+            LogRecord log_record(thread, prev_lsn, LogRecordType::NEWPAGE, thread, i);
+            prev_lsn = log_manager->AppendLogRecord(&log_record);
+          } else {
+            LogRecord log_record(thread, prev_lsn, LogRecordType::BEGIN);
+            prev_lsn = log_manager->AppendLogRecord(&log_record);
+          }
+        }
+      });
+    }
+    for (auto &thread : threads) {
+      thread.join();
+    }
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    lsn_t last_lsn = log_manager->GetNextLSN() - 1;
+    log_manager->WaitForFlush(last_lsn);
+    log_manager->StopFlushThread();
+    EXPECT_EQ(last_lsn, log_manager->GetPersistentLSN());
+    printf("%2d writers: %10.0f appends/s\n", num_threads, num_threads * records_per_thread / elapsed.count());
+
+    // Read the log back.
+    int num_records = num_threads * records_per_thread;
+    int log_size = num_records / 2 * (header_size + 2 * static_cast<int>(sizeof(page_id_t))) +
+                   num_records / 2 * header_size;
+    std::vector<char> log(log_size);
+    ASSERT_TRUE(disk_manager->ReadLog(log.data(), log_size, 0));
+    std::vector<lsn_t> prev_lsns(num_threads, INVALID_LSN);
+    std::vector<int> next_sequence(num_threads, 0);
+    int pos = 0;
+    for (lsn_t lsn = 0; lsn < num_records; lsn++) {
+      int32_t header[5];
+      memcpy(header, log.data() + pos, sizeof(header));
+      int32_t size = header[0];
+      txn_id_t thread = header[2];
+      ASSERT_EQ(lsn, header[1]);
+      ASSERT_GE(thread, 0);
+      ASSERT_LT(thread, num_threads);
+      // Each writer's records chain up through prev_lsn.
+      ASSERT_EQ(prev_lsns[thread], header[3]);
+      prev_lsns[thread] = lsn;
+      if (static_cast<LogRecordType>(header[4]) == LogRecordType::NEWPAGE) {
+        page_id_t page_ids[2];
+        memcpy(page_ids, log.data() + pos + header_size, sizeof(page_ids));
+        ASSERT_EQ(thread, page_ids[0]);
+        ASSERT_EQ(next_sequence[thread], page_ids[1]);
+      } else {
+        ASSERT_EQ(LogRecordType::BEGIN, static_cast<LogRecordType>(header[4]));
+      }
+      next_sequence[thread]++;
+      pos += size;
+    }
+    EXPECT_EQ(log_size, pos);
+
+    delete log_manager;
+    disk_manager->ShutDown();
+    delete disk_manager;
+    RemoveDatabaseFiles("test.db");
+  }
+}
+
+// A compressed record is smaller in the log, but the record the caller appended keeps its own size.
+TEST(LogManagerTest, CompressedAppendTest) {
+  RemoveDatabaseFiles("test.db");
+  auto *disk_manager = new DiskManager("test.db");
+  auto *log_manager = new LogManager(disk_manager);
+  log_manager->SetLogCompression(true);
+  log_manager->RunFlushThread();
+
+  Schema schema({Column("a", TypeId::VARCHAR, 300)});
+  Tuple tuple({Value(TypeId::VARCHAR, std::string(200, 'x'))}, &schema);
+  LogRecord log_record(0, INVALID_LSN, LogRecordType::INSERT, RID(0, 0), tuple);
+  int32_t size = log_record.GetSize();
+  lsn_t lsn = log_manager->AppendLogRecord(&log_record);
+  EXPECT_EQ(size, log_record.GetSize());
+  EXPECT_EQ(lsn, log_record.GetLSN());
+
+  log_manager->WaitForFlush(lsn);
+  log_manager->StopFlushThread();
+  int32_t logged_size;
+  ASSERT_TRUE(disk_manager->ReadLog(reinterpret_cast<char *>(&logged_size), sizeof(logged_size), 0));
+  EXPECT_LT(logged_size, size);
+
+  delete log_manager;
+  disk_manager->ShutDown();
+  delete disk_manager;
+  RemoveDatabaseFiles("test.db");
+}
+
+}  // namespace bustub
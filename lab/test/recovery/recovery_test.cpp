@@ -10,7 +10,13 @@
 //
 //===----------------------------------------------------------------------===//
 
+#include <algorithm>
+#include <atomic>
+#include <set>
 #include <string>
+#include <thread>  // NOLINT
+#include <tuple>
+#include <utility>
 #include <vector>
 
 #include "common/bustub_instance.h"
@@ -20,6 +26,7 @@
 #include "gtest/gtest.h"
 #include "logging/common.h"
 #include "recovery/log_recovery.h"
+#include "storage/disk/database_files.h"
 #include "storage/table/table_heap.h"
 #include "storage/table/table_iterator.h"
 #include "storage/table/tuple.h"
@@ -28,8 +35,7 @@ namespace bustub {
 
 // NOLINTNEXTLINE
 TEST(RecoveryTest, RedoTest) {
-  remove("test.db");
-  remove("test.log");
+  RemoveDatabaseFiles("test.db");
 
   BustubInstance *bustub_instance = new BustubInstance("test.db");
 
@@ -117,14 +123,12 @@ TEST(RecoveryTest, RedoTest) {
 
   delete bustub_instance;
   LOG_INFO("Tearing down the system..");
-  remove("test.db");
-  remove("test.log");
+  RemoveDatabaseFiles("test.db");
 }
 
 // NOLINTNEXTLINE
 TEST(RecoveryTest, UndoTest) {
-  remove("test.db");
-  remove("test.log");
+  RemoveDatabaseFiles("test.db");
   BustubInstance *bustub_instance = new BustubInstance("test.db");
 
   ASSERT_FALSE(enable_logging);
@@ -201,14 +205,12 @@ TEST(RecoveryTest, UndoTest) {
 
   delete bustub_instance;
   LOG_INFO("Tearing down the system..");
-  remove("test.db");
-  remove("test.log");
+  RemoveDatabaseFiles("test.db");
 }
 
 // NOLINTNEXTLINE
 TEST(RecoveryTest, CheckpointTest) {
-  remove("test.db");
-  remove("test.log");
+  RemoveDatabaseFiles("test.db");
   BustubInstance *bustub_instance = new BustubInstance("test.db");
 
   EXPECT_FALSE(enable_logging);
@@ -311,7 +313,484 @@ TEST(RecoveryTest, CheckpointTest) {
   delete bustub_instance;
 
   LOG_INFO("Tearing down the system..");
-  remove("test.db");
-  remove("test.log");
+  RemoveDatabaseFiles("test.db");
+}
+
+// NOLINTNEXTLINE
+TEST(RecoveryTest, FuzzyCheckpointTest) {
+  RemoveDatabaseFiles("test.db");
+  BustubInstance *bustub_instance = new BustubInstance("test.db");
+  bustub_instance->log_manager_->RunFlushThread();
+  ASSERT_TRUE(enable_logging);
+
+  Transaction *txn = bustub_instance->transaction_manager_->Begin();
+  auto *test_table = new TableHeap(bustub_instance->buffer_pool_manager_, bustub_instance->lock_manager_,
+                                   bustub_instance->log_manager_, txn);
+  bustub_instance->transaction_manager_->Commit(txn);
+
+  Column col1{"a", TypeId::VARCHAR, 20};
+  Column col2{"b", TypeId::SMALLINT};
+  std::vector<Column> cols{col1, col2};
+  Schema schema{cols};
+  Tuple tuple = ConstructTuple(&schema);
+
+  // txn1 is still running when the checkpoint is taken
+  Transaction *txn1 = bustub_instance->transaction_manager_->Begin();
+  for (int i = 0; i < 200; i++) {
+    RID rid;
+    ASSERT_TRUE(test_table->InsertTuple(tuple, &rid, txn1));
+  }
+  lsn_t txn1_last_lsn = txn1->GetPrevLSN();
+  lsn_t checkpoint_lsn = bustub_instance->log_manager_->GetNextLSN();
+
+  bustub_instance->checkpoint_manager_->BeginCheckpoint();
+  EXPECT_EQ(checkpoint_lsn, bustub_instance->disk_manager_->GetCheckpointLSN());
+
+  // transactions keep going while the dirty pages are written
+  Transaction *txn2 = bustub_instance->transaction_manager_->Begin();
+  for (int i = 0; i < 200; i++) {
+    RID rid;
+    ASSERT_TRUE(test_table->InsertTuple(tuple, &rid, txn2));
+  }
+  bustub_instance->transaction_manager_->Commit(txn2);
+  bustub_instance->checkpoint_manager_->EndCheckpoint();
+  bustub_instance->transaction_manager_->Commit(txn1);
+
+  // find the END_CHECKPOINT record; a record starts with its size and its lsn
+  const int header_size = 20;
+  auto *log_data = new char[LOG_BUFFER_SIZE];
+  int offset = bustub_instance->disk_manager_->GetLogOffset(checkpoint_lsn);
+  int pos = 0;
+  bool found = false;
+  while (!found && bustub_instance->disk_manager_->ReadLog(log_data, LOG_BUFFER_SIZE, offset)) {
+    pos = 0;
+    while (pos + header_size <= LOG_BUFFER_SIZE) {
+      auto *header = reinterpret_cast<int32_t *>(log_data + pos);
+      if (header[0] <= 0 || pos + header[0] > LOG_BUFFER_SIZE) {
+        break;
+      }
+      if (header[1] == checkpoint_lsn + 1) {
+        found = true;
+        break;
+      }
+      pos += header[0];
+    }
+    offset += pos;
+  }
+  ASSERT_TRUE(found);
+
+  auto *header = reinterpret_cast<int32_t *>(log_data + pos);
+  EXPECT_EQ(checkpoint_lsn, header[3]);
+  EXPECT_EQ(static_cast<int32_t>(LogRecordType::END_CHECKPOINT), header[4]);
+  const char *data = log_data + pos + header_size;
+  lsn_t redo_lsn = *reinterpret_cast<const lsn_t *>(data);
+  data += sizeof(lsn_t);
+
+  // the active transaction table has txn1 with its last record, and nothing that had committed
+  int32_t txn_count = *reinterpret_cast<const int32_t *>(data);
+  data += sizeof(int32_t);
+  ASSERT_EQ(1, txn_count);
+  auto active_txn = *reinterpret_cast<const std::pair<txn_id_t, lsn_t> *>(data);
+  data += sizeof(active_txn);
+  EXPECT_EQ(txn1->GetTransactionId(), active_txn.first);
+  EXPECT_EQ(txn1_last_lsn, active_txn.second);
+
+  // the dirty page table has the pages txn1 changed, none of them changed before its recLSN
+  int32_t page_count = *reinterpret_cast<const int32_t *>(data);
+  data += sizeof(int32_t);
+  ASSERT_GT(page_count, 0);
+  bool has_first_page = false;
+  lsn_t min_rec_lsn = checkpoint_lsn;
+  for (int32_t i = 0; i < page_count; i++) {
+    auto dirty_page = *reinterpret_cast<const std::pair<page_id_t, lsn_t> *>(data);
+    data += sizeof(dirty_page);
+    has_first_page |= dirty_page.first == test_table->GetFirstPageId();
+    EXPECT_NE(INVALID_LSN, dirty_page.second);
+    EXPECT_LT(dirty_page.second, checkpoint_lsn);
+    min_rec_lsn = std::min(min_rec_lsn, dirty_page.second);
+  }
+  EXPECT_TRUE(has_first_page);
+  EXPECT_EQ(min_rec_lsn, redo_lsn);
+  delete[] log_data;
+
+  delete txn;
+  delete txn1;
+  delete txn2;
+  delete test_table;
+  delete bustub_instance;
+
+  RemoveDatabaseFiles("test.db");
+}
+
+// Transactions begin and commit while checkpoints are taken. Each checkpoint holds exactly the transactions whose
+// BEGIN record comes before it and whose COMMIT record comes after it.
+// NOLINTNEXTLINE
+TEST(RecoveryTest, ActiveTransactionTableTest) {
+  RemoveDatabaseFiles("test.db");
+  BustubInstance *bustub_instance = new BustubInstance("test.db");
+  bustub_instance->log_manager_->RunFlushThread();
+  ASSERT_TRUE(enable_logging);
+  TransactionManager *txn_mgr = bustub_instance->transaction_manager_;
+
+  const int num_threads = 4;
+  const int num_txns = 200;
+  std::vector<std::vector<std::tuple<txn_id_t, lsn_t, lsn_t>>> txns(num_threads);
+  std::atomic<bool> stop{false};
+  std::vector<std::thread> threads;
+  for (int tid = 0; tid < num_threads; tid++) {
+    threads.emplace_back([&, tid] {
+      for (int i = 0; i < num_txns; i++) {
+        Transaction *txn = txn_mgr->Begin();
+        EXPECT_TRUE(txn_mgr->Commit(txn));
+        txns[tid].emplace_back(txn->GetTransactionId(), txn->GetBeginLSN(), txn->GetEndLSN());
+        delete txn;
+      }
+    });
+  }
+
+  std::vector<std::pair<lsn_t, std::vector<std::pair<txn_id_t, lsn_t>>>> checkpoints;
+  std::thread checkpointer([&] {
+    while (!stop) {
+      LogRecord begin_record(INVALID_TXN_ID, INVALID_LSN, LogRecordType::BEGIN_CHECKPOINT);
+      lsn_t checkpoint_lsn = bustub_instance->log_manager_->AppendLogRecord(&begin_record);
+      std::vector<std::pair<txn_id_t, lsn_t>> active_txns;
+      txn_mgr->GetActiveTransactionTable(checkpoint_lsn, &active_txns);
+      checkpoints.emplace_back(checkpoint_lsn, std::move(active_txns));
+      std::this_thread::yield();
+    }
+  });
+  for (auto &thread : threads) {
+    thread.join();
+  }
+  stop = true;
+  checkpointer.join();
+
+  ASSERT_FALSE(checkpoints.empty());
+  for (const auto &checkpoint : checkpoints) {
+    std::set<txn_id_t> expected;
+    for (const auto &thread_txns : txns) {
+      for (const auto &txn : thread_txns) {
+        if (std::get<1>(txn) < checkpoint.first && std::get<2>(txn) > checkpoint.first) {
+          expected.insert(std::get<0>(txn));
+        }
+      }
+    }
+    std::set<txn_id_t> active;
+    for (const auto &active_txn : checkpoint.second) {
+      active.insert(active_txn.first);
+    }
+    EXPECT_EQ(expected, active);
+  }
+
+  delete bustub_instance;
+  RemoveDatabaseFiles("test.db");
+}
+
+// NOLINTNEXTLINE
+TEST(RecoveryTest, CheckpointRecoveryTest) {
+  RemoveDatabaseFiles("test.db");
+  BustubInstance *bustub_instance = new BustubInstance("test.db");
+  bustub_instance->log_manager_->RunFlushThread();
+  ASSERT_TRUE(enable_logging);
+
+  Transaction *txn = bustub_instance->transaction_manager_->Begin();
+  auto *test_table = new TableHeap(bustub_instance->buffer_pool_manager_, bustub_instance->lock_manager_,
+                                   bustub_instance->log_manager_, txn);
+  page_id_t first_page_id = test_table->GetFirstPageId();
+  bustub_instance->transaction_manager_->Commit(txn);
+  delete txn;
+
+  Column col1{"a", TypeId::VARCHAR, 20};
+  Column col2{"b", TypeId::SMALLINT};
+  std::vector<Column> cols{col1, col2};
+  Schema schema{cols};
+  Tuple tuple = ConstructTuple(&schema);
+
+  // committed before the checkpoint, so it is on disk and redo can skip it
+  std::vector<RID> committed_rids;
+  txn = bustub_instance->transaction_manager_->Begin();
+  for (int i = 0; i < 300; i++) {
+    RID rid;
+    ASSERT_TRUE(test_table->InsertTuple(tuple, &rid, txn));
+    committed_rids.push_back(rid);
+  }
+  bustub_instance->transaction_manager_->Commit(txn);
+  delete txn;
+
+  // the loser runs across the checkpoint, so its first changes are on disk and must be undone
+  std::vector<RID> loser_rids;
+  Transaction *loser = bustub_instance->transaction_manager_->Begin();
+  for (int i = 0; i < 20; i++) {
+    RID rid;
+    ASSERT_TRUE(test_table->InsertTuple(tuple, &rid, loser));
+    loser_rids.push_back(rid);
+  }
+
+  bustub_instance->checkpoint_manager_->BeginCheckpoint();
+  bustub_instance->checkpoint_manager_->EndCheckpoint();
+  lsn_t checkpoint_lsn = bustub_instance->disk_manager_->GetCheckpointLSN();
+  ASSERT_NE(INVALID_LSN, checkpoint_lsn);
+
+  // committed after the checkpoint, so it is only in the log
+  txn = bustub_instance->transaction_manager_->Begin();
+  for (int i = 0; i < 300; i++) {
+    RID rid;
+    ASSERT_TRUE(test_table->InsertTuple(tuple, &rid, txn));
+    committed_rids.push_back(rid);
+  }
+  bustub_instance->transaction_manager_->Commit(txn);
+  delete txn;
+  for (int i = 0; i < 20; i++) {
+    RID rid;
+    ASSERT_TRUE(test_table->InsertTuple(tuple, &rid, loser));
+    loser_rids.push_back(rid);
+  }
+
+  // crash without writing the pages
+  delete loser;
+  delete test_table;
+  delete bustub_instance;
+
+  bustub_instance = new BustubInstance("test.db");
+  EXPECT_EQ(checkpoint_lsn, bustub_instance->disk_manager_->GetCheckpointLSN());
+  auto *log_recovery = new LogRecovery(bustub_instance->disk_manager_, bustub_instance->buffer_pool_manager_);
+  log_recovery->Redo();
+  log_recovery->Undo();
+  delete log_recovery;
+
+  txn = bustub_instance->transaction_manager_->Begin();
+  test_table = new TableHeap(bustub_instance->buffer_pool_manager_, bustub_instance->lock_manager_,
+                             bustub_instance->log_manager_, first_page_id);
+  Tuple old_tuple;
+  for (const RID &rid : committed_rids) {
+    ASSERT_TRUE(test_table->GetTuple(rid, &old_tuple, txn));
+    EXPECT_EQ(old_tuple.GetValue(&schema, 0).CompareEquals(tuple.GetValue(&schema, 0)), CmpBool::CmpTrue);
+  }
+  for (const RID &rid : loser_rids) {
+    EXPECT_FALSE(test_table->GetTuple(rid, &old_tuple, txn));
+  }
+  bustub_instance->transaction_manager_->Commit(txn);
+  delete txn;
+  delete test_table;
+  delete bustub_instance;
+
+  RemoveDatabaseFiles("test.db");
+}
+
+// NOLINTNEXTLINE
+TEST(RecoveryTest, ParallelRedoTest) {
+  RemoveDatabaseFiles("test.db");
+  BustubInstance *bustub_instance = new BustubInstance("test.db");
+  bustub_instance->log_manager_->RunFlushThread();
+  ASSERT_TRUE(enable_logging);
+
+  Transaction *txn = bustub_instance->transaction_manager_->Begin();
+  auto *test_table = new TableHeap(bustub_instance->buffer_pool_manager_, bustub_instance->lock_manager_,
+                                   bustub_instance->log_manager_, txn);
+  page_id_t first_page_id = test_table->GetFirstPageId();
+  bustub_instance->transaction_manager_->Commit(txn);
+  delete txn;
+
+  Column col1{"a", TypeId::INTEGER};
+  Column col2{"b", TypeId::INTEGER};
+  std::vector<Column> cols{col1, col2};
+  Schema schema{cols};
+  auto make_tuple = [&](int32_t a) { return Tuple({Value(TypeId::INTEGER, a), Value(TypeId::INTEGER, -a)}, &schema); };
+
+  // spread inserts, updates and deletes over many pages, in several transactions
+  const int num_tuples = 5000;
+  std::vector<RID> rids(num_tuples);
+  for (int i = 0; i < num_tuples; i += 500) {
+    txn = bustub_instance->transaction_manager_->Begin();
+    for (int j = i; j < i + 500; j++) {
+      ASSERT_TRUE(test_table->InsertTuple(make_tuple(j), &rids[j], txn));
+    }
+    bustub_instance->transaction_manager_->Commit(txn);
+    delete txn;
+  }
+  txn = bustub_instance->transaction_manager_->Begin();
+  for (int i = 0; i < num_tuples; i++) {
+    if (i % 5 == 0) {
+      ASSERT_TRUE(test_table->MarkDelete(rids[i], txn));
+    } else if (i % 7 == 0) {
+      ASSERT_TRUE(test_table->UpdateTuple(make_tuple(i + num_tuples), rids[i], txn));
+    }
+  }
+  bustub_instance->transaction_manager_->Commit(txn);
+  delete txn;
+
+  // crash without writing the pages
+  delete test_table;
+  delete bustub_instance;
+
+  bustub_instance = new BustubInstance("test.db");
+  auto *log_recovery = new LogRecovery(bustub_instance->disk_manager_, bustub_instance->buffer_pool_manager_);
+  log_recovery->Redo(4);
+  log_recovery->Undo();
+  delete log_recovery;
+
+  txn = bustub_instance->transaction_manager_->Begin();
+  test_table = new TableHeap(bustub_instance->buffer_pool_manager_, bustub_instance->lock_manager_,
+                             bustub_instance->log_manager_, first_page_id);
+  Tuple tuple;
+  for (int i = 0; i < num_tuples; i++) {
+    if (i % 5 == 0) {
+      EXPECT_FALSE(test_table->GetTuple(rids[i], &tuple, txn));
+      continue;
+    }
+    ASSERT_TRUE(test_table->GetTuple(rids[i], &tuple, txn));
+    int32_t expected = i % 7 == 0 ? i + num_tuples : i;
+    EXPECT_EQ(expected, tuple.GetValue(&schema, 0).GetAs<int32_t>());
+  }
+  bustub_instance->transaction_manager_->Commit(txn);
+  delete txn;
+  delete test_table;
+  delete bustub_instance;
+
+  RemoveDatabaseFiles("test.db");
+}
+
+// NOLINTNEXTLINE
+TEST(RecoveryTest, CompressedUpdateTest) {
+  RemoveDatabaseFiles("test.db");
+  BustubInstance *bustub_instance = new BustubInstance("test.db");
+  bustub_instance->log_manager_->SetLogCompression(true);
+  bustub_instance->log_manager_->RunFlushThread();
+  ASSERT_TRUE(enable_logging);
+
+  Transaction *txn = bustub_instance->transaction_manager_->Begin();
+  auto *test_table = new TableHeap(bustub_instance->buffer_pool_manager_, bustub_instance->lock_manager_,
+                                   bustub_instance->log_manager_, txn);
+  page_id_t first_page_id = test_table->GetFirstPageId();
+
+  Column col1{"a", TypeId::INTEGER};
+  Column col2{"b", TypeId::VARCHAR, 300};
+  std::vector<Column> cols{col1, col2};
+  Schema schema{cols};
+  // the text makes the records big enough to compress, and the same in every version
+  std::string text(200, 'x');
+  auto make_tuple = [&](int32_t a, const std::string &b) {
+    return Tuple({Value(TypeId::INTEGER, a), Value(TypeId::VARCHAR, b)}, &schema);
+  };
+
+  const int num_tuples = 50;
+  std::vector<RID> rids(num_tuples);
+  for (int i = 0; i < num_tuples; i++) {
+    ASSERT_TRUE(test_table->InsertTuple(make_tuple(i, text), &rids[i], txn));
+  }
+  bustub_instance->transaction_manager_->Commit(txn);
+  delete txn;
+
+  // a winner changes a column, or grows the text
+  txn = bustub_instance->transaction_manager_->Begin();
+  for (int i = 0; i < num_tuples; i += 2) {
+    ASSERT_TRUE(test_table->UpdateTuple(make_tuple(i + 1000, text), rids[i], txn));
+  }
+  ASSERT_TRUE(test_table->UpdateTuple(make_tuple(1, text + "yyy"), rids[1], txn));
+  bustub_instance->transaction_manager_->Commit(txn);
+  delete txn;
+
+  // a loser changes them again, and its records reach the log through a later commit
+  Transaction *loser = bustub_instance->transaction_manager_->Begin();
+  for (int i = 0; i < num_tuples; i += 2) {
+    ASSERT_TRUE(test_table->UpdateTuple(make_tuple(i + 2000, text), rids[i], loser));
+  }
+  ASSERT_TRUE(test_table->UpdateTuple(make_tuple(1, "z"), rids[1], loser));
+  txn = bustub_instance->transaction_manager_->Begin();
+  bustub_instance->transaction_manager_->Commit(txn);
+  delete txn;
+
+  // crash without writing the pages
+  delete loser;
+  delete test_table;
+  delete bustub_instance;
+
+  bustub_instance = new BustubInstance("test.db");
+  auto *log_recovery = new LogRecovery(bustub_instance->disk_manager_, bustub_instance->buffer_pool_manager_);
+  log_recovery->Redo();
+  log_recovery->Undo();
+  delete log_recovery;
+
+  txn = bustub_instance->transaction_manager_->Begin();
+  test_table = new TableHeap(bustub_instance->buffer_pool_manager_, bustub_instance->lock_manager_,
+                             bustub_instance->log_manager_, first_page_id);
+  Tuple tuple;
+  for (int i = 0; i < num_tuples; i++) {
+    ASSERT_TRUE(test_table->GetTuple(rids[i], &tuple, txn));
+    int32_t expected = i % 2 == 0 ? i + 1000 : i;
+    EXPECT_EQ(expected, tuple.GetValue(&schema, 0).GetAs<int32_t>());
+    EXPECT_EQ(i == 1 ? text + "yyy" : text, tuple.GetValue(&schema, 1).ToString());
+  }
+  bustub_instance->transaction_manager_->Commit(txn);
+  delete txn;
+  delete test_table;
+  delete bustub_instance;
+
+  RemoveDatabaseFiles("test.db");
+}
+
+// Undo writes no compensation records, so a crash after its pages were written runs it again on tuples that are
+// reverted already.
+// NOLINTNEXTLINE
+TEST(RecoveryTest, RepeatedUndoTest) {
+  RemoveDatabaseFiles("test.db");
+  BustubInstance *bustub_instance = new BustubInstance("test.db");
+  bustub_instance->log_manager_->RunFlushThread();
+  ASSERT_TRUE(enable_logging);
+
+  Transaction *txn = bustub_instance->transaction_manager_->Begin();
+  auto *test_table = new TableHeap(bustub_instance->buffer_pool_manager_, bustub_instance->lock_manager_,
+                                   bustub_instance->log_manager_, txn);
+  page_id_t first_page_id = test_table->GetFirstPageId();
+
+  Column col1{"a", TypeId::INTEGER};
+  Column col2{"b", TypeId::VARCHAR, 300};
+  std::vector<Column> cols{col1, col2};
+  Schema schema{cols};
+  auto make_tuple = [&](int32_t a, const std::string &b) {
+    return Tuple({Value(TypeId::INTEGER, a), Value(TypeId::VARCHAR, b)}, &schema);
+  };
+  RID rid0;
+  RID rid1;
+  ASSERT_TRUE(test_table->InsertTuple(make_tuple(0, "x"), &rid0, txn));
+  ASSERT_TRUE(test_table->InsertTuple(make_tuple(1, "x"), &rid1, txn));
+  bustub_instance->transaction_manager_->Commit(txn);
+  delete txn;
+
+  // a loser changes a column and grows the text, and its records reach the log through a later commit
+  Transaction *loser = bustub_instance->transaction_manager_->Begin();
+  ASSERT_TRUE(test_table->UpdateTuple(make_tuple(1000, "x"), rid0, loser));
+  ASSERT_TRUE(test_table->UpdateTuple(make_tuple(1, "xyz"), rid1, loser));
+  txn = bustub_instance->transaction_manager_->Begin();
+  bustub_instance->transaction_manager_->Commit(txn);
+  delete txn;
+  delete loser;
+  delete test_table;
+  delete bustub_instance;
+
+  // the first recovery writes its pages before it crashes too, and the second one finds the updates undone
+  for (int i = 0; i < 2; i++) {
+    bustub_instance = new BustubInstance("test.db");
+    auto *log_recovery = new LogRecovery(bustub_instance->disk_manager_, bustub_instance->buffer_pool_manager_);
+    log_recovery->Redo();
+    log_recovery->Undo();
+    bustub_instance->buffer_pool_manager_->FlushAllPages();
+    delete log_recovery;
+
+    txn = bustub_instance->transaction_manager_->Begin();
+    test_table = new TableHeap(bustub_instance->buffer_pool_manager_, bustub_instance->lock_manager_,
+                               bustub_instance->log_manager_, first_page_id);
+    Tuple tuple;
+    ASSERT_TRUE(test_table->GetTuple(rid0, &tuple, txn));
+    EXPECT_EQ(0, tuple.GetValue(&schema, 0).GetAs<int32_t>());
+    ASSERT_TRUE(test_table->GetTuple(rid1, &tuple, txn));
+    EXPECT_EQ("x", tuple.GetValue(&schema, 1).ToString());
+    bustub_instance->transaction_manager_->Commit(txn);
+    delete txn;
+    delete test_table;
+    delete bustub_instance;
+  }
+
+  RemoveDatabaseFiles("test.db");
 }
 }  // namespace bustub
@@ -0,0 +1,95 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// tuple_delta_test.cpp
+//
+// Identification: test/recovery/tuple_delta_test.cpp
+//
+// Copyright (c) 2015-2019, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include <string>
+#include <vector>
+
+#include "catalog/schema.h"
+#include "gtest/gtest.h"
+#include "recovery/tuple_delta.h"
+#include "storage/table/tuple.h"
+#include "type/value.h"
+
+namespace bustub {
+
+/** Check that the delta turns each version into the other, also after a round trip through its serialized form. */
+static void CheckDelta(const Tuple &old_tuple, const Tuple &new_tuple) {
+  TupleDelta delta(old_tuple, new_tuple);
+  std::vector<char> buffer(delta.GetSerializedSize());
+  delta.SerializeTo(buffer.data());
+  TupleDelta result;
+  result.DeserializeFrom(buffer.data());
+
+  Tuple applied;
+  ASSERT_TRUE(result.Apply(old_tuple, &applied));
+  ASSERT_EQ(new_tuple.GetLength(), applied.GetLength());
+  EXPECT_EQ(0, memcmp(new_tuple.GetData(), applied.GetData(), new_tuple.GetLength()));
+  Tuple reverted;
+  ASSERT_TRUE(result.Revert(new_tuple, &reverted));
+  ASSERT_EQ(old_tuple.GetLength(), reverted.GetLength());
+  EXPECT_EQ(0, memcmp(old_tuple.GetData(), reverted.GetData(), old_tuple.GetLength()));
+}
+
+// NOLINTNEXTLINE
+TEST(TupleDeltaTest, DeltaTest) {
+  Column col1{"a", TypeId::INTEGER};
+  Column col2{"b", TypeId::VARCHAR, 300};
+  Column col3{"c", TypeId::BIGINT};
+  std::vector<Column> cols{col1, col2, col3};
+  Schema schema{cols};
+  auto make_tuple = [&](int32_t a, const std::string &b, int64_t c) {
+    return Tuple({Value(TypeId::INTEGER, a), Value(TypeId::VARCHAR, b), Value(TypeId::BIGINT, c)}, &schema);
+  };
+  std::string text(200, 'x');
+
+  // one column changes, so the delta is much smaller than the tuple
+  Tuple old_tuple = make_tuple(1, text, 2);
+  Tuple new_tuple = make_tuple(1, text, 3);
+  EXPECT_LT(TupleDelta(old_tuple, new_tuple).GetSerializedSize(), old_tuple.GetLength() / 4);
+  CheckDelta(old_tuple, new_tuple);
+
+  // changes at both ends
+  CheckDelta(make_tuple(1, text, 2), make_tuple(5, text, 6));
+  // no change at all
+  CheckDelta(old_tuple, old_tuple);
+  // the tuple grows and shrinks
+  CheckDelta(make_tuple(1, text, 2), make_tuple(1, text + "yyy", 2));
+  CheckDelta(make_tuple(1, text + "yyy", 2), make_tuple(1, "z", 2));
+}
+
+// A delta does not splice into a version it was not computed from, such as one it was spliced into already.
+// NOLINTNEXTLINE
+TEST(TupleDeltaTest, WrongVersionTest) {
+  Column col1{"a", TypeId::INTEGER};
+  Column col2{"b", TypeId::VARCHAR, 300};
+  std::vector<Column> cols{col1, col2};
+  Schema schema{cols};
+  auto make_tuple = [&](int32_t a, const std::string &b) {
+    return Tuple({Value(TypeId::INTEGER, a), Value(TypeId::VARCHAR, b)}, &schema);
+  };
+
+  Tuple result;
+  TupleDelta same_size(make_tuple(1, "x"), make_tuple(2, "x"));
+  EXPECT_FALSE(same_size.Apply(make_tuple(2, "x"), &result));
+  EXPECT_FALSE(same_size.Revert(make_tuple(1, "x"), &result));
+  EXPECT_FALSE(same_size.Revert(make_tuple(3, "x"), &result));
+
+  TupleDelta resized(make_tuple(1, "x"), make_tuple(1, "xyz"));
+  EXPECT_FALSE(resized.Apply(make_tuple(1, "xyz"), &result));
+  EXPECT_FALSE(resized.Revert(make_tuple(1, "x"), &result));
+  EXPECT_FALSE(resized.Revert(make_tuple(1, "abc"), &result));
+  ASSERT_TRUE(resized.Revert(make_tuple(1, "xyz"), &result));
+  EXPECT_EQ(1, result.GetValue(&schema, 0).GetAs<int32_t>());
+  EXPECT_EQ("x", result.GetValue(&schema, 1).ToString());
+}
+
+}  // namespace bustub
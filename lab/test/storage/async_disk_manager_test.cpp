@@ -0,0 +1,178 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// async_disk_manager_test.cpp
+//
+// Identification: test/storage/async_disk_manager_test.cpp
+//
+// Copyright (c) 2015-2019, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <thread>  // NOLINT
+#include <vector>
+
+#include "buffer/buffer_pool_manager.h"
+#include "gtest/gtest.h"
+#include "storage/disk/async_disk_manager.h"
+#include "storage/disk/database_files.h"
+
+namespace bustub {
+
+// NOLINTNEXTLINE
+TEST(AsyncDiskManagerTest, ReadWritePageTest) {
+  for (bool use_io_uring : {true, false}) {
+    char buf[PAGE_SIZE] = {0};
+    char data[PAGE_SIZE] = {0};
+    std::string db_file("test.db");
+    AsyncDiskManager dm(db_file, use_io_uring);
+    std::strncpy(data, "A test string.", sizeof(data));
+
+    dm.ReadPage(0, buf);  // tolerate empty read
+
+    dm.WritePage(0, data);
+    dm.ReadPage(0, buf);
+    EXPECT_EQ(std::memcmp(buf, data, sizeof(buf)), 0);
+
+    std::memset(buf, 0, sizeof(buf));
+    dm.WritePage(5, data);
+    dm.ReadPage(5, buf);
+    EXPECT_EQ(std::memcmp(buf, data, sizeof(buf)), 0);
+
+    dm.ShutDown();
+    RemoveDatabaseFiles(db_file);
+  }
+}
+
+// More I/Os than the queue holds can be submitted before waiting for any of them.
+// NOLINTNEXTLINE
+TEST(AsyncDiskManagerTest, ManyInFlightTest) {
+  const page_id_t num_pages = 3 * ASYNC_DISK_QUEUE_DEPTH;
+  for (bool use_io_uring : {true, false}) {
+    std::string db_file("test.db");
+    AsyncDiskManager dm(db_file, use_io_uring);
+
+    char data[PAGE_SIZE] = {0};
+    std::vector<AsyncDiskManager::request_id_t> writes;
+    for (page_id_t page_id = 0; page_id < num_pages; page_id++) {
+      snprintf(data, sizeof(data), "page %d", page_id);
+      writes.push_back(dm.SubmitWritePage(page_id, data));
+    }
+    for (auto request_id : writes) {
+      EXPECT_TRUE(dm.Wait(request_id));
+    }
+    EXPECT_EQ(num_pages, dm.GetNumWrites());
+
+    std::vector<std::vector<char>> pages(num_pages, std::vector<char>(PAGE_SIZE));
+    for (page_id_t page_id = num_pages - 1; page_id >= 0; page_id--) {
+      dm.SubmitReadPage(page_id, pages[page_id].data());
+    }
+    EXPECT_TRUE(dm.WaitAll());
+    for (page_id_t page_id = 0; page_id < num_pages; page_id++) {
+      EXPECT_EQ("page " + std::to_string(page_id), std::string(pages[page_id].data()));
+    }
+
+    dm.ShutDown();
+    RemoveDatabaseFiles(db_file);
+  }
+}
+
+// NOLINTNEXTLINE
+TEST(AsyncDiskManagerTest, WriteLogTest) {
+  for (bool use_io_uring : {true, false}) {
+    std::string db_file("test.db");
+    AsyncDiskManager dm(db_file, use_io_uring);
+
+    // Appends land in submission order, even when they are in flight together.
+    std::string expected;
+    std::vector<AsyncDiskManager::request_id_t> appends;
+    for (int i = 0; i < 100; i++) {
+      std::string record = "record " + std::to_string(i) + ";";
+      appends.push_back(dm.SubmitWriteLog(record.c_str(), record.size()));
+      expected += record;
+    }
+    EXPECT_TRUE(dm.WaitAll());
+
+    std::vector<char> buf(expected.size() + 1, 0);
+    EXPECT_TRUE(dm.ReadLog(buf.data(), expected.size(), 0));
+    EXPECT_EQ(expected, std::string(buf.data()));
+    EXPECT_FALSE(dm.ReadLog(buf.data(), 1, expected.size()));
+
+    dm.ShutDown();
+    RemoveDatabaseFiles(db_file);
+  }
+}
+
+// Threads submit and wait for I/Os at the same time, while completions come in.
+// NOLINTNEXTLINE
+TEST(AsyncDiskManagerTest, ConcurrentSubmitTest) {
+  const int num_threads = 8;
+  const page_id_t pages_per_thread = ASYNC_DISK_QUEUE_DEPTH;
+  for (bool use_io_uring : {true, false}) {
+    std::string db_file("test.db");
+    AsyncDiskManager dm(db_file, use_io_uring);
+
+    std::vector<std::thread> threads;
+    for (int tid = 0; tid < num_threads; tid++) {
+      threads.emplace_back([&dm, tid] {
+        char data[PAGE_SIZE] = {0};
+        std::vector<AsyncDiskManager::request_id_t> writes;
+        for (page_id_t i = 0; i < pages_per_thread; i++) {
+          page_id_t page_id = tid * pages_per_thread + i;
+          snprintf(data, sizeof(data), "page %d", page_id);
+          writes.push_back(dm.SubmitWritePage(page_id, data));
+        }
+        for (auto request_id : writes) {
+          EXPECT_TRUE(dm.Wait(request_id));
+        }
+        std::vector<char> buf(PAGE_SIZE);
+        for (page_id_t i = 0; i < pages_per_thread; i++) {
+          page_id_t page_id = tid * pages_per_thread + i;
+          EXPECT_TRUE(dm.Wait(dm.SubmitReadPage(page_id, buf.data())));
+          EXPECT_EQ("page " + std::to_string(page_id), std::string(buf.data()));
+        }
+      });
+    }
+    for (auto &thread : threads) {
+      thread.join();
+    }
+    EXPECT_EQ(num_threads * pages_per_thread, dm.GetNumWrites());
+
+    dm.ShutDown();
+    RemoveDatabaseFiles(db_file);
+  }
+}
+
+// The buffer pool runs on top of the asynchronous backend unchanged.
+// NOLINTNEXTLINE
+TEST(AsyncDiskManagerTest, BufferPoolTest) {
+  const size_t buffer_pool_size = 10;
+  std::string db_file("test.db");
+  auto *disk_manager = new AsyncDiskManager(db_file);
+  auto *bpm = new BufferPoolManager(buffer_pool_size, disk_manager);
+
+  for (size_t i = 0; i < 5 * buffer_pool_size; i++) {
+    page_id_t page_id;
+    Page *page = bpm->NewPage(&page_id);
+    ASSERT_NE(nullptr, page);
+    snprintf(page->GetData(), PAGE_SIZE, "page %d", page_id);
+    ASSERT_TRUE(bpm->UnpinPage(page_id, true));
+  }
+  for (page_id_t page_id = 0; page_id < static_cast<page_id_t>(5 * buffer_pool_size); page_id++) {
+    Page *page = bpm->FetchPage(page_id);
+    ASSERT_NE(nullptr, page);
+    EXPECT_EQ("page " + std::to_string(page_id), std::string(page->GetData()));
+    ASSERT_TRUE(bpm->UnpinPage(page_id, false));
+  }
+
+  delete bpm;
+  disk_manager->ShutDown();
+  delete disk_manager;
+  RemoveDatabaseFiles(db_file);
+}
+
+}  // namespace bustub
@@ -0,0 +1,144 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// disk_manager_benchmark_test.cpp
+//
+// Identification: test/storage/disk_manager_benchmark_test.cpp
+//
+// Copyright (c) 2015-2019, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include <atomic>
+#include <chrono>  // NOLINT
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <mutex>  // NOLINT
+#include <random>
+#include <string>
+#include <thread>  // NOLINT
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "storage/disk/database_files.h"
+#include "storage/disk/disk_manager.h"
+
+namespace bustub {
+
+// The page I/O path DiskManager used before it switched to pread/pwrite: one stream, whose cursor every read and
+// write moves, behind one mutex.
+class StreamPageFile {
+ public:
+  explicit StreamPageFile(const std::string &file_name) {
+    db_io_.open(file_name, std::ios::binary | std::ios::in | std::ios::out);
+  }
+
+  void WritePage(page_id_t page_id, const char *page_data) {
+    std::lock_guard<std::mutex> guard(latch_);
+    db_io_.seekp(static_cast<size_t>(page_id) * PAGE_SIZE);
+    db_io_.write(page_data, PAGE_SIZE);
+    db_io_.flush();
+  }
+
+  void ReadPage(page_id_t page_id, char *page_data) {
+    std::lock_guard<std::mutex> guard(latch_);
+    db_io_.seekp(static_cast<size_t>(page_id) * PAGE_SIZE);
+    db_io_.read(page_data, PAGE_SIZE);
+  }
+
+ private:
+  std::fstream db_io_;
+  std::mutex latch_;
+};
+
+// Runs random page reads and writes (one in ten) from 1 to 16 threads for a while, and returns the throughput of each
+// round.
+static std::vector<double> RunPageIO(const std::function<void(page_id_t, char *, bool)> &page_io, page_id_t num_pages) {
+  const auto duration = std::chrono::milliseconds(100);
+  std::vector<double> results;
+  for (size_t num_threads = 1; num_threads <= 16; num_threads *= 2) {
+    std::atomic<bool> stop{false};
+    std::atomic<uint64_t> total_ops{0};
+    std::vector<std::thread> threads;
+    for (size_t tid = 0; tid < num_threads; tid++) {
+      threads.emplace_back([&page_io, num_pages, &stop, &total_ops, tid] {
+        std::mt19937 rng(tid);
+        std::uniform_int_distribution<page_id_t> dist(0, num_pages - 1);
+        char data[PAGE_SIZE];
+        uint64_t ops = 0;
+        while (!stop) {
+          page_id_t page_id = dist(rng);
+          bool write = ops % 10 == 0;
+          if (write) {
+            snprintf(data, sizeof(data), "page %d", page_id);
+          }
+          page_io(page_id, data, write);
+          if (!write) {
+            EXPECT_EQ("page " + std::to_string(page_id), std::string(data));
+          }
+          ops++;
+        }
+        total_ops += ops;
+      });
+    }
+    auto start = std::chrono::steady_clock::now();
+    std::this_thread::sleep_for(duration);
+    stop = true;
+    for (auto &thread : threads) {
+      thread.join();
+    }
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    results.push_back(static_cast<double>(total_ops) / elapsed.count());
+  }
+  return results;
+}
+
+// Compares concurrent page I/O through a shared stream with positional I/O through DiskManager.
+TEST(DiskManagerBenchmark, ConcurrentPageIOTest) {
+  const std::string db_name = "test.db";
+  const page_id_t num_pages = 1024;
+
+  auto *disk_manager = new DiskManager(db_name);
+  char data[PAGE_SIZE] = {0};
+  for (page_id_t page_id = 0; page_id < num_pages; page_id++) {
+    snprintf(data, sizeof(data), "page %d", page_id);
+    disk_manager->WritePage(page_id, data);
+  }
+
+  auto *stream_file = new StreamPageFile(db_name);
+  std::vector<double> stream_results = RunPageIO(
+      [stream_file](page_id_t page_id, char *page_data, bool write) {
+        if (write) {
+          stream_file->WritePage(page_id, page_data);
+        } else {
+          stream_file->ReadPage(page_id, page_data);
+        }
+      },
+      num_pages);
+  delete stream_file;
+
+  std::vector<double> positional_results = RunPageIO(
+      [disk_manager](page_id_t page_id, char *page_data, bool write) {
+        if (write) {
+          disk_manager->WritePage(page_id, page_data);
+        } else {
+          disk_manager->ReadPage(page_id, page_data);
+        }
+      },
+      num_pages);
+
+  for (size_t i = 0, num_threads = 1; i < positional_results.size(); i++, num_threads *= 2) {
+    printf("%2zu threads: stream %10.0f pages/s, pread/pwrite %10.0f pages/s (%.2fx)\n", num_threads,
+           stream_results[i], positional_results[i], positional_results[i] / stream_results[i]);
+  }
+
+  disk_manager->ShutDown();
+  RemoveDatabaseFiles("test.db");
+
+  delete disk_manager;
+}
+
+}  // namespace bustub
@@ -10,11 +10,17 @@
 //
 //===----------------------------------------------------------------------===//
 
+#include <unistd.h>
+
 #include <cstring>
+#include <string>
+#include <vector>
 
 #include "common/exception.h"
 #include "gtest/gtest.h"
+#include "storage/disk/database_files.h"
 #include "storage/disk/disk_manager.h"
+#include "storage/disk/extent_reservation.h"
 
 namespace bustub {
 
@@ -38,7 +44,7 @@ TEST(DiskManagerTest, ReadWritePageTest) {
   EXPECT_EQ(std::memcmp(buf, data, sizeof(buf)), 0);
 
   dm.ShutDown();
-  remove(db_file.c_str());
+  RemoveDatabaseFiles(db_file);
 }
 
 TEST(DiskManagerTest, ReadWriteLogTest) {
@@ -55,7 +61,172 @@ TEST(DiskManagerTest, ReadWriteLogTest) {
   EXPECT_EQ(std::memcmp(buf, data, sizeof(buf)), 0);
 
   dm.ShutDown();
+  RemoveDatabaseFiles(db_file);
+}
+
+// Deallocated pages are handed out again, lowest first, also after a restart.
+// NOLINTNEXTLINE
+TEST(DiskManagerTest, FreePageReuseTest) {
+  char data[PAGE_SIZE] = {0};
+  std::string db_file("test.db");
+  RemoveDatabaseFiles(db_file);
+  {
+    DiskManager dm(db_file);
+    for (page_id_t i = 0; i < 10; i++) {
+      EXPECT_EQ(i, dm.AllocatePage());
+      dm.WritePage(i, data);
+    }
+    dm.DeallocatePage(7);
+    dm.DeallocatePage(3);
+    dm.DeallocatePage(3);  // ignored
+    EXPECT_EQ(2, dm.GetNumFreePages());
+    EXPECT_EQ(3, dm.AllocatePage());
+    EXPECT_EQ(7, dm.AllocatePage());
+    EXPECT_EQ(10, dm.AllocatePage());
+
+    dm.DeallocatePage(5);
+    dm.DeallocatePage(10);  // never written, so it lies beyond the end of the file
+    dm.ShutDown();
+  }
+
+  // The next page id comes from the file size, and the free page survived.
+  {
+    DiskManager dm(db_file);
+    EXPECT_EQ(1, dm.GetNumFreePages());
+    EXPECT_EQ(5, dm.AllocatePage());
+    EXPECT_EQ(10, dm.AllocatePage());
+    EXPECT_EQ(11, dm.AllocatePage());
+    dm.ShutDown();
+  }
+
+  // A new database file does not pick up the map of an old one.
   remove(db_file.c_str());
+  {
+    DiskManager dm(db_file);
+    dm.DeallocatePage(0);
+    EXPECT_EQ(0, dm.GetNumFreePages());
+    EXPECT_EQ(0, dm.AllocatePage());
+    dm.ShutDown();
+  }
+  RemoveDatabaseFiles(db_file);
+}
+
+// Extents come from a long enough run of free pages, or from the end of the file.
+// NOLINTNEXTLINE
+TEST(DiskManagerTest, AllocateExtentTest) {
+  std::string db_file("test.db");
+  RemoveDatabaseFiles(db_file);
+  DiskManager dm(db_file);
+
+  EXPECT_EQ(0, dm.AllocateExtent(8));
+  EXPECT_EQ(8, dm.AllocatePage());
+  EXPECT_EQ(9, dm.AllocateExtent(8));
+
+  // Free 2..5 and 11..13. Only the first run is long enough for an extent of four.
+  for (page_id_t page_id : {2, 3, 4, 5, 11, 12, 13}) {
+    dm.DeallocatePage(page_id);
+  }
+  EXPECT_EQ(2, dm.AllocateExtent(4));
+  EXPECT_EQ(17, dm.AllocateExtent(4));
+  EXPECT_EQ(3, dm.GetNumFreePages());
+  EXPECT_EQ(11, dm.AllocatePage());
+
+  // A reservation hands out the pages of its extents in order, and gives back the rest.
+  ExtentReservation extent(&dm, 4);
+  EXPECT_EQ(21, extent.AllocatePage());
+  EXPECT_EQ(22, extent.AllocatePage());
+  EXPECT_EQ(2, extent.GetNumReservedPages());
+  extent.Release();
+  EXPECT_EQ(0, extent.GetNumReservedPages());
+  EXPECT_EQ(4, dm.GetNumFreePages());
+  EXPECT_EQ(25, extent.AllocatePage());
+  extent.Release();
+
+  dm.ShutDown();
+  RemoveDatabaseFiles(db_file);
+}
+
+// The log is spread over fixed-size segments, which are found again on restart and recycled by TruncateLog.
+// NOLINTNEXTLINE
+TEST(DiskManagerTest, LogSegmentTest) {
+  std::string db_file("test.db");
+  RemoveDatabaseFiles(db_file);
+  const int record_size = 100;
+  const int records_per_write = 400;
+
+  // Records with a size and an LSN in their header, like the log manager writes.
+  std::string log;
+  auto append_records = [&](DiskManager *dm, int num_writes) {
+    static char buffers[2][record_size * records_per_write];
+    for (int write = 0; write < num_writes; write++) {
+      char *buffer = buffers[write % 2];
+      for (int i = 0; i < records_per_write; i++) {
+        int32_t header[2] = {record_size, static_cast<int32_t>(log.size() / record_size)};
+        std::string record(record_size, static_cast<char>('a' + header[1] % 26));
+        memcpy(&record[0], header, sizeof(header));
+        memcpy(buffer + i * record_size, record.data(), record_size);
+        log += record;
+      }
+      dm->WriteLog(buffer, record_size * records_per_write);
+    }
+  };
+  auto count_segment_files = [] {
+    int count = 0;
+    for (int i = 0; i < 10; i++) {
+      count += access(("test.log." + std::to_string(i)).c_str(), F_OK) == 0 ? 1 : 0;
+    }
+    return count;
+  };
+
+  auto *dm = new DiskManager(db_file);
+  append_records(dm, 100);
+  EXPECT_EQ(4, dm->GetNumLogSegments());
+  EXPECT_EQ(4, count_segment_files());
+
+  // Reads cross segment boundaries.
+  std::vector<char> buf(2 * record_size);
+  int offset = LOG_SEGMENT_DATA_SIZE - record_size;
+  EXPECT_TRUE(dm->ReadLog(buf.data(), buf.size(), offset));
+  EXPECT_EQ(log.substr(offset, buf.size()), std::string(buf.data(), buf.size()));
+
+  // The segment headers point at a record at or shortly before the LSN.
+  offset = dm->GetLogOffset(25000);
+  EXPECT_EQ(0, offset % record_size);
+  EXPECT_LE(offset, 25000 * record_size);
+  EXPECT_GT(offset, 25000 * record_size - LOG_SEGMENT_DATA_SIZE);
+
+  // The end of the log is found again after a restart.
+  dm->ShutDown();
+  delete dm;
+  dm = new DiskManager(db_file);
+  EXPECT_EQ(40000, dm->GetRecoveredNextLSN());
+  EXPECT_TRUE(dm->ReadLog(buf.data(), record_size, log.size() - record_size));
+  EXPECT_FALSE(dm->ReadLog(buf.data(), record_size, log.size()));
+
+  // Segments 0 and 1 end before the checkpoint, so they become spares.
+  dm->TruncateLog(25000 * record_size);
+  EXPECT_EQ(2, dm->GetNumLogSegments());
+  int start = dm->GetLogStartOffset();
+  EXPECT_EQ((2 * LOG_SEGMENT_DATA_SIZE + record_size - 1) / record_size * record_size, start);
+  EXPECT_FALSE(dm->ReadLog(buf.data(), record_size, 0));
+  EXPECT_TRUE(dm->ReadLog(buf.data(), record_size, start));
+  EXPECT_EQ(log.substr(start, record_size), std::string(buf.data(), record_size));
+
+  // New segments reuse the spares instead of creating files, and the stale log in them is not mistaken for records.
+  append_records(dm, 20);
+  EXPECT_EQ(3, dm->GetNumLogSegments());
+  EXPECT_EQ(4, count_segment_files());
+  dm->ShutDown();
+  delete dm;
+  dm = new DiskManager(db_file);
+  EXPECT_EQ(48000, dm->GetRecoveredNextLSN());
+  EXPECT_EQ(start, dm->GetLogStartOffset());
+  EXPECT_TRUE(dm->ReadLog(buf.data(), record_size, log.size() - record_size));
+  EXPECT_EQ(log.substr(log.size() - record_size), std::string(buf.data(), record_size));
+
+  dm->ShutDown();
+  delete dm;
+  RemoveDatabaseFiles(db_file);
 }
 
 TEST(DiskManagerTest, ThrowBadFileTest) { EXPECT_THROW(DiskManager("dev/null\\/foo/bar/baz/test.db"), Exception); }
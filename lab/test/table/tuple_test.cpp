@@ -19,6 +19,7 @@
 #include "buffer/buffer_pool_manager.h"
 #include "gtest/gtest.h"
 #include "logging/common.h"
+#include "storage/disk/database_files.h"
 #include "storage/table/table_heap.h"
 #include "storage/table/tuple.h"
 
@@ -64,11 +65,155 @@ TEST(TupleTest, DISABLED_TableHeapTest) {
     assert(table->MarkDelete(rid, transaction) == 1);
   }
   disk_manager->ShutDown();
-  remove("test.db");  // remove db file
-  remove("test.log");
+  RemoveDatabaseFiles("test.db");
   delete table;
   delete buffer_pool_manager;
   delete disk_manager;
 }
 
+// NOLINTNEXTLINE
+TEST(TupleTest, TableHeapReadAheadTest) {
+  Column col1{"a", TypeId::VARCHAR, 20};
+  Column col2{"b", TypeId::BIGINT};
+  std::vector<Column> cols{col1, col2};
+  Schema schema{cols};
+  Tuple tuple = ConstructTuple(&schema);
+
+  auto *transaction = new Transaction(0);
+  auto *disk_manager = new DiskManager("test.db");
+  auto *buffer_pool_manager = new BufferPoolManager(32, disk_manager);
+  auto *lock_manager = new LockManager(TwoPLMode::REGULAR, DeadlockMode::PREVENTION);
+  auto *log_manager = new LogManager(disk_manager);
+  auto *table = new TableHeap(buffer_pool_manager, lock_manager, log_manager, transaction);
+
+  // Make the table several times larger than the buffer pool.
+  const int num_tuples = 6000;
+  for (int i = 0; i < num_tuples; ++i) {
+    RID rid;
+    ASSERT_TRUE(table->InsertTuple(tuple, &rid, transaction));
+  }
+
+  // Scan through the pool and through a ring, both reading ahead.
+  for (bool use_strategy : {false, true}) {
+    auto strategy = buffer_pool_manager->GetAccessStrategy(AccessStrategyType::BULK_READ);
+    BufferAccessStrategy *scan_strategy = use_strategy ? strategy.get() : nullptr;
+    int count = 0;
+    for (auto itr = table->Begin(transaction, scan_strategy); itr != table->End(); ++itr) {
+      count++;
+    }
+    EXPECT_EQ(num_tuples, count);
+  }
+
+  // Without read-ahead, the scan sees the same tuples.
+  table->SetReadAheadDistance(0);
+  int count = 0;
+  for (auto itr = table->Begin(transaction); itr != table->End(); ++itr) {
+    count++;
+  }
+  EXPECT_EQ(num_tuples, count);
+
+  delete table;
+  disk_manager->ShutDown();
+  RemoveDatabaseFiles("test.db");
+  delete log_manager;
+  delete lock_manager;
+  delete buffer_pool_manager;
+  delete disk_manager;
+  delete transaction;
+}
+
+// Tables that grow side by side each get their own extents, so each page chain runs through contiguous pages.
+// NOLINTNEXTLINE
+TEST(TupleTest, TableHeapExtentTest) {
+  Column col1{"a", TypeId::VARCHAR, 20};
+  Column col2{"b", TypeId::BIGINT};
+  std::vector<Column> cols{col1, col2};
+  Schema schema{cols};
+  Tuple tuple = ConstructTuple(&schema);
+
+  auto *transaction = new Transaction(0);
+  auto *disk_manager = new DiskManager("test.db");
+  auto *buffer_pool_manager = new BufferPoolManager(32, disk_manager);
+  auto *lock_manager = new LockManager(TwoPLMode::REGULAR, DeadlockMode::PREVENTION);
+  auto *log_manager = new LogManager(disk_manager);
+  auto *table1 = new TableHeap(buffer_pool_manager, lock_manager, log_manager, transaction);
+  auto *table2 = new TableHeap(buffer_pool_manager, lock_manager, log_manager, transaction);
+
+  for (int i = 0; i < 2000; ++i) {
+    RID rid;
+    ASSERT_TRUE(table1->InsertTuple(tuple, &rid, transaction));
+    ASSERT_TRUE(table2->InsertTuple(tuple, &rid, transaction));
+  }
+
+  for (TableHeap *table : {table1, table2}) {
+    size_t num_pages = 0;
+    page_id_t page_id = table->GetFirstPageId();
+    while (page_id != INVALID_PAGE_ID) {
+      EXPECT_EQ(table->GetFirstPageId() + static_cast<page_id_t>(num_pages), page_id);
+      auto *page = static_cast<TablePage *>(buffer_pool_manager->FetchPage(page_id));
+      ASSERT_NE(nullptr, page);
+      page_id_t next_page_id = page->GetNextPageId();
+      buffer_pool_manager->UnpinPage(page_id, false);
+      page_id = next_page_id;
+      num_pages++;
+    }
+    EXPECT_LT(1, num_pages);
+    EXPECT_GT(EXTENT_SIZE, num_pages);
+  }
+  EXPECT_EQ(table1->GetFirstPageId() + static_cast<page_id_t>(EXTENT_SIZE), table2->GetFirstPageId());
+
+  delete table2;
+  delete table1;
+  disk_manager->ShutDown();
+  RemoveDatabaseFiles("test.db");
+  delete log_manager;
+  delete lock_manager;
+  delete buffer_pool_manager;
+  delete disk_manager;
+  delete transaction;
+}
+
+// A table that goes away gives back the rest of its extent, so the pages it never used are free after a restart.
+// NOLINTNEXTLINE
+TEST(TupleTest, TableHeapExtentReleaseTest) {
+  Column col1{"a", TypeId::VARCHAR, 20};
+  Column col2{"b", TypeId::BIGINT};
+  std::vector<Column> cols{col1, col2};
+  Schema schema{cols};
+  Tuple tuple = ConstructTuple(&schema);
+
+  RemoveDatabaseFiles("test.db");
+  auto *transaction = new Transaction(0);
+  auto *disk_manager = new DiskManager("test.db");
+  auto *buffer_pool_manager = new BufferPoolManager(32, disk_manager);
+  auto *lock_manager = new LockManager(TwoPLMode::REGULAR, DeadlockMode::PREVENTION);
+  auto *log_manager = new LogManager(disk_manager);
+
+  // The second table's extent comes after the first one's, so the unused pages of the first are inside the file.
+  auto *table1 = new TableHeap(buffer_pool_manager, lock_manager, log_manager, transaction);
+  auto *table2 = new TableHeap(buffer_pool_manager, lock_manager, log_manager, transaction);
+  RID rid;
+  ASSERT_TRUE(table1->InsertTuple(tuple, &rid, transaction));
+  ASSERT_TRUE(table2->InsertTuple(tuple, &rid, transaction));
+  page_id_t first_page_id = table1->GetFirstPageId();
+  EXPECT_EQ(first_page_id + static_cast<page_id_t>(EXTENT_SIZE), table2->GetFirstPageId());
+  delete table2;
+  delete table1;
+  buffer_pool_manager->FlushAllPages();
+  disk_manager->ShutDown();
+  delete log_manager;
+  delete lock_manager;
+  delete buffer_pool_manager;
+  delete disk_manager;
+
+  // Only the first page of each extent was used. The rest of the second extent is past the end of the file.
+  disk_manager = new DiskManager("test.db");
+  EXPECT_EQ(EXTENT_SIZE - 1, disk_manager->GetNumFreePages());
+  EXPECT_EQ(first_page_id + 1, disk_manager->AllocatePage());
+  disk_manager->ShutDown();
+  delete disk_manager;
+  delete transaction;
+  RemoveDatabaseFiles("test.db");
+}
+
 }  // namespace bustub